@@ -0,0 +1,597 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * End-to-end benchmark, run against a live dwm (normally on a private Xvfb,
+ * see bench-dwm.sh).
+ *
+ * Maps up to N test clients and, at each client count, times:
+ *   map      map request until dwm has mapped the client;
+ *   view     IPC "view" round-trip, alternating between tags 1 and 2;
+ *   layout   IPC "setlayoutex" round-trip, alternating tile and monocle;
+ *   title    _NET_WM_NAME change until the bar is repainted (DAMAGE);
+ *   alttab   Alt+Tab press (XTEST) until the switcher window is mapped;
+ *   ipc      IPC "enableurgency" round-trip, the cost of a trivial command;
+ *
+ * usage: bench-dwm -s socket [-n 10,100,500] [-r repeats] [-c class]
+ *                  [-t title] [-i iconsize] [-j]
+ *   -s  dwm's IPC socket
+ *   -n  client counts to measure at, ascending
+ *   -r  samples per measurement at each client count
+ *   -c  WM_CLASS of the test clients
+ *   -t  title prefix of the test clients
+ *   -i  _NET_WM_ICON size of the test clients, 0 for none
+ *   -j  print the results as JSON instead of a table
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+#include <xcb/damage.h>
+#include <xcb/xtest.h>
+
+#define LENGTH(X)               (sizeof (X) / sizeof (X)[0])
+
+#define MAXCOUNTS               16
+#define TIMEOUT                 2000		// ms to wait for dwm before a sample fails;
+
+#define IPC_MAGIC               "DWM-IPC"
+#define IPC_MAGIC_LEN           7
+#define IPC_TYPE_RUN_COMMAND    0
+
+enum { MetricMap, MetricView, MetricLayout, MetricTitle, MetricAltTab, MetricIPC, MetricLast };
+
+static const char *metricnames[MetricLast] = {
+	[MetricMap] = "map",
+	[MetricView] = "view",
+	[MetricLayout] = "layout",
+	[MetricTitle] = "title",
+	[MetricAltTab] = "alttab",
+	[MetricIPC] = "ipc",
+};
+
+typedef struct {
+	double *samples;
+	unsigned int n, size;
+	unsigned int failed;
+} Samples;
+
+static Samples results[MAXCOUNTS][MetricLast];
+static unsigned int counts[MAXCOUNTS] = { 10, 100, 500 };
+static unsigned int ncounts = 3;
+static unsigned int repeats = 20;
+static const char *wmclass = "bench";
+static const char *title = "bench client";
+static unsigned int iconsize = 32;
+static int json = 0;
+
+static xcb_connection_t *conn;
+static xcb_screen_t *screen;
+static xcb_window_t *clients;
+static unsigned int nclients;
+static xcb_window_t bar;
+static xcb_damage_damage_t damage;
+static uint8_t damageevent;
+static xcb_atom_t netwmname, netwmicon, utf8string;
+static xcb_keycode_t altkey, tabkey;
+static int ipcfd = -1;
+
+static void
+die(const char *msg)
+{
+	fprintf(stderr, "bench-dwm: %s\n", msg);
+	exit(1);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void
+addsample(Samples *s, double ms)
+{
+	if (ms < 0) {
+		s->failed++;
+		return;
+	}
+	if (s->n == s->size) {
+		s->size = s->size ? s->size * 2 : 64;
+		if (!(s->samples = realloc(s->samples, s->size * sizeof(double))))
+			die("out of memory");
+	}
+	s->samples[s->n++] = ms;
+}
+
+static int
+cmpdouble(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static double
+quantile(const Samples *s, double q)
+{
+	unsigned int i = q * s->n;
+	return s->n ? s->samples[i < s->n ? i : s->n - 1] : 0;
+}
+
+static double
+mean(const Samples *s)
+{
+	double total = 0;
+	unsigned int i;
+
+	for (i = 0; i < s->n; i++)
+		total += s->samples[i];
+	return s->n ? total / s->n : 0;
+}
+
+// waits for the first event accepted by match, discarding the rest;
+// returns the ms elapsed since start, or -1 if dwm didn't respond in time;
+static double
+waitfor(double start, int (*match)(xcb_generic_event_t *ev, xcb_window_t w), xcb_window_t w)
+{
+	struct pollfd pfd = { .fd = xcb_get_file_descriptor(conn), .events = POLLIN };
+	xcb_generic_event_t *ev;
+	double t;
+	int found;
+
+	for (;;) {
+		while ((ev = xcb_poll_for_event(conn))) {
+			found = match(ev, w);
+			free(ev);
+			if (found)
+				return now() - start;
+		}
+		if (xcb_connection_has_error(conn))
+			die("lost the X connection");
+		t = TIMEOUT - (now() - start);
+		if (t <= 0 || poll(&pfd, 1, (int)t) == 0)
+			return -1;
+	}
+}
+
+static int
+ismapped(xcb_generic_event_t *ev, xcb_window_t w)
+{
+	return (ev->response_type & ~0x80) == XCB_MAP_NOTIFY
+		&& ((xcb_map_notify_event_t *)ev)->window == w;
+}
+
+static int
+isunmapped(xcb_generic_event_t *ev, xcb_window_t w)
+{
+	uint8_t type = ev->response_type & ~0x80;
+	return (type == XCB_UNMAP_NOTIFY && ((xcb_unmap_notify_event_t *)ev)->window == w)
+		|| (type == XCB_DESTROY_NOTIFY && ((xcb_destroy_notify_event_t *)ev)->window == w);
+}
+
+static int
+isdamaged(xcb_generic_event_t *ev, xcb_window_t w)
+{
+	if ((ev->response_type & ~0x80) != damageevent + XCB_DAMAGE_NOTIFY)
+		return 0;
+	xcb_damage_subtract(conn, damage, XCB_NONE, XCB_NONE);
+	return ((xcb_damage_notify_event_t *)ev)->drawable == w;
+}
+
+static xcb_window_t switcher;
+
+// the switcher is told apart from dwm's other override-redirect windows, such
+// as the bars and the focus window, by its WM_CLASS: "dwm", "dwm-*-switcher";
+static int
+isswitcher(xcb_generic_event_t *ev, xcb_window_t w)
+{
+	static const char *classes[] = { "dwm-alttab-switcher", "dwm-client-switcher" };
+	xcb_map_notify_event_t *e = (xcb_map_notify_event_t *)ev;
+	xcb_get_property_reply_t *r;
+	const char *v;
+	int len, n, match = 0;
+	unsigned int i;
+
+	if ((ev->response_type & ~0x80) != XCB_MAP_NOTIFY || !e->override_redirect)
+		return 0;
+	r = xcb_get_property_reply(conn, xcb_get_property(conn, 0, e->window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 64), NULL);
+	if (!r)
+		return 0;
+	v = xcb_get_property_value(r);
+	len = xcb_get_property_value_length(r);
+	n = strnlen(v, len);
+	if (n == 3 && !strncmp(v, "dwm", 3) && n < len)
+		for (i = 0; i < LENGTH(classes); i++)
+			if (strnlen(v + n + 1, len - n - 1) == strlen(classes[i]) && !strncmp(v + n + 1, classes[i], len - n - 1))
+				match = 1;
+	free(r);
+	if (match)
+		switcher = e->window;
+	return match;
+}
+
+static int
+isnothing(xcb_generic_event_t *ev, xcb_window_t w)
+{
+	return 0;
+}
+
+// lets dwm finish whatever the last measurement set off;
+static void
+settle(void)
+{
+	free(xcb_get_input_focus_reply(conn, xcb_get_input_focus(conn), NULL));
+	waitfor(now() - TIMEOUT + 50, isnothing, XCB_NONE);
+}
+
+static xcb_atom_t
+atom(const char *name)
+{
+	xcb_intern_atom_reply_t *r;
+	xcb_atom_t a = XCB_NONE;
+
+	r = xcb_intern_atom_reply(conn, xcb_intern_atom(conn, 0, strlen(name), name), NULL);
+	if (r) {
+		a = r->atom;
+		free(r);
+	}
+	return a;
+}
+
+static xcb_keycode_t
+keycode(xcb_keysym_t sym)
+{
+	const xcb_setup_t *setup = xcb_get_setup(conn);
+	xcb_get_keyboard_mapping_reply_t *r;
+	xcb_keysym_t *syms;
+	xcb_keycode_t code = 0;
+	int i, n;
+
+	r = xcb_get_keyboard_mapping_reply(conn, xcb_get_keyboard_mapping(conn,
+		setup->min_keycode, setup->max_keycode - setup->min_keycode + 1), NULL);
+	if (!r)
+		return 0;
+	syms = xcb_get_keyboard_mapping_keysyms(r);
+	n = xcb_get_keyboard_mapping_keysyms_length(r);
+	for (i = 0; i < n; i++)
+		if (syms[i] == sym) {
+			code = setup->min_keycode + i / r->keysyms_per_keycode;
+			break;
+		}
+	free(r);
+	return code;
+}
+
+// dwm's bar windows carry the WM_CLASS "dwm", "dwm";
+static xcb_window_t
+findbar(void)
+{
+	xcb_query_tree_reply_t *tree;
+	xcb_get_property_reply_t *p;
+	xcb_window_t *children, found = XCB_NONE;
+	int i, n;
+
+	tree = xcb_query_tree_reply(conn, xcb_query_tree(conn, screen->root), NULL);
+	if (!tree)
+		return XCB_NONE;
+	children = xcb_query_tree_children(tree);
+	n = xcb_query_tree_children_length(tree);
+	for (i = 0; i < n && !found; i++) {
+		p = xcb_get_property_reply(conn, xcb_get_property(conn, 0, children[i],
+			XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 8), NULL);
+		if (p && xcb_get_property_value_length(p) == 8
+		&& !memcmp(xcb_get_property_value(p), "dwm\0dwm\0", 8))
+			found = children[i];
+		free(p);
+	}
+	free(tree);
+	return found;
+}
+
+static void
+settitle(xcb_window_t w, const char *name)
+{
+	xcb_change_property(conn, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_NAME,
+		XCB_ATOM_STRING, 8, strlen(name), name);
+	xcb_change_property(conn, XCB_PROP_MODE_REPLACE, w, netwmname,
+		utf8string, 8, strlen(name), name);
+}
+
+static xcb_window_t
+createclient(unsigned int i)
+{
+	xcb_window_t w = xcb_generate_id(conn);
+	char name[256], class[256];
+	uint32_t *icon;
+	size_t len;
+	unsigned int p;
+
+	xcb_create_window(conn, XCB_COPY_FROM_PARENT, w, screen->root, 0, 0, 400, 300, 0,
+		XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual, XCB_CW_BACK_PIXEL,
+		(uint32_t[]){ screen->white_pixel });
+
+	// WM_CLASS is instance and class, each NUL terminated;
+	len = snprintf(class, sizeof class, "%s", wmclass) + 1;
+	len += snprintf(class + len, sizeof class - len, "%s", wmclass) + 1;
+	xcb_change_property(conn, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_CLASS,
+		XCB_ATOM_STRING, 8, len, class);
+
+	snprintf(name, sizeof name, "%s %u", title, i);
+	settitle(w, name);
+
+	if (iconsize) {
+		if (!(icon = malloc((2 + iconsize * iconsize) * sizeof(uint32_t))))
+			die("out of memory");
+		icon[0] = icon[1] = iconsize;
+		for (p = 0; p < iconsize * iconsize; p++)
+			icon[2 + p] = 0xff000000 | ((i * 0x9e3779b9u >> 8) ^ p);
+		xcb_change_property(conn, XCB_PROP_MODE_REPLACE, w, netwmicon,
+			XCB_ATOM_CARDINAL, 32, 2 + iconsize * iconsize, icon);
+		free(icon);
+	}
+	return w;
+}
+
+static void
+ipcconnect(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (strlen(path) >= sizeof addr.sun_path)
+		die("socket path too long");
+	strcpy(addr.sun_path, path);
+	if ((ipcfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+	|| connect(ipcfd, (struct sockaddr *)&addr, sizeof addr) < 0)
+		die("cannot connect to dwm's IPC socket");
+}
+
+static int
+ipcio(int out, void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t n;
+
+	while (len) {
+		n = out ? write(ipcfd, p, len) : read(ipcfd, p, len);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// sends a run_command message and waits for its reply;
+// returns the round-trip in ms, or -1 on failure;
+static double
+ipccommand(const char *command, const char *args)
+{
+	char msg[512], hdr[IPC_MAGIC_LEN + 5], *reply;
+	uint32_t size;
+	double start;
+
+	size = snprintf(msg, sizeof msg, "{\"command\":\"%s\",\"args\":[%s]}", command, args) + 1;
+	memcpy(hdr, IPC_MAGIC, IPC_MAGIC_LEN);
+	memcpy(hdr + IPC_MAGIC_LEN, &size, 4);
+	hdr[IPC_MAGIC_LEN + 4] = IPC_TYPE_RUN_COMMAND;
+
+	start = now();
+	if (ipcio(1, hdr, sizeof hdr) < 0 || ipcio(1, msg, size) < 0
+	|| ipcio(0, hdr, sizeof hdr) < 0)
+		die("lost the IPC connection");
+	memcpy(&size, hdr + IPC_MAGIC_LEN, 4);
+	if (!(reply = malloc(size)) || ipcio(0, reply, size) < 0)
+		die("lost the IPC connection");
+	free(reply);
+	return now() - start;
+}
+
+static void
+measure(Samples *res, unsigned int target)
+{
+	xcb_get_input_focus_reply_t *focus;
+	xcb_window_t w;
+	char name[256];
+	double start;
+	unsigned int i;
+
+	// map to managed, mapping clients one at a time up to the target count;
+	for (; nclients < target; nclients++) {
+		clients[nclients] = createclient(nclients);
+		start = now();
+		xcb_map_window(conn, clients[nclients]);
+		xcb_flush(conn);
+		addsample(&res[MetricMap], waitfor(start, ismapped, clients[nclients]));
+	}
+	settle();
+
+	for (i = 0; i < repeats; i++) {
+		addsample(&res[MetricView], ipccommand("view", i % 2 ? "1" : "2"));
+		settle();
+	}
+	ipccommand("view", "1");
+	settle();
+
+	for (i = 0; i < repeats; i++) {
+		addsample(&res[MetricLayout], ipccommand("setlayoutex", i % 2 ? "\"[]=\"" : "\"[M]\""));
+		settle();
+	}
+	ipccommand("setlayoutex", "\"[]=\"");
+	settle();
+
+	// the bar shows the title of the focused client;
+	focus = xcb_get_input_focus_reply(conn, xcb_get_input_focus(conn), NULL);
+	w = focus ? focus->focus : XCB_NONE;
+	free(focus);
+	for (i = 0; bar && i < repeats && w != XCB_NONE; i++) {
+		snprintf(name, sizeof name, "%s %u/%u", title, target, i);
+		start = now();
+		settitle(w, name);
+		xcb_flush(conn);
+		addsample(&res[MetricTitle], waitfor(start, isdamaged, bar));
+		settle();
+	}
+
+	for (i = 0; altkey && tabkey && i < repeats; i++) {
+		switcher = XCB_NONE;
+		start = now();
+		xcb_test_fake_input(conn, XCB_KEY_PRESS, altkey, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+		xcb_test_fake_input(conn, XCB_KEY_PRESS, tabkey, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+		xcb_flush(conn);
+		addsample(&res[MetricAltTab], waitfor(start, isswitcher, XCB_NONE));
+		xcb_test_fake_input(conn, XCB_KEY_RELEASE, tabkey, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+		xcb_test_fake_input(conn, XCB_KEY_RELEASE, altkey, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+		xcb_flush(conn);
+		if (switcher)
+			waitfor(now(), isunmapped, switcher);
+		settle();
+	}
+
+	for (i = 0; i < repeats; i++)
+		addsample(&res[MetricIPC], ipccommand("enableurgency", "1"));
+}
+
+static void
+printtable(void)
+{
+	unsigned int i, m;
+	Samples *s;
+
+	printf("%-8s %8s %8s %6s %10s %10s %10s %10s\n",
+		"metric", "clients", "samples", "failed", "mean ms", "p50 ms", "p99 ms", "max ms");
+	for (m = 0; m < MetricLast; m++)
+		for (i = 0; i < ncounts; i++) {
+			s = &results[i][m];
+			if (!s->n && !s->failed)
+				continue;
+			printf("%-8s %8u %8u %6u %10.3f %10.3f %10.3f %10.3f\n",
+				metricnames[m], counts[i], s->n, s->failed,
+				mean(s), quantile(s, 0.5), quantile(s, 0.99), quantile(s, 1));
+		}
+}
+
+static void
+printjson(void)
+{
+	unsigned int i, m;
+	Samples *s;
+	int first = 1;
+
+	printf("[");
+	for (m = 0; m < MetricLast; m++)
+		for (i = 0; i < ncounts; i++) {
+			s = &results[i][m];
+			if (!s->n && !s->failed)
+				continue;
+			printf("%s\n  {\"metric\": \"%s\", \"clients\": %u, \"samples\": %u, \"failed\": %u, "
+				"\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+				first ? "" : ",", metricnames[m], counts[i], s->n, s->failed,
+				mean(s), quantile(s, 0.5), quantile(s, 0.99), quantile(s, 1));
+			first = 0;
+		}
+	printf("\n]\n");
+}
+
+static void
+usage(void)
+{
+	die("usage: bench-dwm -s socket [-n 10,100,500] [-r repeats] [-c class] "
+		"[-t title] [-i iconsize] [-j]");
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *sockpath = NULL;
+	const xcb_query_extension_reply_t *ext;
+	char *p, *end;
+	unsigned int i, m;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:n:r:c:t:i:j")) != -1) {
+		switch (opt) {
+		case 's': sockpath = optarg; break;
+		case 'n':
+			for (ncounts = 0, p = optarg; *p && ncounts < MAXCOUNTS; p = *end ? end + 1 : end) {
+				counts[ncounts] = strtoul(p, &end, 10);
+				if (end == p || (ncounts && counts[ncounts] < counts[ncounts - 1]))
+					usage();
+				ncounts++;
+			}
+			break;
+		case 'r': repeats = strtoul(optarg, NULL, 10); break;
+		case 'c': wmclass = optarg; break;
+		case 't': title = optarg; break;
+		case 'i': iconsize = strtoul(optarg, NULL, 10); break;
+		case 'j': json = 1; break;
+		default: usage();
+		}
+	}
+	if (!sockpath || !ncounts)
+		usage();
+
+	conn = xcb_connect(NULL, NULL);
+	if (xcb_connection_has_error(conn))
+		die("cannot open display");
+	screen = xcb_setup_roots_iterator(xcb_get_setup(conn)).data;
+
+	ext = xcb_get_extension_data(conn, &xcb_test_id);
+	if (!ext || !ext->present)
+		die("the X server lacks the XTEST extension");
+	ext = xcb_get_extension_data(conn, &xcb_damage_id);
+	if (!ext || !ext->present)
+		die("the X server lacks the DAMAGE extension");
+	damageevent = ext->first_event;
+	free(xcb_damage_query_version_reply(conn, xcb_damage_query_version(conn,
+		XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION), NULL));
+
+	netwmname = atom("_NET_WM_NAME");
+	netwmicon = atom("_NET_WM_ICON");
+	utf8string = atom("UTF8_STRING");
+	altkey = keycode(0xffe9);		// XK_Alt_L;
+	tabkey = keycode(0xff09);		// XK_Tab;
+
+	// dwm owns SubstructureRedirect; SubstructureNotify may be shared;
+	xcb_change_window_attributes(conn, screen->root, XCB_CW_EVENT_MASK,
+		(uint32_t[]){ XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY });
+
+	if ((bar = findbar())) {
+		damage = xcb_generate_id(conn);
+		xcb_damage_create(conn, damage, bar, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+	}
+	else
+		fprintf(stderr, "bench-dwm: no bar window found, skipping title\n");
+
+	ipcconnect(sockpath);
+
+	if (!(clients = calloc(counts[ncounts - 1], sizeof(xcb_window_t))))
+		die("out of memory");
+	for (i = 0; i < ncounts; i++) {
+		measure(results[i], counts[i]);
+		for (m = 0; m < MetricLast; m++)
+			if (results[i][m].n)
+				qsort(results[i][m].samples, results[i][m].n, sizeof(double), cmpdouble);
+	}
+
+	if (json)
+		printjson();
+	else
+		printtable();
+
+	for (i = 0; i < nclients; i++)
+		xcb_destroy_window(conn, clients[i]);
+	xcb_disconnect(conn);
+	close(ipcfd);
+	return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# Runs bench-dwm against the dwm in the current directory, on a private Xvfb
+# and with a private HOME and IPC socket, so the user's session is untouched.
+#
+# usage: bench/bench-dwm.sh [bench-dwm options]
+
+dir=$(dirname "$0")
+tmp=$(mktemp -d) || exit 1
+xpid=
+wpid=
+
+cleanup() {
+	[ -n "$wpid" ] && kill "$wpid" 2>/dev/null
+	[ -n "$xpid" ] && kill "$xpid" 2>/dev/null
+	wait 2>/dev/null
+	rm -rf "$tmp"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# -displayfd writes the display number once the server accepts connections;
+Xvfb -displayfd 3 -screen 0 1920x1080x24 -nolisten tcp 3>"$tmp/display" 2>"$tmp/xvfb.log" &
+xpid=$!
+i=0
+while [ ! -s "$tmp/display" ]; do
+	i=$((i + 1))
+	if [ $i -gt 100 ] || ! kill -0 $xpid 2>/dev/null; then
+		echo "bench-dwm: Xvfb failed to start:" >&2
+		cat "$tmp/xvfb.log" >&2
+		exit 1
+	fi
+	sleep 0.1
+done
+DISPLAY=:$(cat "$tmp/display")
+export DISPLAY
+
+HOME="$tmp" XDG_RUNTIME_DIR="$tmp" ./dwm -p "$tmp/dwm.sock" 2>"$tmp/dwm.log" &
+wpid=$!
+i=0
+while [ ! -S "$tmp/dwm.sock" ]; do
+	i=$((i + 1))
+	if [ $i -gt 100 ] || ! kill -0 $wpid 2>/dev/null; then
+		echo "bench-dwm: dwm failed to start:" >&2
+		cat "$tmp/dwm.log" >&2
+		exit 1
+	fi
+	sleep 0.1
+done
+
+"$dir/bench-dwm" -s "$tmp/dwm.sock" "$@"
@@ -0,0 +1,193 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Headless layout benchmark.
+ *
+ * Runs every layout in layouts.c over a set of monitor/client scenarios and
+ * compares a hash of the resulting geometry against the golden file, then
+ * times each layout at 1 to 1000 clients.
+ *
+ * usage: bench-layouts [-g] [golden-file]
+ *   -g  print the golden outputs instead of checking them
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../layouts.h"
+
+#define LENGTH(X)               (sizeof (X) / sizeof (X)[0])
+
+static const struct {
+	const char *name;
+	LayoutFunc func;
+} layouts[] = {
+	{ "bstack",                 layout_bstack },
+	{ "bstackhoriz",            layout_bstackhoriz },
+	{ "centredfloatingmaster",  layout_centredfloatingmaster },
+	{ "centredmaster",          layout_centredmaster },
+	{ "deck",                   layout_deck },
+	{ "dwindle",                layout_dwindle },
+	{ "gaplessgrid",            layout_gaplessgrid },
+	{ "grid",                   layout_grid },
+	{ "horizgrid",              layout_horizgrid },
+	{ "nrowgrid",               layout_nrowgrid },
+	{ "spiral",                 layout_spiral },
+	{ "tile",                   layout_tile },
+};
+
+// client counts checked against the golden outputs;
+static const unsigned int checkcounts[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 13, 17, 50, 100, 333, 1000 };
+// client counts timed;
+static const unsigned int timecounts[] = { 1, 10, 100, 1000 };
+
+#define NSCENARIOS 6
+#define MAXCLIENTS 1000
+
+static LayoutClient clients[MAXCLIENTS];
+
+// scenario 0: single master, uniform borders;
+// scenario 1: second monitor, mirrored;
+// scenario 2: 2 masters, mirrored, cfacts;
+// scenario 3: wide mfact, no inner gaps, cfacts;
+// scenario 4: no masters, gaps disabled, cfacts;
+// scenario 5: portrait monitor, 3 masters, cfacts;
+static void
+setup(LayoutParams *p, int s, unsigned int n)
+{
+	unsigned int i;
+	int enablegaps = (s != 4);
+
+	memset(p, 0, sizeof(LayoutParams));
+	p->mfact = (s == 3 ? 0.7f : 0.55f);
+	p->nmaster = (s == 2 ? 2 : s == 4 ? 0 : s == 5 ? 3 : 1);
+	p->wx = (s == 1 ? 1920 : 0);
+	p->wy = 22;
+	p->ww = (s == 5 ? 1080 : 1920);
+	p->wh = (s == 5 ? 1898 : 1058);
+	// as getgaps() with smartgaps;
+	p->oh = p->ov = (n == 1 ? 0 : 10 * enablegaps);
+	p->ih = p->iv = (s == 3 ? 0 : 8 * enablegaps);
+	p->mirror = (s == 1 || s == 2);
+	p->bh = 22;
+	p->forcevsplit = 1;
+
+	for (i = 0; i < n; i++) {
+		memset(&clients[i], 0, sizeof(LayoutClient));
+		clients[i].bw = (s == 0 ? 1 : i % 3);
+		clients[i].cfact = (s < 2 ? 1.0f : 0.25f + (i % 7) * 0.5f);
+	}
+}
+
+static unsigned int
+hashgeometry(unsigned int n)
+{
+	unsigned int i, j, k, hash = 2166136261u;	// FNV-1a;
+	unsigned int v;
+
+	for (i = 0; i < n; i++)
+		for (j = 0; j < 4; j++) {
+			v = (unsigned int)(j == 0 ? clients[i].x : j == 1 ? clients[i].y : j == 2 ? clients[i].w : clients[i].h);
+			for (k = 0; k < 4; k++) {
+				hash ^= (v >> (8 * k)) & 0xff;
+				hash *= 16777619u;
+			}
+		}
+	return hash;
+}
+
+static int
+check(const char *path, int generate)
+{
+	char line[256], expect[256];
+	unsigned int i, j, s, failed = 0, total = 0;
+	LayoutParams p;
+	FILE *fd = NULL;
+
+	if (!generate && !(fd = fopen(path, "r"))) {
+		perror(path);
+		return 0;
+	}
+
+	for (i = 0; i < LENGTH(layouts); i++)
+		for (s = 0; s < NSCENARIOS; s++)
+			for (j = 0; j < LENGTH(checkcounts); j++) {
+				setup(&p, s, checkcounts[j]);
+				layouts[i].func(&p, clients, checkcounts[j]);
+				snprintf(line, sizeof line, "%s s%u n%u \"%s\" %08x\n",
+					layouts[i].name, s, checkcounts[j], p.ltsymbol, hashgeometry(checkcounts[j])
+				);
+				if (generate) {
+					fputs(line, stdout);
+					continue;
+				}
+				total++;
+				if (!fgets(expect, sizeof expect, fd) || strcmp(line, expect)) {
+					fprintf(stderr, "mismatch: %s", line);
+					failed++;
+				}
+			}
+
+	if (fd) {
+		fclose(fd);
+		printf("golden: %u/%u layout results match\n", total - failed, total);
+	}
+	return !failed;
+}
+
+static double
+elapsed(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void
+timelayouts(void)
+{
+	unsigned int i, j, k, n, iterations;
+	struct timespec start, end;
+	LayoutParams p;
+	double ns;
+
+	printf("%-24s", "layout (ns/arrange)");
+	for (j = 0; j < LENGTH(timecounts); j++)
+		printf("%12u", timecounts[j]);
+	printf("\n");
+
+	for (i = 0; i < LENGTH(layouts); i++) {
+		printf("%-24s", layouts[i].name);
+		for (j = 0; j < LENGTH(timecounts); j++) {
+			n = timecounts[j];
+			iterations = 1000000 / n;
+			setup(&p, 2, n);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (k = 0; k < iterations; k++)
+				layouts[i].func(&p, clients, n);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			ns = elapsed(&start, &end) / iterations;
+			printf("%12.0f", ns);
+		}
+		printf("\n");
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *golden = "bench/layouts.golden";
+	int generate = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+		if (!strcmp(argv[i], "-g"))
+			generate = 1;
+		else
+			golden = argv[i];
+
+	if (generate)
+		return !check(NULL, 1);
+	if (!check(golden, 0))
+		return 1;
+	timelayouts();
+	return 0;
+}
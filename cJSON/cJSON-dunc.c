@@ -251,6 +251,21 @@ static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
     return node;
 }
 
+/* Lookup index over the children of an array/object.
+ * items[0..capacity) holds the children by position, followed by an open addressed hash table
+ * of slots entries for objects, keyed by the case folded member name. The index is allocated
+ * once by cJSON_EnableIndex and rebuilt in place after changes, so a rebuild never allocates
+ * (from whatever the current hooks happen to be); when the children outgrow it, lookups fall back
+ * to walking the list. */
+struct cJSON_Index
+{
+    cJSON_bool valid;
+    size_t count;
+    size_t capacity;
+    size_t slots;
+    cJSON **items;
+};
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
@@ -258,6 +273,11 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
     while (item != NULL)
     {
         next = item->next;
+        if (item->index != NULL)
+        {
+            global_hooks.deallocate(item->index);
+            item->index = NULL;
+        }
         if (!(item->type & cJSON_IsReference) && (item->child != NULL))
         {
             cJSON_Delete(item->child);
@@ -1886,6 +1906,133 @@ static cJSON_bool print_object(const cJSON * const item, printbuffer * const out
     return true;
 }
 
+static size_t index_hash(const unsigned char *string)
+{
+    /* FNV-1a over the case folded name, so case insensitive lookups probe the same slots */
+    size_t hash = (size_t)2166136261U;
+    for (; *string != '\0'; string++)
+    {
+        hash = (hash ^ (size_t)tolower(*string)) * (size_t)16777619U;
+    }
+
+    return hash;
+}
+
+static void invalidate_index(const cJSON *item)
+{
+    if ((item != NULL) && (item->index != NULL))
+    {
+        item->index->valid = false;
+    }
+}
+
+/* (Re)build the index of item in place; false when item has none or it is too small. */
+static cJSON_bool build_index(const cJSON *item)
+{
+    struct cJSON_Index *index = item->index;
+    cJSON *child = NULL;
+    size_t count = 0;
+    size_t slot = 0;
+    cJSON **table = NULL;
+
+    if (index == NULL)
+    {
+        return false;
+    }
+    if (index->valid)
+    {
+        return true;
+    }
+
+    for (child = item->child; child != NULL; child = child->next)
+    {
+        if ((count == index->capacity) || (index->slots && (child->string == NULL)))
+        {
+            return false;
+        }
+        index->items[count++] = child;
+    }
+
+    if (index->slots)
+    {
+        table = index->items + index->capacity;
+        memset(table, '\0', index->slots * sizeof(cJSON*));
+        /* insert in member order: with linear probing and no removals, the first of several
+         * matching members is always met first, as with the linear walk */
+        for (child = item->child; child != NULL; child = child->next)
+        {
+            slot = index_hash((const unsigned char*)child->string) & (index->slots - 1);
+            while ((table[slot] != NULL) && (strcmp(table[slot]->string, child->string) != 0))
+            {
+                slot = (slot + 1) & (index->slots - 1);
+            }
+            if (table[slot] == NULL)
+            {
+                table[slot] = child;
+            }
+        }
+    }
+
+    index->count = count;
+    index->valid = true;
+
+    return true;
+}
+
+static void enable_index(cJSON *item, size_t depth)
+{
+    struct cJSON_Index *index = NULL;
+    cJSON *child = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t slots = 0;
+
+    if ((item->type & cJSON_IsReference) || (depth >= CJSON_NESTING_LIMIT))
+    {
+        return;
+    }
+
+    for (child = item->child; child != NULL; child = child->next)
+    {
+        count++;
+        enable_index(child, depth + 1);
+    }
+
+    if ((count < CJSON_INDEX_THRESHOLD) || (item->index != NULL) || !(cJSON_IsArray(item) || cJSON_IsObject(item)))
+    {
+        return;
+    }
+
+    /* leave some headroom for members added later on */
+    capacity = count + count / 2;
+    if (cJSON_IsObject(item))
+    {
+        for (slots = 16; slots < 2 * capacity; slots <<= 1);
+    }
+
+    index = (struct cJSON_Index*)global_hooks.allocate(sizeof(struct cJSON_Index) + (capacity + slots) * sizeof(cJSON*));
+    if (index == NULL)
+    {
+        return;
+    }
+    index->valid = false;
+    index->count = 0;
+    index->capacity = capacity;
+    index->slots = slots;
+    index->items = (cJSON**)(index + 1);
+
+    item->index = index;
+    build_index(item);
+}
+
+CJSON_PUBLIC(void) cJSON_EnableIndex(cJSON *item)
+{
+    if (item != NULL)
+    {
+        enable_index(item, 0);
+    }
+}
+
 /* Get Array size/item / object item. */
 CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array)
 {
@@ -1897,6 +2044,11 @@ CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array)
         return 0;
     }
 
+    if (build_index(array))
+    {
+        return (int)array->index->count;
+    }
+
     child = array->child;
 
     while(child != NULL)
@@ -1919,6 +2071,11 @@ static cJSON* get_array_item(const cJSON *array, size_t index)
         return NULL;
     }
 
+    if (build_index(array))
+    {
+        return (index < array->index->count) ? array->index->items[index] : NULL;
+    }
+
     current_child = array->child;
     while ((current_child != NULL) && (index > 0))
     {
@@ -1948,6 +2105,20 @@ static cJSON *get_object_item(const cJSON * const object, const char * const nam
         return NULL;
     }
 
+    if (build_index(object) && object->index->slots)
+    {
+        cJSON **table = object->index->items + object->index->capacity;
+        size_t slot = index_hash((const unsigned char*)name) & (object->index->slots - 1);
+        for (; table[slot] != NULL; slot = (slot + 1) & (object->index->slots - 1))
+        {
+            if (case_sensitive ? (strcmp(name, table[slot]->string) == 0) : (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)table[slot]->string) == 0))
+            {
+                return table[slot];
+            }
+        }
+        return NULL;
+    }
+
     current_element = object->child;
     if (case_sensitive)
     {
@@ -2010,6 +2181,7 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
+    reference->index = NULL;
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -2024,6 +2196,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         return false;
     }
 
+    invalidate_index(array);
     child = array->child;
     /*
      * To find the last item in array quickly, we use prev in array
@@ -2265,6 +2438,7 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         return NULL;
     }
 
+    invalidate_index(parent);
     if (item != parent->child)
     {
         /* not the first element */
@@ -2354,6 +2528,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
         return false;
     }
 
+    invalidate_index(array);
     newitem->next = after_inserted;
     newitem->prev = after_inserted->prev;
     after_inserted->prev = newitem;
@@ -2380,6 +2555,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return true;
     }
 
+    invalidate_index(parent);
     replacement->next = item->next;
     replacement->prev = item->prev;
 
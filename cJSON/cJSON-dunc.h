@@ -123,6 +123,9 @@ typedef struct cJSON
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+    /* Lookup index over the children of an array/object, see cJSON_EnableIndex; NULL when not indexed. */
+    struct cJSON_Index *index;
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -146,6 +149,11 @@ typedef int cJSON_bool;
 #define CJSON_CIRCULAR_LIMIT 10000
 #endif
 
+/* Arrays and objects with at least this many children get a lookup index from cJSON_EnableIndex. */
+#ifndef CJSON_INDEX_THRESHOLD
+#define CJSON_INDEX_THRESHOLD 8
+#endif
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
@@ -266,6 +274,11 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse);
  * case_sensitive determines if object keys are treated case sensitive (1) or case insensitive (0) */
 CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive);
 
+/* Attach lookup indexes to the arrays and objects in a tree that have at least CJSON_INDEX_THRESHOLD children,
+ * making cJSON_GetArrayItem, cJSON_GetArraySize and the object lookups O(1) on them.
+ * Each index is built on first use and rebuilt after the children are changed through the cJSON API. */
+CJSON_PUBLIC(void) cJSON_EnableIndex(cJSON *item);
+
 /* Minify a strings, remove blank characters(such as ' ', '\t', '\r', '\n') from strings.
  * The input pointer json cannot point to a read-only address area, such as a string constant, 
  * but should point to a readable and writable address area. */
@@ -128,6 +128,7 @@ static char *desktop_icon = "";
 static       unsigned int borderpx		= 3;        /* border pixel of windows */
 static       unsigned int titleborderpx	= 6;        /* border pixel of WinTitle bar element when monitor is active but no client is */
 static const unsigned int snap			= 32;       /* snap pixel */
+static const unsigned int dragrate		= 0;        /* Hz of interactive move/resize updates, 0 follows the refresh rate of the monitor under the pointer */
 
 #if PATCH_VANITY_GAPS
 static       Bool defgaps           = True;		/* vanity gaps on/off by default */
@@ -334,6 +335,11 @@ static const Layout layouts[] = {
 #if PATCH_IPC
 static const char *socketpath = "${XDG_RUNTIME_DIR}/dwm.sock";	// sometimes we can't expand this - possibly not getting environment every time;
 static const char *socketpath_fallback = "/tmp/dwm.sock";
+static const unsigned int ipcqueuemax = 1048576;				// most bytes of events queued for an IPC client that isn't reading, 0 for no limit;
+static const IPCSlowPolicy ipcslowpolicy = IPC_SLOW_DROP_EVENTS;	// or IPC_SLOW_DISCONNECT;
+#if PATCH_HOT_RELOAD
+static const unsigned int hotreloaddelay = 250;					// ms for the rules/layout files to settle after a change before reloading;
+#endif // PATCH_HOT_RELOAD
 static IPCCommand ipccommands[] = {
 	IPCCOMMAND(  activate,            1,      {ARG_TYPE_STR}    ),
 	IPCCOMMAND(  clearurgency,        1,      {ARG_TYPE_NONE}   ),
@@ -352,8 +358,10 @@ static IPCCommand ipccommands[] = {
 	IPCCOMMAND(  enablemousewarp,     1,      {ARG_TYPE_UINT}   ),
 	#endif // PATCH_MOUSE_POINTER_WARPING
 	IPCCOMMAND(  reload,              1,      {ARG_TYPE_NONE}   ),
+	IPCCOMMAND(  reloadinplace,       1,      {ARG_TYPE_NONE}   ),
 	IPCCOMMAND(  reloadrules,         1,      {ARG_TYPE_NONE}   ),
 //	IPCCOMMAND(  setlayoutsafe,       1,      {ARG_TYPE_PTR}    ),
+	IPCCOMMAND(  setlayoutex,         1,      {ARG_TYPE_STR}    ),
 	IPCCOMMAND(  setmfact,            1,      {ARG_TYPE_FLOAT}  ),
 	IPCCOMMAND(  tag,                 1,      {ARG_TYPE_UINT}   ),
 	IPCCOMMAND(  tagmon,              1,      {ARG_TYPE_UINT}   ),
@@ -151,6 +151,19 @@ drw_fontgroup_create_json(Drw *drw, cJSON *fontgroup)
 }
 #endif // PATCH_FONT_GROUPS
 
+#if PATCH_FONT_GROUPS
+static void
+fontgroups_free(FntGrp **groups, int n)
+{
+	for (int i = 0; i < n; i++)
+		if (groups[i]) {
+			drw_fontset_free(groups[i]->fonts);
+			free(groups[i]);
+		}
+	free(groups);
+}
+#endif // PATCH_FONT_GROUPS
+
 void
 drw_free(Drw *drw)
 {
@@ -161,14 +174,8 @@ drw_free(Drw *drw)
 	XFreeGC(drw->dpy, drw->gc);
 	drw_fontset_free(drw->fonts);
 	#if PATCH_FONT_GROUPS
-	if (drw->fontgroups) {
-		for (int i = 0; i < drw->numfontgroups; i++)
-			if (drw->fontgroups[i]) {
-				drw_fontset_free(drw->fontgroups[i]->fonts);
-				free(drw->fontgroups[i]);
-			}
-		free(drw->fontgroups);
-	}
+	if (drw->fontgroups)
+		fontgroups_free(drw->fontgroups, drw->numfontgroups);
 	#endif // PATCH_FONT_GROUPS
 	free(drw);
 }
@@ -177,16 +184,27 @@ drw_free(Drw *drw)
 int
 drw_populate_fontgroups(Drw *drw, cJSON *fontgroup_array)
 {
-	FntGrp *grp;
+	FntGrp *grp, **old;
 	cJSON *fg, *f, *g;
-	int i, j = 0, n = 0;
+	int i, j = 0, k, n = 0, oldn;
+
+	if (!drw)
+		return 0;
 
-	if (!drw || !fontgroup_array ||
+	// hold on to any current groups, so a reload can reuse the unchanged ones;
+	old = drw->fontgroups;
+	oldn = old ? drw->numfontgroups : 0;
+	drw->fontgroups = NULL;
+	drw->numfontgroups = 0;
+	drw->selfonts = NULL;
+
+	if (!fontgroup_array ||
 		!((cJSON_IsArray(fontgroup_array) && (n = cJSON_GetArraySize(fontgroup_array)) > 0) ||
 			cJSON_IsObject(fontgroup_array)
 		)
 	) {
-		drw->fontgroups = NULL;
+		if (old)
+			fontgroups_free(old, oldn);
 		return 0;
 	}
 
@@ -208,13 +226,25 @@ drw_populate_fontgroups(Drw *drw, cJSON *fontgroup_array)
 			)
 			continue;
 
-		grp = ecalloc(1, sizeof(FntGrp));
+		// reuse the group's fonts if its definition is unchanged;
+		for (grp = NULL, k = 0; k < oldn; k++)
+			if (old[k] && strcmp(old[k]->name, f->valuestring) == 0 && cJSON_Compare(old[k]->spec, g, 1)) {
+				grp = old[k];
+				old[k] = NULL;
+				break;
+			}
+		if (!grp) {
+			grp = ecalloc(1, sizeof(FntGrp));
+			grp->fonts = drw_fontset_create_json(drw, g);
+		}
 		grp->name = f->valuestring;
-		grp->fonts = drw_fontset_create_json(drw, g);
+		grp->spec = g;
 		drw->fontgroups[j++] = grp;
 	}
 
 	drw->numfontgroups = j;
+	if (old)
+		fontgroups_free(old, oldn);
 	return j;
 }
 #endif // PATCH_FONT_GROUPS
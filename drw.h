@@ -23,6 +23,7 @@ typedef struct Fnt {
 #if PATCH_FONT_GROUPS
 typedef struct FntGrp {
 	const char *name;
+	cJSON *spec;			// the group's fonts array, to detect changes on reload;
 	Fnt *fonts;
 } FntGrp;
 #endif // PATCH_FONT_GROUPS
@@ -50,6 +50,9 @@
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
 #include <X11/Xft/Xft.h>
 #include <X11/Xlib-xcb.h>
 #include <xcb/res.h>
@@ -61,11 +64,29 @@
 
 #include "patches.h"
 #include "drw.h"
+#include "layouts.h"
 #include "util.h"
 
-#if PATCH_HANDLE_SIGNALS
 #include <poll.h>
-#endif // PATCH_HANDLE_SIGNALS
+
+#if PATCH_HOT_RELOAD && !PATCH_IPC
+// file changes are picked up by the IPC epoll loop;
+#undef PATCH_HOT_RELOAD
+#define PATCH_HOT_RELOAD 0
+#endif // PATCH_HOT_RELOAD && !PATCH_IPC
+#if PATCH_HOT_RELOAD
+#include <sys/inotify.h>
+#endif // PATCH_HOT_RELOAD
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#if PATCH_EVENT_RECORDING && !PATCH_IPC
+// IPC messages are recorded and replayed too;
+#undef PATCH_EVENT_RECORDING
+#define PATCH_EVENT_RECORDING 0
+#endif // PATCH_EVENT_RECORDING && !PATCH_IPC
+#if PATCH_EVENT_RECORDING
+#include <sys/socket.h>
+#endif // PATCH_EVENT_RECORDING
 
 #if PATCH_BIDIRECTIONAL_TEXT
 #include <fribidi.h>
@@ -96,8 +117,29 @@
 static cJSON *layout_json = NULL;
 static cJSON *fonts_json = NULL;
 static cJSON *monitors_json = NULL;
+static const char *layout_filename = NULL;
 static cJSON *rules_json = NULL;
 static const char *rules_filename = NULL;
+#if PATCH_HOT_RELOAD
+enum { HotReloadRules = 1, HotReloadLayout = 2 };	// hotreload_pending;
+static int hotreload_fd = -1;			// inotify, watching the directories of the rules/layout files;
+static int hotreload_wd[2] = { -1, -1 };	// watches for the rules/layout file directories;
+static int hotreload_pending = 0;
+#endif // PATCH_HOT_RELOAD
+// cJSON allocates from jsonarena, or the heap when it is NULL; trees that are
+// parsed and deleted together share an arena, released without a free() per node;
+static Arena *jsonarena = NULL;
+#define JSON_PREFIX		16		// ahead of each cJSON allocation, see jsonalloc();
+static Arena layoutarena = { NULL, 65536 };	// layout_json, until the layout is reloaded;
+static Arena layoutstaging = { NULL, 65536 };	// reloaded layout until it replaces layout_json;
+static Arena rulesarena = { NULL, 65536 };	// rules_json, until the rules are reloaded;
+static Arena rulesstaging = { NULL, 65536 };	// reloaded rules until they replace rules_json;
+static unsigned long *rulesadded = NULL;	// rules new to a reload, which applyrules() also evaluates while they are set;
+static size_t nrulesadded = 0;
+static int rulesaddedonly = 0;			// only evaluate rulesadded, for clients whose applied rules are unchanged;
+#if PATCH_IPC
+static Arena ipcarena = { NULL, 16384 };	// requests, replies and events, until each is handled;
+#endif // PATCH_IPC
 #if PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
 static cJSON *rules_compost = NULL;
 #endif // PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
@@ -879,6 +921,7 @@ static int debug_sensitivity_on = 0;
 #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
 #define TEXTW(X)                (drw_fontset_getwidth(drw, (X)) + lrpad)
 #define OPAQUE                  0xffU
+#define SCANHASH(W)             ((unsigned int) (((W) * 2654435761UL) & (nscanhash - 1)))
 
 #define NOT_STRINGMATCH(JSON,VARNAME,sz_VARNAME,TEXT)	( \
 	(!cJSON_HasObjectItem(JSON, TEXT"-is") || napplyrules_stringtest(cJSON_GetObjectItemCaseSensitive(JSON, TEXT"-is"), VARNAME, sz_VARNAME, APPLYRULES_STRING_EXACT)) && \
@@ -1013,7 +1056,12 @@ enum {	NetSupported, NetWMName,
 		NetWMWindowsOpacity,
 		#endif // PATCH_CLIENT_OPACITY
 		NetClientList, NetClientInfo, NetLast }; /* EWMH atoms */
-enum {	Manager, Xembed, XembedInfo, XLast }; /* Xembed atoms */
+enum {	Manager, Xembed, XembedInfo,
+		Utf8String, NetWMPid,
+		#if PATCH_ALPHA_CHANNEL
+		NetWMCMSelection,
+		#endif // PATCH_ALPHA_CHANNEL
+		XLast }; /* Xembed and other atoms */
 enum {	WMProtocols, WMDelete, WMState, WMTakeFocus, WMWindowRole, WMLast }; /* default atoms */
 enum {	ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
 		ClkClientWin, ClkRootWin,
@@ -1054,6 +1102,7 @@ enum {	FOCUS_BORDER_N, FOCUS_BORDER_E, FOCUS_BORDER_S, FOCUS_BORDER_W };
 enum {	FOCUS_PIXEL_SE = 1, FOCUS_PIXEL_SW, FOCUS_PIXEL_NW, FOCUS_PIXEL_NE };
 #endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 
+enum {	TallyBar = 1, TallyUrgent = 2, TallyHidden = 4, TallySticky = 8, TallyAllTags = 16, TallyPanel = 32 };	/* client tally flags */
 
 #if PATCH_IPC
 typedef struct TagState TagState;
@@ -1067,6 +1116,13 @@ typedef struct ClientState ClientState;
 struct ClientState {
 	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
 };
+
+// how a subscriber receives IPC events; each has its own baseline state to diff against;
+typedef enum IPCDelivery {
+	IPC_DELIVERY_LATEST,		// the latest state, once per batch of X events or IPC command;
+	IPC_DELIVERY_EVERY,			// every transition, after each X event handler;
+	IPC_DELIVERY_LAST
+} IPCDelivery;
 #endif // PATCH_IPC
 
 typedef union {
@@ -1093,6 +1149,8 @@ typedef struct Monitor Monitor;
 typedef struct Client Client;
 struct Client {
 	char name[256];
+	char class[256];		// WM_CLASS, empty if unset;
+	char instance[256];
 	#if PATCH_FLAG_TITLE
 	char *displayname;
 	#endif // PATCH_FLAG_TITLE
@@ -1122,6 +1180,8 @@ struct Client {
 	int oldx, oldy, oldw, oldh;
 	int basew, baseh, incw, inch, maxw, maxh, minw, minh, hintsvalid;
 	int bw, oldbw;
+	int cfgx, cfgy, cfgw, cfgh, cfgbw, cfgfocus;	// geometry last requested from the server by resizeclient();
+	int cfgvalid;		// 0 when the window may have been configured outside resizeclient();
 	unsigned int tags;
 	int dormant;
 	int isfixed, isfloating, isurgent;
@@ -1230,6 +1290,8 @@ struct Client {
 	int isignored;
 	#endif // PATCH_FLAG_IGNORED
 	int ruledefer; // reapply rules if/when the title changes;
+	unsigned long rulehashes[8];	// the rules applied, to find clients affected when the rules are reloaded;
+	int nrulehashes;				// -1 when more rules were applied than fit;
 	pid_t pid;
 	int beingmoved;
 	#if PATCH_HANDLE_SIGNALS
@@ -1285,8 +1347,11 @@ struct Client {
 	#endif // PATCH_CROP_WINDOWS
 	int index;
 	#if PATCH_IPC
-	ClientState prevstate;
+	ClientState prevstate[IPC_DELIVERY_LAST];
 	#endif // PATCH_IPC
+	Monitor *tallymon;			// monitor whose tag counts include this client, NULL if none;
+	unsigned int tallytags;		// tags the client was counted on;
+	unsigned int tallyflags;	// Tally* flags the client was counted with;
 };
 
 typedef struct SortNode SortNode;
@@ -1308,6 +1373,117 @@ typedef struct {
 	void (*arrange)(Monitor *);
 } Layout;
 
+// layout inputs of one tiled client;
+typedef struct {
+	Client *c;
+	Window win;
+	int bw, isfullscreen, hintsvalid;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	float mina, maxa;
+	#if PATCH_CFACTS
+	float cfact;
+	#endif // PATCH_CFACTS
+} LayoutClientInputs;
+
+// layout inputs of a monitor;
+typedef struct {
+	void (*arrange)(Monitor *);
+	float mfact;
+	int nmaster, mirror;
+	int wx, wy, ww, wh;
+	int oh, ov, ih, iv;
+	int bh, minbh;
+	unsigned int n;			// number of tiled clients;
+} LayoutInputs;
+
+typedef struct {
+	LayoutClientInputs in;
+	int x, y, w, h;			// geometry the layout requested, before size hints;
+	int placed;				// the layout requested it through layoutplace();
+} LayoutCacheClient;
+
+// last layout result of a monitor (or tag), replayed while its inputs are unchanged;
+typedef struct {
+	int valid;
+	LayoutInputs in;
+	char ltsymbol[16];
+	LayoutCacheClient *clients;	// in nexttiled() order;
+	unsigned int size;			// allocated entries in clients;
+} LayoutCache;
+
+// properties manage() reads, prefetched by scan() for the windows it will manage;
+enum {	ScanNetWMName, ScanWMName, ScanWMClass, ScanWMRole, ScanWMNormalHints, ScanWMHints,
+		#if PATCH_WINDOW_ICONS
+		ScanNetWMIcon,
+		#endif // PATCH_WINDOW_ICONS
+		ScanLast };
+
+// window state fetched up front by scan(), in one batch of pipelined requests;
+typedef struct {
+	Window win;
+	int valid;				// attributes and geometry were returned;
+	XWindowAttributes wa;
+	int istrans;			// has WM_TRANSIENT_FOR;
+	Window trans;			// WM_TRANSIENT_FOR, None if unset;
+	xcb_get_property_reply_t *props[ScanLast];	// NULL if not fetched;
+	long state;				// WM_STATE, -1 if unavailable;
+	Atom wtype;				// first _NET_WM_WINDOW_TYPE, None if unset;
+	#if PATCH_PERSISTENT_METADATA
+	unsigned long index;	// _NET_CLIENT_INFO index stored by cleanup(), 0 if unset;
+	#endif // PATCH_PERSISTENT_METADATA
+	pid_t pid;				// 0 if unknown;
+} ScanWin;
+
+// phases timed during startup and reloads;
+enum {	ProfileLayout, ProfileRules, ProfileDisplay, ProfileAtoms, ProfileFonts, ProfileMonitors,
+		ProfileColours, ProfileScan, ProfileManage, ProfileArrange, ProfileBars, ProfileLast };
+
+typedef struct {
+	const char *trigger;		// startup, reload, reloadinplace or reloadrules;
+	int done;
+	struct timespec started;
+	double ms[ProfileLast];		// time spent in each phase;
+	double total;				// ms from start to finish;
+	unsigned int managed;		// windows passed to manage() by scan();
+} Profile;
+
+// log-linear latency buckets: 4 per power of two microseconds, the last one open ended;
+#define LATENCY_BUCKETS			96
+
+// latency of one X event type or IPC message type;
+typedef struct {
+	unsigned long count;
+	unsigned long requests;		// X requests issued while handling;
+	unsigned long flushes;		// Xlib request buffer flushes; not requests or replies on xcon;
+	double total;				// ms;
+	double max;					// ms;
+	unsigned long buckets[LATENCY_BUCKETS];
+} Latency;
+
+typedef struct {
+	struct timespec started;
+	unsigned long request;
+	unsigned long flushes;
+} LatencyMark;
+
+// 1ms slots, so timers due within one revolution are found by one pass over the wheel;
+#define TIMER_WHEEL_SLOTS		256
+// Hz to pace interactive moves/resizes to, when RandR doesn't know the monitor's;
+#define FALLBACK_REFRESH_RATE	60
+#if PATCH_ALTTAB || PATCH_TORCH
+// 1ms apart, when another client holds the keyboard or pointer grab;
+#define GRAB_RETRIES			1000
+#endif // PATCH_ALTTAB || PATCH_TORCH
+
+// one-shot timer on the main loop's timer wheel, owned by the caller;
+// the callback may restart its own timer;
+typedef struct Timer Timer;
+struct Timer {
+	void (*func)(Timer *t);
+	unsigned long long expires;	// ms on the monotonic clock;
+	Timer *next, **pprev;		// wheel slot, pprev is NULL when not pending;
+};
+
 /* tagging */
 static char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
 //static char *tags[] = { "󾠮", "󾠯", "󾠰", "󾠱", "󾠲", "󾠳", "󾠴", "󾠵", "󾠶" };
@@ -1379,6 +1555,7 @@ struct Monitor {
 	int by;               /* bar geometry */
 	int mx, my, mw, mh;   /* screen size */
 	int wx, wy, ww, wh;   /* window area  */
+	double refreshrate;   /* Hz, from RandR, 0 when unknown */
 	#if PATCH_CLASS_STACKING
 	int class_stacking;
 	#endif // PATCH_CLASS_STACKING
@@ -1427,16 +1604,19 @@ struct Monitor {
 	int barvisible;
 	const Layout *lt[2];
 	#if PATCH_IPC
-	Client *lastsel;
-	const Layout *lastlt;
-	char lastltsymbol[16];
-	TagState tagstate;
+	// state last sent to IPC subscribers, per IPCDelivery;
+	Window lastselwin[IPC_DELIVERY_LAST];
+	const Layout *lastlt[IPC_DELIVERY_LAST];
+	char lastltsymbol[IPC_DELIVERY_LAST][16];
+	TagState tagstate[IPC_DELIVERY_LAST];
 	#endif // PATCH_IPC
 	#if PATCH_SWITCH_TAG_ON_EMPTY
 	unsigned int switchonempty;
 	#endif // PATCH_SWITCH_TAG_ON_EMPTY
 	#if PATCH_PERTAG
 	Pertag *pertag;
+	#else // NO PATCH_PERTAG
+	LayoutCache ltcache;
 	#endif // PATCH_PERTAG
 	unsigned int tagw[9];
 	#if PATCH_LOG_DIAGNOSTICS
@@ -1472,6 +1652,14 @@ struct Monitor {
 	int isdefault;
 	unsigned int defaulttag;
 	Client *focusontag[9];
+	// per-tag client counts, kept up to date by tallyclient();
+	unsigned int tagclients[LENGTH(tags)];		// clients;
+	unsigned int tagurgent[LENGTH(tags)];		// urgent clients;
+	unsigned int tagbarclients[LENGTH(tags)];	// clients shown on the bar (not dormant, ignored or panels);
+	unsigned int tagbaroccupied[LENGTH(tags)];	// bar clients that aren't on every tag;
+	unsigned int tagbarhidden[LENGTH(tags)];	// hidden bar clients;
+	unsigned int tagbarurgent[LENGTH(tags)];	// urgent bar clients that aren't hidden;
+	unsigned int tagbarsticky[LENGTH(tags)];	// sticky bar clients that aren't on the tag;
 	#if PATCH_ALT_TAGS
 	char *tags[9];
 	int alttags;
@@ -1498,6 +1686,9 @@ struct Systray {
 /* function declarations */
 static void activate(const Arg *arg);
 static void activateclient(Client *c, int setfocus);
+#if PATCH_FLAG_ACTIVATION_CLICK
+static void activationclickrelease(Timer *t);
+#endif // PATCH_FLAG_ACTIVATION_CLICK
 static void adjustfloatposition(Client *c);
 #if PATCH_FLAG_FLOAT_ALIGNMENT
 static int alignfloat(Client *c, float relX, float relY);
@@ -1517,6 +1708,7 @@ static void apply_fribidi(char *str);
 #endif // PATCH_BIDIRECTIONAL_TEXT
 static int applyrules(Client *c, int deferred, char *oldtitle);
 static void applyrulesdeferred(Client *c, char *oldtitle);
+static void applyrulesreloaded(unsigned long *oldhashes, size_t nold);
 static int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
@@ -1547,9 +1739,17 @@ static void checkotherwm(void);
 static int checkstack(Monitor *mon);
 #endif // DEBUGGING || PATCH_LOG_DIAGNOSTICS
 static void cleanup(void);
+#if PATCH_HOT_RELOAD
+static void cleanuphotreload(void);
+#endif // PATCH_HOT_RELOAD
 static void cleanupmon(Monitor *mon);
+static void cleanupsignals(void);
+static void cleanuptimers(void);
 static void clearurgency(const Arg *arg);
 static void clientmessage(XEvent *e);
+#if PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
+static void compostrules(void);
+#endif // PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
 static void configure(Client *c);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
@@ -1578,6 +1778,7 @@ static void cropresize(Client *c);
 #endif // PATCH_CROP_WINDOWS
 static void cyclelayout(const Arg *arg);
 static void cyclelayoutmouse(const Arg *arg);
+static void defaultcolours(void);
 #if PATCH_SHOW_DESKTOP
 static int desktopvalid(Client *c);
 static int desktopvalidex(Client *c, unsigned int tagset, int show_desktop);
@@ -1601,6 +1802,7 @@ static void dragfact(const Arg *arg);
 #endif // PATCH_DRAG_FACTS
 static void drawbar(Monitor *m, int skiptags);
 static int drawbar_elementvisible(Monitor *m, unsigned int element_type);
+static void dispatch(XEvent *ev);
 static void drawbars(void);
 #if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 static void drawfocusborder(int remove);
@@ -1619,6 +1821,7 @@ static void enabletermswallow(const Arg *arg);
 #if PATCH_IPC
 static void enableurgency(const Arg *arg);
 #endif // PATCH_IPC
+static double elapsedms(const struct timespec *since);
 static void enternotify(XEvent *e);
 static void expose(XEvent *e);
 #if PATCH_IPC
@@ -1639,9 +1842,13 @@ static Client *getfirstmodal(Monitor *m);
 #endif // PATCH_HANDLE_SIGNALS
 #if PATCH_IPC
 static int find_dwm_client(const char *name);
+static int get_clients(int argc, char *argv[]);
 static int get_dwm_client(Window win);
+static int get_latency();
 static int get_layouts();
 static int get_monitors();
+static int get_profile();
+static int get_state_shm();
 static int get_tags();
 #endif // PATCH_IPC
 #if PATCH_FLAG_GAME
@@ -1664,6 +1871,7 @@ static Picture geticonprop(
 	#endif // PATCH_WINDOW_ICONS_DEFAULT_ICON || PATCH_WINDOW_ICONS_CUSTOM_ICONS
 	Window w, unsigned int *icw, unsigned int *ich, unsigned int iconsize
 );
+static Picture iconpicture(unsigned long *p, unsigned long n, unsigned int *picw, unsigned int *pich, unsigned int iconsize);
 #endif // PATCH_WINDOW_ICONS
 #if PATCH_FLAG_PANEL
 #if PATCH_FLAG_FLOAT_ALIGNMENT
@@ -1673,6 +1881,7 @@ static int getpanelpadding(Monitor *m, unsigned int *px, unsigned int *pw);
 static Client *getparentclient(Client *c);
 static pid_t getparentprocess(pid_t p);
 static pid_t getprocessid(const char *procname);
+static int readcommand(const char *cmd, char *buf, size_t size);
 static int getprocname(pid_t pid, char *buffer, size_t buffer_size, char **procname, char **parameters);
 #if PATCH_MOUSE_POINTER_WARPING || PATCH_FOCUS_FOLLOWS_MOUSE
 static int getrelativeptr(Client *c, int *x, int *y);
@@ -1692,12 +1901,19 @@ static Client *getultimateparentclient(Client *c);
 static void grabbuttons(Client *c, int focused);
 #if PATCH_ALTTAB || PATCH_TORCH
 static int grabinputs(int keyboard, int mouse, Cursor cursor);
+static int grabinputslater(void (*func)(const Arg *arg), const Arg *arg);
+static void grabretried(Timer *t);
 #endif // PATCH_ALTTAB || PATCH_TORCH
 static void grabkeys(void);
 #if PATCH_CLASS_STACKING
 static void groupallclassstacks(Monitor *m);
 #endif // PATCH_CLASS_STACKING
 static Client *guessnextfocus(Client *c, Monitor *m);	// derive the next valid client to focus;
+#if PATCH_HOT_RELOAD
+static void handlehotreload(void);
+#endif // PATCH_HOT_RELOAD
+static void handlesignals(void);
+static void handletimers(void);
 #if PATCH_IPC
 static int handlexevent(struct epoll_event *ev);
 #endif // PATCH_IPC
@@ -1713,7 +1929,12 @@ static void hidewin(const Arg *arg);
 #if PATCH_ALTTAB
 static void highlight(Client *c);
 #endif // PATCH_ALTTAB
+#if PATCH_HOT_RELOAD
+static void hotreloadsettled(Timer *t);
+#endif // PATCH_HOT_RELOAD
 static void incnmaster(const Arg *arg);
+static void internatoms(void);
+static int isconfigured(Client *c, int x, int y, int w, int h, int bw, int focused);
 #if PATCH_DRAG_FACTS
 static int ismaster(Client *c);
 #endif // PATCH_DRAG_FACTS
@@ -1730,11 +1951,16 @@ static int is_hex(const char *s);
 static int is_signed_int(const char *s);
 static int is_unsigned_int(const char *s);
 #endif // PATCH_IPC
+static void *jsonalloc(size_t size);
+static int json_isboolean(cJSON *node);
+static void jsonfree(void *p);
+static int jsoninarena(const void *p);
 static int keycode_to_modifier(XModifierKeymap *modmap, KeyCode keycode);
 static void keypress(XEvent *e);
 #if PATCH_ALT_TAGS || PATCH_KEY_HOLD
 static void keyrelease(XEvent *e);
 #endif // PATCH_ALT_TAGS || PATCH_KEY_HOLD
+static int keysdown(KeyCode key);
 static void killclient(const Arg *arg);
 static void killclientex(Client *c, int sigterm);
 static void killgroup(const Arg *arg);
@@ -1743,8 +1969,16 @@ static void killwin(Window w);
 static void lastcoordsrecall(Client *c, int reset, int relative, int *px, int *py);
 static void lastcoordsstore(Client *c);
 #endif // PATCH_MOUSE_POINTER_WARPING_RECALL
+static void latencybegin(LatencyMark *mark);
+static unsigned int latencybucket(unsigned long us);
+static unsigned long latencybucketus(unsigned int bucket);
+static void latencyend(Latency *l, const LatencyMark *mark);
+static void latencyflush(Display *dpy, XExtCodes *codes, const char *data, long len);
+static void latencyprint(FILE *f, const char *type, const Latency *l);
+static double latencyquantile(const Latency *l, double q);
 static int layoutstringtoindex(const char *layout);
 static int line_to_buffer(const char *text, char *buffer, size_t buffer_size, size_t line_length, size_t *index);
+static int loadfonts(void);
 #if PATCH_LOG_DIAGNOSTICS
 static void logdiagnostics(const Arg *arg);
 #if PATCH_IPC
@@ -1792,6 +2026,8 @@ static Client *nexttiledall(Client *c);
 #if PATCH_CLIENT_OPACITY
 static void opacity(Client *c, int focused);
 #endif // PATCH_CLIENT_OPACITY
+static void pacemotion(XEvent *ev, struct timespec *lastframe);
+static Bool pendingmotion(Display *d, XEvent *e, XPointer arg);
 static cJSON *parsejsonfile(const char *filename, const char *filetype);
 static int parselayoutjson(cJSON *layout);
 static void parsemon(Monitor *m, int index, int first);
@@ -1811,6 +2047,9 @@ static void print_supported_json(FILE *f, const supported_json array[], const si
 static void print_supported_rules_json(FILE *f, const supported_rules_json array[], const size_t len, const char *title, const char *indent);
 static void print_wrap(FILE *f, size_t line_length, const char *indent, size_t col1_size,
 	const char *col1_text, const char *line1_gap, const char *normal_gap, const char *col2_text);
+static int profilebegin(const char *trigger);
+static void profileend(void);
+static void profilemark(int phase, struct timespec *mark);
 static void propertynotify(XEvent *e);
 static void publishwindowstate(Client *c);
 #if PATCH_ALTTAB
@@ -1822,16 +2061,29 @@ static void raisewin(Monitor *m, Window w, int above_bar);
 #if PATCH_IPC
 static int read_socket(IPCMessageType *msg_type, uint32_t *msg_size, char **msg);
 #endif // PATCH_IPC
+static void reapchildren(void);
+#if PATCH_EVENT_RECORDING
+static void recordevent(XEvent *ev, int nested);
+static void recordipc(IPCMessageType type, const char *msg, uint32_t size);
+static int recordstart(const char *filename);
+static void recordstate(void);
+static void recordstop(void);
+static void recordwindow(Window w, int managed);
+#endif // PATCH_EVENT_RECORDING
 static Client *recttoclient(int x, int y, int w, int h, int onlyfocusable);
 static Monitor *recttomon(int x, int y, int w, int h);
 #if PATCH_IPC
 static int recv_message(uint8_t *msg_type, uint32_t *reply_size, uint8_t **reply);
 #endif // PATCH_IPC
+static void refocus(Client *sel);
+static void refocuslater(Client *sel, Monitor *m);
 #if PATCH_MOUSE_POINTER_WARPING
 static void refocuspointer(const Arg *arg);
 #endif // PATCH_MOUSE_POINTER_WARPING
+static void refocuswhenclear(Timer *t);
 static void reload(const Arg *arg);
 static int reload_rules(void);
+static void reloadinplace(const Arg *arg);
 static void reloadrules(const Arg *arg);
 static void removelinks(Client *c);
 #if PATCH_SYSTRAY
@@ -1840,7 +2092,11 @@ static void removesystrayicon(Client *i);
 #if PATCH_FOCUS_PIXEL && !PATCH_FOCUS_BORDER
 static void repelfocusborder(void);
 #endif // PATCH_FOCUS_PIXEL && !PATCH_FOCUS_BORDER
+#if PATCH_EVENT_RECORDING
+static int replay(const char *filename);
+#endif // PATCH_EVENT_RECORDING
 static void rescan(const Arg *arg);
+static void resetlayout(void);
 static void resize(Client *c, int x, int y, int w, int h, int interact);
 static void resizebarwin(Monitor *m);
 static void resizeclient(Client *c, int x, int y, int w, int h, int save_old);
@@ -1852,11 +2108,20 @@ static void resizeorfacts(const Arg *arg);
 static void resizerequest(XEvent *e);
 #endif // PATCH_SYSTRAY
 static void restack(Monitor *m);
+static void retally(Client *c);
+static int ruleadded(cJSON *rule);
+static unsigned long rulehash(cJSON *rule);
 static void run(void);
 #if PATCH_IPC
 static int run_command(char *name, char *args[], int argc);
 #endif // PATCH_IPC
 static void scan(void);
+static void scanmanage(Window w, XWindowAttributes *wa, unsigned int *n);
+static void scanprefetch(Window *wins, unsigned int num);
+static ScanWin *scanwin(Window w);
+static xcb_get_property_reply_t *scanprop(Window w, Atom prop);
+static int scansizehints(xcb_get_property_reply_t *p, XSizeHints *size);
+static XWMHints *scanwmhints(xcb_get_property_reply_t *p);
 #if PATCH_IPC
 static int send_message(IPCMessageType msg_type, uint32_t msg_size, uint8_t *msg);
 #endif // PATCH_IPC
@@ -1876,6 +2141,7 @@ static void setclientstate(Client *c, long state);
 static void setclienttagprop(Client *c);
 static void setclienttagpropex(Client *c, int index);
 #endif // PATCH_PERSISTENT_METADATA
+static void setconfigured(Client *c, int x, int y, int w, int h, int bw, int focused);
 #if PATCH_EWMH_TAGS
 static void setcurrentdesktop(void);
 #endif // PATCH_EWMH_TAGS
@@ -1889,6 +2155,7 @@ static void setfullscreen(Client *c, int fullscreen);
 #if PATCH_FLAG_HIDDEN
 static void sethidden(Client *c, int hidden, int rearrange);
 #endif // PATCH_FLAG_HIDDEN
+static Arena *setjsonarena(Arena *a);
 static void setlayout(const Arg *arg);
 static void setlayoutex(const Arg *arg);
 static void setlayoutmouse(const Arg *arg);
@@ -1907,6 +2174,11 @@ static int setup(void);
 #if PATCH_IPC
 static int setupepoll(void);
 #endif // PATCH_IPC
+#if PATCH_HOT_RELOAD
+static void setuphotreload(void);
+#endif // PATCH_HOT_RELOAD
+static void setupsignals(void);
+static void setuptimers(void);
 #if PATCH_MOUSE_POINTER_HIDING
 static void setup_sync_counters(void);
 #endif // PATCH_MOUSE_POINTER_HIDING
@@ -1926,7 +2198,6 @@ static void sigreloadrules(int unused);
 static void sigterm(int unused);
 #endif // PATCH_HANDLE_SIGNALS
 #if PATCH_STATUSCMD
-//static void sigchld(int unused);
 static void sigstatusbar(const Arg *arg);
 #endif // PATCH_STATUSCMD
 static int skipnextkeyevent(int type, unsigned int keycode, unsigned int state, unsigned long serial);
@@ -1945,7 +2216,7 @@ static void spawnhelp(const Arg *arg);
 static int strcmpbynum(const char *s1, const char *s2);
 #endif // PATCH_ALTTAB
 #if PATCH_IPC
-static int subscribe(const char *event);
+static int subscribe(const char *event, const char *delivery);
 #endif // PATCH_IPC
 #if PATCH_TERMINAL_SWALLOWING
 static Client *swallowingclient(Window w);
@@ -1955,11 +2226,14 @@ static void swapmon(const Arg *arg); // switch view() on specified monitor;
 static Monitor *systraytomon(Monitor *m);
 #endif // PATCH_SYSTRAY
 static void tag(const Arg *arg);
+static unsigned int tagcountmask(const unsigned int counts[]);
 static void tagmon(const Arg *arg);
 #if PATCH_FLAG_FOLLOW_PARENT
 static int tagsatellites(Client *p);
 #endif // PATCH_FLAG_FOLLOW_PARENT
 static int tagtoindex(unsigned int tag);
+static void tallyclient(Client *c, int add);
+static void tallytags(Monitor *m, unsigned int tagmask, unsigned int flags, int delta);
 #if PATCH_TERMINAL_SWALLOWING
 static Client *termforwin(const Client *w);
 #endif // PATCH_TERMINAL_SWALLOWING
@@ -1973,6 +2247,10 @@ static void textwithicon(char *text, Picture icon, unsigned int icw,
 	int invert
 );
 #endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG && ((PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS) || PATCH_CUSTOM_TAG_ICONS)
+static void timerarm(void);
+static unsigned long long timernow(void);
+static void timerstart(Timer *t, unsigned int ms, void (*func)(Timer *t));
+static void timerstop(Timer *t);
 #if PATCH_FLAG_ALWAYSONTOP
 static void togglealwaysontop(const Arg *arg);
 #endif // PATCH_FLAG_ALWAYSONTOP
@@ -2039,8 +2317,10 @@ static void unmapnotify(XEvent *e);
 #if PATCH_FLAG_GAME || PATCH_FLAG_HIDDEN || PATCH_FLAG_PANEL
 static void unminimize(Client *c);
 #endif // PATCH_FLAG_GAME || PATCH_FLAG_HIDDEN || PATCH_FLAG_PANEL
+static void updatebarheight(void);
 static int updatebarpos(Monitor *m);
 static void updatebars(void);
+static void updateclass(Client *c);
 static void updateclientlist(void);
 static void updateclientmonitors(void);
 #if PATCH_EWMH_TAGS
@@ -2048,6 +2328,7 @@ static void updatecurrentdesktop(void);
 #endif // PATCH_EWMH_TAGS
 static int updategeom(void);
 static void updatenumlockmask(void);
+static void updaterefreshrates(void);
 static void updatesizehints(Client *c);
 static void updatestatus(void);
 #if PATCH_SYSTRAY
@@ -2082,9 +2363,10 @@ static void viewactivenext(const Arg *arg);	// argument is monitor index;
 static void viewactiveprev(const Arg *arg);	// argument is monitor index;
 static void viewactiveex(Monitor *m, int direction);
 static void viewmontag(Monitor *m, unsigned int tagmask, int switchmon);
-static void waitforclearkeyboard(void);
 #if PATCH_MOUSE_POINTER_WARPING
 #if PATCH_MOUSE_POINTER_WARPING_SMOOTH
+static void warpend(int arrived);
+static void warpstep(Timer *t);
 static void warptoclient(Client *c, int smoothly, int force);
 #else // NO PATCH_MOUSE_POINTER_WARPING_SMOOTH
 static void warptoclient(Client *c, int force);
@@ -2094,6 +2376,9 @@ static void warptoclient(Client *c, int force);
 static void window_switcher(const Arg *arg);
 #endif // PATCH_EXTERNAL_WINDOW_ACTIVATION
 static pid_t winpid(Window w);
+#ifdef __linux__
+static pid_t winpidreply(xcb_res_query_client_ids_reply_t *r);
+#endif /* __linux__ */
 static Client *wintoclient(Window w);
 #if PATCH_SCAN_OVERRIDE_REDIRECTS
 static Client *wintoorclient(Window w);
@@ -2171,7 +2456,7 @@ Client *keypress_client = NULL;
 #endif // PATCH_KEY_HOLD
 
 #if PATCH_MOUSE_POINTER_WARPING
-static volatile sig_atomic_t warptoclient_stop_flag = 0;
+static int warptoclient_stop_flag = 0;
 #endif // PATCH_MOUSE_POINTER_WARPING
 
 static int (*xerrorxlib)(Display *, XErrorEvent *);
@@ -2198,13 +2483,107 @@ static void (*handler[LASTEvent]) (XEvent *) = {
 	#endif // PATCH_SYSTRAY
 	[UnmapNotify] = unmapnotify
 };
+// handled X event types, as reported with their latencies;
+static const char *handlernames[LASTEvent] = {
+	[ButtonPress] = "ButtonPress",
+	[ClientMessage] = "ClientMessage",
+	[ConfigureRequest] = "ConfigureRequest",
+	[ConfigureNotify] = "ConfigureNotify",
+	[DestroyNotify] = "DestroyNotify",
+	[EnterNotify] = "EnterNotify",
+	[Expose] = "Expose",
+	[FocusIn] = "FocusIn",
+	[KeyPress] = "KeyPress",
+	#if PATCH_ALT_TAGS || PATCH_KEY_HOLD
+	[KeyRelease] = "KeyRelease",
+	#endif // PATCH_ALT_TAGS || PATCH_KEY_HOLD
+	[MappingNotify] = "MappingNotify",
+	[MapRequest] = "MapRequest",
+	[MotionNotify] = "MotionNotify",
+	[PropertyNotify] = "PropertyNotify",
+	#if PATCH_SYSTRAY
+	[ResizeRequest] = "ResizeRequest",
+	#endif // PATCH_SYSTRAY
+	[UnmapNotify] = "UnmapNotify"
+};
 static Atom wmatom[WMLast], netatom[NetLast], xatom[XLast];
-#if PATCH_HANDLE_SIGNALS
-static volatile sig_atomic_t running = 1;
-static volatile sig_atomic_t killable = 0;
-#else
+// atom names, interned together by internatoms();
+static const char *wmatomnames[WMLast] = {
+	[WMProtocols] = "WM_PROTOCOLS",
+	[WMDelete] = "WM_DELETE_WINDOW",
+	[WMState] = "WM_STATE",
+	[WMTakeFocus] = "WM_TAKE_FOCUS",
+	[WMWindowRole] = "WM_WINDOW_ROLE",
+};
+static const char *netatomnames[NetLast] = {
+	[NetActiveWindow] = "_NET_ACTIVE_WINDOW",
+	[NetSupported] = "_NET_SUPPORTED",
+	[NetSystemTray] = "_NET_SYSTEM_TRAY_S0",
+	[NetSystemTrayOP] = "_NET_SYSTEM_TRAY_OPCODE",
+	[NetSystemTrayOrientation] = "_NET_SYSTEM_TRAY_ORIENTATION",
+	[NetSystemTrayOrientationHorz] = "_NET_SYSTEM_TRAY_ORIENTATION_HORZ",
+	[NetSystemTrayVisual] = "_NET_SYSTEM_TRAY_VISUAL",
+	[NetWMName] = "_NET_WM_NAME",
+	[NetWMAttention] = "_NET_WM_STATE_DEMANDS_ATTENTION",
+	#if PATCH_WINDOW_ICONS
+	[NetWMIcon] = "_NET_WM_ICON",
+	#endif // PATCH_WINDOW_ICONS
+	[NetWMState] = "_NET_WM_STATE",
+	[NetWMCheck] = "_NET_SUPPORTING_WM_CHECK",
+	[NetWMFullscreen] = "_NET_WM_STATE_FULLSCREEN",
+	#if PATCH_FLAG_STICKY
+	[NetWMSticky] = "_NET_WM_STATE_STICKY",
+	#endif // PATCH_FLAG_STICKY
+	#if PATCH_FLAG_ALWAYSONTOP
+	[NetWMStaysOnTop] = "_NET_WM_STATE_STAYS_ON_TOP",
+	#endif // PATCH_FLAG_ALWAYSONTOP
+	#if PATCH_FLAG_HIDDEN
+	[NetWMHidden] = "_NET_WM_STATE_HIDDEN",
+	#endif // PATCH_FLAG_HIDDEN
+	#if PATCH_MODAL_SUPPORT
+	[NetWMModal] = "_NET_WM_STATE_MODAL",
+	#endif // PATCH_MODAL_SUPPORT
+	[NetWMWindowType] = "_NET_WM_WINDOW_TYPE",
+	[NetWMWindowTypeDialog] = "_NET_WM_WINDOW_TYPE_DIALOG",
+	[NetWMWindowTypeSplash] = "_NET_WM_WINDOW_TYPE_SPLASH",
+	[NetWMWindowTypeDock] = "_NET_WM_WINDOW_TYPE_DOCK",
+	[NetWMWindowTypeMenu] = "_NET_WM_WINDOW_TYPE_MENU",
+	[NetWMWindowTypePopupMenu] = "_NET_WM_WINDOW_TYPE_POPUP_MENU",
+	#if PATCH_EWMH_TAGS
+	[NetDesktopViewport] = "_NET_DESKTOP_VIEWPORT",
+	[NetNumberOfDesktops] = "_NET_NUMBER_OF_DESKTOPS",
+	[NetCurrentDesktop] = "_NET_CURRENT_DESKTOP",
+	[NetDesktopNames] = "_NET_DESKTOP_NAMES",
+	#endif // PATCH_EWMH_TAGS
+	#if PATCH_SHOW_DESKTOP
+	[NetWMWindowTypeDesktop] = "_NET_WM_WINDOW_TYPE_DESKTOP",
+	#endif // PATCH_SHOW_DESKTOP
+	#if PATCH_LOG_DIAGNOSTICS
+	[NetWMAbove] = "_NET_WM_STATE_ABOVE",
+	[NetWMBelow] = "_NET_WM_STATE_BELOW",
+	[NetWMMaximizedH] = "_NET_WM_STATE_MAXIMIZED_HORZ",
+	[NetWMMaximizedV] = "_NET_WM_STATE_MAXIMIZED_VERT",
+	[NetWMShaded] = "_NET_WM_STATE_SHADED",
+	[NetWMSkipPager] = "_NET_WM_STATE_SKIP_PAGER",
+	[NetWMSkipTaskbar] = "_NET_WM_STATE_SKIP_TASKBAR",
+	#endif // PATCH_LOG_DIAGNOSTICS
+	[NetClientList] = "_NET_CLIENT_LIST",
+	[NetClientInfo] = "_NET_CLIENT_INFO",
+	#if PATCH_CLIENT_OPACITY
+	[NetWMWindowsOpacity] = "_NET_WM_WINDOW_OPACITY",
+	#endif // PATCH_CLIENT_OPACITY
+};
+static const char *xatomnames[XLast] = {
+	[Manager] = "MANAGER",
+	[Xembed] = "_XEMBED",
+	[XembedInfo] = "_XEMBED_INFO",
+	[Utf8String] = "UTF8_STRING",
+	[NetWMPid] = "_NET_WM_PID",
+	#if PATCH_ALPHA_CHANNEL
+	[NetWMCMSelection] = NULL,		// per screen, named by internatoms();
+	#endif // PATCH_ALPHA_CHANNEL
+};
 static int running = 1;
-#endif // PATCH_HANDLE_SIGNALS
 static Cur *cursor[CurLast];
 static Clr **scheme;
 static Display *dpy;
@@ -2223,6 +2602,11 @@ static Window focuswin = None;
 #if PATCH_FOCUS_PIXEL && !PATCH_FOCUS_BORDER
 static unsigned int fpcurpos = 0;
 #endif // PATCH_FOCUS_PIXEL && !PATCH_FOCUS_BORDER
+static unsigned long configures_sent = 0;		// client configure requests issued by resizeclient();
+static unsigned long configures_elided = 0;		// no-op client configure requests skipped by resizeclient();
+static int configurebatch = 0;					// >0 while arrange() queues client configure requests without syncing;
+static unsigned long layouts_cached = 0;		// arrangements replayed from the layout cache;
+static unsigned long layouts_computed = 0;		// arrangements computed by the layout function;
 #if PATCH_SHOW_DESKTOP
 #if PATCH_SHOW_DESKTOP_UNMANAGED
 static Window desktopwin = None;
@@ -2238,10 +2622,11 @@ static int altTabActive = 0;	// 1 for selection is highlighted, 0 is not highlig
 #endif // PATCH_ALTTAB
 
 #if PATCH_EXTERNAL_WINDOW_ACTIVATION
-static volatile sig_atomic_t enable_switching = 0;
+static int enable_switching = 0;				// while the window switcher runs;
+static pid_t switcher_pid;					// reaped by reapchildren();
 #endif // PATCH_EXTERNAL_WINDOW_ACTIVATION
 #if PATCH_HANDLE_SIGNALS
-static volatile sig_atomic_t closing = 0;
+static int closing = 0;
 #endif // PATCH_HANDLE_SIGNALS
 
 #if PATCH_ALPHA_CHANNEL
@@ -2252,13 +2637,76 @@ static Colormap cmap;
 #endif // PATCH_ALPHA_CHANNEL
 
 static xcb_connection_t *xcon;
+static ScanWin *scanwins = NULL;		// prefetched window state, only while scan() runs;
+static unsigned int nscanwins = 0;
+static unsigned int *scanhash = NULL;		// scanwins index + 1 by window id, probed linearly;
+static unsigned int nscanhash = 0;		// a power of two, at least twice nscanwins;
+static Atom scanatoms[ScanLast];			// the properties in ScanWin.props;
+static const char *profilephases[ProfileLast] = {
+	[ProfileLayout] = "layout", [ProfileRules] = "rules", [ProfileDisplay] = "display",
+	[ProfileAtoms] = "atoms", [ProfileFonts] = "fonts", [ProfileMonitors] = "monitors",
+	[ProfileColours] = "colours", [ProfileScan] = "scan", [ProfileManage] = "manage",
+	[ProfileArrange] = "arrange", [ProfileBars] = "bars",
+};
+static Profile profiles[2];				// the startup, and the latest reload;
+static Profile *profiling = NULL;		// being recorded;
+static Latency xlatency[LASTEvent];		// per handled X event type;
+static unsigned long xflushes = 0;		// request buffer flushes, counted by latencyflush();
+static Timer *timerwheel[TIMER_WHEEL_SLOTS];
+static unsigned long long timertick = 0;	// next ms the wheel has to run;
+static unsigned long long timerarmed = 0;	// expiry the timerfd is set for, 0 when disarmed;
+static unsigned int timercount = 0;			// pending timers;
+static int timer_fd = -1;
+static int signal_fd = -1;					// delivers the blocked signals to the main loop;
+static sigset_t sigorigmask;				// restored for spawned processes;
+static int sigorigsaved = 0;				// sigorigmask is kept from the first setupsignals();
+#ifdef XRANDR
+static int randr = 0;						// RandR 1.3 is available for refresh rates;
+#endif /* XRANDR */
+#if PATCH_HOT_RELOAD
+static Timer hotreloadtimer;				// debounces the rules/layout file changes;
+#endif // PATCH_HOT_RELOAD
+static Timer refocustimer;					// polls for the keys to be released;
+#if PATCH_MOUSE_POINTER_WARPING_SMOOTH
+static Timer warptimer;						// steps the smooth warp;
+static struct {
+	Window win;				// client window, or None for the root;
+	int x, y, w, h;			// target area;
+	int tpx, tpy;			// target pointer location;
+	int px, py;				// starting pointer location;
+	int lastx, lasty;		// last warped location;
+	int step, steps;
+	double due;				// ms after started that the next step is due;
+	struct timespec started;
+	int force;
+	int grabbed;
+} warp;
+#endif // PATCH_MOUSE_POINTER_WARPING_SMOOTH
+#if PATCH_FLAG_ACTIVATION_CLICK
+static Timer activationclicktimer;
+static XButtonEvent activationclick;		// press sent by focus(), released by the timer;
+#endif // PATCH_FLAG_ACTIVATION_CLICK
+#if PATCH_ALTTAB || PATCH_TORCH
+static Timer grabretrytimer;
+static struct {
+	void (*func)(const Arg *arg);
+	Arg arg;
+	unsigned int tries;
+	int retrying;		// func is being called from the timer;
+} grabretry;
+#endif // PATCH_ALTTAB || PATCH_TORCH
+static struct {
+	Window win;			// client to focus, or None to let focus() choose;
+	Monitor *mon;		// monitor of the unmanaged client;
+	Window from;		// selected client when held back; a focus change meanwhile cancels;
+} refocusing;
 
 #if PATCH_IPC
 static char *ipcsockpath = NULL;
 static int epoll_fd;
 static int dpy_fd;
 static unsigned int ipc_ignore_reply = 0;	// IPC client-side flag;
-static Monitor *lastselmon;
+static Monitor *lastselmon[IPC_DELIVERY_LAST];
 #endif // PATCH_IPC
 
 typedef struct charcodemap {
@@ -2285,6 +2733,36 @@ int charcodes_len;
 
 static unsigned int colourflags[LENGTH(colours)] = { 0 };
 
+// string settings the layout file may point into its own JSON tree;
+// restored to their config.h values before a layout is applied again;
+static char **layoutstrings[] = {
+	#if PATCH_ALTTAB
+	(char **)&monnumf,
+	#if PATCH_FONT_GROUPS
+	&tabFontgroup,
+	#endif // PATCH_FONT_GROUPS
+	#endif // PATCH_ALTTAB
+	#if PATCH_SHOW_DESKTOP
+	&desktopsymbol,
+	#if PATCH_SHOW_DESKTOP_BUTTON
+	&showdesktop_button,
+	#endif // PATCH_SHOW_DESKTOP_BUTTON
+	#endif // PATCH_SHOW_DESKTOP
+	#if PATCH_SHOW_MASTER_CLIENT_ON_TAG
+	&etagf,
+	&ptagf,
+	#endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG
+	#if PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_DEFAULT_ICON
+	&default_icon,
+	#if PATCH_SHOW_DESKTOP
+	&desktop_icon,
+	#endif // PATCH_SHOW_DESKTOP
+	#endif // PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_DEFAULT_ICON
+	NULL
+};
+static char *layoutstringsbackup[LENGTH(layoutstrings)];
+static char *tagsbackup[LENGTH(tags)];
+
 #define DWM_VERSION_STRING			"dwm-"VERSION"-"DWM_VERSION_SUFFIX" r"DWM_REVISION
 #define DWM_VERSION_STRING_LONG		"dwm-"VERSION"-"DWM_VERSION_SUFFIX" revision "DWM_REVISION
 #define DWM_VERSION_STRING_SHORT	"dwm-"VERSION"-"DWM_VERSION_SUFFIX
@@ -2310,6 +2788,7 @@ struct Pertag {
 	const Layout *ltidxs[LENGTH(tags) + 1][2]; /* matrix of tags and layouts indexes  */
 	int showbars[LENGTH(tags) + 1]; /* display bar for the current tag */
 	int enablegaps[LENGTH(tags) + 1]; /* enable/disable vanity gaps */
+	LayoutCache ltcaches[LENGTH(tags) + 1]; /* last layout result per tag */
 	int alttagsquiet[LENGTH(tags) + 1];	// don't raise the bar or show over fullscreen clients;
 	#if PATCH_CLASS_STACKING
 	int class_stacking[LENGTH(tags) + 1];
@@ -2322,6 +2801,9 @@ struct Pertag {
 #endif // PATCH_PERTAG
 
 #include "vanitygaps.c"
+#if PATCH_EVENT_RECORDING
+#include "record.c"
+#endif // PATCH_EVENT_RECORDING
 
 /* compile-time check if all tags fit into an unsigned int bit array. */
 struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
@@ -2352,6 +2834,7 @@ activateclient(Client *c, int setfocus)
 	#if PATCH_FLAG_HIDDEN
 	if (c->ishidden) {
 		c->ishidden = False;
+		retally(c);
 		#if PATCH_PERSISTENT_METADATA
 		setclienttagprop(c);
 		#endif // PATCH_PERSISTENT_METADATA
@@ -2377,6 +2860,19 @@ activateclient(Client *c, int setfocus)
 	#endif // PATCH_MOUSE_POINTER_WARPING
 }
 
+#if PATCH_FLAG_ACTIVATION_CLICK
+// the second half of focus()'s activation click, sent after a ms;
+void
+activationclickrelease(Timer *t)
+{
+	if (!wintoclient(activationclick.window))
+		return;
+	activationclick.type = ButtonRelease;
+	XSendEvent(dpy, activationclick.window, True, ButtonReleaseMask, (XEvent *)&activationclick);
+	XFlush(dpy);
+}
+#endif // PATCH_FLAG_ACTIVATION_CLICK
+
 void
 adjustfloatposition(Client *c)
 {
@@ -2607,6 +3103,7 @@ applyrulesdeferred(Client *c, char *oldtitle)
 			c->tags = tags;
 		Monitor *mm = c->mon;
 		c->mon = m;
+		retally(c);
 		if (floating != c->isfloating_override && c->isfloating) {
 			if (c->isfloating) {
 				// move client into appropriate position;
@@ -2682,6 +3179,144 @@ applyrulesdeferred(Client *c, char *oldtitle)
 
 }
 
+// after the rules are replaced, re-run deferred rule evaluation for the
+// clients that had rules applied which have since been changed or removed,
+// and evaluate the rules new to this reload against every client;
+void
+applyrulesreloaded(unsigned long *oldhashes, size_t nold)
+{
+	unsigned long *hashes;
+	size_t i, j, n = 0;
+	int k, defer = 0, adddefer = 0, ruledefer;
+	unsigned int affected = 0, count = 0;
+	Client *c, **clients;
+	char *changed;
+	Monitor *m;
+	cJSON *r, *r_node;
+
+	if (!rules_json || !mons)
+		return;
+
+	for (r = rules_json->child; r; r = r->next)
+		++n;
+	hashes = ecalloc(n ? n : 1, sizeof(unsigned long));
+	rulesadded = ecalloc(n ? n : 1, sizeof(unsigned long));
+	nrulesadded = 0;
+	for (i = 0, r = rules_json->child; r; r = r->next) {
+		hashes[i] = rulehash(r);
+		k = ((r_node = cJSON_GetObjectItemCaseSensitive(r, "defer-rule")) && json_isboolean(r_node) && r_node->valueint);
+		defer |= k;
+		for (j = 0; j < nold && oldhashes[j] != hashes[i]; j++);
+		if (j == nold) {
+			rulesadded[nrulesadded++] = hashes[i];
+			adddefer |= k;
+		}
+		++i;
+	}
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			++count;
+	clients = ecalloc(count ? count : 1, sizeof(Client *));
+	changed = ecalloc(count ? count : 1, sizeof(char));
+
+	for (count = 0, m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next) {
+			clients[count] = c;
+			if (c->nrulehashes == 0)
+				;
+			else if (c->nrulehashes == -1) {
+				c->nrulehashes = 0;
+				changed[count] = 1;
+			}
+			else {
+				// keep the rules that are still in place, verbatim;
+				for (j = k = 0; j < c->nrulehashes; j++) {
+					for (i = 0; i < n && hashes[i] != c->rulehashes[j]; i++);
+					if (i < n)
+						c->rulehashes[k++] = c->rulehashes[j];
+				}
+				changed[count] = (k != c->nrulehashes);
+				c->nrulehashes = k;
+			}
+			++count;
+		}
+
+	// clients can change monitor, so evaluate them outside of the walk;
+	for (i = 0; i < count; i++) {
+		c = clients[i];
+		if (changed[i])
+			++affected;
+		if (changed[i] ? !defer && !nrulesadded : !nrulesadded)
+			continue;
+		ruledefer = c->ruledefer;
+		rulesaddedonly = !changed[i];
+		c->ruledefer = 1;
+		applyrulesdeferred(c, NULL);
+		// a deferred rule still pending stays pending, and an unmatched client
+		// only waits on its title if a new deferred rule might match it later;
+		if (rulesaddedonly && (ruledefer == 1 || (c->ruledefer == 1 && !adddefer)))
+			c->ruledefer = ruledefer;
+	}
+	rulesaddedonly = 0;
+
+	if (affected || nrulesadded) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: %u client%s affected by changed rules, %u rule%s added%s.\n",
+			affected, affected == 1 ? "" : "s", (unsigned int)nrulesadded, nrulesadded == 1 ? "" : "s",
+			defer ? ", deferred rules re-evaluated" : ""
+		);
+	}
+
+	free(rulesadded);
+	rulesadded = NULL;
+	nrulesadded = 0;
+	free(changed);
+	free(clients);
+	free(hashes);
+}
+
+// hash of a rule's content, ignoring the state dwm keeps on it;
+unsigned long
+rulehash(cJSON *rule)
+{
+	unsigned long hash = 2166136261UL;
+	const unsigned char *p;
+	cJSON *n;
+
+	for (n = rule->child; n; n = n->next) {
+		if (n->string && !strcmp(n->string, "parsed"))
+			continue;
+		hash = (hash ^ (unsigned long)(n->type & 0xFF)) * 16777619UL;
+		if (n->string)
+			for (p = (const unsigned char *)n->string; *p; p++)
+				hash = (hash ^ *p) * 16777619UL;
+		if (n->valuestring)
+			for (p = (const unsigned char *)n->valuestring; *p; p++)
+				hash = (hash ^ *p) * 16777619UL;
+		else if (cJSON_IsNumber(n))
+			for (p = (const unsigned char *)&n->valuedouble; p < (const unsigned char *)(&n->valuedouble + 1); p++)
+				hash = (hash ^ *p) * 16777619UL;
+		if (n->child)
+			hash = (hash ^ rulehash(n)) * 16777619UL;
+	}
+	return hash;
+}
+
+// whether a rule is new to the reload being applied;
+int
+ruleadded(cJSON *rule)
+{
+	unsigned long hash;
+	size_t i;
+
+	if (!nrulesadded)
+		return 0;
+	hash = rulehash(rule);
+	for (i = 0; i < nrulesadded && rulesadded[i] != hash; i++);
+	return (i < nrulesadded);
+}
+
 int
 applyrules_stringtest(cJSON *rule_node, const char *string, int string_len, int match_type)
 {
@@ -2820,7 +3455,6 @@ applyrules(Client *c, int deferred, char *oldtitle)
 	#endif // PATCH_LOG_DIAGNOSTICS
 	char role[64];
 	cJSON *r_json;
-	XClassHint ch = { NULL, NULL };
 
 	#if PATCH_FLAG_PARENT
 	Monitor *mm;
@@ -2851,9 +3485,8 @@ applyrules(Client *c, int deferred, char *oldtitle)
 	Atom wtype = getatomprop(c, netatom[NetWMWindowType]);
 
 	/* rule matching */
-	XGetClassHint(dpy, c->win, &ch);
-	class    = ch.res_class ? ch.res_class : broken;
-	instance = ch.res_name  ? ch.res_name  : broken;
+	class    = c->class[0]    ? c->class    : broken;
+	instance = c->instance[0] ? c->instance : broken;
 
 	gettextprop(c->win, wmatom[WMWindowRole], role, sizeof(role));
 	size_t sz_class = (class == broken ? 0 : strlen(class));
@@ -2890,8 +3523,10 @@ applyrules(Client *c, int deferred, char *oldtitle)
 		c->toplevel = 1;
 	}
 
-	if (!deferred)
+	if (!deferred) {
 		setdefaultvalues(c);
+		c->nrulehashes = 0;
+	}
 
 	// some kind of broken window;
 	if (class == broken && instance == broken && c->name[0] == '\0')
@@ -2921,7 +3556,7 @@ applyrules(Client *c, int deferred, char *oldtitle)
 		int exclusive = ((r_node = cJSON_GetObjectItemCaseSensitive(r_json, "exclusive")) && json_isboolean(r_node)) ? r_node->valueint : 0;
 
 		int defer = ((r_node = cJSON_GetObjectItemCaseSensitive(r_json, "defer-rule")) && json_isboolean(r_node)) ? r_node->valueint : 0;
-		if (deferred && (!defer || c->ruledefer != 1))
+		if (deferred && (rulesaddedonly || !defer || c->ruledefer != 1) && !ruleadded(r_json))
 			continue;
 
 		int has_parent = ((r_node = cJSON_GetObjectItemCaseSensitive(r_json, "if-has-parent")) && json_isboolean(r_node)) ? r_node->valueint : -1;
@@ -2948,7 +3583,7 @@ applyrules(Client *c, int deferred, char *oldtitle)
 							||	(p->parent_is && applyrules_stringtest(p->parent_is, c->name, sz_title, APPLYRULES_STRING_EXACT))
 							) {
 								XGetClassHint(dpy, p->win, &pch);
-								p->parent_late = (strcmp(pch.res_class ? pch.res_class : broken, ch.res_class ? ch.res_class : broken) == 0) ? 0 : 1;
+								p->parent_late = (strcmp(pch.res_class ? pch.res_class : broken, class) == 0) ? 0 : 1;
 								if (pch.res_class)
 									XFree(pch.res_class);
 								if (pch.res_name)
@@ -3094,6 +3729,18 @@ applyrules(Client *c, int deferred, char *oldtitle)
 			if (!match)
 				continue;
 
+			if (c->nrulehashes >= 0) {
+				unsigned long hash = rulehash(r_json);
+				int i;
+				for (i = 0; i < c->nrulehashes && c->rulehashes[i] != hash; i++);
+				if (i == c->nrulehashes) {
+					if (i < LENGTH(c->rulehashes))
+						c->rulehashes[c->nrulehashes++] = hash;
+					else
+						c->nrulehashes = -1;
+				}
+			}
+
 			// use to prevent spamming the same warning messages when re-using a rule;
 			parsed = ((r_node = cJSON_GetObjectItemCaseSensitive(r_json, "parsed")) && json_isboolean(r_node)) ? r_node->valueint : 0;
 			if (!parsed) {
@@ -3179,7 +3826,7 @@ applyrules(Client *c, int deferred, char *oldtitle)
 						||	(c->parent_is && applyrules_stringtest(c->parent_is, p->name, sz_sp_title, APPLYRULES_STRING_EXACT))
 						) {
 							XGetClassHint(dpy, p->win, &pch);
-							c->parent_late = (strcmp(pch.res_class ? pch.res_class : broken, ch.res_class ? ch.res_class : broken) == 0) ? 0 : 1;
+							c->parent_late = (strcmp(pch.res_class ? pch.res_class : broken, class) == 0) ? 0 : 1;
 							if (pch.res_class)
 								XFree(pch.res_class);
 							if (pch.res_name)
@@ -3642,13 +4289,9 @@ skip_parenting:
 	#endif // PATCH_SHOW_DESKTOP
 
 	#if PATCH_TERMINAL_SWALLOWING
-	if (!ch.res_class || !ch.res_name)
+	if (class == broken || instance == broken)
 		c->noswallow = 1;
 	#endif // PATCH_TERMINAL_SWALLOWING
-	if (ch.res_class)
-		XFree(ch.res_class);
-	if (ch.res_name)
-		XFree(ch.res_name);
 
 	return matched;
 }
@@ -3744,11 +4387,15 @@ void
 arrange(Monitor *m)
 {
 	if (m) {
+		configurebatch++;
 		arrangemon(m);
+		configurebatch--;
 		restack(m);
 		showhide(m->stack, 0);
 	} else for (m = mons; m; m = m->next) {
+		configurebatch++;
 		arrangemon(m);
+		configurebatch--;
 		restack(m);
 		showhide(m->stack, 0);
 	}
@@ -3768,8 +4415,10 @@ arrangemon(Monitor *m)
 	// validate all client pids;
 	for (c = m->clients; c; c = c->next)
 		#if PATCH_FLAG_IGNORED
-		if (!validate_pid(c))
+		if (!validate_pid(c)) {
 			c->isignored = 1;
+			retally(c);
+		}
 		#else // NO PATCH_FLAG_IGNORED
 		validate_pid(c);
 		#endif // PATCH_FLAG_IGNORED
@@ -3779,6 +4428,7 @@ arrangemon(Monitor *m)
 		if (c->dormant == -1) {
 			detach(c);
 			detachstack(c);
+			tallyclient(c, 0);
 			removelinks(c);
 			#if PATCH_WINDOW_ICONS
 			freeicon(c);
@@ -3831,7 +4481,7 @@ arrangemon(Monitor *m)
 		groupallclassstacks(m);
 
 		if (m->lt[m->sellt]->arrange)
-			m->lt[m->sellt]->arrange(m);
+			arrangelayout(m);
 
 		for (c = m->clients; c; c = c->next)
 		{
@@ -3845,7 +4495,7 @@ arrangemon(Monitor *m)
 	else
 	#endif // PATCH_CLASS_STACKING
 	if (m->lt[m->sellt]->arrange)
-		m->lt[m->sellt]->arrange(m);
+		arrangelayout(m);
 	/*
 	// compensate for possible earlier exclusion of window border;
 	if (m == selmon && m->sel && !solitary(m->sel)
@@ -3951,6 +4601,7 @@ arrangemon_process_classstack(Client *c, int added_to_stack)
 int
 attach_stackhead(Client *c)
 {
+	retally(c);
 	if (c->isfloating || !ISVISIBLE(c)
 		#if PATCH_FLAG_HIDDEN
 		|| c->ishidden
@@ -4050,12 +4701,14 @@ attach(Client *c)
 {
 	c->next = c->mon->clients;
 	c->mon->clients = c;
+	retally(c);
 }
 
 #if PATCH_ATTACH_BELOW_AND_NEWMASTER
 void
 attachBelow(Client *c)
 {
+	retally(c);
 	// if there is nothing on the monitor or the selected client is floating, attach as normal
 	if(c->mon->sel == NULL || c->mon->sel->isfloating || !ISVISIBLE(c)) {
 		int nmaster = 1;
@@ -4257,6 +4910,7 @@ swallow(Client *p, Client *c)
 		return;
 	detach(c);
 	detachstackex(c);
+	tallyclient(c, 0);
 	if (c->mon->sel == c)
 		c->mon->sel = p;
 
@@ -4273,6 +4927,7 @@ swallow(Client *p, Client *c)
 
 	updatetitle(p, 1);
 	XMoveResizeWindow(dpy, p->win, p->x, p->y, p->w, p->h);
+	p->cfgvalid = c->cfgvalid = 0;
 	#if PATCH_WINDOW_ICONS
 	freeicon(p);
 	p->icon = c->icon;
@@ -4289,6 +4944,7 @@ unswallow(Client *c)
 	DEBUG("unswallow(c): %s\n", c->name);
 
 	c->win = c->swallowing->win;
+	c->cfgvalid = 0;
 	#if PATCH_WINDOW_ICONS
 	updateicon(c);
 	#endif // PATCH_WINDOW_ICONS
@@ -4302,6 +4958,7 @@ unswallow(Client *c)
 	arrange(c->mon);
 	XMapWindow(dpy, c->win);
 	XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+	c->cfgvalid = 0;
 	setclientstate(c, NormalState);
 	focus(NULL, 0);
 	arrange(c->mon);
@@ -4363,16 +5020,7 @@ buttonpress(XEvent *e)
 		switch (m->bar[zone].type) {
 			case TagBar:
 				i = 0;
-				for (c = m->clients; c; c = c->next)
-					if (!c->dormant
-						#if PATCH_FLAG_PANEL
-						&& !c->ispanel
-						#endif // PATCH_FLAG_PANEL
-						#if PATCH_FLAG_IGNORED
-						&& !c->isignored
-						#endif // PATCH_FLAG_IGNORED
-						)
-						occ |= c->tags == 255 ? 0 : c->tags;
+				occ = tagcountmask(m->tagbaroccupied);
 				do {
 					#if PATCH_HIDE_VACANT_TAGS
 					// do not reserve space for vacant tags;
@@ -4649,6 +5297,7 @@ logdatetime(stderr);
 fprintf(stderr, "dwm: starting cleanup...\n");
 
 	free(charcodes);
+	free(layoutclients);
 
 	#if PATCH_ALTTAB
 	altTabEnd();
@@ -4797,7 +5446,11 @@ cleanupmon(Monitor *mon)
 			XRenderFreePicture(dpy, mon->tagicons[i]);
 	#endif // PATCH_CUSTOM_TAG_ICONS
 	#if PATCH_PERTAG
+	for (int i = 0; i <= LENGTH(tags); i++)
+		free(mon->pertag->ltcaches[i].clients);
 	free(mon->pertag);
+	#else // NO PATCH_PERTAG
+	free(mon->ltcache.clients);
 	#endif // PATCH_PERTAG
 	free(mon);
 }
@@ -5216,8 +5869,11 @@ configurerequest(XEvent *e)
 						c->y = m->my + (m->mh / 2 - HEIGHT(c) / 2); /* centre in y direction */
 				}
 			}
-			if (ISVISIBLE(c))
+			if (ISVISIBLE(c)) {
+				// the client expects a ConfigureNotify even if nothing changes;
+				c->cfgvalid = 0;
 				resizeclient(c, c->x, c->y, c->w, c->h, 0);
+			}
 			#if PATCH_CROP_WINDOWS
 			if (cc)
 				cropresize(cc);
@@ -5553,6 +6209,7 @@ cropwindow(Client *c)
 		c->crop = ecalloc(1, sizeof(Client));
 		memcpy(c->crop, c, sizeof(Client));
 		c->crop->crop = NULL;
+		c->crop->tallymon = NULL;
 		c->crop->x = c->crop->y = c->crop->bw = 0;
 		c->basew = c->baseh = c->mina = 0;
 		//c->maxa = c->maxw = c->maxh = c->incw = c->inch = 0;
@@ -5588,9 +6245,13 @@ cropdelete(Client *c)
 	XReparentWindow(dpy, c->crop->win, root, c->crop->x, c->crop->y);
 	XDestroyWindow(dpy, c->win);
 	crop = c->crop;
+	crop->tallymon = c->tallymon;
+	crop->tallytags = c->tallytags;
+	crop->tallyflags = c->tallyflags;
 	memcpy(c, c->crop, sizeof(Client));
 	c->crop = NULL;
 	free(crop);
+	retally(c);
 	resize(c, c->x, c->y, c->w, c->h, 0);
 	focus(c, 0);
 	XCheckTypedWindowEvent(dpy, c->win, UnmapNotify, &ev);
@@ -5658,6 +6319,96 @@ cyclelayout(const Arg *arg)
 	#endif // PATCH_MOUSE_POINTER_WARPING
 }
 
+// fill in the colour schemes left unset by config.h and the layout file;
+void
+defaultcolours(void)
+{
+	#if PATCH_COLOUR_BAR
+	setdefaultcolours(colours[SchemeTagBar], colours[SchemeNorm]);
+	#if PATCH_FLAG_HIDDEN
+	setdefaultcolours(colours[SchemeTagBarHide], colours[SchemeHide]);
+	#endif // PATCH_FLAG_HIDDEN
+	setdefaultcolours(colours[SchemeTagBarSel], colours[SchemeSel]);
+	setdefaultcolours(colours[SchemeLayout], colours[SchemeNorm]);
+	setdefaultcolours(colours[SchemeTitle], colours[SchemeNorm]);
+	setdefaultcolours(colours[SchemeTitleSel], colours[SchemeSel]);
+	setdefaultcolours(colours[SchemeStatus], colours[SchemeNorm]);
+	#endif // PATCH_COLOUR_BAR
+	#if PATCH_RAINBOW_TAGS
+	setdefaultcolours(colours[SchemeTag1], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag2], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag3], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag4], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag5], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag6], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag7], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag8], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	setdefaultcolours(colours[SchemeTag9], colours[
+		#if PATCH_COLOUR_BAR
+		SchemeTagBarSel
+		#else // NO PATCH_COLOUR_BAR
+		SchemeSel
+		#endif // PATCH_COLOUR_BAR
+	]);
+	#endif // PATCH_RAINBOW_TAGS
+	#if PATCH_ALTTAB
+	setdefaultcolours(colours[SchemeTabNorm], colours[SchemeNorm]);
+	setdefaultcolours(colours[SchemeTabSel], colours[SchemeSel]);
+	setdefaultcolours(colours[SchemeTabUrg], colours[SchemeUrg]);
+	#if PATCH_FLAG_HIDDEN
+	setdefaultcolours(colours[SchemeTabHide], colours[SchemeTabNorm]);
+	#endif // PATCH_FLAG_HIDDEN
+	#endif // PATCH_ALTTAB
+}
+
 #if PATCH_SHOW_DESKTOP
 int
 desktopvalid(Client *c)
@@ -5891,9 +6642,23 @@ dirtomon(int dir)
 	return m;
 }
 
-#if PATCH_DRAG_FACTS
+// call the handler for an event, recording its latency;
 void
-dragfact(const Arg *arg)
+dispatch(XEvent *ev)
+{
+	LatencyMark mark;
+
+	#if PATCH_EVENT_RECORDING
+	recordevent(ev, 0);
+	#endif // PATCH_EVENT_RECORDING
+	latencybegin(&mark);
+	handler[ev->type](ev);
+	latencyend(&xlatency[ev->type], &mark);
+}
+
+#if PATCH_DRAG_FACTS
+void
+dragfact(const Arg *arg)
 {
 	#if PATCH_FOCUS_FOLLOWS_MOUSE
 	checkmouseovermonitor(selmon);
@@ -5918,7 +6683,7 @@ dragfact(const Arg *arg)
 	Client *c;
 	Monitor *m = selmon;
 	XEvent ev;
-	Time lasttime = 0;
+	struct timespec lastframe = { 0 };
 
 	for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++);
 	if (!(c = m->sel) || !n || !m->lt[m->sellt]->arrange)
@@ -6033,8 +6798,12 @@ dragfact(const Arg *arg)
 		XUnmapWindow(dpy, focuswin);
 	#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 
+	updaterefreshrates();
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		#if PATCH_EVENT_RECORDING
+		recordevent(&ev, 1);
+		#endif // PATCH_EVENT_RECORDING
 		switch (ev.type) {
 		case ConfigureRequest:
 		case Expose:
@@ -6042,9 +6811,7 @@ dragfact(const Arg *arg)
 			handler[ev.type](&ev);
 			break;
 		case MotionNotify:
-			if ((ev.xmotion.time - lasttime) <= (1000 / 40))
-				continue;
-			lasttime = ev.xmotion.time;
+			pacemotion(&ev, &lastframe);
 
 			dist_x = (lock_x ? 0 : ev.xmotion.x - px);
 			dist_y = (lock_y ? 0 : ev.xmotion.y - py);
@@ -6684,18 +7451,33 @@ drawbar(Monitor *m, int skiptags)
 				mc[i] = NULL;
 				#endif // (PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS) || PATCH_CUSTOM_TAG_ICONS
 				#if PATCH_FLAG_HIDDEN
-				visible[i] = hidden[i] = 0;
+				hidden[i] = m->tagbarhidden[i];
+				visible[i] = m->tagbarclients[i] - m->tagbarhidden[i];
 				#endif // PATCH_FLAG_HIDDEN
 				#if PATCH_CLIENT_INDICATORS
-				total[i] = 0;
+				total[i] = m->tagbarclients[i];
 				#if PATCH_FLAG_STICKY
-				sticky[i] = 0;
+				sticky[i] = m->tagbarsticky[i];
 				#endif // PATCH_FLAG_STICKY
 				#endif // PATCH_CLIENT_INDICATORS
 				m->tagw[i] = 0;
 			}
+			occ = tagcountmask(m->tagbaroccupied);
+			urg = urgency ? tagcountmask(m->tagbarurgent) : 0;
 
-			for (c = m->clients; c; c = c->next) {
+			// the tag counts are kept by tallyclient(), so the clients only
+			// need to be walked for the master client or icon on each tag;
+			#if PATCH_SHOW_MASTER_CLIENT_ON_TAG || (PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS)
+			#if PATCH_SHOW_MASTER_CLIENT_ON_TAG
+			c = m->showmaster ? m->clients : NULL;
+			#if PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS
+			if (m->showiconsontags)
+				c = m->clients;
+			#endif // PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS
+			#else // NO PATCH_SHOW_MASTER_CLIENT_ON_TAG
+			c = m->clients;
+			#endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG
+			for (; c; c = c->next) {
 				if (c->dormant
 					#if PATCH_FLAG_IGNORED
 					|| c->isignored
@@ -6705,15 +7487,6 @@ drawbar(Monitor *m, int skiptags)
 					|| c->ultparent->ispanel
 					#endif // PATCH_FLAG_PANEL
 					) continue;
-				//occ |= c->tags == TAGMASK ? 0 : c->tags;
-				if (c->tags != TAGMASK)
-					occ |= c->tags;
-				if (c->isurgent && urgency
-					#if PATCH_FLAG_HIDDEN
-					&& !c->ishidden
-					#endif // PATCH_FLAG_HIDDEN
-					)
-					urg |= c->tags;
 
 				#if PATCH_SHOW_MASTER_CLIENT_ON_TAG
 				if (m->showmaster) {
@@ -6769,31 +7542,8 @@ drawbar(Monitor *m, int skiptags)
 							mc[i] = c;
 				}
 				#endif // PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS
-				#if PATCH_FLAG_HIDDEN || PATCH_CLIENT_INDICATORS
-				for (i = 0; i < LENGTH(tags); i++) {
-					if (
-						#if 0// PATCH_SHOW_DESKTOP
-						showdesktop ? desktopvalidex(c, 1<<i, 0) :
-						#endif // PATCH_SHOW_DESKTOP
-						c->tags & (1<<i)
-					) {
-						#if PATCH_CLIENT_INDICATORS
-						++total[i];
-						#endif // PATCH_CLIENT_INDICATORS
-						#if PATCH_FLAG_HIDDEN
-						if (c->ishidden)
-							++hidden[i];
-						else
-							++visible[i];
-						#endif // PATCH_FLAG_HIDDEN
-					}
-					#if PATCH_FLAG_STICKY && PATCH_CLIENT_INDICATORS
-					else if (c->issticky)
-						++sticky[i];
-					#endif // PATCH_FLAG_STICKY && PATCH_CLIENT_INDICATORS
-				}
-				#endif // PATCH_FLAG_HIDDEN || PATCH_CLIENT_INDICATORS
 			}
+			#endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG || (PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_ON_TAGS)
 
 			#if PATCH_FLAG_PANEL
 			x = px;
@@ -7853,6 +8603,7 @@ void drawfocusborder(int remove)
 			if (desktopvalid(c))
 			#endif // PATCH_SHOW_DESKTOP
 			XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+			c->cfgvalid = 0;
 		}
 		#elif PATCH_FOCUS_PIXEL
 		fpcurpos = 0;
@@ -7866,6 +8617,7 @@ void drawfocusborder(int remove)
 	#if PATCH_FOCUS_BORDER
 	if (wa.border_width) {
 		unsigned int size = 0;
+		c->cfgvalid = 0;
 		switch (fbpos) {
 			case FOCUS_BORDER_E:
 				if (!c->isfloating || c->x + WIDTH(c) < c->mon->wx + c->mon->ww) {
@@ -7981,6 +8733,15 @@ enableurgency(const Arg *arg)
 }
 #endif // PATCH_IPC
 
+// milliseconds on the monotonic clock since the given time;
+double
+elapsedms(const struct timespec *since)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec) * 1000.0 + (now.tv_nsec - since->tv_nsec) / 1000000.0;
+}
+
 void
 enternotify(XEvent *e)
 {
@@ -8765,6 +9526,56 @@ get_dwm_client(Window win)
 	return 0;
 }
 
+int
+get_clients(int argc, char *argv[])
+{
+	if (connect_to_socket() == -1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to connect to socket \"%s\".\n", ipcsockpath);
+		return 0;
+	}
+
+	char *msg;
+	size_t msg_size;
+
+	// Message format, from <filter> <value> pairs:
+	// {
+	//   "monitor": <num>, "tags": <mask>, "class": "<class>", "offset": <n>, "limit": <n>
+	// }
+	cJSON *gen = cJSON_CreateObject();
+	for (int i = 0; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "class"))
+			cJSON_AddStringToObject(gen, argv[i], argv[i + 1]);
+		else
+			cJSON_AddIntegerToObject(gen, argv[i], atol(argv[i + 1]));
+	}
+
+	msg = cJSON_PrintUnformatted(gen);
+	msg_size = strlen(msg) + 1;
+
+	send_message(IPC_TYPE_GET_CLIENTS, msg_size, (uint8_t *)msg);
+
+	print_socket_reply();
+
+	cJSON_free(msg);
+	cJSON_Delete(gen);
+
+	return 0;
+}
+
+int
+get_latency()
+{
+	if (connect_to_socket() == -1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to connect to socket \"%s\".\n", ipcsockpath);
+		return 0;
+	}
+	send_message(IPC_TYPE_GET_LATENCY, 1, (uint8_t *)"");
+	print_socket_reply();
+	return 0;
+}
+
 int
 get_layouts()
 {
@@ -8792,6 +9603,32 @@ get_monitors()
 	return 0;
 }
 
+int
+get_profile()
+{
+	if (connect_to_socket() == -1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to connect to socket \"%s\".\n", ipcsockpath);
+		return 0;
+	}
+	send_message(IPC_TYPE_GET_PROFILE, 1, (uint8_t *)"");
+	print_socket_reply();
+	return 0;
+}
+
+int
+get_state_shm()
+{
+	if (connect_to_socket() == -1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to connect to socket \"%s\".\n", ipcsockpath);
+		return 0;
+	}
+	send_message(IPC_TYPE_GET_STATE_SHM, 1, (uint8_t *)"");
+	print_socket_reply();
+	return 0;
+}
+
 int
 get_tags()
 {
@@ -8837,6 +9674,10 @@ getatompropex(Window w, Atom prop)
 	unsigned long dl;
 	unsigned char *p = NULL;
 	Atom da, atom = None;
+	ScanWin *sw;
+
+	if (prop == netatom[NetWMWindowType] && (sw = scanwin(w)))
+		return sw->wtype;
 
 	/* FIXME getatomprop should return the number of items and a pointer to
 	 * the stored data instead of this workaround */
@@ -9206,6 +10047,48 @@ static uint32_t prealpha(uint32_t p) {
 	return (rb & 0xFF00FFu) | (g & 0x00FF00u) | (a << 24u);
 }
 
+// picture of the _NET_WM_ICON image closest to iconsize, None if the data is malformed;
+Picture
+iconpicture(unsigned long *p, unsigned long n, unsigned int *picw, unsigned int *pich, unsigned int iconsize)
+{
+	unsigned long *bstp = NULL;
+	uint32_t w, h, sz, icw, ich;
+	{
+		unsigned long *i; const unsigned long *end = p + n;
+		uint32_t bstd = UINT32_MAX, d, m;
+		for (i = p; i < end - 1; i += sz) {
+			if ((w = *i++) >= 16384 || (h = *i++) >= 16384) return None;
+			if ((sz = w * h) > end - i) break;
+			if ((m = w > h ? w : h) >= iconsize && (d = m - iconsize) < bstd) { bstd = d; bstp = i; }
+		}
+		if (!bstp) {
+			for (i = p; i < end - 1; i += sz) {
+				if ((w = *i++) >= 16384 || (h = *i++) >= 16384) return None;
+				if ((sz = w * h) > end - i) break;
+				if ((d = iconsize - (w > h ? w : h)) < bstd) { bstd = d; bstp = i; }
+			}
+		}
+		if (!bstp) return None;
+	}
+
+	if ((w = *(bstp - 2)) == 0 || (h = *(bstp - 1)) == 0) return None;
+
+	if (w <= h) {
+		ich = iconsize; icw = w * iconsize / h;
+		if (icw == 0) icw = 1;
+	}
+	else {
+		icw = iconsize; ich = h * iconsize / w;
+		if (ich == 0) ich = 1;
+	}
+	*picw = icw; *pich = ich;
+
+	uint32_t i, *bstp32 = (uint32_t *)bstp;
+	for (sz = w * h, i = 0; i < sz; ++i) bstp32[i] = prealpha(bstp[i]);
+
+	return drw_picture_create_resized(drw, (char *)bstp, w, h, icw, ich);
+}
+
 Picture
 geticonprop(
 	#if PATCH_WINDOW_ICONS_DEFAULT_ICON || PATCH_WINDOW_ICONS_CUSTOM_ICONS
@@ -9217,7 +10100,6 @@ geticonprop(
 	int format;
 	unsigned long n, extra, *p = NULL;
 	Atom real;
-	uint32_t icw, ich;
 	Picture ret;
 
 	#if PATCH_WINDOW_ICONS_CUSTOM_ICONS
@@ -9230,55 +10112,35 @@ geticonprop(
 	}
 	#endif // PATCH_WINDOW_ICONS_CUSTOM_ICONS
 
-	Status status = XGetWindowProperty(dpy, win, netatom[NetWMIcon], 0L, LONG_MAX, False, AnyPropertyType, 
-						   &real, &format, &n, &extra, (unsigned char **)&p);
-	if (status == Success && (n == 0 || format != 32)) {
-		XFree(p);
-		status ^= 1;
-	}
-
-	if (status == Success) {
-
-		unsigned long *bstp = NULL;
-		uint32_t w, h, sz;
-		{
-			unsigned long *i; const unsigned long *end = p + n;
-			uint32_t bstd = UINT32_MAX, d, m;
-			for (i = p; i < end - 1; i += sz) {
-				if ((w = *i++) >= 16384 || (h = *i++) >= 16384) { XFree(p); return None; }
-				if ((sz = w * h) > end - i) break;
-				if ((m = w > h ? w : h) >= iconsize && (d = m - iconsize) < bstd) { bstd = d; bstp = i; }
-			}
-			if (!bstp) {
-				for (i = p; i < end - 1; i += sz) {
-					if ((w = *i++) >= 16384 || (h = *i++) >= 16384) { XFree(p); return None; }
-					if ((sz = w * h) > end - i) break;
-					if ((d = iconsize - (w > h ? w : h)) < bstd) { bstd = d; bstp = i; }
-				}
-			}
-			if (!bstp) { XFree(p); return None; }
-		}
-
-		if ((w = *(bstp - 2)) == 0 || (h = *(bstp - 1)) == 0) { XFree(p); return None; }
-
-		if (w <= h) {
-			ich = iconsize; icw = w * iconsize / h;
-			if (icw == 0) icw = 1;
+	xcb_get_property_reply_t *r = scanprop(win, netatom[NetWMIcon]);
+	Status status;
+	if (r) {
+		// widen the prefetched CARDINALs to the longs Xlib would return;
+		status = !Success;
+		if (r->format == 32 && (n = r->value_len)) {
+			uint32_t *v = xcb_get_property_value(r);
+			p = ecalloc(n, sizeof(unsigned long));
+			for (extra = 0; extra < n; extra++)
+				p[extra] = v[extra];
+			status = Success;
 		}
-		else {
-			icw = iconsize; ich = h * iconsize / w;
-			if (ich == 0) ich = 1;
+	}
+	else {
+		status = XGetWindowProperty(dpy, win, netatom[NetWMIcon], 0L, LONG_MAX, False, AnyPropertyType, 
+							   &real, &format, &n, &extra, (unsigned char **)&p);
+		if (status == Success && (n == 0 || format != 32)) {
+			XFree(p);
+			status ^= 1;
 		}
-		*picw = icw; *pich = ich;
-
-		uint32_t i, *bstp32 = (uint32_t *)bstp;
-		for (sz = w * h, i = 0; i < sz; ++i) bstp32[i] = prealpha(bstp[i]);
-
-		ret = drw_picture_create_resized(drw, (char *)bstp, w, h, icw, ich);
-		XFree(p);
+	}
 
+	if (status == Success) {
+		ret = iconpicture(p, n, picw, pich, iconsize);
+		if (r)
+			free(p);
+		else
+			XFree(p);
 		return ret;
-
 	}
 	#if PATCH_WINDOW_ICONS_LEGACY_ICCCM
 	else {
@@ -9290,8 +10152,9 @@ geticonprop(
 		int x, y;
 		unsigned int w = 0, h = 0;
 		unsigned int bw, depth = 0;
+		uint32_t icw, ich;
 
-		if ((wmh = XGetWMHints(dpy, win))) {
+		if ((wmh = (r = scanprop(win, XA_WM_HINTS)) ? scanwmhints(r) : XGetWMHints(dpy, win))) {
 			if (wmh->flags & IconPixmapHint) {
 				icon = wmh->icon_pixmap;
 				if (wmh->flags & IconMaskHint)
@@ -9391,18 +10254,52 @@ getparentprocess(pid_t p)
 	return (pid_t)v;
 }
 
+// as popen(cmd, "r") and reading its output into buf, but the command runs
+// with the signal mask dwm had before blocking the signals for signal_fd;
+int
+readcommand(const char *cmd, char *buf, size_t size)
+{
+	int fd[2];
+	size_t len = 0;
+	ssize_t n;
+	pid_t pid;
+
+	if (!size || pipe(fd) == -1)
+		return 0;
+	if ((pid = fork()) == -1) {
+		close(fd[0]);
+		close(fd[1]);
+		return 0;
+	}
+	if (pid == 0) {
+		sigprocmask(SIG_SETMASK, &sigorigmask, NULL);
+		close(fd[0]);
+		if (fd[1] != STDOUT_FILENO) {
+			dup2(fd[1], STDOUT_FILENO);
+			close(fd[1]);
+		}
+		execl("/bin/sh", "sh", "-c", cmd, (char *) NULL);
+		_exit(127);
+	}
+	close(fd[1]);
+	while (len < size - 1 && ((n = read(fd[0], buf + len, size - 1 - len)) > 0 || (n == -1 && errno == EINTR)))
+		if (n > 0)
+			len += n;
+	buf[len] = '\0';
+	close(fd[0]);
+	while (waitpid(pid, NULL, 0) == -1 && errno == EINTR);
+	return 1;
+}
+
 pid_t
 getprocessid(const char *procname)
 {
 	unsigned int v = 0;
 #ifdef __linux__
-	FILE *fp;
 	char buf[256];
 	snprintf(buf, sizeof(buf) - 1, "pidof -s %s", procname);
-	if (!(fp = popen(buf, "r")))
+	if (!readcommand(buf, buf, sizeof(buf)))
 		return 0;
-	fgets(buf, sizeof(buf), fp);
-	pclose(fp);
 	v = strtol(buf, NULL, 10);
 #endif /* __linux__*/
 	return (pid_t)v;
@@ -9559,10 +10456,8 @@ getstatusbarpid()
 				return statuspid;
 		}
 	}
-	if (!(fp = popen("pidof -s "STATUSBAR, "r")))
+	if (!readcommand("pidof -s "STATUSBAR, buf, sizeof(buf)))
 		return -1;
-	fgets(buf, sizeof(buf), fp);
-	pclose(fp);
 	return strtol(buf, NULL, 10);
 }
 #endif // PATCH_STATUSCMD
@@ -9585,20 +10480,32 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
 	char **list = NULL;
 	int n;
 	XTextProperty name;
+	xcb_get_property_reply_t *p;
 
 	if (!text || size == 0)
 		return 0;
 	text[0] = '\0';
-	if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
+	if ((p = scanprop(w, atom))) {
+		// the prefetched value isn't null terminated;
+		if (p->type == None || !(name.nitems = p->value_len))
+			return 0;
+		name.value = xcb_get_property_value(p);
+		name.encoding = p->type;
+		name.format = p->format;
+	}
+	else if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
 		return 0;
 	if (name.encoding == XA_STRING) {
-		strncpy(text, (char *)name.value, size - 1);
+		n = MIN(size - 1, name.nitems);
+		strncpy(text, (char *)name.value, n);
+		text[n] = '\0';
 	} else if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
 		strncpy(text, *list, size - 1);
 		XFreeStringList(list);
 	}
 	text[size - 1] = '\0';
-	XFree(name.value);
+	if (!p)
+		XFree(name.value);
 	return 1;
 }
 
@@ -9729,24 +10636,49 @@ grabbuttons(Client *c, int focused)
 }
 
 #if PATCH_ALTTAB || PATCH_TORCH
+// tries the grabs once; when another client holds them, the caller retries
+// with grabinputslater() rather than sleeping in the handler;
 int
 grabinputs(int keyboard, int mouse, Cursor cursor)
 {
-	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+	int grabkey = !keyboard, grabmouse = !mouse;
 
-	int grabbed = 1, grabkey = !keyboard, grabmouse = !mouse;
-	for (int i = 1000; i > 0; i--) {
-		if (!grabkey && XGrabKeyboard(dpy, root, True, GrabModeAsync, GrabModeAsync, CurrentTime) == GrabSuccess)
-			grabkey = 1;
-		if (!grabmouse && XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync, None, cursor, CurrentTime) == GrabSuccess)
-			grabmouse = 1;
-		if (grabkey && grabmouse) break;
+	if (!grabkey && XGrabKeyboard(dpy, root, True, GrabModeAsync, GrabModeAsync, CurrentTime) == GrabSuccess)
+		grabkey = 1;
+	if (!grabmouse && XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync, None, cursor, CurrentTime) == GrabSuccess)
+		grabmouse = 1;
+	if (grabkey && grabmouse)
+		return 1;
 
-		nanosleep(&ts, NULL);
-		if (i <= 0)
-			grabbed = 0;
-	}
-	return grabbed;
+	// don't hold on to half of the grab until the retry;
+	if (keyboard && grabkey)
+		XUngrabKeyboard(dpy, CurrentTime);
+	if (mouse && grabmouse)
+		XUngrabPointer(dpy, CurrentTime);
+	return 0;
+}
+
+// calls func(arg) again from the timer wheel, every ms for up to GRAB_RETRIES;
+// returns 0 once the retries are used up;
+int
+grabinputslater(void (*func)(const Arg *arg), const Arg *arg)
+{
+	if (!grabretry.retrying)
+		grabretry.tries = 0;
+	if (++grabretry.tries > GRAB_RETRIES)
+		return 0;
+	grabretry.func = func;
+	grabretry.arg = *arg;
+	timerstart(&grabretrytimer, 1, grabretried);
+	return 1;
+}
+
+void
+grabretried(Timer *t)
+{
+	grabretry.retrying = 1;
+	grabretry.func(&grabretry.arg);
+	grabretry.retrying = 0;
 }
 #endif // PATCH_ALTTAB || PATCH_TORCH
 
@@ -10026,11 +10958,14 @@ handlexevent(struct epoll_event *ev)
 				if (logdiagnostics_event(ev))
 				#endif // PATCH_LOG_DIAGNOSTICS
 				{
-					handler[ev.type](&ev); /* call handler */
-					ipc_send_events(mons, &lastselmon, selmon);
+					dispatch(&ev);
+					if (ipc_subscribers(IPC_DELIVERY_EVERY))
+						ipc_send_events(mons, lastselmon, selmon, IPC_DELIVERY_EVERY);
 				}
 			}
 		}
+		// the batch is drained, so only its outcome goes to the other subscribers;
+		ipc_send_events(mons, lastselmon, selmon, IPC_DELIVERY_LATEST);
 	} else if (ev->events & EPOLLHUP) {
 		return -1;
 	}
@@ -10393,6 +11328,59 @@ incnmaster(const Arg *arg)
 	arrange(selmon);
 }
 
+// intern all the atoms in one batch, instead of a round-trip each;
+void
+internatoms(void)
+{
+	char *names[WMLast + NetLast + XLast];
+	Atom atoms[WMLast + NetLast + XLast];
+	int i, n = 0;
+	#if PATCH_ALPHA_CHANNEL
+	char cmselection[20];
+	#endif // PATCH_ALPHA_CHANNEL
+
+	for (i = 0; i < WMLast; i++)
+		names[n++] = (char *) wmatomnames[i];
+	for (i = 0; i < NetLast; i++)
+		names[n++] = (char *) netatomnames[i];
+	for (i = 0; i < XLast; i++)
+		names[n++] = (char *) xatomnames[i];
+	#if PATCH_ALPHA_CHANNEL
+	snprintf(cmselection, sizeof cmselection, "_NET_WM_CM_S%d", screen);
+	names[WMLast + NetLast + NetWMCMSelection] = cmselection;
+	#endif // PATCH_ALPHA_CHANNEL
+	for (i = 0; i < n; i++)
+		if (!names[i])
+			die("dwm: atom %d has no name.", i);
+
+	XInternAtoms(dpy, names, n, False, atoms);
+	memcpy(wmatom, atoms, sizeof wmatom);
+	memcpy(netatom, atoms + WMLast, sizeof netatom);
+	memcpy(xatom, atoms + WMLast + NetLast, sizeof xatom);
+}
+
+int
+isconfigured(Client *c, int x, int y, int w, int h, int bw, int focused)
+{
+	return (c->cfgvalid
+		&& c->cfgx == x && c->cfgy == y && c->cfgw == w && c->cfgh == h
+		&& c->cfgbw == bw && c->cfgfocus == focused
+	);
+}
+
+// record the geometry just sent to the server, for isconfigured();
+void
+setconfigured(Client *c, int x, int y, int w, int h, int bw, int focused)
+{
+	c->cfgx = x;
+	c->cfgy = y;
+	c->cfgw = w;
+	c->cfgh = h;
+	c->cfgbw = bw;
+	c->cfgfocus = focused;
+	c->cfgvalid = 1;
+}
+
 #if PATCH_DRAG_FACTS
 int
 ismaster(Client *c)
@@ -10601,6 +11589,20 @@ keyrelease(XEvent *e)
 }
 #endif // PATCH_ALT_TAGS || PATCH_KEY_HOLD
 
+// whether the key is held down, or any key for 0;
+int
+keysdown(KeyCode key)
+{
+	char keys[32];
+	XQueryKeymap(dpy, keys);
+	if (key)
+		return keys[key / 8] & (1 << (key % 8));
+	for (int i = 0; i < LENGTH(keys); i++)
+		if (keys[i])
+			return 1;
+	return 0;
+}
+
 void
 killclient(const Arg *arg)
 {
@@ -10617,17 +11619,12 @@ killclient(const Arg *arg)
 	#if PATCH_HANDLE_SIGNALS
 	if (arg->ui == 0) {
 		c->sigtermcount = 0;
-		if (procparents) {
-			int cnt = cJSON_GetArraySize(procparents);
-			for (int i = 0; i < cnt; ++i) {
-				cJSON *pp = cJSON_GetArrayItem(procparents, i);
-				if (!pp)
-					continue;
+		if (procparents)
+			for (cJSON *pp = procparents->child; pp; pp = pp->next) {
 				cJSON *pp_count = cJSON_GetObjectItemCaseSensitive(pp, "sigtermcount");
 				if (pp_count)
 					cJSON_SetIntValue(pp_count, 0L);
 			}
-		}
 	}
 	#endif // PATCH_HANDLE_SIGNALS
 	killclientex(c, (arg->ui == 0 ? 1 : 0));
@@ -10644,10 +11641,8 @@ killclientex(Client *c, int sigterm)
 	int do_sigterm = sigterm;
 	if (do_sigterm) {
 		if ((gotname = getprocname(c->pid, buffer, sizeof(buffer), &procname, &params))) {
-			int cnt = 0;
-			if (badprocs && (cnt = cJSON_GetArraySize(badprocs))) {
-				for (int i = 0; i < cnt; ++i) {
-					cJSON *badproc = cJSON_GetArrayItem(badprocs, i);
+			if (badprocs) {
+				for (cJSON *badproc = badprocs->child; badproc; badproc = badproc->next) {
 					char *string = cJSON_GetStringValue(badproc);
 					if (!string)
 						continue;
@@ -10661,11 +11656,8 @@ killclientex(Client *c, int sigterm)
 					}
 				}
 			}
-			if (do_sigterm && procparents && (cnt = cJSON_GetArraySize(procparents))) {
-				for (int i = 0; i < cnt; ++i) {
-					cJSON *pp = cJSON_GetArrayItem(procparents, i);
-					if (!pp)
-						continue;
+			if (do_sigterm && procparents) {
+				for (cJSON *pp = procparents->child; pp; pp = pp->next) {
 					cJSON *pp_name = cJSON_GetObjectItemCaseSensitive(pp, "procname");
 					cJSON *pp_parent = cJSON_GetObjectItemCaseSensitive(pp, "parent");
 					#if PATCH_HANDLE_SIGNALS
@@ -11324,6 +12316,86 @@ logdiagnostics_client(Client *c, const char *indent)
 
 }
 
+void
+latencybegin(LatencyMark *mark)
+{
+	clock_gettime(CLOCK_MONOTONIC, &mark->started);
+	mark->request = NextRequest(dpy);
+	mark->flushes = xflushes;
+}
+
+unsigned int
+latencybucket(unsigned long us)
+{
+	unsigned int e, b;
+
+	if (us < 4)
+		return us;
+	for (e = 2; us >> (e + 1); e++);
+	b = (e - 1) * 4 + ((us >> (e - 2)) & 3);
+	return b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1;
+}
+
+// the lowest latency in microseconds that falls into the bucket;
+unsigned long
+latencybucketus(unsigned int bucket)
+{
+	if (bucket < 4)
+		return bucket;
+	return (4UL + bucket % 4) << (bucket / 4 - 1);
+}
+
+// add the handling that started at *mark to the latency;
+void
+latencyend(Latency *l, const LatencyMark *mark)
+{
+	double ms = elapsedms(&mark->started);
+
+	l->count++;
+	l->total += ms;
+	if (ms > l->max)
+		l->max = ms;
+	l->buckets[latencybucket(ms * 1000)]++;
+	l->requests += NextRequest(dpy) - mark->request;
+	l->flushes += xflushes - mark->flushes;
+}
+
+// called by Xlib before the request buffer is written, including before waiting on a reply;
+void
+latencyflush(Display *dpy, XExtCodes *codes, const char *data, long len)
+{
+	xflushes++;
+}
+
+void
+latencyprint(FILE *f, const char *type, const Latency *l)
+{
+	if (!l->count)
+		return;
+	fprintf(f, "    %-18s %8lu calls, mean %.3f, p50 %.3f, p99 %.3f, max %.3f; %.1f requests, %.1f flushes per call\n",
+		type, l->count, l->total / l->count, latencyquantile(l, 0.5), latencyquantile(l, 0.99), l->max,
+		(double) l->requests / l->count, (double) l->flushes / l->count
+	);
+}
+
+// an upper bound in ms on the q quantile of the latency;
+double
+latencyquantile(const Latency *l, double q)
+{
+	unsigned int b;
+	unsigned long n = 0, rank = q * l->count + 0.5;
+	double ms;
+
+	if (!rank)
+		rank = 1;
+	for (b = 0; b < LATENCY_BUCKETS - 1; b++)
+		if ((n += l->buckets[b]) >= rank) {
+			ms = latencybucketus(b + 1) / 1000.0;
+			return ms < l->max ? ms : l->max;
+		}
+	return l->max;
+}
+
 int
 layoutstringtoindex(const char *layout)
 {
@@ -11362,6 +12434,20 @@ line_to_buffer(const char *text, char *buffer, size_t buffer_size, size_t line_l
 	return 1;
 }
 
+// (re)load the default font set, keeping the current one on failure;
+int
+loadfonts(void)
+{
+	Fnt *fnt;
+
+	if (!(fonts_json && (fnt = drw_fontset_create_json(drw, fonts_json))) &&
+		!(fnt = drw_fontset_create(drw, fonts, LENGTH(fonts))))
+		return 0;
+	drw_fontset_free(drw->fonts);
+	drw->fonts = fnt;
+	return 1;
+}
+
 void
 logdiagnostics(const Arg *arg)
 {
@@ -11429,6 +12515,16 @@ logdiagnostics(const Arg *arg)
 	fprintf(stderr, "--\n");
 	logdatetime(stderr);
 	fprintf(stderr, "dwm: Diagnostics:\n\nversion: "DWM_VERSION_STRING_LONG"\nbar height: %i\n", bh);
+	fprintf(stderr, "client configures: %lu sent, %lu elided\n", configures_sent, configures_elided);
+	fprintf(stderr, "layouts: %lu computed, %lu replayed from cache\n", layouts_computed, layouts_cached);
+	fputs("handler latency (ms):\n", stderr);
+	for (int i = 0; i < LASTEvent; i++)
+		if (handlernames[i])
+			latencyprint(stderr, handlernames[i], &xlatency[i]);
+	#if PATCH_IPC
+	for (int i = 0; i < LENGTH(ipc_latency); i++)
+		latencyprint(stderr, ipc_type_names[i], &ipc_latency[i]);
+	#endif // PATCH_IPC
 	#if PATCH_ALPHA_CHANNEL
 	fprintf(stderr, "useargb: %i\n", useargb);
 	#endif // PATCH_ALPHA_CHANNEL
@@ -11887,6 +12983,7 @@ manage(Window w, XWindowAttributes *wa)
 	#endif // PATCH_TERMINAL_SWALLOWING
 	Monitor *m;
 	Window trans = None;
+	ScanWin *scanned;
 	XWindowChanges wc;
 	XEvent xev;
 	#if PATCH_SHOW_DESKTOP
@@ -11932,6 +13029,7 @@ manage(Window w, XWindowAttributes *wa)
 	c->ultparent = getultimateparentclient(c);
 
 	updatetitle(c, 0);
+	updateclass(c);
 
 	#if PATCH_SCAN_OVERRIDE_REDIRECTS
 	if (wa->override_redirect) {
@@ -11967,7 +13065,8 @@ manage(Window w, XWindowAttributes *wa)
 
 	updatesizehints(c);
 
-	if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+	if (((scanned = scanwin(w)) ? scanned->istrans && (trans = scanned->trans) : XGetTransientForHint(dpy, w, &trans))
+	&& (t = wintoclient(trans))) {
 		c->isfloating = c->oldstate = 1;
 		c->mon = t->mon;
 		c->monindex = t->monindex;
@@ -12481,6 +13580,8 @@ manage(Window w, XWindowAttributes *wa)
 	}
 	#endif // PATCH_FLAG_GAME || PATCH_FLAG_HIDDEN
 
+	tallyclient(c, 1);
+
 	if (!nonstop && !c->isfixed && !c->isfloating
 	) {
 		logdatetime(stderr);
@@ -12517,6 +13618,7 @@ manage(Window w, XWindowAttributes *wa)
 	else
 	#endif // PATCH_FLAG_IGNORED
 	XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
+	c->cfgvalid = 0;
 
 	#if PATCH_HANDLE_SIGNALS
 	if (closing) {
@@ -12782,6 +13884,7 @@ DEBUGENDIF
 			#endif // PATCH_FLAG_FLOAT_ALIGNMENT
 			)
 			XMoveWindow(dpy, c->win, c->x, c->y);
+		c->cfgvalid = 0;
 	}
 
 //	#if PATCH_MOUSE_POINTER_WARPING
@@ -13156,6 +14259,7 @@ movefloat(const Arg *arg)
 	focus(c, 1);
 	#endif // PATCH_MOUSE_POINTER_WARPING || PATCH_FOCUS_FOLLOWS_MOUSE
 	XMoveWindow(dpy, c->win, c->x, c->y);
+	c->cfgvalid = 0;
 
 	#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 	if (focuswin)
@@ -13193,7 +14297,7 @@ movemouse(const Arg *arg)
 	#endif // PATCH_MODAL_SUPPORT
 	Monitor *m;
 	XEvent ev;
-	Time lasttime = 0;
+	struct timespec lastframe = { 0 };
 
 	if (!(c = selmon->sel) || c->dormant
 		#if PATCH_FLAG_IGNORED
@@ -13277,8 +14381,12 @@ movemouse(const Arg *arg)
 	// prevent client moves via resize() triggering updates of
 	// the client's parent offset coordinates, sfxo & sfyo
 	nonstop = 1;
+	updaterefreshrates();
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		#if PATCH_EVENT_RECORDING
+		recordevent(&ev, 1);
+		#endif // PATCH_EVENT_RECORDING
 		switch(ev.type) {
 		case ConfigureRequest:
 		case Expose:
@@ -13286,9 +14394,7 @@ movemouse(const Arg *arg)
 			handler[ev.type](&ev);
 			break;
 		case MotionNotify:
-			if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-				continue;
-			lasttime = ev.xmotion.time;
+			pacemotion(&ev, &lastframe);
 
 			nx = ocx + (ev.xmotion.x - x);
 			ny = ocy + (ev.xmotion.y - y);
@@ -15183,6 +16289,12 @@ parsemon(Monitor *m, int index, int first)
 int
 parserulesjson(cJSON *rules)
 {
+	if (!cJSON_IsArray(rules)) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: error: rules not loaded - the rules file must contain an array of rules.\n");
+		return 0;
+	}
+
 	cJSON *unsupported = ecalloc(1, sizeof(cJSON));
 	cJSON *unsupported_values = ecalloc(1, sizeof(cJSON));
 	unsigned int changed = 0, ignore, unmatchable = 0, malformed_group = 0;
@@ -15442,20 +16554,81 @@ parserulesjson(cJSON *rules)
 	return 1;
 }
 
+// matches the first queued MotionNotify, unless an event the drag loops act
+// on is queued ahead of it, which is flagged through arg instead;
+Bool
+pendingmotion(Display *d, XEvent *e, XPointer arg)
+{
+	switch (e->type) {
+	case MotionNotify:
+		return !*(int *) arg;
+	case ButtonPress:
+	case ButtonRelease:
+	case KeyPress:
+	case KeyRelease:
+	case Expose:
+	case MapRequest:
+	case ConfigureRequest:
+		*(int *) arg = 1;
+	}
+	return False;
+}
+
+// folds the queued pointer motion into ev, and holds the latest position back
+// until a frame of the monitor under the pointer has passed since the previous
+// update, so a drag applies one geometry update per frame; crossing, property
+// and focus events left queued by the drag loops are skipped over, while
+// a button, key, expose, map or configure request event ends the wait;
 void
-placemouse(const Arg *arg)
+pacemotion(XEvent *ev, struct timespec *lastframe)
 {
-	#if PATCH_FOCUS_FOLLOWS_MOUSE
-	checkmouseoverclient();
-	#endif // PATCH_FOCUS_FOLLOWS_MOUSE
-	int x, y, px, py, ocx, ocy, nx = -9999, ny = -9999, freemove = 0;
-	Client *c, *r = NULL, *at, *prevr;
+	struct pollfd pfd = { .fd = ConnectionNumber(dpy), .events = POLLIN };
+	double rate, wait;
+	int blocked;
 	Monitor *m;
-	XEvent ev;
-	XWindowAttributes wa;
-	Time lasttime = 0;
-	int attachmode, prevattachmode;
-	attachmode = prevattachmode = -1;
+	XEvent next;
+
+	for (;;) {
+		// motion queued behind a handled event is left for after it;
+		for (blocked = 0; XCheckIfEvent(dpy, &next, pendingmotion, (XPointer) &blocked); blocked = 0) {
+			*ev = next;
+			#if PATCH_EVENT_RECORDING
+			recordevent(ev, 1);
+			#endif // PATCH_EVENT_RECORDING
+		}
+		if (blocked)
+			break;
+		if (dragrate)
+			rate = dragrate;
+		else {
+			m = recttomon(ev->xmotion.x_root, ev->xmotion.y_root, 1, 1);
+			rate = m && m->refreshrate > 0 ? m->refreshrate : FALLBACK_REFRESH_RATE;
+		}
+		wait = 1000.0 / rate - elapsedms(lastframe);
+		if (wait <= 0)
+			break;
+		if (poll(&pfd, 1, (int) ceil(wait)) <= 0)
+			break;
+		// only reads the connection, so the events are checked again above;
+		XEventsQueued(dpy, QueuedAfterReading);
+	}
+	clock_gettime(CLOCK_MONOTONIC, lastframe);
+}
+
+void
+placemouse(const Arg *arg)
+{
+	#if PATCH_FOCUS_FOLLOWS_MOUSE
+	checkmouseoverclient();
+	#endif // PATCH_FOCUS_FOLLOWS_MOUSE
+	int x, y, px, py, ocx, ocy, nx = -9999, ny = -9999, freemove = 0;
+	Client *c, *r = NULL, *at, *prevr;
+	Monitor *m;
+	XEvent ev;
+	XWindowAttributes wa;
+	struct timespec lastframe = { 0 };
+	int attachmode, prevattachmode;
+	attachmode = prevattachmode = -1;
 
 	if (!(c = selmon->sel) || c->dormant || !c->mon->lt[c->mon->sellt]->arrange) /* no support for placemouse when floating layout is used */
 		return;
@@ -15494,8 +16667,12 @@ placemouse(const Arg *arg)
 		destroybarriermon();
 	#endif // PATCH_CONSTRAIN_MOUSE
 
+	updaterefreshrates();
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		#if PATCH_EVENT_RECORDING
+		recordevent(&ev, 1);
+		#endif // PATCH_EVENT_RECORDING
 		switch (ev.type) {
 		case ConfigureRequest:
 		case Expose:
@@ -15503,9 +16680,7 @@ placemouse(const Arg *arg)
 			handler[ev.type](&ev);
 			break;
 		case MotionNotify:
-			if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-				continue;
-			lasttime = ev.xmotion.time;
+			pacemotion(&ev, &lastframe);
 
 			nx = ocx + (ev.xmotion.x - x);
 			ny = ocy + (ev.xmotion.y - y);
@@ -15513,8 +16688,10 @@ placemouse(const Arg *arg)
 			if (!freemove && (abs(nx - ocx) > snap || abs(ny - ocy) > snap))
 				freemove = 1;
 
-			if (freemove)
+			if (freemove) {
 				XMoveWindow(dpy, c->win, nx, ny);
+				c->cfgvalid = 0;
+			}
 
 			if ((m = recttomon(ev.xmotion.x, ev.xmotion.y, 1, 1)) && m != selmon)
 				selmon = m;
@@ -15573,6 +16750,7 @@ placemouse(const Arg *arg)
 					c->next = r->next;
 					r->next = c;
 				}
+				retally(c);
 
 				attachstack(c);
 				arrangemon(r->mon);
@@ -15933,6 +17111,52 @@ print_wrap(FILE *f,
 }
 
 
+// start recording a profile, unless one is already being recorded;
+int
+profilebegin(const char *trigger)
+{
+	if (profiling)
+		return 0;
+	profiling = &profiles[strcmp(trigger, "startup") ? 1 : 0];
+	memset(profiling, 0, sizeof(Profile));
+	profiling->trigger = trigger;
+	clock_gettime(CLOCK_MONOTONIC, &profiling->started);
+	return 1;
+}
+
+// finish the profile being recorded, and log its breakdown;
+void
+profileend(void)
+{
+	int i, n = 0;
+
+	if (!profiling)
+		return;
+	profiling->total = elapsedms(&profiling->started);
+	profiling->done = 1;
+
+	logdatetime(stderr);
+	fprintf(stderr, "dwm: %s took %.3f ms", profiling->trigger, profiling->total);
+	for (i = 0; i < ProfileLast; i++)
+		if (profiling->ms[i] > 0)
+			fprintf(stderr, "%s %s %.3f", n++ ? "," : ";", profilephases[i], profiling->ms[i]);
+	if (profiling->managed)
+		fprintf(stderr, "; %u windows managed at %.3f ms each",
+			profiling->managed, profiling->ms[ProfileManage] / profiling->managed
+		);
+	fputs(".\n", stderr);
+	profiling = NULL;
+}
+
+// add the time since *mark to a phase of the profile being recorded, and restart *mark;
+void
+profilemark(int phase, struct timespec *mark)
+{
+	if (profiling)
+		profiling->ms[phase] += elapsedms(mark);
+	clock_gettime(CLOCK_MONOTONIC, mark);
+}
+
 void
 propertynotify(XEvent *e)
 {
@@ -15980,6 +17204,9 @@ propertynotify(XEvent *e)
 				updatewmhints(c);
 				drawbar(c->mon, 0);
 				break;
+			case XA_WM_CLASS:
+				updateclass(c);
+				break;
 		}
 		if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
 			if (c->ruledefer == 1) {
@@ -16266,6 +17493,54 @@ recv_message(uint8_t *msg_type, uint32_t *reply_size, uint8_t **reply)
 }
 #endif // PATCH_IPC
 
+// focuses sel after the focused client went away, or lets focus() choose if NULL;
+void
+refocus(Client *sel)
+{
+	if (!sel)
+		focus(NULL, 0);
+	else if (sel->mon != selmon) {
+		sel->mon->sel = sel;
+		viewmontag(sel->mon, sel->tags, 0);
+		focus(NULL, 0);
+	}
+	else focus(sel, 0);
+}
+
+// holds refocus() back until no keys are held, so the rest of a key binding
+// isn't delivered to the next client; the event loop keeps running meanwhile;
+void
+refocuslater(Client *sel, Monitor *m)
+{
+	refocusing.win = sel ? sel->win : None;
+	refocusing.mon = m;
+	refocusing.from = selmon->sel ? selmon->sel->win : None;
+	timerstart(&refocustimer, 1, refocuswhenclear);
+}
+
+void
+refocuswhenclear(Timer *t)
+{
+	Monitor *m;
+
+	if (keysdown(0)) {
+		timerstart(t, 1, refocuswhenclear);
+		return;
+	}
+	for (m = mons; m && m != refocusing.mon; m = m->next);
+	if (!m || (selmon->sel ? selmon->sel->win : None) != refocusing.from)
+		return;
+	refocus(refocusing.win ? wintoclient(refocusing.win) : NULL);
+	#if PATCH_MOUSE_POINTER_WARPING
+	if (m == selmon && m->sel)
+		#if PATCH_MOUSE_POINTER_WARPING_SMOOTH
+		warptoclient(m->sel, 1, -1);
+		#else // NO PATCH_MOUSE_POINTER_WARPING_SMOOTH
+		warptoclient(m->sel, -1);
+		#endif // PATCH_MOUSE_POINTER_WARPING_SMOOTH
+	#endif // PATCH_MOUSE_POINTER_WARPING
+}
+
 #if PATCH_MOUSE_POINTER_WARPING
 void
 refocuspointer(const Arg *arg)
@@ -16296,22 +17571,64 @@ reload(const Arg *arg)
 int
 reload_rules(void)
 {
-	rules_json = parsejsonfile(rules_filename, "rules");
-	if (rules_json)
-		return (parserulesjson(rules_json));
-	return 0;
+	Arena swap, *prev;
+	unsigned long *oldhashes = NULL;
+	size_t nold = 0;
+	cJSON *json, *r;
+
+	if (!rules_filename)
+		return 0;
+
+	// parse into the staging arena, so the current rules survive a bad file;
+	prev = setjsonarena(&rulesstaging);
+	json = parsejsonfile(rules_filename, "rules");
+	setjsonarena(prev);
+	if (!json) {
+		arena_reset(&rulesstaging);
+		return 0;
+	}
+	if (!parserulesjson(json)) {
+		// frees the nodes added while parsing; the rest go with the arena;
+		cJSON_Delete(json);
+		arena_reset(&rulesstaging);
+		return 0;
+	}
+	// index once the rule groups have been flattened;
+	prev = setjsonarena(&rulesstaging);
+	cJSON_EnableIndex(json);
+	setjsonarena(prev);
+
+	if (rules_json) {
+		for (r = rules_json->child; r; r = r->next)
+			++nold;
+		oldhashes = ecalloc(nold ? nold : 1, sizeof(unsigned long));
+		for (nold = 0, r = rules_json->child; r; r = r->next)
+			oldhashes[nold++] = rulehash(r);
+		#if PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
+		compostrules();
+		#endif // PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
+		// frees the nodes added since parsing; the parsed ones go with the arena;
+		cJSON_Delete(rules_json);
+		arena_reset(&rulesarena);
+	}
+	swap = rulesarena;
+	rulesarena = rulesstaging;
+	rulesstaging = swap;
+	rules_json = json;
+
+	applyrulesreloaded(oldhashes, nold);
+	free(oldhashes);
+	return 1;
 }
 
 #if PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
 void
 compost(void **link, cJSON *parent, cJSON *item, const char *string)
 {
-	size_t sz;
 	cJSON *c = item, *cc = NULL;
 	if (rules_compost) {
-		sz = cJSON_GetArraySize(rules_compost);
-		for (size_t i = 0; i < sz; i++) {
-			cc = cJSON_GetArrayItem(rules_compost, i);
+		// walk the list, rather than a lookup by position for every item;
+		for (cc = rules_compost->child; cc; cc = cc->next) {
 			if (c && c == cc)
 				return;
 			if (string && cJSON_GetStringValue(cc) == string)
@@ -16322,6 +17639,12 @@ compost(void **link, cJSON *parent, cJSON *item, const char *string)
 		rules_compost = cJSON_CreateArray();
 	if (c) {
 		c = cJSON_DetachItemViaPointer(parent, item);
+		// the rules arena is released on reload, so keep a copy on the heap;
+		if (jsoninarena(c)) {
+			cc = c;
+			c = cJSON_Duplicate(cc, 1);
+			cJSON_Delete(cc);
+		}
 		*link = c;
 	}
 	else {
@@ -16339,77 +17662,221 @@ uncompost(cJSON *item, const char *string)
 	if (!rules_compost)
 		return;
 	cJSON *c = item, *cc = NULL;
-	size_t sz = cJSON_GetArraySize(rules_compost);
-	for (size_t i = 0; i < sz; i++) {
-		cc = cJSON_GetArrayItem(rules_compost, i);
+	for (cc = rules_compost->child; cc; cc = cc->next)
 		if ((c && c == cc) || (string && cJSON_GetStringValue(cc) == string)) {
-			cJSON_DeleteItemFromArray(rules_compost, i);
-			--sz;
+			cJSON_Delete(cJSON_DetachItemViaPointer(rules_compost, cc));
 			break;
 		}
-	}
-	if (!sz) {
+	if (!rules_compost->child) {
 		cJSON_Delete(rules_compost);
 		rules_compost = NULL;
 	}
 }
 #endif // PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
 
+#if PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
+// detach client links into rules_json before it is released;
 void
-reloadrules(const Arg *arg)
+compostrules(void)
 {
-	int success;
 	logdatetime(stderr);
-	fputs("dwm: reloading rules from json file...\n", stderr);
-	if (rules_json) {
-		#if PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
+	fputs("dwm: composting links to stale JSON data from affected clients.\n", stderr);
+	for (Monitor *m = mons; m; m = m->next)
+		for (Client *c = m->clients; c; c = c->next) {
+			#if PATCH_FLAG_TITLE
+			if (c->displayname)
+				compost((void **)&c->displayname, NULL, NULL, c->displayname);
+			#endif // PATCH_FLAG_TITLE
+			#if PATCH_SHOW_MASTER_CLIENT_ON_TAG
+			if (c->dispclass)
+				compost((void **)&c->dispclass, NULL, NULL, c->dispclass);
+			#endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG
+			#if PATCH_ALTTAB
+			if (c->grpclass)
+				compost((void **)&c->grpclass, NULL, NULL, c->grpclass);
+			#endif // PATCH_ALTTAB
+			#if PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_CUSTOM_ICONS
+			if (c->icon_file)
+				compost((void **)&c->icon_file, NULL, NULL, c->icon_file);
+			#endif // PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_CUSTOM_ICONS
+			#if PATCH_FLAG_PARENT
+			if (c->parent_condition_node) {
+				if (c->parent_is)
+					compost((void **)&c->parent_is, c->parent_condition_node, c->parent_is, NULL);
+				if (c->parent_begins)
+					compost((void **)&c->parent_begins, c->parent_condition_node, c->parent_begins, NULL);
+				if (c->parent_contains)
+					compost((void **)&c->parent_contains, c->parent_condition_node, c->parent_contains, NULL);
+				if (c->parent_ends)
+					compost((void **)&c->parent_ends, c->parent_condition_node, c->parent_ends, NULL);
+				c->parent_condition_node = NULL;
+			}
+			#endif // PATCH_FLAG_PARENT
+		}
+	if (rules_compost) {
 		logdatetime(stderr);
-		fputs("dwm: composting links to stale JSON data from affected clients.\n", stderr);
-		for (Monitor *m = mons; m; m = m->next)
-			for (Client *c = m->clients; c; c = c->next) {
-				#if PATCH_FLAG_TITLE
-				if (c->displayname)
-					compost((void **)&c->displayname, NULL, NULL, c->displayname);
-				#endif // PATCH_FLAG_TITLE
-				#if PATCH_SHOW_MASTER_CLIENT_ON_TAG
-				if (c->dispclass)
-					compost((void **)&c->dispclass, NULL, NULL, c->dispclass);
-				#endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG
-				#if PATCH_ALTTAB
-				if (c->grpclass)
-					compost((void **)&c->grpclass, NULL, NULL, c->grpclass);
-				#endif // PATCH_ALTTAB
-				#if PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_CUSTOM_ICONS
-				if (c->icon_file)
-					compost((void **)&c->icon_file, NULL, NULL, c->icon_file);
-				#endif // PATCH_WINDOW_ICONS && PATCH_WINDOW_ICONS_CUSTOM_ICONS
-				#if PATCH_FLAG_PARENT
-				if (c->parent_condition_node) {
-					if (c->parent_is)
-						compost((void **)&c->parent_is, c->parent_condition_node, c->parent_is, NULL);
-					if (c->parent_begins)
-						compost((void **)&c->parent_begins, c->parent_condition_node, c->parent_begins, NULL);
-					if (c->parent_contains)
-						compost((void **)&c->parent_contains, c->parent_condition_node, c->parent_contains, NULL);
-					if (c->parent_ends)
-						compost((void **)&c->parent_ends, c->parent_condition_node, c->parent_ends, NULL);
-					c->parent_condition_node = NULL;
-				}
-				#endif // PATCH_FLAG_PARENT
-			}
-		if (rules_compost) {
+		fprintf(stderr, "dwm: composted rule data items: %u\n", cJSON_GetArraySize(rules_compost));
+	}
+}
+#endif // PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
+
+// re-apply the layout and rules files without restarting, keeping the X
+// connection, the bars and every managed client with its runtime state;
+// only the schemes, fonts and font groups whose definitions changed are rebuilt;
+void
+reloadinplace(const Arg *arg)
+{
+	int i, j, fontschanged, schemeschanged = 0;
+	char *oldcolours[LENGTH(colours)][3];
+	cJSON *json = NULL, *oldfonts = fonts_json;
+	Arena swap, *prev;
+	Client *c;
+	Monitor *m;
+	struct timespec mark;
+
+	logdatetime(stderr);
+	fputs("dwm: reloading in place...\n", stderr);
+	profilebegin("reloadinplace");
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+
+	// parse into the staging arena, so the current layout survives a bad file;
+	if (layout_filename) {
+		prev = setjsonarena(&layoutstaging);
+		json = parsejsonfile(layout_filename, "layout");
+		cJSON_EnableIndex(json);
+		setjsonarena(prev);
+		if (!json) {
+			arena_reset(&layoutstaging);
 			logdatetime(stderr);
-			fprintf(stderr, "dwm: composted rule data items: %u\n", cJSON_GetArraySize(rules_compost));
+			fputs("dwm: errors occurred while loading or parsing the layout JSON file; keeping the current layout.\n", stderr);
+			profilemark(ProfileLayout, &mark);
+			profileend();
+			return;
 		}
-		#endif // PATCH_FLAG_TITLE || PATCH_SHOW_MASTER_CLIENT_ON_TAG || PATCH_ALTTAB || PATCH_WINDOW_ICONS_CUSTOM_ICONS || PATCH_FLAG_PARENT
-		cJSON_Delete(rules_json);
 	}
+
+	memcpy(oldcolours, colours, sizeof(colours));
+	resetlayout();
+	if (json)
+		parselayoutjson(json);
+	profilemark(ProfileLayout, &mark);
+	defaultcolours();
+
+	for (i = 0; i < LENGTH(colours); i++) {
+		for (j = 0; j < 3; j++)
+			if (colours[i][j] != oldcolours[i][j] &&
+				(!colours[i][j] || !oldcolours[i][j] || strcmp(colours[i][j], oldcolours[i][j]))
+			)
+				break;
+		if (j == 3)
+			continue;
+		free(scheme[i]);
+		scheme[i] = drw_scm_create(drw, colours[i], 3);
+		schemeschanged++;
+	}
+	drw_setscheme(drw, scheme[SchemeNorm]);
+	profilemark(ProfileColours, &mark);
+
+	// the old tree is still alive, so unchanged fonts can be told apart;
+	fontschanged = (oldfonts != fonts_json && !(oldfonts && fonts_json && cJSON_Compare(oldfonts, fonts_json, 1)));
+	if (fontschanged && !loadfonts()) {
+		logdatetime(stderr);
+		fputs("dwm: no fonts could be loaded; keeping the current fonts.\n", stderr);
+	}
+	updatebarheight();
+	profilemark(ProfileFonts, &mark);
+
+	for (m = mons; m; m = m->next) {
+		#if PATCH_FONT_GROUPS
+		m->barelement_fontgroups_json = NULL;
+		m->bh = m->minbh = 0;
+		#endif // PATCH_FONT_GROUPS
+		#if PATCH_SHOW_MASTER_CLIENT_ON_TAG
+		m->etagf = etagf;
+		m->ptagf = ptagf;
+		#endif // PATCH_SHOW_MASTER_CLIENT_ON_TAG
+		#if PATCH_ALT_TAGS
+		for (i = 0; i < LENGTH(tags); i++)
+			m->tags[i] = tags[i];
+		#endif // PATCH_ALT_TAGS
+		#if PATCH_CUSTOM_TAG_ICONS
+		for (i = 0; i < LENGTH(tags); i++) {
+			m->tagiconpaths[i] = tagiconpaths[i];
+			if (m->tagicons[i])
+				XRenderFreePicture(dpy, m->tagicons[i]);
+			m->tagicons[i] = None;
+		}
+		#endif // PATCH_CUSTOM_TAG_ICONS
+		parsemon(m, m->num, 0);
+	}
+	profilemark(ProfileMonitors, &mark);
+
+	// reloadrules() adds to this profile;
+	if (rules_filename)
+		reloadrules(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+
+	// nothing points into the old tree any more;
+	if (layout_json)
+		cJSON_Delete(layout_json);
+	arena_reset(&layoutarena);
+	swap = layoutarena;
+	layoutarena = layoutstaging;
+	layoutstaging = swap;
+	layout_json = json;
+
+	if (schemeschanged) {
+		for (m = mons; m; m = m->next)
+			for (c = m->clients; c; c = c->next)
+				XSetWindowBorder(dpy, c->win, scheme[c->isurgent ? SchemeUrg : SchemeNorm][ColBorder].pixel);
+		#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+		if (focuswin) {
+			#if PATCH_FOCUS_BORDER
+			XSetWindowBackground(dpy, focuswin, scheme[SchemeSel][ColBorder].pixel);
+			#elif PATCH_FOCUS_PIXEL
+			XSetWindowBackground(dpy, focuswin, (scheme[SchemeSel][ColBorder].pixel &~ 0xFF000000L) | 0xA0000000L);
+			#endif // PATCH_FOCUS_BORDER
+			XClearWindow(dpy, focuswin);
+		}
+		#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+	}
+	for (m = mons; m; m = m->next)
+		updatebarpos(m);
+	#if PATCH_SYSTRAY
+	if (showsystray)
+		updatesystray(0);
+	#endif // PATCH_SYSTRAY
+	profilemark(ProfileMonitors, &mark);
+	arrange(NULL);
+	focus(NULL, 0);
+	profilemark(ProfileArrange, &mark);
+	drawbars();
+	profilemark(ProfileBars, &mark);
+
+	logdatetime(stderr);
+	fprintf(stderr, "dwm: reloaded in place; %i colour scheme%s rebuilt, fonts %s.\n",
+		schemeschanged, schemeschanged == 1 ? "" : "s", fontschanged ? "reloaded" : "unchanged"
+	);
+	profileend();
+}
+
+void
+reloadrules(const Arg *arg)
+{
+	int success, profiled = profilebegin("reloadrules");
+	struct timespec mark;
+	logdatetime(stderr);
+	fputs("dwm: reloading rules from json file...\n", stderr);
+	clock_gettime(CLOCK_MONOTONIC, &mark);
 	success = reload_rules();
+	profilemark(ProfileRules, &mark);
 	logdatetime(stderr);
 	if (success)
 		fputs("dwm: successfully parsed the rules JSON file.\n", stderr);
 	else
-		fputs("dwm: errors occurred while loading or parsing the rules JSON file.\n", stderr);
+		fputs("dwm: errors occurred while loading or parsing the rules JSON file; keeping the current rules.\n", stderr);
+	if (profiled)
+		profileend();
 }
 
 void
@@ -16500,6 +17967,27 @@ rescan(const Arg *arg)
 	fprintf(stderr, "dwm: rescanning complete - found %lu more clients.\n", (count2 - count1));
 }
 
+// restore the settings that may point into layout_json to their config.h values;
+void
+resetlayout(void)
+{
+	memcpy(colours, coloursbackup, sizeof(colours));
+	#if PATCH_CUSTOM_TAG_ICONS
+	memcpy(tagiconpaths, tagiconpathsbackup, sizeof(tagiconpaths));
+	#endif // PATCH_CUSTOM_TAG_ICONS
+	for (int i = 0; layoutstrings[i]; i++)
+		*layoutstrings[i] = layoutstringsbackup[i];
+	memcpy(tags, tagsbackup, sizeof(tags));
+	fonts_json = NULL;
+	monitors_json = NULL;
+	#if PATCH_FONT_GROUPS
+	fontgroups_json = NULL;
+	barelement_fontgroups_json = NULL;
+	#endif // PATCH_FONT_GROUPS
+	badprocs = NULL;
+	procparents = NULL;
+}
+
 void
 resize(Client *c, int x, int y, int w, int h, int interact)
 {
@@ -16549,6 +18037,7 @@ void
 resizeclient(Client *c, int x, int y, int w, int h, int save_old)
 {
 	XWindowChanges wc;
+	int visible, focused = 0;
 	#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 	XWindowChanges fwc;
 	#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
@@ -16591,140 +18080,153 @@ resizeclient(Client *c, int x, int y, int w, int h, int save_old)
 			c->bw = wc.border_width = 0;
 	}
 
-	#if PATCH_FLAG_FLOAT_ALIGNMENT || PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
-	if (ISVISIBLE(c)) {
-		#if PATCH_FLAG_FLOAT_ALIGNMENT
-		// nail it to no border & y=0:
-		if (alignfloat(c, c->floatalignx, c->floataligny)) {
-			wc.x = c->x;
-			wc.y = c->y;
-		}
-		#endif // PATCH_FLAG_FLOAT_ALIGNMENT
+	visible = ISVISIBLE(c);
+	#if PATCH_FLAG_FLOAT_ALIGNMENT
+	// nail it to no border & y=0:
+	if (visible && alignfloat(c, c->floatalignx, c->floataligny)) {
+		wc.x = c->x;
+		wc.y = c->y;
+	}
+	#endif // PATCH_FLAG_FLOAT_ALIGNMENT
+	if (!visible)
+		wc.x = c->w * -2;
 
-		#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+	#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+	// 2 when floating, as the focus border sits outside a floating client
+	// but shrinks a tiled one;
+	if (visible && focuswin && selmon->sel == c)
+		focused = 1 + !!c->isfloating;
+	#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+
+	// nothing would change on the server, so skip the requests and the synthetic
+	// ConfigureNotify, but still follow the parent and move the children;
+	if (isconfigured(c, wc.x, wc.y, wc.width, wc.height, wc.border_width, focused)) {
+		configures_elided++;
+		goto snap;
+	}
+	setconfigured(c, wc.x, wc.y, wc.width, wc.height, wc.border_width, focused);
+
+	#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+	if (focused) {
 		fwc.stack_mode = Above;
 		fwc.sibling = c->win;
-		if (focuswin && selmon->sel == c) {
-			#if PATCH_FOCUS_BORDER
-			if (!wc.border_width || (c->isfullscreen
-				#if PATCH_FLAG_FAKEFULLSCREEN
-				&& c->fakefullscreen != 1
-				#endif // PATCH_FLAG_FAKEFULLSCREEN
-				)
-				#if PATCH_FLAG_PANEL
-				|| c->ispanel
-				#endif // PATCH_FLAG_PANEL
-				)
-				XMoveResizeWindow(dpy, focuswin, 0, -fh - 1, fh, fh);
-			else {
-				unsigned int size = 0;
-				switch (fbpos) {
-					case FOCUS_BORDER_E:
-						if (!c->isfloating || c->x + WIDTH(c) < c->mon->wx + c->mon->ww) {
-							size = c->isfloating ? MIN(fh, MAX(c->mon->wx + c->mon->ww - WIDTH(c) - c->x, 1)) : fh;
-							XMoveResizeWindow(dpy, focuswin, c->x + WIDTH(c) - (!c->isfloating ? size : 0), c->y, size, HEIGHT(c));
-							if (!c->isfloating)
-								wc.width -= fh;
-						}
-						break;
-					case FOCUS_BORDER_S:
-						if (!c->isfloating || c->y + HEIGHT(c) < c->mon->wy + c->mon->wh) {
-							size = c->isfloating ? MIN(fh, MAX(c->mon->wy + c->mon->wh - HEIGHT(c) - c->y, 1)) : fh;
-							XMoveResizeWindow(dpy, focuswin, c->x, c->y + HEIGHT(c) - (!c->isfloating ? size : 0), WIDTH(c), size);
-							if (!c->isfloating)
-								wc.height -= fh;
-						}
-						break;
-					case FOCUS_BORDER_W:
-						if (!c->isfloating || c->x > c->mon->wx) {
-							size = c->isfloating ? MIN(fh, MAX(c->mon->wx + c->mon->ww - WIDTH(c) - c->x, 1)) : fh;
-							XMoveResizeWindow(dpy, focuswin, c->x - (c->isfloating ? size : 0), c->y, size, HEIGHT(c));
-							if (!c->isfloating) {
-								wc.x += fh; wc.width -= fh;
-							}
+		#if PATCH_FOCUS_BORDER
+		if (!wc.border_width || (c->isfullscreen
+			#if PATCH_FLAG_FAKEFULLSCREEN
+			&& c->fakefullscreen != 1
+			#endif // PATCH_FLAG_FAKEFULLSCREEN
+			)
+			#if PATCH_FLAG_PANEL
+			|| c->ispanel
+			#endif // PATCH_FLAG_PANEL
+			)
+			XMoveResizeWindow(dpy, focuswin, 0, -fh - 1, fh, fh);
+		else {
+			unsigned int size = 0;
+			switch (fbpos) {
+				case FOCUS_BORDER_E:
+					if (!c->isfloating || c->x + WIDTH(c) < c->mon->wx + c->mon->ww) {
+						size = c->isfloating ? MIN(fh, MAX(c->mon->wx + c->mon->ww - WIDTH(c) - c->x, 1)) : fh;
+						XMoveResizeWindow(dpy, focuswin, c->x + WIDTH(c) - (!c->isfloating ? size : 0), c->y, size, HEIGHT(c));
+						if (!c->isfloating)
+							wc.width -= fh;
+					}
+					break;
+				case FOCUS_BORDER_S:
+					if (!c->isfloating || c->y + HEIGHT(c) < c->mon->wy + c->mon->wh) {
+						size = c->isfloating ? MIN(fh, MAX(c->mon->wy + c->mon->wh - HEIGHT(c) - c->y, 1)) : fh;
+						XMoveResizeWindow(dpy, focuswin, c->x, c->y + HEIGHT(c) - (!c->isfloating ? size : 0), WIDTH(c), size);
+						if (!c->isfloating)
+							wc.height -= fh;
+					}
+					break;
+				case FOCUS_BORDER_W:
+					if (!c->isfloating || c->x > c->mon->wx) {
+						size = c->isfloating ? MIN(fh, MAX(c->mon->wx + c->mon->ww - WIDTH(c) - c->x, 1)) : fh;
+						XMoveResizeWindow(dpy, focuswin, c->x - (c->isfloating ? size : 0), c->y, size, HEIGHT(c));
+						if (!c->isfloating) {
+							wc.x += fh; wc.width -= fh;
 						}
-						break;
-					default:
-					case FOCUS_BORDER_N:
-						if (!c->isfloating || c->y > c->mon->wy) {
-							size = c->isfloating ? MIN(fh, MAX(c->mon->wy + c->mon->wh - HEIGHT(c) - c->y, 1)) : fh;
-							XMoveResizeWindow(dpy, focuswin, c->x, c->y - (c->isfloating ? size : 0), WIDTH(c), size);
-							if (!c->isfloating) {
-								wc.y += fh; wc.height -= fh;
-							}
+					}
+					break;
+				default:
+				case FOCUS_BORDER_N:
+					if (!c->isfloating || c->y > c->mon->wy) {
+						size = c->isfloating ? MIN(fh, MAX(c->mon->wy + c->mon->wh - HEIGHT(c) - c->y, 1)) : fh;
+						XMoveResizeWindow(dpy, focuswin, c->x, c->y - (c->isfloating ? size : 0), WIDTH(c), size);
+						if (!c->isfloating) {
+							wc.y += fh; wc.height -= fh;
 						}
-				}
-				if (size)
-					XConfigureWindow(dpy, focuswin, CWSibling|CWStackMode, &fwc);
-				else
-					XMoveResizeWindow(dpy, focuswin, 0, -fh - 1, fh, fh);
+					}
 			}
-			#elif PATCH_FOCUS_PIXEL
-			if ((c->isfullscreen
-				#if PATCH_FLAG_FAKEFULLSCREEN
-				&& c->fakefullscreen != 1
-				#endif // PATCH_FLAG_FAKEFULLSCREEN
-				)
-				#if PATCH_FLAG_PANEL
-				|| c->ispanel
-				#endif // PATCH_FLAG_PANEL
-				)
-				XMoveResizeWindow(dpy, focuswin, 0, -fh - 1, fh, fh);
-			else {
-				int fhadj = fh;
-				if (c->w >= c->h && fhadj >= (c->h / 2))
-					fhadj = (c->h / 2) - 1;
-				else if (c->h > c->w && fhadj >= (c->w / 2))
-					fhadj = (c->w / 2) - 1;
-				if (fhadj < 1)
-					fhadj = 1;
-				if (!fpcurpos)
-					fpcurpos = fppos;
-				switch (fpcurpos) {
-					case FOCUS_PIXEL_SW:
-						XMoveResizeWindow(dpy, focuswin,
-							c->x + wc.border_width,
-							c->y + c->h + wc.border_width - fhadj - 2,
-							fhadj, fhadj
-						);
-						break;
-					case FOCUS_PIXEL_NW:
-						XMoveResizeWindow(dpy, focuswin,
-							c->x + wc.border_width,
-							c->y + wc.border_width,
-							fhadj, fhadj
-						);
-						break;
-					case FOCUS_PIXEL_NE:
-						XMoveResizeWindow(dpy, focuswin,
-							c->x + c->w + wc.border_width - fhadj - 2,
-							c->y + wc.border_width,
-							fhadj, fhadj
-						);
-						break;
-					default:
-					case FOCUS_PIXEL_SE:
-						XMoveResizeWindow(dpy, focuswin,
-							c->x + c->w + wc.border_width - fhadj - 2,
-							c->y + c->h + wc.border_width - fhadj - 2,
-							fhadj, fhadj
-						);
-				}
+			if (size)
 				XConfigureWindow(dpy, focuswin, CWSibling|CWStackMode, &fwc);
+			else
+				XMoveResizeWindow(dpy, focuswin, 0, -fh - 1, fh, fh);
+		}
+		#elif PATCH_FOCUS_PIXEL
+		if ((c->isfullscreen
+			#if PATCH_FLAG_FAKEFULLSCREEN
+			&& c->fakefullscreen != 1
+			#endif // PATCH_FLAG_FAKEFULLSCREEN
+			)
+			#if PATCH_FLAG_PANEL
+			|| c->ispanel
+			#endif // PATCH_FLAG_PANEL
+			)
+			XMoveResizeWindow(dpy, focuswin, 0, -fh - 1, fh, fh);
+		else {
+			int fhadj = fh;
+			if (c->w >= c->h && fhadj >= (c->h / 2))
+				fhadj = (c->h / 2) - 1;
+			else if (c->h > c->w && fhadj >= (c->w / 2))
+				fhadj = (c->w / 2) - 1;
+			if (fhadj < 1)
+				fhadj = 1;
+			if (!fpcurpos)
+				fpcurpos = fppos;
+			switch (fpcurpos) {
+				case FOCUS_PIXEL_SW:
+					XMoveResizeWindow(dpy, focuswin,
+						c->x + wc.border_width,
+						c->y + c->h + wc.border_width - fhadj - 2,
+						fhadj, fhadj
+					);
+					break;
+				case FOCUS_PIXEL_NW:
+					XMoveResizeWindow(dpy, focuswin,
+						c->x + wc.border_width,
+						c->y + wc.border_width,
+						fhadj, fhadj
+					);
+					break;
+				case FOCUS_PIXEL_NE:
+					XMoveResizeWindow(dpy, focuswin,
+						c->x + c->w + wc.border_width - fhadj - 2,
+						c->y + wc.border_width,
+						fhadj, fhadj
+					);
+					break;
+				default:
+				case FOCUS_PIXEL_SE:
+					XMoveResizeWindow(dpy, focuswin,
+						c->x + c->w + wc.border_width - fhadj - 2,
+						c->y + c->h + wc.border_width - fhadj - 2,
+						fhadj, fhadj
+					);
 			}
-			#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
+			XConfigureWindow(dpy, focuswin, CWSibling|CWStackMode, &fwc);
 		}
 		#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 	}
-	else
-	#else // NO PATCH_FLAG_FLOAT_ALIGNMENT || PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
-	if (!ISVISIBLE(c))
-	#endif // PATCH_FLAG_FLOAT_ALIGNMENT || PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
-		wc.x = c->w * -2;
+	#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 
 	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
+	configures_sent++;
 	configure(c);
 
+	// during a layout pass the requests stay queued until restack() flushes them;
+	if (!configurebatch)
 	#if 0 // PATCH_FLAG_FAKEFULLSCREEN
 	if (c->fakefullscreen == 1)
 		XSync(dpy, True);
@@ -16732,6 +18234,7 @@ resizeclient(Client *c, int x, int y, int w, int h, int save_old)
 	#endif // PATCH_FLAG_FAKEFULLSCREEN
 		XSync(dpy, False);
 
+snap:
 	if (!(nonstop & 1)
 		#if PATCH_FLAG_IGNORED
 		&& !c->isignored
@@ -16784,6 +18287,9 @@ skipnextkeyevent(int type, unsigned int keycode, unsigned int state, unsigned lo
 	if (xev.type != type || xev.xkey.keycode != keycode || CLEANMASK(xev.xkey.state) != state || xev.xkey.serial != serial)
 		return 0;
 	XNextEvent(dpy, &xev);
+	#if PATCH_EVENT_RECORDING
+	recordevent(&xev, 1);
+	#endif // PATCH_EVENT_RECORDING
 	return 1;
 }
 
@@ -16837,6 +18343,7 @@ snapchildclients(Client *p, int quiet)
 					);
 				if (!quiet)
 					XMoveWindow(dpy, c->win, c->x, c->y);
+				c->cfgvalid = 0;
 
 				snapchildclients(c, quiet);
 			}
@@ -16867,6 +18374,7 @@ tagsatellites(Client *p) {
 				changes += tagsatellites(c);
 				if (c->tags != p->tags) {
 					c->tags = p->tags;
+					retally(c);
 					#if PATCH_PERSISTENT_METADATA
 					setclienttagprop(c);
 					#endif // PATCH_PERSISTENT_METADATA
@@ -17087,9 +18595,13 @@ toggletorch(const Arg *arg)
 
 		if (!grabinputs(1, 1, cursor[CurInvisible]->cursor)) {
 			#if PATCH_LOG_DIAGNOSTICS
-			logdatetime(stderr);
-			fprintf(stderr, "dwm: warning: toggletorch() unable to grab inputs, aborting.\n");
-			#endif
+			if (!grabinputslater(toggletorch, arg)) {
+				logdatetime(stderr);
+				fprintf(stderr, "dwm: warning: toggletorch() unable to grab inputs, aborting.\n");
+			}
+			#else // NO PATCH_LOG_DIAGNOSTICS
+			grabinputslater(toggletorch, arg);
+			#endif // PATCH_LOG_DIAGNOSTICS
 			return;
 		}
 
@@ -17172,7 +18684,7 @@ resizemouse(const Arg *arg)
 	int horizcorner, vertcorner;
 	unsigned int dui;
 	Window dummy;
-	Time lasttime = 0;
+	struct timespec lastframe = { 0 };
 
 	if (!(c = selmon->sel))
 		return;
@@ -17218,8 +18730,12 @@ resizemouse(const Arg *arg)
 	if ((was_cc = constrained_client == c))
 		destroybarriermon();
 	#endif // PATCH_CONSTRAIN_MOUSE
+	updaterefreshrates();
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		#if PATCH_EVENT_RECORDING
+		recordevent(&ev, 1);
+		#endif // PATCH_EVENT_RECORDING
 		switch(ev.type) {
 		case ConfigureRequest:
 		case Expose:
@@ -17227,9 +18743,7 @@ resizemouse(const Arg *arg)
 			handler[ev.type](&ev);
 			break;
 		case MotionNotify:
-			if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-				continue;
-			lasttime = ev.xmotion.time;
+			pacemotion(&ev, &lastframe);
 
 			nx = horizcorner ? (ocx + ev.xmotion.x - opx) : c->x;
 			ny = vertcorner ? (ocy + ev.xmotion.y - opy) : c->y;
@@ -17789,12 +19303,26 @@ run(void)
 					return;
 				}
 			}
+			else if (event_fd == timer_fd || event_fd == signal_fd) {
+				if (event_fd == timer_fd)
+					handletimers();
+				else
+					handlesignals();
+				// events read in by the handlers' requests are already off the socket, unseen by epoll;
+				if (running == 1 && XEventsQueued(dpy, QueuedAlready))
+					handlexevent(&(struct epoll_event){ .events = EPOLLIN, .data.fd = dpy_fd });
+			}
+			#if PATCH_HOT_RELOAD
+			else if (event_fd == hotreload_fd) {
+				handlehotreload();
+			}
+			#endif // PATCH_HOT_RELOAD
 			else if (event_fd == ipc_get_sock_fd()) {
 				ipc_handle_socket_epoll_event(events + i);
 			}
 			else if (ipc_is_client_registered(event_fd)){
 				if (ipc_handle_client_epoll_event(
-						events + i, mons, &lastselmon, selmon, tags, LENGTH(tags), layouts, LENGTH(layouts)
+						events + i, mons, lastselmon, selmon, tags, LENGTH(tags), layouts, LENGTH(layouts)
 					) < 0) {
 					logdatetime(stderr);
 					fprintf(stderr, "dwm: Error handling IPC event on fd %d\n", event_fd);
@@ -17826,16 +19354,29 @@ run(void)
 		#endif // PATCH_MOUSE_POINTER_HIDING
 		//#endif // PATCH_FOCUS_FOLLOWS_MOUSE || PATCH_MOUSE_POINTER_HIDING
 
-		struct pollfd pfd = {
-			.fd = ConnectionNumber(dpy),
-			.events = POLLIN,
+		// the timers and signals are checked between queued events too, so they can't be starved;
+		struct pollfd pfd[] = {
+			{ .fd = ConnectionNumber(dpy), .events = POLLIN },
+			{ .fd = timer_fd, .events = POLLIN },
+			{ .fd = signal_fd, .events = POLLIN },
 		};
-		int pending = XPending(dpy) > 0 || poll(&pfd, 1, -1) > 0;
+		int queued = XPending(dpy) > 0;
+		int pending = poll(pfd, LENGTH(pfd), queued ? 0 : -1) > 0 || queued;
 
 		if (running != 1)
 			break;
 		if (!pending)
 			continue;
+		if (pfd[2].revents & POLLIN)
+			handlesignals();
+		if (pfd[1].revents & POLLIN)
+			handletimers();
+		if (pfd[1].revents & POLLIN || pfd[2].revents & POLLIN) {
+			if (running != 1)
+				break;
+			if (!XPending(dpy))
+				continue;
+		}
 
 		XNextEvent(dpy, &ev);
 
@@ -17971,7 +19512,7 @@ run(void)
 		#endif // PATCH_MOUSE_POINTER_HIDING
 
 		if (handler[ev.type])
-			handler[ev.type](&ev); /* call handler */
+			dispatch(&ev);
 	}
 	#else // NO PATCH_IPC
 	XEvent ev;
@@ -17990,6 +19531,23 @@ run(void)
 		cookie = &ev.xcookie;
 		#endif // PATCH_MOUSE_POINTER_HIDING
 		//#endif // PATCH_FOCUS_FOLLOWS_MOUSE || PATCH_MOUSE_POINTER_HIDING
+		// the timers and signals are checked between queued events too, so they can't be starved;
+		struct pollfd pfd[] = {
+			{ .fd = ConnectionNumber(dpy), .events = POLLIN },
+			{ .fd = timer_fd, .events = POLLIN },
+			{ .fd = signal_fd, .events = POLLIN },
+		};
+		int queued = XPending(dpy) > 0;
+		if (poll(pfd, LENGTH(pfd), queued ? 0 : -1) > 0) {
+			if (pfd[2].revents & POLLIN)
+				handlesignals();
+			if (pfd[1].revents & POLLIN)
+				handletimers();
+			if (running != 1)
+				break;
+		}
+		if (!XPending(dpy))
+			continue;
 		if (XNextEvent(dpy, &ev))
 			break;
 
@@ -18128,7 +19686,7 @@ run(void)
 			#if PATCH_LOG_DIAGNOSTICS
 			if (logdiagnostics_event(ev))
 			#endif // PATCH_LOG_DIAGNOSTICS
-			handler[ev.type](&ev); /* call handler */
+			dispatch(&ev);
 		}
 	}
 	#endif // PATCH_IPC
@@ -18188,26 +19746,32 @@ void
 scan(void)
 {
 	int i;
-	unsigned int num;
+	unsigned int num, nmanage = 0;
 	Window d1, d2, *wins = NULL;
-	XWindowAttributes wa;
+	ScanWin *sw;
 	Client *c = NULL;
 	Monitor *m = NULL, *mdef = NULL;
+	struct timespec started;
+	// manage() time is tallied under its own phase, so keep it out of the scan phase;
+	double managed = profiling ? profiling->ms[ProfileManage] : 0;
 
+	clock_gettime(CLOCK_MONOTONIC, &started);
 	if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
 
 		nonstop = 1;
 		if (num > 0) {
 
+			// fetch what scan() and manage() need from every window at once,
+			// instead of a round-trip per request per window;
+			scanprefetch(wins, num);
+
 			#if PATCH_PERSISTENT_METADATA
-			int format;
-			unsigned long *data, n, extra, index;
-			Atom atom;
+			unsigned long index;
 
 			// restore clients in (reverse) order based on the index stored during cleanup();
 			// so that the client list is in the same order after a manual restart (as much as possible);
-			Window wlist[num];
-			for (i = 0; i < num; wlist[i++] = 0);
+			ScanWin *wlist[num];
+			for (i = 0; i < num; wlist[i++] = NULL);
 			#if DEBUGGING
 			int wcount = 0;
 			#endif // DEBUGGING
@@ -18218,36 +19782,30 @@ scan(void)
 					continue;
 				}
 
-				if (!XGetWindowAttributes(dpy, wins[i], &wa)
+				sw = &scanwins[i];
+				if (!sw->valid
 					#if !PATCH_SCAN_OVERRIDE_REDIRECTS
-					|| wa.override_redirect
+					|| sw->wa.override_redirect
 					#endif // PATCH_SCAN_OVERRIDE_REDIRECTS
-					|| !wa.depth
-					|| XGetTransientForHint(dpy, wins[i], &d1)
+					|| !sw->wa.depth
+					|| sw->istrans
 					)
 					continue;
-				long state = getstate(wins[i]);
-				if (wa.map_state == IsViewable || state == IconicState) {
-					index = 0;
-
-					if (XGetWindowProperty(dpy, wins[i], netatom[NetClientInfo], 0L, 1L, False, XA_CARDINAL,
-							&atom, &format, &n, &extra, (unsigned char **)&data) == Success && n > 0) {
-						index = *data;
-					}
-					if (n > 0)
-						XFree(data);
+				long state = sw->state;
+				if (sw->wa.map_state == IsViewable || state == IconicState) {
+					index = sw->index;
 					if (index < 1 || index > num || wlist[index - 1]) {
-						if (n > 0) {
+						if (index) {
 							logdatetime(stderr);
 							fprintf(stderr, "dwm: client index out of range or already taken, mapping out of order (0x%lx).\n", wins[i]);
 						}
-						manage(wins[i], &wa);
+						scanmanage(wins[i], &sw->wa, &nmanage);
 						continue;
 					}
 					#if DEBUGGING
 					wcount++;
 					#endif // DEBUGGING
-					wlist[index - 1] = wins[i];
+					wlist[index - 1] = sw;
 				}
 				else {
 					char name[256];
@@ -18260,7 +19818,7 @@ scan(void)
 						DEBUG("dwm: unable to get WM_STATE property (0x%lx: %s).\n", wins[i], name);
 					}
 					else
-						DEBUG("dwm: map_state(0x%x) not IsViewable or state(0x%lx) not IconicState (0x%lx: %s).\n", wa.map_state, state, wins[i], name);
+						DEBUG("dwm: map_state(0x%x) not IsViewable or state(0x%lx) not IconicState (0x%lx: %s).\n", sw->wa.map_state, state, wins[i], name);
 				}
 			}
 
@@ -18273,10 +19831,9 @@ scan(void)
 			#endif // DEBUGGING
 			for (i = num - 1; i >= 0; i--)
 				if (wlist[i]) {
-					DEBUG("%i: 0x%lx\n", i, wlist[i]);
-					if (XGetWindowAttributes(dpy, wlist[i], &wa))
-						manage(wlist[i], &wa);
-					wlist[i] = 0;
+					DEBUG("%i: 0x%lx\n", i, wlist[i]->win);
+					scanmanage(wlist[i]->win, &wlist[i]->wa, &nmanage);
+					wlist[i] = NULL;
 				}
 
 			for (i = 0; i < num; i++) { /* now the transients */
@@ -18285,38 +19842,27 @@ scan(void)
 					continue;
 				}
 
-				int result = XGetWindowAttributes(dpy, wins[i], &wa);
-				if (!result) {
+				sw = &scanwins[i];
+				if (!sw->valid) {
 					logdatetime(stderr);
 					fprintf(stderr, "dwm: unable to get window attributes (0x%lx).\n", wins[i]);
-				}
-				if (!result)
-				//if (!XGetWindowAttributes(dpy, wins[i], &wa))
 					continue;
-				if (XGetTransientForHint(dpy, wins[i], &d1)
-				&& (wa.map_state == IsViewable || getstate(wins[i]) == IconicState)) {
-					index = 0;
-
-					if (XGetWindowProperty(dpy, wins[i], netatom[NetClientInfo], 0L, 1L, False, XA_CARDINAL,
-							&atom, &format, &n, &extra, (unsigned char **)&data) == Success && n > 0) {
-						index = *data;
-					}
-					else index = 0;
-					if (n > 0)
-						XFree(data);
-
+				}
+				if (sw->istrans
+				&& (sw->wa.map_state == IsViewable || sw->state == IconicState)) {
+					index = sw->index;
 					if (index < 1 || index > num || wlist[index - 1]) {
-						if (n > 0) {
+						if (index) {
 							logdatetime(stderr);
 							fprintf(stderr, "dwm: transient client index out of range or already taken, mapping out of order (0x%lx).\n", wins[i]);
 						}
-						manage(wins[i], &wa);
+						scanmanage(wins[i], &sw->wa, &nmanage);
 						continue;
 					}
 					#if DEBUGGING
 					wcount++;
 					#endif // DEBUGGING
-					wlist[index - 1] = wins[i];
+					wlist[index - 1] = sw;
 				}
 			}
 			#if DEBUGGING
@@ -18327,9 +19873,8 @@ scan(void)
 			#endif // DEBUGGING
 			for (i = num - 1; i >= 0; i--)
 				if (wlist[i]) {
-					DEBUG("%i: 0x%lx\n", i, wlist[i]);
-					if (XGetWindowAttributes(dpy, wlist[i], &wa))
-						manage(wlist[i], &wa);
+					DEBUG("%i: 0x%lx\n", i, wlist[i]->win);
+					scanmanage(wlist[i]->win, &wlist[i]->wa, &nmanage);
 				}
 			#else // NO PATCH_PERSISTENT_METADATA
 			for (i = 0; i < num; i++) {
@@ -18338,27 +19883,37 @@ scan(void)
 					continue;
 				}
 
-				if (!XGetWindowAttributes(dpy, wins[i], &wa)
+				sw = &scanwins[i];
+				if (!sw->valid
 				#if !PATCH_SCAN_OVERRIDE_REDIRECTS
-				|| wa.override_redirect
+				|| sw->wa.override_redirect
 				#endif // PATCH_SCAN_OVERRIDE_REDIRECTS
-				|| !wa.depth || XGetTransientForHint(dpy, wins[i], &d1))
+				|| !sw->wa.depth || sw->istrans)
 					continue;
-				if (wa.map_state == IsViewable || getstate(wins[i]) == IconicState)
-					manage(wins[i], &wa);
+				if (sw->wa.map_state == IsViewable || sw->state == IconicState)
+					scanmanage(wins[i], &sw->wa, &nmanage);
 			}
 			for (i = 0; i < num; i++) { /* now the transients */
 				if ((c = wintoclient(wins[i]))) {
 					DEBUG("scan - transient window 0x%lx already linked to client \"%s\".\n", wins[i], c->name);
 					continue;
 				}
-				if (!XGetWindowAttributes(dpy, wins[i], &wa))
-					continue;
-				if (XGetTransientForHint(dpy, wins[i], &d1)
-				&& (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
-					manage(wins[i], &wa);
+				sw = &scanwins[i];
+				if (sw->valid && sw->istrans
+				&& (sw->wa.map_state == IsViewable || sw->state == IconicState))
+					scanmanage(wins[i], &sw->wa, &nmanage);
 			}
 			#endif // PATCH_PERSISTENT_METADATA
+
+			for (i = 0; i < num; i++)
+				for (int k = 0; k < ScanLast; k++)
+					free(scanwins[i].props[k]);
+			free(scanwins);
+			scanwins = NULL;
+			nscanwins = 0;
+			free(scanhash);
+			scanhash = NULL;
+			nscanhash = 0;
 		}
 		if (wins)
 			XFree(wins);
@@ -18411,7 +19966,284 @@ scan(void)
 			drawbars();
 		}
 
+		if (profiling)
+			profiling->ms[ProfileScan] += elapsedms(&started) - (profiling->ms[ProfileManage] - managed);
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: scanned %u windows, %u passed to manage(), in %.3f ms.\n", num, nmanage, elapsedms(&started));
+	}
+}
+
+// manage a window found by scan(), timing it for the profile;
+void
+scanmanage(Window w, XWindowAttributes *wa, unsigned int *n)
+{
+	struct timespec mark;
+
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+	manage(w, wa);
+	profilemark(ProfileManage, &mark);
+	if (profiling)
+		profiling->managed++;
+	(*n)++;
+}
+
+// issue every request scan() needs for each unmanaged window before waiting on
+// any reply, so the whole batch costs one round-trip;
+void
+scanprefetch(Window *wins, unsigned int num)
+{
+	unsigned int i, k;
+	ScanWin *sw;
+	xcb_generic_error_t *e;
+	xcb_get_window_attributes_reply_t *a;
+	xcb_get_geometry_reply_t *g;
+	xcb_get_property_reply_t *p;
+	struct {
+		int fetch;
+		xcb_get_window_attributes_cookie_t attr;
+		xcb_get_geometry_cookie_t geom;
+		xcb_get_property_cookie_t trans, state, wtype;
+		xcb_get_property_cookie_t props[ScanLast];
+		#if PATCH_PERSISTENT_METADATA
+		xcb_get_property_cookie_t index;
+		#endif // PATCH_PERSISTENT_METADATA
+		#ifdef __linux__
+		xcb_res_query_client_ids_cookie_t pid;
+		#endif /* __linux__ */
+	} *ck;
+
+	scanwins = ecalloc(num, sizeof(ScanWin));
+	nscanwins = num;
+	for (nscanhash = 2; nscanhash < num * 2; nscanhash <<= 1);
+	scanhash = ecalloc(nscanhash, sizeof(unsigned int));
+	for (i = 0; i < num; i++) {
+		for (k = SCANHASH(wins[i]); scanhash[k]; k = (k + 1) & (nscanhash - 1));
+		scanhash[k] = i + 1;
+	}
+	ck = ecalloc(num, sizeof *ck);
+
+	for (i = 0; i < num; i++) {
+		if (wintoclient(wins[i]))
+			continue;
+		ck[i].fetch = 1;
+		ck[i].attr = xcb_get_window_attributes(xcon, wins[i]);
+		ck[i].geom = xcb_get_geometry(xcon, wins[i]);
+		ck[i].trans = xcb_get_property(xcon, 0, wins[i], XA_WM_TRANSIENT_FOR, XA_WINDOW, 0, 1);
+		ck[i].state = xcb_get_property(xcon, 0, wins[i], wmatom[WMState], wmatom[WMState], 0, 2);
+		ck[i].wtype = xcb_get_property(xcon, 0, wins[i], netatom[NetWMWindowType], XA_ATOM, 0, 1);
+		#if PATCH_PERSISTENT_METADATA
+		ck[i].index = xcb_get_property(xcon, 0, wins[i], netatom[NetClientInfo], XA_CARDINAL, 0, 1);
+		#endif // PATCH_PERSISTENT_METADATA
+		#ifdef __linux__
+		xcb_res_client_id_spec_t spec = { .client = wins[i], .mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID };
+		ck[i].pid = xcb_res_query_client_ids(xcon, 1, &spec);
+		#endif /* __linux__ */
+	}
+
+	for (i = 0; i < num; i++) {
+		sw = &scanwins[i];
+		sw->win = wins[i];
+		sw->state = -1;
+		if (!ck[i].fetch)
+			continue;
+
+		e = NULL;
+		a = xcb_get_window_attributes_reply(xcon, ck[i].attr, &e);
+		free(e);
+		e = NULL;
+		g = xcb_get_geometry_reply(xcon, ck[i].geom, &e);
+		free(e);
+		if (a && g) {
+			sw->valid = 1;
+			sw->wa.x = g->x;
+			sw->wa.y = g->y;
+			sw->wa.width = g->width;
+			sw->wa.height = g->height;
+			sw->wa.border_width = g->border_width;
+			sw->wa.depth = g->depth;
+			sw->wa.root = g->root;
+			sw->wa.visual = NULL;	// not used by manage();
+			sw->wa.class = a->_class;
+			sw->wa.bit_gravity = a->bit_gravity;
+			sw->wa.win_gravity = a->win_gravity;
+			sw->wa.backing_store = a->backing_store;
+			sw->wa.backing_planes = a->backing_planes;
+			sw->wa.backing_pixel = a->backing_pixel;
+			sw->wa.save_under = a->save_under;
+			sw->wa.colormap = a->colormap;
+			sw->wa.map_installed = a->map_is_installed;
+			sw->wa.map_state = a->map_state;
+			sw->wa.all_event_masks = a->all_event_masks;
+			sw->wa.your_event_mask = a->your_event_mask;
+			sw->wa.do_not_propagate_mask = a->do_not_propagate_mask;
+			sw->wa.override_redirect = a->override_redirect;
+			sw->wa.screen = ScreenOfDisplay(dpy, screen);
+		}
+		free(a);
+		free(g);
+
+		e = NULL;
+		if ((p = xcb_get_property_reply(xcon, ck[i].wtype, &e))) {
+			if (p->type == XA_ATOM && p->format == 32 && p->value_len)
+				sw->wtype = *(uint32_t *) xcb_get_property_value(p);
+			free(p);
+		}
+		free(e);
+
+		e = NULL;
+		if ((p = xcb_get_property_reply(xcon, ck[i].trans, &e))) {
+			if ((sw->istrans = (p->type == XA_WINDOW && p->format == 32 && p->value_len)))
+				sw->trans = *(uint32_t *) xcb_get_property_value(p);
+			free(p);
+		}
+		free(e);
+
+		// as getstate(), assume iconic when WM_STATE can't be read but a window type is set;
+		e = NULL;
+		if ((p = xcb_get_property_reply(xcon, ck[i].state, &e))) {
+			if (p->type == wmatom[WMState] && p->format == 32 && p->value_len)
+				sw->state = *(uint32_t *) xcb_get_property_value(p);
+			free(p);
+		}
+		else if (sw->wtype != None)
+			sw->state = IconicState;
+		free(e);
+
+		#if PATCH_PERSISTENT_METADATA
+		e = NULL;
+		if ((p = xcb_get_property_reply(xcon, ck[i].index, &e))) {
+			if (p->type == XA_CARDINAL && p->format == 32 && p->value_len)
+				sw->index = *(uint32_t *) xcb_get_property_value(p);
+			free(p);
+		}
+		free(e);
+		#endif // PATCH_PERSISTENT_METADATA
+
+		#ifdef __linux__
+		xcb_res_query_client_ids_reply_t *r;
+		e = NULL;
+		if ((r = xcb_res_query_client_ids_reply(xcon, ck[i].pid, &e))) {
+			sw->pid = winpidreply(r);
+			free(r);
+		}
+		free(e);
+		#endif /* __linux__ */
+	}
+
+	// then what manage() reads, only for the windows scan() will manage, so
+	// the windows left alone don't cost their icons; one more round-trip;
+	scanatoms[ScanNetWMName] = netatom[NetWMName];
+	scanatoms[ScanWMName] = XA_WM_NAME;
+	scanatoms[ScanWMClass] = XA_WM_CLASS;
+	scanatoms[ScanWMRole] = wmatom[WMWindowRole];
+	scanatoms[ScanWMNormalHints] = XA_WM_NORMAL_HINTS;
+	scanatoms[ScanWMHints] = XA_WM_HINTS;
+	#if PATCH_WINDOW_ICONS
+	scanatoms[ScanNetWMIcon] = netatom[NetWMIcon];
+	#endif // PATCH_WINDOW_ICONS
+	for (i = 0; i < num; i++) {
+		sw = &scanwins[i];
+		if ((ck[i].fetch = (sw->valid && (sw->wa.map_state == IsViewable || sw->state == IconicState))))
+			for (k = 0; k < ScanLast; k++)
+				ck[i].props[k] = xcb_get_property(xcon, 0, wins[i], scanatoms[k], XCB_GET_PROPERTY_TYPE_ANY, 0, UINT32_MAX / 4);
+	}
+	for (i = 0; i < num; i++) {
+		if (!ck[i].fetch)
+			continue;
+		for (k = 0; k < ScanLast; k++) {
+			e = NULL;
+			scanwins[i].props[k] = xcb_get_property_reply(xcon, ck[i].props[k], &e);
+			free(e);
+		}
+	}
+
+	free(ck);
+}
+
+// the window's prefetched state while scan() runs, NULL otherwise;
+ScanWin *
+scanwin(Window w)
+{
+	ScanWin *sw;
+
+	if (!nscanhash)
+		return NULL;
+	for (unsigned int k = SCANHASH(w); scanhash[k]; k = (k + 1) & (nscanhash - 1))
+		if ((sw = &scanwins[scanhash[k] - 1])->win == w)
+			return sw->valid ? sw : NULL;
+	return NULL;
+}
+
+// the window's prefetched property while scan() runs, NULL if it has to be requested;
+xcb_get_property_reply_t *
+scanprop(Window w, Atom prop)
+{
+	ScanWin *sw;
+	int k;
+
+	if (!(sw = scanwin(w)))
+		return NULL;
+	for (k = 0; k < ScanLast && scanatoms[k] != prop; k++);
+	return (k < ScanLast ? sw->props[k] : NULL);
+}
+
+// as XGetWMNormalHints(), from a prefetched WM_NORMAL_HINTS;
+int
+scansizehints(xcb_get_property_reply_t *p, XSizeHints *size)
+{
+	uint32_t *v;
+
+	if (p->type != XA_WM_SIZE_HINTS || p->format != 32 || p->value_len < 15)
+		return 0;
+	v = xcb_get_property_value(p);
+	size->flags = v[0] & (USPosition|USSize|PAllHints);
+	size->x = (int32_t) v[1];
+	size->y = (int32_t) v[2];
+	size->width = (int32_t) v[3];
+	size->height = (int32_t) v[4];
+	size->min_width = (int32_t) v[5];
+	size->min_height = (int32_t) v[6];
+	size->max_width = (int32_t) v[7];
+	size->max_height = (int32_t) v[8];
+	size->width_inc = (int32_t) v[9];
+	size->height_inc = (int32_t) v[10];
+	size->min_aspect.x = (int32_t) v[11];
+	size->min_aspect.y = (int32_t) v[12];
+	size->max_aspect.x = (int32_t) v[13];
+	size->max_aspect.y = (int32_t) v[14];
+	if (p->value_len >= 18) {
+		size->flags |= v[0] & (PBaseSize|PWinGravity);
+		size->base_width = (int32_t) v[15];
+		size->base_height = (int32_t) v[16];
+		size->win_gravity = (int32_t) v[17];
+	}
+	else {
+		size->base_width = size->base_height = 0;
+		size->win_gravity = NorthWestGravity;
 	}
+	return 1;
+}
+
+// as XGetWMHints(), from a prefetched WM_HINTS; XFree() the result;
+XWMHints *
+scanwmhints(xcb_get_property_reply_t *p)
+{
+	XWMHints *wmh;
+	uint32_t *v;
+
+	if (p->type != XA_WM_HINTS || p->format != 32 || p->value_len < 8 || !(wmh = XAllocWMHints()))
+		return NULL;
+	v = xcb_get_property_value(p);
+	wmh->flags = v[0];
+	wmh->input = (v[1] ? True : False);
+	wmh->initial_state = (int32_t) v[2];
+	wmh->icon_pixmap = v[3];
+	wmh->icon_window = v[4];
+	wmh->icon_x = (int32_t) v[5];
+	wmh->icon_y = (int32_t) v[6];
+	wmh->icon_mask = v[7];
+	wmh->window_group = (p->value_len >= 9 ? v[8] : 0);
+	return wmh;
 }
 
 #if PATCH_IPC
@@ -19020,29 +20852,33 @@ setfocus(Client *c)
 		sendevent(c->win, wmatom[WMTakeFocus], NoEventMask, wmatom[WMTakeFocus], CurrentTime, 0, 0, 0);
 		#if PATCH_FLAG_ACTIVATION_CLICK
 		if (c->activationclick) {
-			struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
 			int dummy, root_x, root_y;
 			unsigned int mask;
 			Window wdummy;
 			XQueryPointer(dpy, root, &wdummy, &wdummy, &root_x, &root_y, &dummy, &dummy, &mask);
 
-			XButtonEvent xbpe;
-			xbpe.window = c->win;
-			xbpe.button = c->activationclick;
-			xbpe.display = dpy;
-			xbpe.root = root;
-			xbpe.same_screen = True;
-			xbpe.state = mask;
-			xbpe.subwindow = None;
-			xbpe.time = CurrentTime;
-			xbpe.type = ButtonPress;
-			XTranslateCoordinates(dpy, xbpe.root, xbpe.window, xbpe.x_root, xbpe.y_root, &xbpe.x, &xbpe.y, &xbpe.subwindow);
-			XSendEvent(dpy, c->win, True, ButtonPressMask, (XEvent *)&xbpe);
-			XFlush(dpy);
-			nanosleep(&ts, NULL);
-			xbpe.type = ButtonRelease;
-			XSendEvent(dpy, c->win, True, ButtonReleaseMask, (XEvent *)&xbpe);
+			// release a click still pending before starting another;
+			if (activationclicktimer.pprev) {
+				timerstop(&activationclicktimer);
+				activationclickrelease(&activationclicktimer);
+			}
+			XButtonEvent *xbpe = &activationclick;
+			memset(xbpe, 0, sizeof *xbpe);
+			xbpe->window = c->win;
+			xbpe->button = c->activationclick;
+			xbpe->display = dpy;
+			xbpe->root = root;
+			xbpe->same_screen = True;
+			xbpe->state = mask;
+			xbpe->subwindow = None;
+			xbpe->time = CurrentTime;
+			xbpe->type = ButtonPress;
+			xbpe->x_root = root_x;
+			xbpe->y_root = root_y;
+			XTranslateCoordinates(dpy, xbpe->root, xbpe->window, xbpe->x_root, xbpe->y_root, &xbpe->x, &xbpe->y, &xbpe->subwindow);
+			XSendEvent(dpy, c->win, True, ButtonPressMask, (XEvent *)xbpe);
 			XFlush(dpy);
+			timerstart(&activationclicktimer, 1, activationclickrelease);
 		}
 		#endif // PATCH_FLAG_ACTIVATION_CLICK
 	}
@@ -19325,6 +21161,7 @@ sethidden(Client *c, int hidden, int rearrange)
 		unminimize(c);
 
 	c->ishidden = hidden;
+	retally(c);
 	publishwindowstate(c);
 	if (rearrange && (!c->isfloating || !hidden))
 		arrange(c->mon);
@@ -19522,6 +21359,7 @@ setsticky(Client *c, int sticky)
 		return;
 
 	c->issticky = sticky;
+	retally(c);
 	publishwindowstate(c);
 	if (!sticky)
 		arrange(c->mon);
@@ -19536,40 +21374,25 @@ setup(void)
 	#if PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
 	XSetWindowAttributes fwa;
 	#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
-	#if PATCH_FONT_GROUPS
-	int j, n = -1, fg_minbh = 0;
-	#if PATCH_CLIENT_INDICATORS
-	int tagbar_bh;
-	#endif // PATCH_CLIENT_INDICATORS
-	cJSON *el, *nom;
-	Fnt *f;
-	#endif // PATCH_FONT_GROUPS
 
-	Atom utf8string;
-	struct sigaction sa;
+	struct timespec mark;
 
-	/* do not transform children into zombies when they terminate */
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = SA_NOCLDSTOP | SA_NOCLDWAIT | SA_RESTART;
-	sa.sa_handler = SIG_IGN;
-	sigaction(SIGCHLD, &sa, NULL);
+	setupsignals();
 
 	/* clean up any zombies (inherited from .xinitrc etc) immediately */
-	while (waitpid(-1, NULL, WNOHANG) > 0);
+	reapchildren();
 
-	#if PATCH_HANDLE_SIGNALS
-	/* add signal handlers */
-	signal(SIGHUP, sighup);
-	signal(SIGTERM, sigterm);
-	signal(SIGRELOAD_RESCAN, sigreload);
-	signal(SIGRELOAD_RULES, sigreloadrules);
-	#endif // PATCH_HANDLE_SIGNALS
+	setuptimers();
 
 	/* init screen */
 	screen = DefaultScreen(dpy);
 	sw = DisplayWidth(dpy, screen);
 	sh = DisplayHeight(dpy, screen);
 	root = RootWindow(dpy, screen);
+	XESetBeforeFlush(dpy, XAddExtension(dpy)->extension, latencyflush);
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+	internatoms();
+	profilemark(ProfileAtoms, &mark);
 	#if PATCH_ALPHA_CHANNEL
 	if (has_compositor(dpy, screen))
 		xinitvisual();
@@ -19578,150 +21401,30 @@ setup(void)
 	drw = drw_create(dpy, screen, root, sw, sh);
 	#endif // PATCH_ALPHA_CHANNEL
 
-	if (!fonts_json || !(drw->fonts = drw_fontset_create_json(drw, fonts_json)))
-		if (!(drw->fonts = drw_fontset_create(drw, fonts, LENGTH(fonts)))) {
-			logdatetime(stderr);
-			fputs("no fonts could be loaded.\n", stderr);
-			return 0;
-		}
-	lrpad = LRPAD(drw->fonts);
-	minbh = drw->fonts->h + 2;
-	bh = minbh
-		#if PATCH_CLIENT_INDICATORS
-		+ (client_ind ? client_ind_size : 0)
-		#endif // PATCH_CLIENT_INDICATORS
-	;
-	#if PATCH_CLIENT_INDICATORS
-	client_ind_offset = client_ind ? ((client_ind_size + 1) / 2) : 0;
-	#endif // PATCH_CLIENT_INDICATORS
-	#if PATCH_FONT_GROUPS
-	if (fontgroups_json && drw_populate_fontgroups(drw, fontgroups_json) && barelement_fontgroups_json) {
-
-		#if PATCH_CLIENT_INDICATORS
-		tagbar_bh = minbh;
-		#endif // PATCH_CLIENT_INDICATORS
-
-		if (cJSON_IsArray(barelement_fontgroups_json))
-			n = cJSON_GetArraySize(barelement_fontgroups_json);
-		else
-			el = barelement_fontgroups_json;
-
-		// iterate through bar element font groups;
-		for (i = 0; i < abs(n); i++) {
-			if (n > 0)
-				el = cJSON_GetArrayItem(barelement_fontgroups_json, i);
-			if (!(nom = cJSON_GetObjectItemCaseSensitive(el, "bar-element")) || !cJSON_IsString(nom))
-				continue;
-
-			// check if named bar-element is current;
-			for (j = LENGTH(BarElementTypes); j > 0; j--)
-				if (BarElementTypes[j - 1].name &&
-					strcmp(BarElementTypes[j - 1].name, nom->valuestring) == 0
-					)
-					break;
-			if (!j)
-				continue;
-
-			if ((el = cJSON_GetObjectItemCaseSensitive(el, "font-group")) && cJSON_IsString(el) &&
-				(f = drw_get_fontgroup_fonts(drw, el->valuestring))
-			) {
-				fg_minbh = f->h + 2;
-
-				#if PATCH_CLIENT_INDICATORS
-				if (BarElementTypes[j - 1].type == TagBar && (fg_minbh > tagbar_bh))
-					tagbar_bh = fg_minbh;
-				#endif // PATCH_CLIENT_INDICATORS
-
-				if (minbh < fg_minbh)
-					minbh = fg_minbh;
-			}
-		}
-		if (bh < minbh)
-			bh = minbh;
-		#if PATCH_CLIENT_INDICATORS
-		if (tagbar_bh + client_ind_size > bh)
-			bh = tagbar_bh + client_ind_size;
-		else if (tagbar_bh + (2 * client_ind_size) <= bh)
-			client_ind_offset = 0;
-		#endif // PATCH_CLIENT_INDICATORS
+	if (!loadfonts()) {
+		logdatetime(stderr);
+		fputs("no fonts could be loaded.\n", stderr);
+		return 0;
 	}
-	#endif // PATCH_FONT_GROUPS
+	updatebarheight();
+	profilemark(ProfileFonts, &mark);
+	#ifdef XRANDR
+	int rr_event_base, rr_error_base, rr_major, rr_minor;
+	randr = XRRQueryExtension(dpy, &rr_event_base, &rr_error_base)
+		&& XRRQueryVersion(dpy, &rr_major, &rr_minor)
+		&& (rr_major > 1 || (rr_major == 1 && rr_minor >= 3));
+	#endif /* XRANDR */
 	updategeom();
+	profilemark(ProfileMonitors, &mark);
 
 	#if PATCH_FLAG_GAME
-	int fixes_opcode, fixes_event_base, fixes_error_base;
-	if (XQueryExtension(dpy, "XFIXES", &fixes_opcode, &fixes_event_base, &fixes_error_base))
-		xfixes_support = 1;
-	else
-		fprintf(stderr, "No support for XFixes PointerBarrier.\n");
-	#endif // PATCH_FLAG_GAME
-
-	/* init atoms */
-	utf8string = XInternAtom(dpy, "UTF8_STRING", False);
-	wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
-	wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
-	wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
-	wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
-	wmatom[WMWindowRole] = XInternAtom(dpy, "WM_WINDOW_ROLE", False);
-	netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
-	netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
-	netatom[NetSystemTray] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_S0", False);
-	netatom[NetSystemTrayOP] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_OPCODE", False);
-	netatom[NetSystemTrayOrientation] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_ORIENTATION", False);
-	netatom[NetSystemTrayOrientationHorz] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_ORIENTATION_HORZ", False);
-	netatom[NetSystemTrayVisual] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_VISUAL", False);
-	netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
-	netatom[NetWMAttention] = XInternAtom(dpy, "_NET_WM_STATE_DEMANDS_ATTENTION", False);
-	#if PATCH_WINDOW_ICONS
-	netatom[NetWMIcon] = XInternAtom(dpy, "_NET_WM_ICON", False);
-	#endif // PATCH_WINDOW_ICONS
-	netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
-	netatom[NetWMCheck] = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
-	netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
-	#if PATCH_FLAG_STICKY
-    netatom[NetWMSticky] = XInternAtom(dpy, "_NET_WM_STATE_STICKY", False);
-	#endif // PATCH_FLAG_STICKY
-	#if PATCH_FLAG_ALWAYSONTOP
-	netatom[NetWMStaysOnTop] = XInternAtom(dpy, "_NET_WM_STATE_STAYS_ON_TOP", False);
-	#endif // PATCH_FLAG_ALWAYSONTOP
-	#if PATCH_FLAG_HIDDEN
-	netatom[NetWMHidden] = XInternAtom(dpy, "_NET_WM_STATE_HIDDEN", False);
-	#endif // PATCH_FLAG_HIDDEN
-	#if PATCH_MODAL_SUPPORT
-	netatom[NetWMModal] = XInternAtom(dpy, "_NET_WM_STATE_MODAL", False);
-	#endif // PATCH_MODAL_SUPPORT
-	netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
-	netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
-	netatom[NetWMWindowTypeSplash] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_SPLASH", False);
-	netatom[NetWMWindowTypeDock] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DOCK", False);
-	netatom[NetWMWindowTypeMenu] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_MENU", False);
-	netatom[NetWMWindowTypePopupMenu] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_POPUP_MENU", False);
-	#if PATCH_EWMH_TAGS
-	netatom[NetDesktopViewport] = XInternAtom(dpy, "_NET_DESKTOP_VIEWPORT", False);
-	netatom[NetNumberOfDesktops] = XInternAtom(dpy, "_NET_NUMBER_OF_DESKTOPS", False);
-	netatom[NetCurrentDesktop] = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
-	netatom[NetDesktopNames] = XInternAtom(dpy, "_NET_DESKTOP_NAMES", False);
-	#endif // PATCH_EWMH_TAGS
-	#if PATCH_SHOW_DESKTOP
-	netatom[NetWMWindowTypeDesktop] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DESKTOP", False);
-	#endif // PATCH_SHOW_DESKTOP
-	#if PATCH_LOG_DIAGNOSTICS
-	netatom[NetWMAbove] = XInternAtom(dpy, "_NET_WM_STATE_ABOVE", False);
-	netatom[NetWMBelow] = XInternAtom(dpy, "_NET_WM_STATE_BELOW", False);
-	netatom[NetWMMaximizedH] = XInternAtom(dpy, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
-	netatom[NetWMMaximizedV] = XInternAtom(dpy, "_NET_WM_STATE_MAXIMIZED_VERT", False);
-	netatom[NetWMShaded] = XInternAtom(dpy, "_NET_WM_STATE_SHADED", False);
-	netatom[NetWMSkipPager] = XInternAtom(dpy, "_NET_WM_STATE_SKIP_PAGER", False);
-	netatom[NetWMSkipTaskbar] = XInternAtom(dpy, "_NET_WM_STATE_SKIP_TASKBAR", False);
-	#endif // PATCH_LOG_DIAGNOSTICS
-	netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
-	netatom[NetClientInfo] = XInternAtom(dpy, "_NET_CLIENT_INFO", False);
-	xatom[Manager] = XInternAtom(dpy, "MANAGER", False);
-	xatom[Xembed] = XInternAtom(dpy, "_XEMBED", False);
-	xatom[XembedInfo] = XInternAtom(dpy, "_XEMBED_INFO", False);
-	#if PATCH_CLIENT_OPACITY
-	netatom[NetWMWindowsOpacity] = XInternAtom(dpy, "_NET_WM_WINDOW_OPACITY", False);
-	#endif // PATCH_CLIENT_OPACITY
+	int fixes_opcode, fixes_event_base, fixes_error_base;
+	if (XQueryExtension(dpy, "XFIXES", &fixes_opcode, &fixes_event_base, &fixes_error_base))
+		xfixes_support = 1;
+	else
+		fprintf(stderr, "No support for XFixes PointerBarrier.\n");
+	#endif // PATCH_FLAG_GAME
+
 	/* init cursors */
 	cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
 	cursor[CurResize] = drw_cur_create(drw, XC_sizing);
@@ -19741,95 +21444,13 @@ setup(void)
 	cursor[CurInvisible] = drw_cur_create(drw, -1);
 	#endif // PATCH_TORCH
 
-	#if PATCH_COLOUR_BAR
-	setdefaultcolours(colours[SchemeTagBar], colours[SchemeNorm]);
-	#if PATCH_FLAG_HIDDEN
-	setdefaultcolours(colours[SchemeTagBarHide], colours[SchemeHide]);
-	#endif // PATCH_FLAG_HIDDEN
-	setdefaultcolours(colours[SchemeTagBarSel], colours[SchemeSel]);
-	setdefaultcolours(colours[SchemeLayout], colours[SchemeNorm]);
-	setdefaultcolours(colours[SchemeTitle], colours[SchemeNorm]);
-	setdefaultcolours(colours[SchemeTitleSel], colours[SchemeSel]);
-	setdefaultcolours(colours[SchemeStatus], colours[SchemeNorm]);
-	#endif // PATCH_COLOUR_BAR
-	#if PATCH_RAINBOW_TAGS
-	setdefaultcolours(colours[SchemeTag1], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag2], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag3], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag4], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag5], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag6], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag7], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag8], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	setdefaultcolours(colours[SchemeTag9], colours[
-		#if PATCH_COLOUR_BAR
-		SchemeTagBarSel
-		#else // NO PATCH_COLOUR_BAR
-		SchemeSel
-		#endif // PATCH_COLOUR_BAR
-	]);
-	#endif // PATCH_RAINBOW_TAGS
-	#if PATCH_ALTTAB
-	setdefaultcolours(colours[SchemeTabNorm], colours[SchemeNorm]);
-	setdefaultcolours(colours[SchemeTabSel], colours[SchemeSel]);
-	setdefaultcolours(colours[SchemeTabUrg], colours[SchemeUrg]);
-	#if PATCH_FLAG_HIDDEN
-	setdefaultcolours(colours[SchemeTabHide], colours[SchemeTabNorm]);
-	#endif // PATCH_FLAG_HIDDEN
-	#endif // PATCH_ALTTAB
-
 	/* init appearance */
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+	defaultcolours();
 	scheme = ecalloc(LENGTH(colours), sizeof(Clr *));
 	for (i = 0; i < LENGTH(colours); i++)
 		scheme[i] = drw_scm_create(drw, colours[i], 3);
+	profilemark(ProfileColours, &mark);
 
 	#if PATCH_CUSTOM_TAG_ICONS
 	dummyc = ecalloc(1, sizeof(Client));
@@ -19843,11 +21464,12 @@ setup(void)
 	/* init bars */
 	updatebars();
 	updatestatus();
+	profilemark(ProfileBars, &mark);
 	/* supporting window for NetWMCheck */
 	wmcheckwin = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
 	XChangeProperty(dpy, wmcheckwin, netatom[NetWMCheck], XA_WINDOW, 32,
 		PropModeReplace, (unsigned char *) &wmcheckwin, 1);
-	XChangeProperty(dpy, wmcheckwin, netatom[NetWMName], utf8string, 8,
+	XChangeProperty(dpy, wmcheckwin, netatom[NetWMName], xatom[Utf8String], 8,
 		PropModeReplace, (unsigned char *) "dwm", 3);
 	XChangeProperty(dpy, root, netatom[NetWMCheck], XA_WINDOW, 32,
 		PropModeReplace, (unsigned char *) &wmcheckwin, 1);
@@ -19951,6 +21573,22 @@ setupepoll(void)
 		return result;
 	}
 
+	struct epoll_event timer_event = { .events = EPOLLIN, .data.fd = timer_fd };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event)) {
+		logdatetime(stderr);
+		fputs("dwm: Failed to add timer file descriptor to epoll", stderr);
+		close(epoll_fd);
+		return result;
+	}
+
+	struct epoll_event signal_event = { .events = EPOLLIN, .data.fd = signal_fd };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &signal_event)) {
+		logdatetime(stderr);
+		fputs("dwm: Failed to add signal file descriptor to epoll", stderr);
+		close(epoll_fd);
+		return result;
+	}
+
 	if (ipcsockpath)
 		free(ipcsockpath);
 	ipcsockpath = expandenv(socketpath);
@@ -19964,7 +21602,10 @@ setupepoll(void)
 			fprintf(stderr, "dwm: Unable to evaluate socket path: \"%s\"; using fallback \"%s\".\n", socketpath, socketpath_fallback);
 		ipcsockpath = strdup(socketpath_fallback);
 	}
-	if (ipc_init(ipcsockpath, epoll_fd, ipccommands, LENGTH(ipccommands)) < 0) {
+	#if PATCH_HOT_RELOAD
+	setuphotreload();
+	#endif // PATCH_HOT_RELOAD
+	if (ipc_init(ipcsockpath, epoll_fd, ipccommands, LENGTH(ipccommands), ipcqueuemax, ipcslowpolicy, profiles, LENGTH(profiles)) < 0) {
 		logdatetime(stderr);
 		fputs("dwm: Failed to initialize IPC\n", stderr);
 	}
@@ -19975,6 +21616,107 @@ setupepoll(void)
 }
 #endif // PATCH_IPC
 
+#if PATCH_HOT_RELOAD
+// watch the directories rather than the files, so files replaced by editors
+// (written elsewhere and renamed over) are still seen;
+void
+setuphotreload(void)
+{
+	const char *files[] = { rules_filename, layout_filename };
+	struct epoll_event event;
+	char dir[PATH_MAX];
+	const char *slash;
+	int i;
+
+	if (!rules_filename && !layout_filename)
+		return;
+	if ((hotreload_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: unable to watch the rules/layout files: %s\n", strerror(errno));
+		cleanuphotreload();
+		return;
+	}
+
+	for (i = 0; i < LENGTH(files); i++) {
+		hotreload_wd[i] = -1;
+		if (!files[i])
+			continue;
+		if (!(slash = strrchr(files[i], '/')))
+			strcpy(dir, ".");
+		else if (slash == files[i])
+			strcpy(dir, "/");
+		else
+			snprintf(dir, sizeof dir, "%.*s", (int)(slash - files[i]), files[i]);
+		if ((hotreload_wd[i] = inotify_add_watch(hotreload_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO)) == -1) {
+			logdatetime(stderr);
+			fprintf(stderr, "dwm: unable to watch \"%s\": %s\n", dir, strerror(errno));
+		}
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = hotreload_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, hotreload_fd, &event);
+}
+
+void
+cleanuphotreload(void)
+{
+	if (hotreload_fd != -1)
+		close(hotreload_fd);
+	timerstop(&hotreloadtimer);
+	hotreload_fd = -1;
+	hotreload_wd[0] = hotreload_wd[1] = -1;
+	hotreload_pending = 0;
+}
+
+void
+handlehotreload(void)
+{
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	const char *files[] = { rules_filename, layout_filename };
+	const int kinds[] = { HotReloadRules, HotReloadLayout };
+	const struct inotify_event *ev;
+	const char *base;
+	ssize_t len;
+	int i;
+
+	while ((len = read(hotreload_fd, buf, sizeof buf)) > 0)
+		for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (const struct inotify_event *) p;
+			if (!ev->len)
+				continue;
+			for (i = 0; i < LENGTH(files); i++) {
+				if (!files[i] || ev->wd != hotreload_wd[i])
+					continue;
+				base = strrchr(files[i], '/');
+				if (!strcmp(ev->name, base ? base + 1 : files[i]))
+					hotreload_pending |= kinds[i];
+			}
+		}
+	// (re)start the debounce, so a burst of writes is reloaded once;
+	if (hotreload_pending)
+		timerstart(&hotreloadtimer, hotreloaddelay, hotreloadsettled);
+}
+
+void
+hotreloadsettled(Timer *t)
+{
+	// an in-place reload re-applies the rules too;
+	if (hotreload_pending & HotReloadLayout) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: layout file \"%s\" changed.\n", layout_filename);
+		reloadinplace(NULL);
+	}
+	else if (hotreload_pending & HotReloadRules) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: rules file \"%s\" changed.\n", rules_filename);
+		reloadrules(NULL);
+	}
+	hotreload_pending = 0;
+}
+#endif // PATCH_HOT_RELOAD
+
 #if PATCH_MOUSE_POINTER_HIDING
 void
 setup_sync_counters(void)
@@ -20024,6 +21766,7 @@ seturgent(Client *c, int urg)
 	XWMHints *wmh;
 
 	c->isurgent = urgency ? urg : 0;
+	retally(c);
 	if (!(wmh = XGetWMHints(dpy, c->win)))
 		return;
 	wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
@@ -20124,12 +21867,25 @@ showhide(Client *c, int client_only)
 		#if PATCH_FLAG_GAME
 		else if (c->isgame && c->isfullscreen) {
 			XWindowAttributes wa;
-			if (!XGetWindowAttributes(dpy, c->win, &wa) || wa.x + wa.width < 0)
+			if (!XGetWindowAttributes(dpy, c->win, &wa) || wa.x + wa.width < 0) {
 				XMoveResizeWindow(dpy, c->win, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
+				c->cfgvalid = 0;
+			}
 		}
 		else
 		#endif // PATCH_FLAG_GAME
-		XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+		if (isconfigured(c, c->x, c->y, c->w, c->h, c->cfgbw,
+			#if PATCH_FOCUS_BORDER
+			0	// the focus border shrinks the focused client;
+			#else // NO PATCH_FOCUS_BORDER
+			c->cfgfocus
+			#endif // PATCH_FOCUS_BORDER
+			))
+			configures_elided++;
+		else {
+			XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+			c->cfgvalid = 0;
+		}
 
 		if (c->snext != c && !client_only)
 			showhide(c->snext, 0);
@@ -20142,7 +21898,15 @@ showhide(Client *c, int client_only)
 			XLowerWindow(dpy, c->win);
 		else
 		#endif // PATCH_FLAG_GAME
-		XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+		// the same x as resizeclient() hides at, so either one's move is elided;
+		if (isconfigured(c, c->w * -2, c->y, c->cfgw, c->cfgh, c->cfgbw, c->cfgfocus))
+			configures_elided++;
+		else {
+			XMoveWindow(dpy, c->win, c->w * -2, c->y);
+			// a move keeps the rest of the cached geometry, if there is any;
+			if (c->cfgvalid)
+				setconfigured(c, c->w * -2, c->y, c->cfgw, c->cfgh, c->cfgbw, c->cfgfocus);
+		}
 		#if PATCH_FLAG_GAME || PATCH_FLAG_HIDDEN || PATCH_FLAG_PANEL
 		if (c->autohide
 			#if PATCH_FLAG_HIDDEN
@@ -20191,17 +21955,12 @@ sighup(int unused)
 		for (c = m->clients; c; c = c->next)
 			c->sigtermcount = 0;
 
-	if (procparents) {
-		cnt = cJSON_GetArraySize(procparents);
-		for (int i = 0; i < cnt; ++i) {
-			cJSON *pp = cJSON_GetArrayItem(procparents, i);
-			if (!pp)
-				continue;
+	if (procparents)
+		for (cJSON *pp = procparents->child; pp; pp = pp->next) {
 			cJSON *pp_count = cJSON_GetObjectItemCaseSensitive(pp, "sigtermcount");
 			if (pp_count)
 				cJSON_SetIntValue(pp_count, 0L);
 		}
-	}
 	cnt = 0;
 
 	#if PATCH_MODAL_SUPPORT
@@ -20298,27 +22057,102 @@ sigterm(int unused)
 {
 	logdatetime(stderr);
 	fputs("dwm: received SIGTERM\n", stderr);
+	running = 0;
+}
+#endif // PATCH_HANDLE_SIGNALS
+
+// the handled signals are blocked and read from signal_fd instead, so they are
+// dispatched from the main loop between events like any other input, and the
+// handlers are free to touch clients, X and the rules;
+void
+setupsignals(void)
+{
+	sigset_t mask, prev;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
 	#if PATCH_HANDLE_SIGNALS
-	if (!running && killable) {
-		pid_t dwmpid = getpid();
-		kill(dwmpid, SIGKILL);
+	sigaddset(&mask, SIGHUP);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGRELOAD_RESCAN);
+	sigaddset(&mask, SIGRELOAD_RULES);
+	#endif // PATCH_HANDLE_SIGNALS
+	if (sigprocmask(SIG_BLOCK, &mask, &prev) == -1)
+		die("can't block signals:");
+	// after a reload the signals are still blocked, so keep the mask from startup;
+	if (!sigorigsaved) {
+		sigorigmask = prev;
+		sigorigsaved = 1;
+	}
+	if ((signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1)
+		die("can't create the signal fd:");
+}
+
+// drops what's still queued, as the clients it would act on are gone, but a
+// SIGTERM still cancels a reload; unblocking restores the default actions, so
+// a reload only unblocks SIGTERM, and any other signal waits for the next
+// setupsignals() rather than killing dwm;
+void
+cleanupsignals(void)
+{
+	struct signalfd_siginfo si;
+	sigset_t mask;
+
+	if (signal_fd == -1)
+		return;
+	while (read(signal_fd, &si, sizeof(si)) == sizeof(si))
+		if (si.ssi_signo == SIGTERM)
+			running = 0;
+	close(signal_fd);
+	signal_fd = -1;
+	if (running == -1) {
+		sigemptyset(&mask);
+		if (!sigismember(&sigorigmask, SIGTERM))
+			sigaddset(&mask, SIGTERM);
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
 	}
 	else
-	#endif // PATCH_HANDLE_SIGNALS
-	running = 0;
+		sigprocmask(SIG_SETMASK, &sigorigmask, NULL);
 }
-#endif // PATCH_HANDLE_SIGNALS
 
-#if PATCH_STATUSCMD
-#if 0
 void
-sigchld(int unused)
+handlesignals(void)
+{
+	struct signalfd_siginfo si;
+
+	while (read(signal_fd, &si, sizeof(si)) == sizeof(si)) {
+		if (si.ssi_signo == SIGCHLD)
+			reapchildren();
+		#if PATCH_HANDLE_SIGNALS
+		else if (si.ssi_signo == SIGHUP)
+			sighup(si.ssi_signo);
+		else if (si.ssi_signo == SIGTERM)
+			sigterm(si.ssi_signo);
+		else if (si.ssi_signo == SIGRELOAD_RESCAN)
+			sigreload(si.ssi_signo);
+		else if (si.ssi_signo == SIGRELOAD_RULES)
+			sigreloadrules(si.ssi_signo);
+		#endif // PATCH_HANDLE_SIGNALS
+	}
+}
+
+// SIGCHLD is coalesced while pending, so one may stand for several children;
+void
+reapchildren(void)
 {
-	if (signal(SIGCHLD, sigchld) == SIG_ERR)
-		die("can't install SIGCHLD handler:");
-	while (0 < waitpid(-1, NULL, WNOHANG));
+	pid_t pid;
+
+	while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+		#if PATCH_EXTERNAL_WINDOW_ACTIVATION
+		if (pid == switcher_pid) {
+			switcher_pid = 0;
+			enable_switching = 0;
+		}
+		#endif // PATCH_EXTERNAL_WINDOW_ACTIVATION
+	}
 }
-#endif
+
+#if PATCH_STATUSCMD
 void
 sigstatusbar(const Arg *arg)
 {
@@ -20794,6 +22628,7 @@ spawnex(const void *v, int keyhelp)
 		sa.sa_flags = 0;
 		sa.sa_handler = SIG_DFL;
 		sigaction(SIGCHLD, &sa, NULL);
+		sigprocmask(SIG_SETMASK, &sigorigmask, NULL);
 
 		execvp(((char **)v)[0], (char **)v);
 		logdatetime(stderr);
@@ -20839,7 +22674,7 @@ strcmpbynum(const char *s1, const char *s2) {
 
 #if PATCH_IPC
 int
-subscribe(const char *event)
+subscribe(const char *event, const char *delivery)
 {
 	if (connect_to_socket() == -1) {
 		logdatetime(stderr);
@@ -20855,11 +22690,14 @@ subscribe(const char *event)
 	// Message format:
 	// {
 	//   "event": "<event>",
-	//   "action": "subscribe"
+	//   "action": "subscribe",
+	//   "delivery": "<latest|every>"
 	// }
 
 	cJSON_AddStringToObject(gen, "event", event);
 	cJSON_AddStringToObject(gen, "action", "subscribe");
+	if (delivery)
+		cJSON_AddStringToObject(gen, "delivery", delivery);
 
 	msg = cJSON_PrintUnformatted(gen);
 	msg_size = strlen(msg) + 1;
@@ -21907,6 +23745,9 @@ altTabStart(const Arg *arg)
 		XEvent event;
 		if (grabbed == 0) {
 			altTabEnd();
+			// retry only while the modifier is held, or the retry would wait for its release;
+			if ((arg->ui & ALTTAB_MOUSE) || keysdown(tabModKey))
+				grabinputslater(altTabStart, arg);
 		} else {
 
 			struct timespec starttime;
@@ -21940,7 +23781,9 @@ altTabStart(const Arg *arg)
 					altTab(direction, 1);
 			}
 
-			Time lasttime = 0;
+			struct timespec lastframe = { 0 };
+			if (altTabMon->isAlt & ALTTAB_MOUSE)
+				updaterefreshrates();
 			#if PATCH_MOUSE_POINTER_WARPING
 			int isAltMouse = (altTabMon->isAlt & ALTTAB_MOUSE);
 			#if PATCH_MOUSE_POINTER_WARPING_SMOOTH
@@ -21952,12 +23795,13 @@ altTabStart(const Arg *arg)
 			XKeyEvent kev = { 0 };
 			while (grabbed) {
 				XNextEvent(dpy, &event);
+				#if PATCH_EVENT_RECORDING
+				recordevent(&event, 1);
+				#endif // PATCH_EVENT_RECORDING
 				if (event.type == KeyPress || event.type == KeyRelease || event.type == MotionNotify || event.type == ButtonPress || event.type == ButtonRelease) {
 					if (altTabMon->isAlt & ALTTAB_MOUSE) {
 						if (event.type == MotionNotify) {
-							if ((event.xmotion.time - lasttime) <= (1000 / 60))
-								continue;
-							lasttime = event.xmotion.time;
+							pacemotion(&event, &lastframe);
 
 							if (event.xmotion.x >= altTabMon->tx && event.xmotion.x <= (altTabMon->tx + altTabMon->maxWTab) &&
 								event.xmotion.y >= altTabMon->ty && event.xmotion.y <= (altTabMon->ty + altTabMon->maxHTab)) {
@@ -22076,6 +23920,9 @@ altTabStart(const Arg *arg)
 			// prematurely if we get a critical event;
 			while (same) {
 				XNextEvent(dpy, &event);
+				#if PATCH_EVENT_RECORDING
+				recordevent(&event, 1);
+				#endif // PATCH_EVENT_RECORDING
 				switch (event.type) {
 					case ButtonRelease:
 						if (same == 1 && event.xbutton.button == bev.button)
@@ -22273,6 +24120,7 @@ tag(const Arg *arg)
 	#endif // PATCH_FLAG_FOLLOW_PARENT
 
 	c->tags = arg->ui & TAGMASK;
+	retally(c);
 	if (c->isfullscreen
 		#if PATCH_FLAG_FAKEFULLSCREEN
 		&& c->fakefullscreen != 1
@@ -22291,6 +24139,7 @@ tag(const Arg *arg)
 		for (Client *p = c->snext; p; p = p->snext)
 			if (p->ultparent == c->ultparent && ISVISIBLE(p)) {
 				p->tags = arg->ui & TAGMASK;
+				retally(p);
 				#if PATCH_PERSISTENT_METADATA
 				setclienttagprop(p);
 				#endif // PATCH_PERSISTENT_METADATA
@@ -22328,6 +24177,107 @@ tag(const Arg *arg)
 			focus(c, 0);
 }
 
+/* bring the tag counts up to date after the client's monitor, tags or flags
+ * changed */
+void
+retally(Client *c)
+{
+	if (c->tallymon)
+		tallyclient(c, 1);
+}
+
+unsigned int
+tagcountmask(const unsigned int counts[])
+{
+	unsigned int i, mask = 0;
+
+	for (i = 0; i < LENGTH(tags); i++)
+		if (counts[i])
+			mask |= 1 << i;
+	return mask;
+}
+
+/* withdraw the client from the tag counts it was last added to, and with add,
+ * add it again as it is now; no-op for clients that were never added */
+void
+tallyclient(Client *c, int add)
+{
+	#if PATCH_FLAG_PANEL
+	int waspanel = (c->tallymon ? !!(c->tallyflags & TallyPanel) : -1);
+	#endif // PATCH_FLAG_PANEL
+
+	if (c->tallymon)
+		tallytags(c->tallymon, c->tallytags, c->tallyflags, -1);
+	if (!add || !c->mon) {
+		c->tallymon = NULL;
+		return;
+	}
+
+	c->tallyflags = 0;
+	if (!c->dormant
+		#if PATCH_FLAG_IGNORED
+		&& !c->isignored
+		#endif // PATCH_FLAG_IGNORED
+		#if PATCH_FLAG_PANEL
+		&& !c->ispanel && !(c->ultparent && c->ultparent->ispanel)
+		#endif // PATCH_FLAG_PANEL
+	)
+		c->tallyflags |= TallyBar;
+	if (c->isurgent)
+		c->tallyflags |= TallyUrgent;
+	#if PATCH_FLAG_HIDDEN
+	if (c->ishidden)
+		c->tallyflags |= TallyHidden;
+	#endif // PATCH_FLAG_HIDDEN
+	#if PATCH_FLAG_STICKY
+	if (c->issticky)
+		c->tallyflags |= TallySticky;
+	#endif // PATCH_FLAG_STICKY
+	if (c->tags == TAGMASK)
+		c->tallyflags |= TallyAllTags;
+	#if PATCH_FLAG_PANEL
+	if (c->ispanel)
+		c->tallyflags |= TallyPanel;
+	#endif // PATCH_FLAG_PANEL
+
+	c->tallymon = c->mon;
+	c->tallytags = c->tags;
+	tallytags(c->tallymon, c->tallytags, c->tallyflags, 1);
+
+	#if PATCH_FLAG_PANEL
+	// the children of a panel are kept off the bar, so count them again
+	// when it stops or starts being one;
+	if (waspanel != -1 && waspanel != !!c->ispanel)
+		for (Monitor *m = mons; m; m = m->next)
+			for (Client *cc = m->clients; cc; cc = cc->next)
+				if (cc != c && cc->ultparent == c)
+					retally(cc);
+	#endif // PATCH_FLAG_PANEL
+}
+
+void
+tallytags(Monitor *m, unsigned int tagmask, unsigned int flags, int delta)
+{
+	for (int i = 0; i < LENGTH(tags); i++) {
+		if (tagmask & 1 << i) {
+			m->tagclients[i] += delta;
+			if (flags & TallyUrgent)
+				m->tagurgent[i] += delta;
+			if (!(flags & TallyBar))
+				continue;
+			m->tagbarclients[i] += delta;
+			if (!(flags & TallyAllTags))
+				m->tagbaroccupied[i] += delta;
+			if (flags & TallyHidden)
+				m->tagbarhidden[i] += delta;
+			else if (flags & TallyUrgent)
+				m->tagbarurgent[i] += delta;
+		}
+		else if ((flags & (TallyBar|TallySticky)) == (TallyBar|TallySticky))
+			m->tagbarsticky[i] += delta;
+	}
+}
+
 void
 tagmon(const Arg *arg)
 {
@@ -22401,7 +24351,133 @@ tagmon(const Arg *arg)
 			);
 	}
 
-	sendmon(c, m, sel, 1);
+	sendmon(c, m, sel, 1);
+}
+
+// a single timerfd serves every timer: it is set for the earliest expiry on the
+// wheel, and handletimers() runs whatever is due from the main loop;
+void
+setuptimers(void)
+{
+	if ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1)
+		die("can't create the timer:");
+	timertick = timernow();
+	timerarmed = 0;
+}
+
+void
+cleanuptimers(void)
+{
+	for (int i = 0; i < TIMER_WHEEL_SLOTS; i++)
+		while (timerwheel[i])
+			timerstop(timerwheel[i]);
+	if (timer_fd != -1)
+		close(timer_fd);
+	timer_fd = -1;
+	timerarmed = 0;
+}
+
+void
+handletimers(void)
+{
+	Timer *expired = NULL, **tail = &expired, *t, *next;
+	unsigned long long now = timernow();
+	uint64_t expirations;
+
+	if (read(timer_fd, &expirations, sizeof expirations) != sizeof expirations && errno != EAGAIN)
+		return;
+	timerarmed = 0;
+
+	// after a long stall every slot is due, so one revolution covers it;
+	if (now >= timertick + TIMER_WHEEL_SLOTS)
+		timertick = now - TIMER_WHEEL_SLOTS + 1;
+	// move what's due to the expired list first, as the callbacks may start and stop timers;
+	for (; timertick <= now; timertick++)
+		for (t = timerwheel[timertick % TIMER_WHEEL_SLOTS]; t; t = next) {
+			next = t->next;
+			if (t->expires > now)
+				continue;
+			if ((*t->pprev = t->next))
+				t->next->pprev = t->pprev;
+			t->next = NULL;
+			t->pprev = tail;
+			*tail = t;
+			tail = &t->next;
+		}
+	while ((t = expired)) {
+		timerstop(t);
+		t->func(t);
+	}
+	timerarm();
+}
+
+// sets the timerfd for the earliest pending expiry, or disarms it;
+void
+timerarm(void)
+{
+	struct itimerspec its = {0};
+	unsigned long long next = 0, tick;
+	Timer *t;
+
+	for (tick = timertick; timercount && !next && tick < timertick + TIMER_WHEEL_SLOTS; tick++)
+		for (t = timerwheel[tick % TIMER_WHEEL_SLOTS]; t; t = t->next)
+			if (t->expires <= tick) {
+				next = tick;
+				break;
+			}
+	// only timers beyond one revolution left, so wake once the wheel has turned;
+	if (timercount && !next)
+		next = timertick + TIMER_WHEEL_SLOTS - 1;
+	its.it_value.tv_sec = next / 1000;
+	its.it_value.tv_nsec = (next % 1000) * 1000000;
+	timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+	timerarmed = next;
+}
+
+// milliseconds on the monotonic clock;
+unsigned long long
+timernow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000ULL + now.tv_nsec / 1000000;
+}
+
+// (re)starts the timer to call func once, after ms;
+void
+timerstart(Timer *t, unsigned int ms, void (*func)(Timer *t))
+{
+	Timer **slot;
+
+	timerstop(t);
+	// nothing pending, so the wheel has nothing to catch up on;
+	if (!timercount)
+		timertick = timernow();
+	t->func = func;
+	// never behind the wheel, or it would wait a whole revolution;
+	if ((t->expires = timernow() + ms) < timertick)
+		t->expires = timertick;
+	slot = &timerwheel[t->expires % TIMER_WHEEL_SLOTS];
+	if ((t->next = *slot))
+		t->next->pprev = &t->next;
+	t->pprev = slot;
+	*slot = t;
+	timercount++;
+	if (!timerarmed || t->expires < timerarmed)
+		timerarm();
+}
+
+// a stopped timer leaves the timerfd set; handletimers() finds nothing due and re-arms it;
+void
+timerstop(Timer *t)
+{
+	if (!t->pprev)
+		return;
+	if ((*t->pprev = t->next))
+		t->next->pprev = t->pprev;
+	t->next = NULL;
+	t->pprev = NULL;
+	timercount--;
 }
 
 void
@@ -22640,8 +24716,10 @@ togglefloatingex(Client *c)
 		c->sfw = c->w;
 		c->sfh = c->h;
 	}
-	if (!vis)
+	if (!vis) {
 		XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+		c->cfgvalid = 0;
+	}
 	#if PATCH_CROP_WINDOWS
 	if (!c->isfloating && c->crop)
 		cropdelete(c);
@@ -22882,6 +24960,7 @@ toggletagex(Client *c, int tagmask)
 	newtags = c->tags ^ (tagmask & TAGMASK);
 	if (newtags) {
 		c->tags = newtags;
+		retally(c);
 		#if PATCH_PERSISTENT_METADATA
 		setclienttagprop(c);
 		#endif // PATCH_PERSISTENT_METADATA
@@ -23029,6 +25108,7 @@ unfocus(Client *c, int setfocus)
 	if (desktopvalid(c))
 	#endif // PATCH_SHOW_DESKTOP
 	XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+	c->cfgvalid = 0;
 	#elif PATCH_FOCUS_PIXEL
 	fpcurpos = 0;
 	#endif // PATCH_FOCUS_BORDER || PATCH_FOCUS_PIXEL
@@ -23219,6 +25299,7 @@ unmanage(Client *c, int destroyed, int cleanup)
 
 	detach(c);
 	detachstack(c);
+	tallyclient(c, 0);
 	removelinks(c);
 	#if PATCH_WINDOW_ICONS
 	freeicon(c);
@@ -23304,6 +25385,7 @@ unmanage(Client *c, int destroyed, int cleanup)
 		}
 		#endif // PATCH_HANDLE_SIGNALS
 
+		int held = 0;
 		#if PATCH_SWITCH_TAG_ON_EMPTY
 		Client *cc = c;
 		if (c->mon->switchonempty && ((c->tags & c->mon->tagset[c->mon->seltags]) || c->issticky)) {
@@ -23334,21 +25416,17 @@ unmanage(Client *c, int destroyed, int cleanup)
 						selmon = pm;
 				}
 				#endif // PATCH_FOCUS_FOLLOWS_MOUSE
-				waitforclearkeyboard();
 				if ((c->mon != selmon && (sel = selmon->sel)) || !(sel = guessnextfocus(c, c->mon)))
-					focus(NULL, 0);
-				else {
-					if (sel->mon != selmon) {
-						sel->mon->sel = sel;
-						viewmontag(sel->mon, sel->tags, 0);
-						focus(NULL, 0);
-					}
-					else focus(sel, 0);
-				}
+					sel = NULL;
+				if ((held = keysdown(0)))
+					refocuslater(sel, c->mon);
+				else
+					refocus(sel);
 			}
 		}
 		#if PATCH_MOUSE_POINTER_WARPING
-		if (c->mon == selmon) {
+		// a held back refocus warps once it's done;
+		if (c->mon == selmon && !held) {
 			if (c->mon->sel)
 				#if PATCH_MOUSE_POINTER_WARPING_SMOOTH
 				warptoclient(c->mon->sel, 1, -1);
@@ -23487,12 +25565,90 @@ unminimize(Client *c)
 		}
 		#endif // PATCH_FLAG_GAME
 		XMoveWindow(dpy, c->win, c->x, c->y);
+		c->cfgvalid = 0;
 		XMapWindow(dpy, c->win);
 	}
 	setclientstate(c, NormalState);
 }
 #endif // PATCH_FLAG_GAME || PATCH_FLAG_HIDDEN || PATCH_FLAG_PANEL
 
+// derive the bar heights from the current fonts and (re)populate the font groups;
+void
+updatebarheight(void)
+{
+	#if PATCH_FONT_GROUPS
+	int i, j, n = -1, fg_minbh = 0;
+	#if PATCH_CLIENT_INDICATORS
+	int tagbar_bh;
+	#endif // PATCH_CLIENT_INDICATORS
+	cJSON *el = NULL, *nom;
+	Fnt *f;
+	#endif // PATCH_FONT_GROUPS
+
+	lrpad = LRPAD(drw->fonts);
+	minbh = drw->fonts->h + 2;
+	bh = minbh
+		#if PATCH_CLIENT_INDICATORS
+		+ (client_ind ? client_ind_size : 0)
+		#endif // PATCH_CLIENT_INDICATORS
+	;
+	#if PATCH_CLIENT_INDICATORS
+	client_ind_offset = client_ind ? ((client_ind_size + 1) / 2) : 0;
+	#endif // PATCH_CLIENT_INDICATORS
+	#if PATCH_FONT_GROUPS
+	if (drw_populate_fontgroups(drw, fontgroups_json) && barelement_fontgroups_json) {
+
+		#if PATCH_CLIENT_INDICATORS
+		tagbar_bh = minbh;
+		#endif // PATCH_CLIENT_INDICATORS
+
+		if (cJSON_IsArray(barelement_fontgroups_json))
+			n = cJSON_GetArraySize(barelement_fontgroups_json);
+		else
+			el = barelement_fontgroups_json;
+
+		// iterate through bar element font groups;
+		for (i = 0; i < abs(n); i++) {
+			if (n > 0)
+				el = cJSON_GetArrayItem(barelement_fontgroups_json, i);
+			if (!(nom = cJSON_GetObjectItemCaseSensitive(el, "bar-element")) || !cJSON_IsString(nom))
+				continue;
+
+			// check if named bar-element is current;
+			for (j = LENGTH(BarElementTypes); j > 0; j--)
+				if (BarElementTypes[j - 1].name &&
+					strcmp(BarElementTypes[j - 1].name, nom->valuestring) == 0
+					)
+					break;
+			if (!j)
+				continue;
+
+			if ((el = cJSON_GetObjectItemCaseSensitive(el, "font-group")) && cJSON_IsString(el) &&
+				(f = drw_get_fontgroup_fonts(drw, el->valuestring))
+			) {
+				fg_minbh = f->h + 2;
+
+				#if PATCH_CLIENT_INDICATORS
+				if (BarElementTypes[j - 1].type == TagBar && (fg_minbh > tagbar_bh))
+					tagbar_bh = fg_minbh;
+				#endif // PATCH_CLIENT_INDICATORS
+
+				if (minbh < fg_minbh)
+					minbh = fg_minbh;
+			}
+		}
+		if (bh < minbh)
+			bh = minbh;
+		#if PATCH_CLIENT_INDICATORS
+		if (tagbar_bh + client_ind_size > bh)
+			bh = tagbar_bh + client_ind_size;
+		else if (tagbar_bh + (2 * client_ind_size) <= bh)
+			client_ind_offset = 0;
+		#endif // PATCH_CLIENT_INDICATORS
+	}
+	#endif // PATCH_FONT_GROUPS
+}
+
 int
 updatebarpos(Monitor *m)
 {
@@ -23592,6 +25748,39 @@ updatebars(void)
 	}
 }
 
+// cache the client's WM_CLASS, as XGetClassHint() splits it: "instance\0class\0";
+void
+updateclass(Client *c)
+{
+	XClassHint ch = { NULL, NULL };
+	xcb_get_property_reply_t *p;
+	const char *v;
+	int len, n;
+
+	c->class[0] = c->instance[0] = '\0';
+	if ((p = scanprop(c->win, XA_WM_CLASS))) {
+		if (p->type != XA_STRING || p->format != 8)
+			return;
+		v = xcb_get_property_value(p);
+		len = xcb_get_property_value_length(p);
+		n = strnlen(v, len);
+		snprintf(c->instance, sizeof c->instance, "%.*s", n, v);
+		if (n < len)
+			snprintf(c->class, sizeof c->class, "%.*s", (int) strnlen(v + n + 1, len - n - 1), v + n + 1);
+		return;
+	}
+	if (!XGetClassHint(dpy, c->win, &ch))
+		return;
+	if (ch.res_class) {
+		snprintf(c->class, sizeof c->class, "%s", ch.res_class);
+		XFree(ch.res_class);
+	}
+	if (ch.res_name) {
+		snprintf(c->instance, sizeof c->instance, "%s", ch.res_name);
+		XFree(ch.res_name);
+	}
+}
+
 void
 updateclientlist(void)
 {
@@ -23848,13 +26037,70 @@ updatenumlockmask(void)
 	XFreeModifiermap(modmap);
 }
 
+// takes each monitor's refresh rate from the RandR CRTC covering most of it,
+// so split (virtual) monitors share their output's rate; 0 when unknown;
+void
+updaterefreshrates(void)
+{
+	Monitor *m;
+
+	for (m = mons; m; m = m->next)
+		m->refreshrate = 0;
+
+	#ifdef XRANDR
+	XRRScreenResources *res;
+	XRRCrtcInfo **crtcs;
+	XRRModeInfo *mode;
+	double *rates, vtotal;
+	int i, j, area, best;
+
+	if (!randr || !(res = XRRGetScreenResourcesCurrent(dpy, root)))
+		return;
+	crtcs = ecalloc(res->ncrtc, sizeof(XRRCrtcInfo *));
+	rates = ecalloc(res->ncrtc, sizeof(double));
+	for (i = 0; i < res->ncrtc; i++) {
+		if (!(crtcs[i] = XRRGetCrtcInfo(dpy, res, res->crtcs[i])) || crtcs[i]->mode == None)
+			continue;
+		for (j = 0; j < res->nmode && res->modes[j].id != crtcs[i]->mode; j++);
+		if (j == res->nmode)
+			continue;
+		mode = &res->modes[j];
+		vtotal = mode->vTotal;
+		if (mode->modeFlags & RR_DoubleScan)
+			vtotal *= 2;
+		if (mode->modeFlags & RR_Interlace)
+			vtotal /= 2;
+		if (mode->hTotal && vtotal)
+			rates[i] = mode->dotClock / (mode->hTotal * vtotal);
+	}
+	for (m = mons; m; m = m->next)
+		for (best = 0, i = 0; i < res->ncrtc; i++) {
+			if (!rates[i])
+				continue;
+			area = MAX(0, MIN(crtcs[i]->x + (int) crtcs[i]->width, m->mx + m->mw) - MAX(crtcs[i]->x, m->mx))
+				* MAX(0, MIN(crtcs[i]->y + (int) crtcs[i]->height, m->my + m->mh) - MAX(crtcs[i]->y, m->my));
+			if (area > best) {
+				best = area;
+				m->refreshrate = rates[i];
+			}
+		}
+	for (i = 0; i < res->ncrtc; i++)
+		if (crtcs[i])
+			XRRFreeCrtcInfo(crtcs[i]);
+	free(crtcs);
+	free(rates);
+	XRRFreeScreenResources(res);
+	#endif /* XRANDR */
+}
+
 void
 updatesizehints(Client *c)
 {
 	long msize;
 	XSizeHints size;
+	xcb_get_property_reply_t *p;
 
-	if (!XGetWMNormalHints(dpy, c->win, &size, &msize))
+	if ((p = scanprop(c->win, XA_WM_NORMAL_HINTS)) ? !scansizehints(p, &size) : !XGetWMNormalHints(dpy, c->win, &size, &msize))
 		/* size is uninitialized, ensure that size.flags aren't used */
 		size.flags = PSize;
 	if (size.flags & PBaseSize) {
@@ -24412,6 +26658,7 @@ updatewindowtype(Client *c)
 		c->isfloating = 1;
 		#if PATCH_FLAG_PANEL
 		c->ispanel = 1;
+		retally(c);
 		#endif // PATCH_FLAG_PANEL
 	}
 }
@@ -24420,13 +26667,16 @@ void
 updatewmhints(Client *c)
 {
 	XWMHints *wmh;
+	xcb_get_property_reply_t *p;
 
-	if ((wmh = XGetWMHints(dpy, c->win))) {
+	if ((wmh = (p = scanprop(c->win, XA_WM_HINTS)) ? scanwmhints(p) : XGetWMHints(dpy, c->win))) {
 		if (c == selmon->sel && wmh->flags & XUrgencyHint) {
 			wmh->flags &= ~XUrgencyHint;
 			XSetWMHints(dpy, c->win, wmh);
-		} else
+		} else {
 			c->isurgent = (wmh->flags & XUrgencyHint) ? (urgency ? 1 : 0) : 0;
+			retally(c);
+		}
 		#if PATCH_FLAG_NEVER_FOCUS
 		if (c->neverfocus_override == -1) {
 		#endif // PATCH_FLAG_NEVER_FOCUS
@@ -24948,125 +27198,70 @@ viewactiveex(Monitor *m, int direction)
 
 }
 
-void
-waitforclearkeyboard(void)
-{
-	int clear = 0;
-	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
-	char keys_return[32];
-	while (!clear) {
-		clear = 1;
-		XQueryKeymap(dpy, keys_return);
-		for (int i = 0; i < 32; i++) {
-			if (keys_return[i] != 0) {
-				clear = 0;
-				break;
-			}
-		}
-		if (!clear)
-			nanosleep(&ts, NULL);
-	}
-}
-
 #if PATCH_MOUSE_POINTER_WARPING
 #if PATCH_MOUSE_POINTER_WARPING_SMOOTH
-typedef struct w2c_data w2c_data;
-struct w2c_data {
-	Display *dpy;
-	Window root;
-	// client window;
-	Window win;
-	// target area rectangle;
-	int x;
-	int y;
-	int width;
-	int height;
-	// target pointer location;
-	int targetx;
-	int targety;
-	//Cursor cursor;
-	int force;
-	int grab;
-	Cursor cursor;	// if grab is non-zero;
-};
-void *
-warppointer(void *arg)
-{
-	w2c_data *data = arg;
-	Display *dpy = data->dpy;
-	Window root = data->root;
-	Window win = data->win;
-	// target area coords;
-	int tx = data->x;
-	int ty = data->y;
-	int tw = data->width;
-	int th = data->height;
-	// target pointer coords;
-	int tpx = data->targetx;
-	int tpy = data->targety;
-	int force = data->force;
-	int grab = data->grab;
-	Cursor cursor = data->cursor;
-	free(data);
-
-	int px, py;			// starting pointer coords;
+#define PI 3.14159265358979323846
 
-	// if the pointer is ungrabbable, we should not warp;
-	if (grab)
-		if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
-			None, cursor, CurrentTime) != GrabSuccess) return NULL;
-
-	#define PI 3.14159265358979323846
-
-	int warpx, warpy, curx, cury, lastx = 0, lasty = 0;
+// ends the smooth warp, placing the pointer at its target if it arrived;
+void
+warpend(int arrived)
+{
+	timerstop(&warptimer);
+	if (warp.grabbed)
+		XUngrabPointer(dpy, CurrentTime);
+	warp.grabbed = 0;
+	warptoclient_stop_flag = 0;
+	if (!arrived)
+		return;
+	if (warp.win != None)
+		XWarpPointer(dpy, None, warp.win, 0, 0, 0, 0, warp.tpx - warp.x, warp.tpy - warp.y);
+	else
+		XWarpPointer(dpy, None, root, 0, 0, 0, 0, warp.tpx, warp.tpy);
+	XFlush(dpy);
+}
 
-	getrootptr(&px, &py);
+// moves the pointer by the steps that are due, easing in and out over
+// MOUSE_WARP_MILLISECONDS, then waits on the timer for the next;
+void
+warpstep(Timer *t)
+{
+	double elapsed = elapsedms(&warp.started);
+	int step = warp.step, x, y, curx, cury;
 
-	int steps = MAX(abs(px-tpx),abs(py-tpy));
-	// adjust delay time to account for approx cpu processing delay;
-	unsigned long t = ((unsigned long)MOUSE_WARP_MILLISECONDS - 500L);
-	t = ((t>0 ? t : 1) * 1000000L);
+	if (warptoclient_stop_flag) {
+		warpend(0);
+		return;
+	}
+	// stop moving prematurely if the mouse was moved and the pointer is over the target area;
+	if (warp.force != 1 && warp.step && getrootptr(&curx, &cury) && (curx != warp.lastx || cury != warp.lasty)
+		#if PATCH_FOCUS_FOLLOWS_MOUSE
+		&& (curx >= warp.x && curx <= warp.x + warp.w && cury >= warp.y && cury <= warp.y + warp.h)
+		#endif // PATCH_FOCUS_FOLLOWS_MOUSE
+		) {
+		warpend(0);
+		return;
+	}
 
-	struct timespec ts = { .tv_sec = 0, .tv_nsec = 0 };
-	for (int i = steps; i > 0; i--) {
-		if (warptoclient_stop_flag)
-			break;
-		warpx = (px + 2*(steps-i+1) * (tpx - px) / (2 * steps));
-		warpy = (py + 2*(steps-i+1) * (tpy - py) / (2 * steps));
-		if (abs(warpx-lastx) || abs(warpy-lasty))
-		{
-			// only warp when the position is different from last iteration;
-			XWarpPointer(dpy, None, root, 0, 0, 0, 0, warpx, warpy);
-			XSync(dpy, False);
-			lastx = warpx;
-			lasty = warpy;
+	while (warp.step < warp.steps && warp.due <= elapsed) {
+		warp.step++;
+		warp.due += (double)MOUSE_WARP_MILLISECONDS / warp.steps * (cos(1.8 * PI * warp.step / warp.steps) + 1) / 2;
+	}
+	if (warp.step != step) {
+		x = warp.px + warp.step * (warp.tpx - warp.px) / warp.steps;
+		y = warp.py + warp.step * (warp.tpy - warp.py) / warp.steps;
+		// only warp when the position is different from the last step;
+		if (x != warp.lastx || y != warp.lasty) {
+			XWarpPointer(dpy, None, root, 0, 0, 0, 0, x, y);
+			XFlush(dpy);
+			warp.lastx = x;
+			warp.lasty = y;
 		}
-		ts.tv_nsec = (unsigned long)((t / steps)*((cos(1.8*PI*(steps-i+1)/steps)+1)/2));
-		nanosleep(&ts, NULL);
-
-		if (force == 1)
-			continue;
-		// stop moving prematurely if the mouse was moved and the pointer is over the target area
-		if (getrootptr(&curx, &cury) && (curx != warpx || cury != warpy)
-			#if PATCH_FOCUS_FOLLOWS_MOUSE
-			&& (curx >= tx && curx <= tx + tw && cury >= ty && cury <= ty + th)
-			#endif // PATCH_FOCUS_FOLLOWS_MOUSE
-			)
-			warptoclient_stop_flag = 1;
 	}
-	if (grab)
-		XUngrabPointer(dpy, CurrentTime);
 
-	if (warptoclient_stop_flag) {
-		warptoclient_stop_flag = 0;
-		return NULL;
-	}
-	if (win != None)
-		XWarpPointer(dpy, None, win, 0, 0, 0, 0, tpx - tx, tpy - ty);
+	if (warp.step == warp.steps && warp.due <= elapsed)
+		warpend(1);
 	else
-		XWarpPointer(dpy, None, root, 0, 0, 0, 0, tpx, tpy);
-
-	return NULL;
+		timerstart(t, (unsigned int) ceil(warp.due - elapsed), warpstep);
 }
 
 void
@@ -25225,23 +27420,32 @@ warptoclient(Client *c, int force)
 	#endif // PATCH_FLAG_GAME
 	if (smoothly)
 	{
+		// a new warp replaces one in progress;
+		if (warptimer.pprev)
+			warpend(0);
 		warptoclient_stop_flag = 0;
 
-		pthread_t th;
-		w2c_data *th_data = ecalloc(1, sizeof(w2c_data));
-		th_data->dpy = dpy;
-		th_data->root = root;
-		th_data->win = c ? c->win : None;
-		th_data->x = tx;
-		th_data->y = ty;
-		th_data->width = tw;
-		th_data->height = th;
-		th_data->targetx = tpx;
-		th_data->targety = tpy;
-		th_data->force = force;
-		if ((th_data->grab = (smoothly && force == 1) ? 0 : 1))
-			th_data->cursor = cursor[CurNormal]->cursor;
-		pthread_create(&th, NULL, warppointer, th_data);
+		warp.win = c ? c->win : None;
+		warp.x = tx;
+		warp.y = ty;
+		warp.w = tw;
+		warp.h = th;
+		warp.tpx = tpx;
+		warp.tpy = tpy;
+		warp.px = warp.lastx = px;
+		warp.py = warp.lasty = py;
+		warp.steps = MAX(abs(px - tpx), abs(py - tpy));
+		warp.step = 0;
+		warp.due = 0;
+		warp.force = force;
+		clock_gettime(CLOCK_MONOTONIC, &warp.started);
+		// if the pointer is ungrabbable, we should not warp;
+		warp.grabbed = (force != 1);
+		if (!warp.grabbed || XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
+			None, cursor[CurNormal]->cursor, CurrentTime) == GrabSuccess)
+			warpstep(&warptimer);
+		else
+			warp.grabbed = 0;
 		if (selmon->sel != c)
 			focus(c, 0);
 		return;
@@ -25261,35 +27465,15 @@ warptoclient(Client *c, int force)
 #endif // PATCH_MOUSE_POINTER_WARPING
 
 #if PATCH_EXTERNAL_WINDOW_ACTIVATION
-int switcher_status = 0;
-typedef struct war_data war_data;
-struct war_data {
-	pid_t pid;
-};
-void *
-wait_and_reset(void *arg)
-{
-	pid_t wpid;
-	war_data *data = arg;
-	pid_t pid = data->pid;
-	free(data);
-
-	while ((wpid = waitpid(pid, &switcher_status, 0)) > 0);
-	enable_switching = 0;
-	return NULL;
-}
 void
 window_switcher(const Arg *arg)
 {
 	#if PATCH_FOCUS_FOLLOWS_MOUSE
 	checkmouseovermonitor(selmon);
 	#endif // PATCH_FOCUS_FOLLOWS_MOUSE
-	pthread_t th;
-	pid_t pid = spawnex(arg->v, False);
+	if ((switcher_pid = spawnex(arg->v, False)) <= 0)
+		return;
 	enable_switching = 1;
-	war_data *th_data = ecalloc(1, sizeof(war_data));
-	th_data->pid = pid;
-	pthread_create(&th, NULL, wait_and_reset, th_data);
 }
 #endif // PATCH_EXTERNAL_WINDOW_ACTIVATION
 
@@ -25298,6 +27482,10 @@ winpid(Window w)
 {
 
 	pid_t result = 0;
+	ScanWin *sw;
+
+	if ((sw = scanwin(w)) && sw->pid)
+		return sw->pid;
 
 #ifdef __linux__
 	xcb_res_client_id_spec_t spec = {0};
@@ -25308,24 +27496,13 @@ winpid(Window w)
 	xcb_res_query_client_ids_cookie_t c = xcb_res_query_client_ids(xcon, 1, &spec);
 	xcb_res_query_client_ids_reply_t *r = xcb_res_query_client_ids_reply(xcon, c, &e);
 
+	free(e);
 	if (!r)
 		return (pid_t)0;
 
-	xcb_res_client_id_value_iterator_t i = xcb_res_query_client_ids_ids_iterator(r);
-	for (; i.rem; xcb_res_client_id_value_next(&i)) {
-		spec = i.data->spec;
-		if (spec.mask & XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID) {
-			uint32_t *t = xcb_res_client_id_value_value(i.data);
-			result = *t;
-			break;
-		}
-	}
-
+	result = winpidreply(r);
 	free(r);
 
-	if (result == (pid_t)-1)
-		result = 0;
-
 #endif /* __linux__ */
 
 #ifdef __OpenBSD__
@@ -25335,7 +27512,7 @@ winpid(Window w)
         unsigned char *prop;
         pid_t ret;
 
-        if (XGetWindowProperty(dpy, w, XInternAtom(dpy, "_NET_WM_PID", 0), 0, 1, False, AnyPropertyType, &type, &format, &len, &bytes, &prop) != Success || !prop)
+        if (XGetWindowProperty(dpy, w, xatom[NetWMPid], 0, 1, False, AnyPropertyType, &type, &format, &len, &bytes, &prop) != Success || !prop)
                return 0;
 
         ret = *(pid_t*)prop;
@@ -25346,6 +27523,24 @@ winpid(Window w)
 	return result;
 }
 
+#ifdef __linux__
+// the local client pid from a resource client ids reply, or 0;
+pid_t
+winpidreply(xcb_res_query_client_ids_reply_t *r)
+{
+	pid_t result = 0;
+	xcb_res_client_id_value_iterator_t i = xcb_res_query_client_ids_ids_iterator(r);
+
+	for (; i.rem; xcb_res_client_id_value_next(&i))
+		if (i.data->spec.mask & XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID) {
+			result = *xcb_res_client_id_value_value(i.data);
+			break;
+		}
+
+	return (result == (pid_t)-1 ? 0 : result);
+}
+#endif /* __linux__ */
+
 int
 isdescprocess(pid_t p, pid_t c)
 {
@@ -25564,6 +27759,7 @@ xerror(Display *dpy, XErrorEvent *ee)
 			if ((c = wintoclient(ee->resourceid))) {
 				c->dormant = -1;
 				c->isfloating = c->isfloating_override = 1;
+				retally(c);
 			}
 		}
 		return 0;
@@ -25596,10 +27792,7 @@ xerrorstart(Display *dpy, XErrorEvent *ee)
 #if PATCH_ALPHA_CHANNEL
 int
 has_compositor(Display *dpy, int screen) {
-    char prop_name[20];
-    snprintf(prop_name, 20, "_NET_WM_CM_S%d", screen);
-    Atom prop_atom = XInternAtom(dpy, prop_name, False);
-    return XGetSelectionOwner(dpy, prop_atom) != None;
+    return XGetSelectionOwner(dpy, xatom[NetWMCMSelection]) != None;
 }
 
 void
@@ -25762,6 +27955,42 @@ readfile(const char *filename, const char *filetype)
 	return (success ? source : NULL);
 }
 
+// each allocation is prefixed with whether it came from an arena, so that
+// jsonfree() needn't search the arenas; the prefix keeps the alignment;
+void *
+jsonalloc(size_t size)
+{
+	char *p = jsonarena ? arena_alloc(jsonarena, JSON_PREFIX + size) : malloc(JSON_PREFIX + size);
+
+	if (!p)
+		return NULL;
+	*p = !!jsonarena;
+	return p + JSON_PREFIX;
+}
+
+// memory from an arena is only released with the whole arena;
+void
+jsonfree(void *p)
+{
+	if (!p || jsoninarena(p))
+		return;
+	free((char *)p - JSON_PREFIX);
+}
+
+int
+jsoninarena(const void *p)
+{
+	return *((const char *)p - JSON_PREFIX);
+}
+
+Arena *
+setjsonarena(Arena *a)
+{
+	Arena *prev = jsonarena;
+	jsonarena = a;
+	return prev;
+}
+
 cJSON *
 parsejsonfile(const char *filename, const char *filetype)
 {
@@ -25797,6 +28026,10 @@ main(int argc, char *argv[], char *envp[])
 		wrap_length = window_size.ws_col;
 	}
 	#endif // PATCH_IPC
+	struct timespec started, mark;
+	int reloads = 0;
+	cJSON_Hooks jsonhooks = { jsonalloc, jsonfree };
+	cJSON_InitHooks(&jsonhooks);
 
 	coloursbackup = malloc(sizeof(colours));
 	memcpy(coloursbackup, colours, sizeof(colours));
@@ -25804,8 +28037,14 @@ main(int argc, char *argv[], char *envp[])
 	tagiconpathsbackup = malloc(sizeof(tagiconpaths));
 	memcpy(tagiconpathsbackup, tagiconpaths, sizeof(tagiconpaths));
 	#endif // PATCH_CUSTOM_TAG_ICONS
+	for (int i = 0; layoutstrings[i]; i++)
+		layoutstringsbackup[i] = *layoutstrings[i];
+	memcpy(tagsbackup, tags, sizeof(tags));
 
 reload:
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	profiling = NULL;
+	profilebegin(reloads ? "reload" : "startup");
 	for (int i = 0; i < LENGTH(colourflags); i++) {
 		if (colourflags[i]) {
 			if (colourflags[i] & 1)
@@ -25839,6 +28078,20 @@ reload:
 					return(usage("error: No layout file specified after -l switch."));
 			}
 
+			#if PATCH_EVENT_RECORDING
+			else if (!strcmp("-e", argv[i])) {
+				if (++i >= argc)
+					return(usage("error: No events file specified after -e switch."));
+				record_filename = argv[i];
+			}
+
+			else if (!strcmp("-E", argv[i])) {
+				if (++i >= argc)
+					return(usage("error: No events file specified after -E switch."));
+				replay_filename = argv[i];
+			}
+			#endif // PATCH_EVENT_RECORDING
+
 			#if PATCH_SYSTRAY
 			else if (!strcmp("-n", argv[i]))
 				showsystray = 0;
@@ -25880,14 +28133,28 @@ reload:
 					print_wrap(f, wrap_length, indent, 27 , "find_dwm_client [name]", indent, NULL,
 						"Find a DWM client Window whose name or class/instance match the specified name"
 					);
+					print_wrap(f, wrap_length, indent, 27 , "get_clients [<filter> <value>]...", indent, NULL,
+						"Return the properties of all clients, or those matching the filters: monitor, tags, class, offset and limit"
+					);
 					print_wrap(f, wrap_length, indent, 27 , "get_dwm_client [Window ID]", indent, NULL,
 						"Return DWM client properties for the specified window (defaults to the active window)"
 					);
+					print_wrap(f, wrap_length, indent, 27 , "get_latency", indent, NULL,
+						"Return latency histograms for each X event and IPC message type handled"
+					);
 					print_wrap(f, wrap_length, indent, 27 , "get_layouts", indent, NULL, "Return a list of layouts");
 					print_wrap(f, wrap_length, indent, 27 , "get_monitors", indent, NULL, "Return monitor properties");
+					print_wrap(f, wrap_length, indent, 27 , "get_profile", indent, NULL,
+						"Return the time spent in each phase of the startup and the latest reload"
+					);
+					print_wrap(f, wrap_length, indent, 27 , "get_state_shm", indent, NULL,
+						"Return the name of the shared memory state snapshot, creating it"
+					);
 					print_wrap(f, wrap_length, indent, 27 , "get_tags", indent, NULL, "Return a list of all tags");
 					print_wrap(f, wrap_length, indent, 27 , "run_command", indent, NULL, "Runs an IPC command");
-					print_wrap(f, wrap_length, indent, 27 , "subscribe <event> ...", indent, NULL, "Subscribe to the specified events");
+					print_wrap(f, wrap_length, indent, 27 , "subscribe <event> ...", indent, NULL,
+						"Subscribe to the specified events; put \"every\" before the events to receive every transition, rather than only the latest state"
+					);
 
 					print_wrap(f, wrap_length, NULL, -1, "\nIPC events:", NULL, NULL, NULL);
 					print_wrap(f, wrap_length, indent, -1, IPC_EVENT_STRING_CLIENT_FOCUS_CHANGE, NULL, NULL, NULL);
@@ -25928,16 +28195,45 @@ reload:
 					return EXIT_SUCCESS;
 				}
 
+				else if (!strcmp("get_profile", argv[i])) {
+					get_profile();
+					return EXIT_SUCCESS;
+				}
+
+				else if (!strcmp("get_state_shm", argv[i])) {
+					get_state_shm();
+					return EXIT_SUCCESS;
+				}
+
 				else if (!strcmp("get_tags", argv[i])) {
 					get_tags();
 					return EXIT_SUCCESS;
 				}
 
+				else if (!strcmp("get_latency", argv[i])) {
+					get_latency();
+					return EXIT_SUCCESS;
+				}
+
 				else if (!strcmp("get_layouts", argv[i])) {
 					get_layouts();
 					return EXIT_SUCCESS;
 				}
 
+				else if (!strcmp("get_clients", argv[i])) {
+					for (int j = i + 1; j < argc; j += 2) {
+						if (strcmp(argv[j], "class") && strcmp(argv[j], "monitor") && strcmp(argv[j], "tags")
+						&& strcmp(argv[j], "offset") && strcmp(argv[j], "limit"))
+							return(usage("error: Unknown filter specified after -s get_clients."));
+						if (j + 1 >= argc)
+							return(usage("error: Filter specified (after -s get_clients) without a value."));
+						if (strcmp(argv[j], "class") && !is_unsigned_int(argv[j + 1]))
+							return(usage("error: Filter value specified (after -s get_clients) must be an unsigned integer."));
+					}
+					get_clients(argc - i - 1, argv + i + 1);
+					return EXIT_SUCCESS;
+				}
+
 				else if (!strcmp("get_dwm_client", argv[i])) {
 					if (++i >= argc) {
 						//return(usage("error: No window ID specified after -s get_dwm_client."));
@@ -25979,9 +28275,12 @@ reload:
 				}
 
 				else if (!strcmp("subscribe", argv[i])) {
+					const char *delivery = NULL;
+					if (i + 1 < argc && (!strcmp("every", argv[i + 1]) || !strcmp("latest", argv[i + 1])))
+						delivery = argv[++i];
 					if (++i >= argc)
 						return(usage("error: No IPC events specified after -s subscribe."));
-					for (int j = i; j < argc; j++) subscribe(argv[j]);
+					for (int j = i; j < argc; j++) subscribe(argv[j], delivery);
 					while (1) {
 						print_socket_reply();
 					}
@@ -26017,15 +28316,22 @@ reload:
 	fputs("\n", stderr);
 	#endif // PATCH_LOG_DIAGNOSTICS
 
+	clock_gettime(CLOCK_MONOTONIC, &mark);
 	if (l) {
-		layout_json = parsejsonfile(argv[l], "layout");
+		layout_filename = argv[l];
+		setjsonarena(&layoutarena);
+		layout_json = parsejsonfile(layout_filename, "layout");
+		cJSON_EnableIndex(layout_json);
+		setjsonarena(NULL);
 		if (layout_json)
 			parselayoutjson(layout_json);
 	}
+	profilemark(ProfileLayout, &mark);
 	if (r) {
 		rules_filename = argv[r];
 		reload_rules();
 	}
+	profilemark(ProfileRules, &mark);
 
 	if (!setlocale(LC_CTYPE, "") || !XSupportsLocale()) {
 		logdatetime(stderr);
@@ -26037,6 +28343,7 @@ reload:
 		die("dwm: cannot get xcb connection");
 
 	checkotherwm();
+	profilemark(ProfileDisplay, &mark);
 #ifdef __OpenBSD__
 	if (pledge("stdio rpath proc exec ps", NULL) == -1)
 		die("pledge");
@@ -26066,6 +28373,14 @@ reload:
 	#endif // PATCH_KEY_HOLD
 
 	scan();
+	clock_gettime(CLOCK_MONOTONIC, &mark);
+	drawbars();
+	profilemark(ProfileBars, &mark);
+	profileend();
+	#if PATCH_EVENT_RECORDING
+	if (record_filename && (recordfile || recordstart(record_filename)))
+		recordstate();
+	#endif // PATCH_EVENT_RECORDING
 	//#if PATCH_FOCUS_FOLLOWS_MOUSE || PATCH_MOUSE_POINTER_HIDING
 	#if PATCH_MOUSE_POINTER_HIDING
 	snoop_root();
@@ -26082,7 +28397,7 @@ reload:
 	#endif // PATCH_MOUSE_POINTER_HIDING
 	#if PATCH_LOG_DIAGNOSTICS
 	logdatetime(stderr);
-	fputs(DWM_VERSION_STRING_LONG" ready.", stderr);
+	fprintf(stderr, DWM_VERSION_STRING_LONG" ready in %.3f ms.", elapsedms(&started));
 	#if DEBUGGING
 	fputs(" (DEBUGGING is on)", stderr);
 	#endif // DEBUGGING
@@ -26091,11 +28406,26 @@ reload:
 	#endif // PATCH_IPC
 	fputs("\n", stderr);
 	#endif // PATCH_LOG_DIAGNOSTICS
+	#if PATCH_EVENT_RECORDING
+	if (replay_filename) {
+		if (!replay(replay_filename))
+			rc = EXIT_FAILURE;
+		running = 0;
+	}
+	else
+	#endif // PATCH_EVENT_RECORDING
 	run();
 
 finish:
+	#if PATCH_HOT_RELOAD
+	cleanuphotreload();
+	#endif // PATCH_HOT_RELOAD
+	cleanuptimers();
 	#if PATCH_IPC
 	ipc_cleanup();
+	// readers keep their snapshot mapping across a reload;
+	if (running != -1)
+		ipc_shm_cleanup();
 	if (ipcsockpath) {
 		free(ipcsockpath);
 		ipcsockpath = NULL;
@@ -26108,12 +28438,21 @@ finish:
 	monitors_json = NULL;
 	if (layout_json)
 		cJSON_Delete(layout_json);
+	layout_json = NULL;
 	if (rules_json)
 		cJSON_Delete(rules_json);
+	rules_json = NULL;
 	if (rules_compost)
 		cJSON_Delete(rules_compost);
+	rules_compost = NULL;
+	arena_free(&layoutarena);
+	arena_free(&layoutstaging);
+	arena_free(&rulesarena);
+	arena_free(&rulesstaging);
 
-	killable = 1;
+	// from here a SIGTERM kills dwm, in case closing the display hangs;
+	// a reload keeps the other signals blocked until setup() reads them;
+	cleanupsignals();
 
 fprintf(stderr, "debug: pre XCloseDisplay()\n");
 	//XGrabServer(dpy);
@@ -26130,16 +28469,17 @@ fputs("dwm: finished.\n", stderr);
 
 	// reload;
 	if (running == -1) {
-		#if PATCH_CUSTOM_TAG_ICONS
-		memcpy(tagiconpaths, tagiconpathsbackup, sizeof(tagiconpaths));
-		#endif // PATCH_CUSTOM_TAG_ICONS
-		memcpy(colours, coloursbackup, sizeof(colours));
+		resetlayout();
 		running = 1;
+		reloads++;
 		logdatetime(stderr);
 		fputs("dwm: reloading...\n", stderr);
 		goto reload;
 	}
 
+	#if PATCH_EVENT_RECORDING
+	recordstop();
+	#endif // PATCH_EVENT_RECORDING
 	free(coloursbackup);
 
 	return rc;
@@ -26165,6 +28505,9 @@ usage(const char * err_text)
 		#if PATCH_IPC
 		"\n[-p <socket-path>] [-s <verb> [command [args]]]"
 		#endif // PATCH_IPC
+		#if PATCH_EVENT_RECORDING
+		"\n[-e <events-file>] [-E <events-file>]"
+		#endif // PATCH_EVENT_RECORDING
 		"\n"
 	);
 
@@ -26182,6 +28525,12 @@ usage(const char * err_text)
 	print_wrap(f, wrap_length, indent, 2, "-p", indent, NULL, "path to unix socket");
 	print_wrap(f, wrap_length, indent, 2, "-s", indent, NULL, "send request to running instance via socket");
 	#endif // PATCH_IPC
+	#if PATCH_EVENT_RECORDING
+	print_wrap(f, wrap_length, indent, 2, "-e", indent, NULL, "record the X events and IPC messages handled to the specified file");
+	print_wrap(f, wrap_length, indent, 2, "-E", indent, NULL,
+		"replay the events recorded in the specified file against the display (Xvfb or Xephyr), report their timing and exit"
+	);
+	#endif // PATCH_EVENT_RECORDING
 	fputs("\n", f);
 
 	return (err_text ? EXIT_FAILURE : EXIT_SUCCESS);
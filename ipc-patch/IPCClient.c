@@ -16,8 +16,20 @@ ipc_client_new(int fd)
 	// Initialize struct
 	memset(&c->event, 0, sizeof(struct epoll_event));
 
+	c->delivery = IPC_DELIVERY_LATEST;
+	c->encoding = IPC_ENCODING_JSON;
 	c->buffer_size = 0;
+	c->buffer_cap = 0;
+	c->buffer_head = 0;
+	c->buffer_sent = 0;
+	c->buffer_events = 0;
+	c->dropped = 0;
 	c->buffer = NULL;
+	c->read_state = IPC_READ_HEADER;
+	c->read_type = 0;
+	c->read_buffer = NULL;
+	c->read_len = 0;
+	c->read_size = 0;
 	c->fd = fd;
 	c->event.data.fd = fd;
 	c->next = NULL;
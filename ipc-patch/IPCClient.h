@@ -5,6 +5,25 @@
 #include <stdlib.h>
 #include <sys/epoll.h>
 
+// size of the packed dwm_ipc_header_t: magic string, payload size, message type
+#define IPC_HEADER_SIZE 12
+
+/**
+ * Which part of an incoming message an IPCClient is waiting for
+ */
+typedef enum IPCReadState {
+	IPC_READ_HEADER = 0,
+	IPC_READ_PAYLOAD = 1
+} IPCReadState;
+
+/**
+ * Payload encoding of the replies and events sent to an IPCClient
+ */
+typedef enum IPCEncoding {
+	IPC_ENCODING_JSON = 0,   // Null terminated JSON text
+	IPC_ENCODING_BINARY = 1  // The same document as IPCBinaryTag values
+} IPCEncoding;
+
 typedef struct IPCClient IPCClient;
 /**
  * This structure contains the details of an IPC Client and pointers for a
@@ -13,9 +32,25 @@ typedef struct IPCClient IPCClient;
 struct IPCClient {
 	int fd;
 	int subscriptions;
+	IPCDelivery delivery;  // Whether the client receives every transition or only the latest state
+	IPCEncoding encoding;  // How replies and events are encoded for the client
 
+	// Outgoing messages, queued in a ring buffer
 	char *buffer;
-	uint32_t buffer_size;
+	uint32_t buffer_size;  // Bytes queued, including those of the first message already written
+	uint32_t buffer_cap;   // Allocated size of the ring
+	uint32_t buffer_head;  // Ring offset of the first queued message
+	uint32_t buffer_sent;  // Bytes of the first queued message already written
+	uint32_t buffer_events;  // Bytes of the queued events, which the queue limit applies to
+	uint32_t dropped;      // Events dropped while the client was not reading
+
+	// Incoming message, reassembled across reads until it is complete
+	IPCReadState read_state;
+	uint8_t read_header[IPC_HEADER_SIZE];
+	uint8_t read_type;
+	uint8_t *read_buffer;
+	uint32_t read_len;   // Bytes received of the current part
+	uint32_t read_size;  // Payload size from the header
 
 	struct epoll_event event;
 	IPCClient *next;
@@ -7,7 +7,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include "../util.h"
@@ -17,11 +20,45 @@ static struct epoll_event sock_epoll_event;
 static IPCClientList ipc_clients = NULL;
 static int epoll_fd = -1;
 static int sock_fd = -1;
-static IPCCommand *ipc_commands;
+static IPCCommand *ipc_commands;			// sorted by name;
 static unsigned int ipc_commands_len;
+static Arg *ipc_args;						// run_command argument buffers;
+static ArgType *ipc_arg_types;
+static unsigned int ipc_args_max;
+static char *ipc_bin_buffer;				// scratch buffer for encoded replies;
+static uint32_t ipc_bin_len;
+static uint32_t ipc_bin_cap;
+static IPCShm *ipc_shm;						// state snapshot, once a reader asked for it;
+static IPCShmSnapshot ipc_shm_staging;
+static char ipc_shm_name[32];
+static uint32_t ipc_queue_max;
+static IPCSlowPolicy ipc_slow_policy;
+static const Profile *ipc_profiles;			// startup and reload timings;
+static int ipc_profiles_len;
+static const char *ipc_type_names[] = {
+	[IPC_TYPE_RUN_COMMAND] = "run_command",
+	[IPC_TYPE_GET_MONITORS] = "get_monitors",
+	[IPC_TYPE_GET_TAGS] = "get_tags",
+	[IPC_TYPE_GET_LAYOUTS] = "get_layouts",
+	[IPC_TYPE_FIND_DWM_CLIENT] = "find_dwm_client",
+	[IPC_TYPE_GET_DWM_CLIENT] = "get_dwm_client",
+	[IPC_TYPE_SUBSCRIBE] = "subscribe",
+	[IPC_TYPE_EVENT] = "event",
+	[IPC_TYPE_SET_ENCODING] = "set_encoding",
+	[IPC_TYPE_GET_STATE_SHM] = "get_state_shm",
+	[IPC_TYPE_GET_CLIENTS] = "get_clients",
+	[IPC_TYPE_GET_PROFILE] = "get_profile",
+	[IPC_TYPE_GET_LATENCY] = "get_latency",
+};
+static Latency ipc_latency[LENGTH(ipc_type_names)];	// per message type;
+static IPCClient *ipc_replay_client;		// sender of replayed messages, whose replies are discarded;
 // Max size is 1 MB
 static const uint32_t MAX_MESSAGE_SIZE = 1000000;
 static const int IPC_SOCKET_BACKLOG = 5;
+static const uint32_t IPC_QUEUE_INITIAL_SIZE = 4096;
+
+/* compile-time check that the client's header buffer fits the packed header */
+struct IPCHeaderSize { char mismatch[sizeof(dwm_ipc_header_t) == IPC_HEADER_SIZE ? 1 : -1]; };
 
 /**
  * Create IPC socket at specified path and return file descriptor to socket.
@@ -82,176 +119,545 @@ ipc_create_socket(const char *filename)
 }
 
 /**
- * Internal function used to receive IPC messages from a given file descriptor.
+ * Internal function used to receive IPC messages from a client. Whatever is
+ * available is read without blocking and kept in the client's read buffer, so
+ * a message that arrives in pieces is reassembled over several EPOLLIN events.
  *
- * Returns -1 on error reading (could be EAGAIN or EINTR)
+ * Returns 0 once a complete message has been received
+ * Returns -1 on error reading, or with errno set to EAGAIN while the message is
+ *   still incomplete
  * Returns -2 if EOF before header could be read
- * Returns -3 if invalid IPC header
+ * Returns -3 if invalid IPC header, or EOF part way through a message
  * Returns -4 if message length exceeds MAX_MESSAGE_SIZE
  */
 static int
-ipc_recv_message(int fd, uint8_t *msg_type, uint32_t *reply_size, uint8_t **reply)
+ipc_recv_message(IPCClient *c, uint8_t *msg_type, uint32_t *reply_size, uint8_t **reply)
 {
-	uint32_t read_bytes = 0;
-	const int32_t to_read = sizeof(dwm_ipc_header_t);
-	char header[to_read];
-	char *walk = header;
+	dwm_ipc_header_t header;
+	ssize_t n;
 
-	// Try to read header
-	while (read_bytes < to_read) {
-		const ssize_t n = read(fd, header + read_bytes, to_read - read_bytes);
+	for (;;) {
+		if (c->read_state == IPC_READ_HEADER)
+			n = read(c->fd, c->read_header + c->read_len, IPC_HEADER_SIZE - c->read_len);
+		else
+			n = read(c->fd, c->read_buffer + c->read_len, c->read_size - c->read_len);
 
 		if (n == 0) {
-		if (read_bytes == 0) {
-			fprintf(stderr, "Unexpectedly reached EOF while reading header.");
-			fprintf(
-				stderr,
-				"Read %" PRIu32 " bytes, expected %" PRIu32 " total bytes.\n",
-				read_bytes, to_read
-			);
-			return -2;
-		} else {
-			fprintf(stderr, "Unexpectedly reached EOF while reading header.");
-			fprintf(
-				stderr,
-				"Read %" PRIu32 " bytes, expected %" PRIu32 " total bytes.\n",
-				read_bytes, to_read
-			);
+			if (c->read_state == IPC_READ_HEADER) {
+				fprintf(stderr, "Unexpectedly reached EOF while reading header.");
+				fprintf(
+					stderr,
+					"Read %" PRIu32 " bytes, expected %" PRIu32 " total bytes.\n",
+					c->read_len, (uint32_t)IPC_HEADER_SIZE
+				);
+				return c->read_len == 0 ? -2 : -3;
+			}
+			fprintf(stderr, "Unexpectedly reached EOF while reading payload.");
+			fprintf(stderr, "Read %" PRIu32 " bytes, expected %" PRIu32 " bytes.\n", c->read_len, c->read_size);
 			return -3;
-		}
 		} else if (n == -1) {
-		// errno will still be set
-		return -1;
+			if (errno == EINTR)
+				continue;
+			// errno will still be set; on EAGAIN or EWOULDBLOCK the partial
+			// message stays in the client until the next EPOLLIN
+			return -1;
 		}
 
-		read_bytes += n;
-	}
+		c->read_len += n;
 
-	// Check if magic string in header matches
-	if (memcmp(walk, IPC_MAGIC, IPC_MAGIC_LEN) != 0) {
-		fprintf(
-			stderr, "Invalid magic string. Got '%.*s', expected '%s'\n",
-			IPC_MAGIC_LEN, walk, IPC_MAGIC
-		);
-		return -3;
-	}
+		if (c->read_state == IPC_READ_HEADER) {
+			if (c->read_len < IPC_HEADER_SIZE)
+				continue;
+
+			memcpy(&header, c->read_header, IPC_HEADER_SIZE);
 
-	walk += IPC_MAGIC_LEN;
+			// Check if magic string in header matches
+			if (memcmp(header.magic, IPC_MAGIC, IPC_MAGIC_LEN) != 0) {
+				fprintf(
+					stderr, "Invalid magic string. Got '%.*s', expected '%s'\n",
+					IPC_MAGIC_LEN, (char *)header.magic, IPC_MAGIC
+				);
+				return -3;
+			}
+
+			if (header.size > MAX_MESSAGE_SIZE) {
+				fprintf(stderr, "Message too long: %" PRIu32 " bytes. ", header.size);
+				fprintf(stderr, "Maximum message size is: %d\n", MAX_MESSAGE_SIZE);
+				return -4;
+			}
+
+			c->read_type = header.type;
+			c->read_size = header.size;
+			c->read_len = 0;
+
+			if (c->read_size == 0)
+				break;
 
-	// Extract reply size
-	memcpy(reply_size, walk, sizeof(uint32_t));
-	walk += sizeof(uint32_t);
+			c->read_buffer = malloc(c->read_size);
+			if (c->read_buffer == NULL)
+				return -1;
+			c->read_state = IPC_READ_PAYLOAD;
+			continue;
+		}
 
-	if (*reply_size > MAX_MESSAGE_SIZE) {
-		fprintf(stderr, "Message too long: %" PRIu32 " bytes. ", *reply_size);
-		fprintf(stderr, "Maximum message size is: %d\n", MAX_MESSAGE_SIZE);
-		return -4;
+		if (c->read_len == c->read_size)
+			break;
 	}
 
-	// Extract message type
-	memcpy(msg_type, walk, sizeof(uint8_t));
-	walk += sizeof(uint8_t);
+	// Hand the complete message over and get ready for the next header
+	*msg_type = c->read_type;
+	*reply_size = c->read_size;
+	if (c->read_size > 0)
+		*reply = c->read_buffer;
+	c->read_state = IPC_READ_HEADER;
+	c->read_buffer = NULL;
+	c->read_len = 0;
+	c->read_size = 0;
 
-	if (*reply_size > 0)
-		(*reply) = malloc(*reply_size);
-	else
-		return 0;
+	return 0;
+}
+
+/**
+ * Copy len bytes starting off bytes past the head of the client's output ring
+ * into dst, following the wrap-around
+ */
+static void
+ipc_ring_read(IPCClient *c, uint32_t off, void *dst, uint32_t len)
+{
+	const uint32_t start = (c->buffer_head + off) % c->buffer_cap;
+	const uint32_t first = MIN(len, c->buffer_cap - start);
 
-	read_bytes = 0;
-	while (read_bytes < *reply_size) {
-		const ssize_t n = read(fd, *reply + read_bytes, *reply_size - read_bytes);
+	memcpy(dst, c->buffer + start, first);
+	memcpy((char *)dst + first, c->buffer, len - first);
+}
 
-		if (n == 0) {
-		fprintf(stderr, "Unexpectedly reached EOF while reading payload.");
-		fprintf(stderr, "Read %" PRIu32 " bytes, expected %" PRIu32 " bytes.\n", read_bytes, *reply_size);
-		free(*reply);
-		return -2;
-		} else if (n == -1) {
-		// TODO: Should we return and wait for another epoll event?
-		// This would require saving the partial read in some way.
-		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+/**
+ * Append len bytes to the tail of the client's output ring, which must have
+ * room for them
+ */
+static void
+ipc_ring_write(IPCClient *c, const void *src, uint32_t len)
+{
+	const uint32_t start = (c->buffer_head + c->buffer_size) % c->buffer_cap;
+	const uint32_t first = MIN(len, c->buffer_cap - start);
+
+	memcpy(c->buffer + start, src, first);
+	memcpy(c->buffer, (const char *)src + first, len - first);
+	c->buffer_size += len;
+}
+
+/**
+ * Move the client's queued messages to the start of a new ring of cap bytes
+ *
+ * Returns 0 on success, or -1 if the new ring can't be allocated
+ */
+static int
+ipc_ring_rebuild(IPCClient *c, uint32_t cap)
+{
+	char *buffer = (char *)malloc(cap);
 
-		free(*reply);
+	if (buffer == NULL)
 		return -1;
-		}
 
-		read_bytes += n;
-	}
+	if (c->buffer_size)
+		ipc_ring_read(c, 0, buffer, c->buffer_size);
+	free(c->buffer);
+	c->buffer = buffer;
+	c->buffer_cap = cap;
+	c->buffer_head = 0;
 
 	return 0;
 }
 
 /**
- * Internal function used to write a buffer to a file descriptor
+ * Drop the oldest queued events, in place, until at least drop bytes are
+ * freed; replies and a partially written message are always kept. The head
+ * advances past each dropped event, and the messages kept ahead of it, which
+ * are usually just the one being written, are moved up behind it.
  *
- * Returns number of bytes written if successful write
- * Returns 0 if no bytes were written due to EAGAIN or EWOULDBLOCK
- * Returns -1 on unknown error trying to write, errno will carry over from
- *   write() call
+ * Returns the number of bytes freed
  */
-static ssize_t
-ipc_write_message(int fd, const void *buf, size_t count)
+static uint32_t
+ipc_ring_drop(IPCClient *c, uint32_t drop)
 {
-	size_t written = 0;
+	dwm_ipc_header_t header;
+	uint32_t keep = 0, packet_size, freed = 0;
 
-	while (written < count) {
-		const ssize_t n = write(fd, (uint8_t *)buf + written, count - written);
+	while (freed < drop && keep < c->buffer_size) {
+		ipc_ring_read(c, keep, &header, sizeof(header));
+		packet_size = sizeof(header) + header.size;
 
-		if (n == -1) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
-			return written;
-		else if (errno == EINTR)
+		if (header.type != IPC_TYPE_EVENT || (!keep && c->buffer_sent)) {
+			keep += packet_size;
 			continue;
-		else
-			return n;
 		}
 
-		written += n;
-		DEBUG("Wrote %zu/%zu to client at fd %d\n", written, count, fd);
+		// Last byte first, as the kept messages may overlap where they move to
+		for (uint32_t i = keep; i--; )
+			c->buffer[(c->buffer_head + packet_size + i) % c->buffer_cap] = c->buffer[(c->buffer_head + i) % c->buffer_cap];
+		c->buffer_head = (c->buffer_head + packet_size) % c->buffer_cap;
+		c->buffer_size -= packet_size;
+		c->buffer_events -= packet_size;
+		c->dropped++;
+		freed += packet_size;
 	}
 
-	return written;
+	return freed;
 }
 
 /**
- * Prepares buffers of IPC subscribers of specified event
+ * Append len bytes to the binary encoding buffer, growing it as needed.
+ *
+ * Returns 0 on success
+ * Returns -1 if the buffer can't be grown
  */
+static int
+ipc_bin_put(const void *src, uint32_t len)
+{
+	uint32_t cap;
+	char *buffer;
+
+	if (ipc_bin_len + len > ipc_bin_cap) {
+		for (cap = ipc_bin_cap ? ipc_bin_cap : IPC_QUEUE_INITIAL_SIZE; cap < ipc_bin_len + len; cap *= 2);
+		if (!(buffer = (char *)realloc(ipc_bin_buffer, cap)))
+			return -1;
+		ipc_bin_buffer = buffer;
+		ipc_bin_cap = cap;
+	}
+	if (len)
+		memcpy(ipc_bin_buffer + ipc_bin_len, src, len);
+	ipc_bin_len += len;
+
+	return 0;
+}
+
+static int
+ipc_bin_put_tag(uint8_t tag)
+{
+	return ipc_bin_put(&tag, sizeof(tag));
+}
 
+static int
+ipc_bin_put_string(const char *s)
+{
+	const uint32_t len = s ? strlen(s) : 0;
+
+	return ipc_bin_put(&len, sizeof(len)) || ipc_bin_put(s, len) ? -1 : 0;
+}
+
+/**
+ * Start a message whose root is an object, or an array, in the binary
+ * encoding (replacing the contents of the binary encoding buffer) or as JSON.
+ */
 static void
-ipc_event_prepare_send_message(cJSON *gen, IPCEvent event)
+ipc_writer_begin(IPCWriter *w, int binary, int array)
 {
-	size_t len = 0;
+	const uint32_t n = 0;
+
+	memset(w, 0, sizeof(IPCWriter));
+	w->binary = binary;
+	w->isarray[0] = array;
+	if (binary) {
+		ipc_bin_len = 0;
+		w->err = ipc_bin_put_tag(array ? IPC_BIN_ARRAY : IPC_BIN_OBJECT) || ipc_bin_put(&n, sizeof(n));
+		w->count_off[0] = ipc_bin_len - sizeof(n);
+	}
+	else if (!(w->json[0] = array ? cJSON_CreateArray() : cJSON_CreateObject()))
+		w->err = 1;
+}
 
-	char *buffer = cJSON_PrintUnformatted(gen);
-	len = strlen(buffer) + 1;// For null char
+/**
+ * Count a value in the innermost open container, preceded by its key in an
+ * object, for the binary encoding
+ */
+static void
+ipc_writer_key(IPCWriter *w, const char *key)
+{
+	w->count[w->depth]++;
+	if (!w->isarray[w->depth] && ipc_bin_put_string(key))
+		w->err = 1;
+}
 
-	for (IPCClient *c = ipc_clients; c; c = c->next) {
-		if (c->subscriptions & event) {
-			DEBUG("Sending selected client change event to fd %d\n", c->fd);
-			ipc_prepare_send_message(c, IPC_TYPE_EVENT, len, (char *)buffer);
+/**
+ * Add a value to the innermost open container, for JSON
+ */
+static void
+ipc_writer_add(IPCWriter *w, const char *key, cJSON *item)
+{
+	if (!item)
+		w->err = 1;
+	else if (w->isarray[w->depth])
+		cJSON_AddItemToArray(w->json[w->depth], item);
+	else
+		cJSON_AddItemToObject(w->json[w->depth], key, item);
+}
+
+static void
+ipc_writer_int(IPCWriter *w, const char *key, int64_t i)
+{
+	if (!w->binary)
+		ipc_writer_add(w, key, cJSON_CreateInteger(i));
+	else {
+		ipc_writer_key(w, key);
+		if (ipc_bin_put_tag(IPC_BIN_INT) || ipc_bin_put(&i, sizeof(i)))
+			w->err = 1;
+	}
+}
+
+static void
+ipc_writer_double(IPCWriter *w, const char *key, double d)
+{
+	if (!w->binary)
+		ipc_writer_add(w, key, cJSON_CreateNumber(d));
+	else {
+		ipc_writer_key(w, key);
+		if (ipc_bin_put_tag(IPC_BIN_DOUBLE) || ipc_bin_put(&d, sizeof(d)))
+			w->err = 1;
+	}
+}
+
+static void
+ipc_writer_bool(IPCWriter *w, const char *key, int b)
+{
+	if (!w->binary)
+		ipc_writer_add(w, key, cJSON_CreateBool(b));
+	else {
+		ipc_writer_key(w, key);
+		if (ipc_bin_put_tag(b ? IPC_BIN_TRUE : IPC_BIN_FALSE))
+			w->err = 1;
+	}
+}
+
+static void
+ipc_writer_null(IPCWriter *w, const char *key)
+{
+	if (!w->binary)
+		ipc_writer_add(w, key, cJSON_CreateNull());
+	else {
+		ipc_writer_key(w, key);
+		if (ipc_bin_put_tag(IPC_BIN_NULL))
+			w->err = 1;
+	}
+}
+
+static void
+ipc_writer_string(IPCWriter *w, const char *key, const char *str)
+{
+	if (!w->binary)
+		ipc_writer_add(w, key, cJSON_CreateString(str));
+	else {
+		ipc_writer_key(w, key);
+		if (ipc_bin_put_tag(IPC_BIN_STRING) || ipc_bin_put_string(str))
+			w->err = 1;
+	}
+}
+
+/**
+ * Open an object, or an array, as the innermost container
+ */
+static void
+ipc_writer_open(IPCWriter *w, const char *key, int array)
+{
+	const uint32_t n = 0;
+	cJSON *item = NULL;
+
+	if (w->overflow || w->depth + 1 >= IPC_WRITER_DEPTH) {
+		// Only the one message is lost; its contents are no longer written
+		if (!w->overflow++) {
+			logdatetime(stderr);
+			fprintf(stderr, "dwm: IPC message nested deeper than %d\n", IPC_WRITER_DEPTH);
 		}
+		w->err = 1;
+		return;
+	}
+	if (!w->binary)
+		ipc_writer_add(w, key, item = array ? cJSON_CreateArray() : cJSON_CreateObject());
+	else {
+		ipc_writer_key(w, key);
+		if (ipc_bin_put_tag(array ? IPC_BIN_ARRAY : IPC_BIN_OBJECT) || ipc_bin_put(&n, sizeof(n)))
+			w->err = 1;
 	}
+	w->depth++;
+	w->json[w->depth] = item;
+	w->count[w->depth] = 0;
+	w->count_off[w->depth] = ipc_bin_len - sizeof(n);
+	w->isarray[w->depth] = array;
+}
+
+static void
+ipc_writer_object(IPCWriter *w, const char *key)
+{
+	ipc_writer_open(w, key, 0);
+}
 
-	cJSON_free(buffer);
+static void
+ipc_writer_array(IPCWriter *w, const char *key)
+{
+	ipc_writer_open(w, key, 1);
 }
 
 /**
- * Prepares the IPC client's buffer with a message
+ * Close the innermost container, or the root
  */
+static void
+ipc_writer_close(IPCWriter *w)
+{
+	if (w->overflow) {
+		w->overflow--;
+		return;
+	}
+	if (w->binary && !w->err)
+		memcpy(ipc_bin_buffer + w->count_off[w->depth], &w->count[w->depth], sizeof(uint32_t));
+	if (w->depth)
+		w->depth--;
+}
+
+/**
+ * Complete the message, setting len to its size
+ *
+ * Returns the message, to be released with ipc_writer_free()
+ * Returns NULL if it couldn't be allocated
+ */
+static char *
+ipc_writer_end(IPCWriter *w, uint32_t *len)
+{
+	char *msg = NULL;
+
+	while (w->depth)
+		ipc_writer_close(w);
+	ipc_writer_close(w);
+
+	if (w->binary) {
+		msg = w->err ? NULL : ipc_bin_buffer;
+		*len = ipc_bin_len;
+	}
+	else {
+		if (!w->err && (msg = cJSON_PrintUnformatted(w->json[0])))
+			*len = strlen(msg) + 1;  // +1 for null char
+		cJSON_Delete(w->json[0]);
+		w->json[0] = NULL;
+	}
+	if (!msg) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to allocate the IPC %s message\n", w->binary ? "binary" : "JSON");
+	}
+
+	return msg;
+}
 
 static void
-ipc_reply_prepare_send_message(cJSON *gen, IPCClient *c,
-                               IPCMessageType msg_type)
+ipc_writer_free(IPCWriter *w, char *msg)
 {
-	char *buffer;
-	size_t len = 0;
+	if (msg && !w->binary)
+		cJSON_free(msg);
+}
+
+/**
+ * Complete the message and queue it as the IPC client's reply
+ */
+static void
+ipc_writer_reply(IPCWriter *w, IPCClient *c, IPCMessageType msg_type)
+{
+	uint32_t len = 0;
+	char *msg = ipc_writer_end(w, &len);
+
+	if (msg)
+		ipc_prepare_send_message(c, msg_type, len, msg);
+	ipc_writer_free(w, msg);
+}
+
+/**
+ * Whether any client subscribed to the event for delivery wants it in the
+ * binary encoding, or as JSON
+ */
+static int
+ipc_event_wanted(IPCEvent event, IPCDelivery delivery, int binary)
+{
+	for (IPCClient *c = ipc_clients; c; c = c->next)
+		if ((c->subscriptions & event) && c->delivery == delivery
+		&& (c->encoding == IPC_ENCODING_BINARY) == binary)
+			return 1;
+
+	return 0;
+}
+
+/**
+ * Complete the event and queue it for the subscribers of event and delivery
+ * that use the writer's encoding
+ */
+static void
+ipc_writer_event(IPCWriter *w, IPCEvent event, IPCDelivery delivery)
+{
+	uint32_t len = 0;
+	char *msg = ipc_writer_end(w, &len);
+
+	for (IPCClient *c = ipc_clients; msg && c; c = c->next)
+		if ((c->subscriptions & event) && c->delivery == delivery
+		&& (c->encoding == IPC_ENCODING_BINARY) == w->binary) {
+			DEBUG("Sending selected client change event to fd %d\n", c->fd);
+			ipc_prepare_send_message(c, IPC_TYPE_EVENT, len, msg);
+		}
+	ipc_writer_free(w, msg);
+}
 
-	buffer = cJSON_PrintUnformatted(gen);
-	len = strlen(buffer) + 1;// For null char
+/**
+ * Order IPCCommands by name; equal names keep their config.h order so the
+ * first definition wins, as it did with the linear search.
+ */
+static int
+ipc_command_cmp(const void *a, const void *b)
+{
+	const IPCCommand *ca = a, *cb = b;
+	int r = strcmp(ca->name, cb->name);
 
-	ipc_prepare_send_message(c, msg_type, len, (const char *)buffer);
+	return r ? r : (ca > cb) - (ca < cb);
+}
 
-	cJSON_free(buffer);
+static int
+ipc_command_key_cmp(const void *key, const void *cmd)
+{
+	return strcmp((const char *)key, ((const IPCCommand *)cmd)->name);
+}
+
+/**
+ * Build the sorted command index and size the argument buffers from the
+ * longest command signature, so run_command needs no allocation.
+ *
+ * Returns 0 on success
+ * Returns -1 on allocation failure
+ */
+static int
+ipc_index_commands(IPCCommand commands[], const int commands_len)
+{
+	int i;
+	unsigned int n = 0;
+
+	ipc_args_max = 1;
+	if (commands_len > 0) {
+		if (!(ipc_commands = malloc(commands_len * sizeof(IPCCommand))))
+			return -1;
+		memcpy(ipc_commands, commands, commands_len * sizeof(IPCCommand));
+		qsort(ipc_commands, commands_len, sizeof(IPCCommand), ipc_command_cmp);
+
+		for (i = 0; i < commands_len; i++) {
+			if (n && strcmp(ipc_commands[n - 1].name, ipc_commands[i].name) == 0) {
+				logdatetime(stderr);
+				fprintf(stderr, "dwm: ignoring duplicate IPC command %s\n", ipc_commands[i].name);
+				continue;
+			}
+			ipc_commands[n++] = ipc_commands[i];
+			if (ipc_commands[i].argc > ipc_args_max)
+				ipc_args_max = ipc_commands[i].argc;
+		}
+	}
+	ipc_commands_len = n;
+
+	ipc_args = malloc(ipc_args_max * sizeof(Arg));
+	ipc_arg_types = malloc(ipc_args_max * sizeof(ArgType));
+	if (!ipc_args || !ipc_arg_types)
+		return -1;
+
+	return 0;
 }
 
 /**
@@ -263,22 +669,251 @@ ipc_reply_prepare_send_message(cJSON *gen, IPCClient *c,
 static int
 ipc_get_ipc_command(const char *name, IPCCommand *ipc_command)
 {
-	for (int i = 0; i < ipc_commands_len; i++) {
-		if (strcmp(ipc_commands[i].name, name) == 0) {
-			*ipc_command = ipc_commands[i];
+	IPCCommand *cmd = NULL;
+
+	if (ipc_commands_len)
+		cmd = bsearch(name, ipc_commands, ipc_commands_len, sizeof(IPCCommand), ipc_command_key_cmp);
+	if (!cmd)
+		return -1;
+
+	*ipc_command = *cmd;
+	return 0;
+}
+
+/*
+ * Minimal streaming JSON reader for run_command messages. Strings are
+ * unescaped in place (the result is never longer than its escaped form), so
+ * the command name and string arguments point into the message buffer.
+ * Each reader returns the position just past what it consumed, or NULL if
+ * the input is malformed.
+ */
+static char *
+ipc_json_ws(char *p)
+{
+	while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+		p++;
+	return p;
+}
+
+static int
+ipc_json_hex4(const char *p, unsigned long *cp)
+{
+	int i;
+
+	for (*cp = i = 0; i < 4; i++) {
+		if (p[i] >= '0' && p[i] <= '9')
+			*cp = (*cp << 4) | (p[i] - '0');
+		else if ((p[i] | 0x20) >= 'a' && (p[i] | 0x20) <= 'f')
+			*cp = (*cp << 4) | ((p[i] | 0x20) - 'a' + 10);
+		else
 			return 0;
+	}
+	return 1;
+}
+
+static char *
+ipc_json_string(char *p, char **out)
+{
+	char *w;
+	unsigned long cp, lo;
+
+	if (*p++ != '"')
+		return NULL;
+
+	for (*out = w = p; *p != '"'; p++) {
+		// this also stops at the terminating '\0'
+		if ((unsigned char)*p < 0x20)
+			return NULL;
+		if (*p != '\\') {
+			*w++ = *p;
+			continue;
+		}
+		switch (*++p) {
+		case '"': case '\\': case '/': *w++ = *p; break;
+		case 'b': *w++ = '\b'; break;
+		case 'f': *w++ = '\f'; break;
+		case 'n': *w++ = '\n'; break;
+		case 'r': *w++ = '\r'; break;
+		case 't': *w++ = '\t'; break;
+		case 'u':
+			if (!ipc_json_hex4(p + 1, &cp))
+				return NULL;
+			p += 4;
+			if (cp >= 0xD800 && cp <= 0xDBFF) {
+				if (p[1] != '\\' || p[2] != 'u' || !ipc_json_hex4(p + 3, &lo)
+				|| lo < 0xDC00 || lo > 0xDFFF)
+					return NULL;
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+				p += 6;
+			}
+			else if ((cp >= 0xDC00 && cp <= 0xDFFF) || cp == 0)
+				return NULL;
+
+			if (cp < 0x80)
+				*w++ = cp;
+			else if (cp < 0x800) {
+				*w++ = 0xC0 | (cp >> 6);
+				*w++ = 0x80 | (cp & 0x3F);
+			}
+			else if (cp < 0x10000) {
+				*w++ = 0xE0 | (cp >> 12);
+				*w++ = 0x80 | ((cp >> 6) & 0x3F);
+				*w++ = 0x80 | (cp & 0x3F);
+			}
+			else {
+				*w++ = 0xF0 | (cp >> 18);
+				*w++ = 0x80 | ((cp >> 12) & 0x3F);
+				*w++ = 0x80 | ((cp >> 6) & 0x3F);
+				*w++ = 0x80 | (cp & 0x3F);
+			}
+			break;
+		default:
+			return NULL;
 		}
 	}
+	*w = '\0';
 
-	return -1;
+	return p + 1;
+}
+
+/**
+ * Scan a JSON number; isint is set unless it has a fraction or exponent.
+ */
+static char *
+ipc_json_number(char *p, int *isint)
+{
+	*isint = 1;
+	if (*p == '-')
+		p++;
+	if (*p == '0')
+		p++;
+	else if (*p >= '1' && *p <= '9')
+		while (*p >= '0' && *p <= '9')
+			p++;
+	else
+		return NULL;
+
+	if (*p == '.') {
+		*isint = 0;
+		if (*++p < '0' || *p > '9')
+			return NULL;
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+	if (*p == 'e' || *p == 'E') {
+		*isint = 0;
+		if (*++p == '+' || *p == '-')
+			p++;
+		if (*p < '0' || *p > '9')
+			return NULL;
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+
+	return p;
+}
+
+/**
+ * Skip over any JSON value, e.g. that of a key run_command doesn't use.
+ */
+static char *
+ipc_json_skip(char *p, int depth)
+{
+	char *s, close;
+	int isint;
+
+	p = ipc_json_ws(p);
+	switch (*p) {
+	case '"':
+		return ipc_json_string(p, &s);
+	case '{':
+	case '[':
+		if (depth >= 32)
+			return NULL;
+		close = *p == '{' ? '}' : ']';
+		p = ipc_json_ws(p + 1);
+		if (*p == close)
+			return p + 1;
+		for (;;) {
+			if (close == '}') {
+				if (!(p = ipc_json_string(p, &s)))
+					return NULL;
+				p = ipc_json_ws(p);
+				if (*p++ != ':')
+					return NULL;
+			}
+			if (!(p = ipc_json_skip(p, depth + 1)))
+				return NULL;
+			p = ipc_json_ws(p);
+			if (*p == close)
+				return p + 1;
+			if (*p++ != ',')
+				return NULL;
+			p = ipc_json_ws(p);
+		}
+	case 't':
+		return strncmp(p, "true", 4) == 0 ? p + 4 : NULL;
+	case 'f':
+		return strncmp(p, "false", 5) == 0 ? p + 5 : NULL;
+	case 'n':
+		return strncmp(p, "null", 4) == 0 ? p + 4 : NULL;
+	default:
+		return ipc_json_number(p, &isint);
+	}
+}
+
+/**
+ * Read one element of the args array straight into an Arg. Negative integers
+ * are signed, other integers unsigned, and any other number is a float.
+ */
+static char *
+ipc_json_arg(char *p, Arg *arg, ArgType *type)
+{
+	char *s, *end;
+	int isint;
+
+	if (*p == '"') {
+		if (!(p = ipc_json_string(p, &s)))
+			return NULL;
+		arg->v = s;
+		*type = ARG_TYPE_STR;
+		return p;
+	}
+
+	if (!(end = ipc_json_number(p, &isint)))
+		return NULL;
+	if (!isint) {
+		arg->f = strtod(p, NULL);
+		*type = ARG_TYPE_FLOAT;
+		DEBUG("f=%f\n", arg->f);
+	}
+	else if (*p == '-') {
+		arg->i = strtol(p, NULL, 10);
+		*type = ARG_TYPE_SINT;
+		DEBUG("i=%ld\n", arg->i);
+	}
+	else {
+		arg->ui = strtoul(p, NULL, 10);
+		*type = ARG_TYPE_UINT;
+		DEBUG("ui=%lu\n", arg->ui);
+	}
+
+	return end;
 }
 
 /**
  * Parse a IPC_TYPE_RUN_COMMAND message from a client. This function extracts
  * the arguments, argument count, argument types, and command name and returns
- * the parsed information as an IPCParsedCommand. If this function returns
- * successfully, the parsed_command must be freed using
- * ipc_free_parsed_command_members.
+ * the parsed information as an IPCParsedCommand. No tree is built: the name
+ * and string arguments point into msg, which is modified in place, and the
+ * arguments are stored in buffers sized at ipc_init(), so the result is only
+ * valid until the next message is parsed.
+ *
+ * Format:
+ * {
+ *   "command": "<command name>",
+ *   "args": [ "arg1", "arg2", ... ]
+ * }
  *
  * Returns 0 if the message was successfully parsed
  * Returns -1 otherwise
@@ -286,119 +921,99 @@ ipc_get_ipc_command(const char *name, IPCCommand *ipc_command)
 static int
 ipc_parse_run_command(char *msg, IPCParsedCommand *parsed_command)
 {
-//	char error_buffer[1000];
-	cJSON *parent = cJSON_Parse(msg);
+	char *p, *key;
+	int has_args = 0;
+	unsigned int *argc = &parsed_command->argc;
+	Arg *args = parsed_command->args = ipc_args;
+	ArgType *arg_types = parsed_command->arg_types = ipc_arg_types;
+
+	parsed_command->name = NULL;
+	*argc = 0;
+
+	if (!msg || *(p = ipc_json_ws(msg)) != '{')
+		goto malformed;
+	p = ipc_json_ws(p + 1);
+
+	while (*p != '}') {
+		if (!(p = ipc_json_string(p, &key)))
+			goto malformed;
+		p = ipc_json_ws(p);
+		if (*p++ != ':')
+			goto malformed;
+		p = ipc_json_ws(p);
+
+		// As with a lookup in a parsed tree, the first of duplicate keys wins
+		if (strcmp(key, "command") == 0 && !parsed_command->name) {
+			if (!(p = ipc_json_string(p, &parsed_command->name)))
+				goto malformed;
+		}
+		else if (strcmp(key, "args") == 0 && !has_args && *p == '[') {
+			has_args = 1;
+			*argc = 0;
+			p = ipc_json_ws(p + 1);
+			while (*p != ']') {
+				// keep counting past the longest signature so the
+				// mismatch can be reported
+				if (*argc < ipc_args_max)
+					p = ipc_json_arg(p, &args[*argc], &arg_types[*argc]);
+				else
+					p = ipc_json_skip(p, 0);
+				if (!p)
+					goto malformed;
+				(*argc)++;
+				p = ipc_json_ws(p);
+				if (*p == ',')
+					p = ipc_json_ws(p + 1);
+				else if (*p != ']')
+					goto malformed;
+			}
+			p++;
+		}
+		else {
+			if (strcmp(key, "args") == 0 && !has_args) {
+				has_args = 1;
+				*argc = 0;
+			}
+			if (!(p = ipc_json_skip(p, 0)))
+				goto malformed;
+		}
 
-	const char *error_ptr = cJSON_GetErrorPtr();
-	if (error_ptr != NULL) {
-		logdatetime(stderr);
-		fprintf(stderr, "dwm: Failed to parse IPC message from client: %s\n	Failure occurred just before: %s\n", msg, error_ptr);
-		return -1;
-	}
-	else if (!parent) {
-		logdatetime(stderr);
-		fprintf(stderr, "dwm: Failed to parse IPC message from client: %s\n", msg);
-		return -1;
+		p = ipc_json_ws(p);
+		if (*p == ',')
+			p = ipc_json_ws(p + 1);
+		else if (*p != '}')
+			goto malformed;
 	}
+	if (*ipc_json_ws(p + 1) != '\0')
+		goto malformed;
 
-	// Format:
-	// {
-	//   "command": "<command name>"
-	//   "args": [ "arg1", "arg2", ... ]
-	// }
-	//const char *command_path[] = {"command", 0};
-	cJSON *command_val = cJSON_GetObjectItemCaseSensitive(parent, "command");
-	if (command_val == NULL) {
-		fputs("dwm: No command key found in client message\n", stderr);
-		cJSON_Delete(parent);
+	if (!parsed_command->name) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: No command key found in client message\n");
 		return -1;
 	}
-
-	const char *command_name = command_val->valuestring;
-	size_t command_name_len = strlen(command_name);
-	parsed_command->name = (char *)malloc((command_name_len + 1) * sizeof(char));
-	strcpy(parsed_command->name, command_name);
-
 	DEBUG("Received command: %s\n", parsed_command->name);
 
-	//const char *args_path[] = {"args", 0};
-	cJSON *args_val = cJSON_GetObjectItemCaseSensitive(parent, "args");
-
-	if (args_val == NULL) {
-		fputs("No args key found in client message\n", stderr);
-		cJSON_Delete(parent);
+	if (!has_args) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: No args key found in client message\n");
 		return -1;
 	}
 
-	unsigned int *argc = &parsed_command->argc;
-	Arg **args = &parsed_command->args;
-	ArgType **arg_types = &parsed_command->arg_types;
-
-	if (!cJSON_IsArray(args_val) || cJSON_GetArraySize(args_val) == 0) {
+	if (*argc == 0) {
 		// If no arguments are specified, make a dummy argument to pass to the
 		// function. This is just the way dwm's void(Arg*) functions are setup.
 		*argc = 1;
-		*args = (Arg *)malloc(sizeof(Arg));
-		*arg_types = (ArgType *)malloc(sizeof(ArgType));
-		(*arg_types)[0] = ARG_TYPE_NONE;
-		(*args)[0].i = 0;
-//		(*argc)++;
-	}
-	else {
-		*argc = cJSON_GetArraySize(args_val);
-		*args = (Arg *)calloc(*argc, sizeof(Arg));
-		*arg_types = (ArgType *)malloc(*argc * sizeof(ArgType));
-
-		for (int i = 0; i < *argc; i++) {
-			cJSON *arg_val = cJSON_GetArrayItem(args_val, i);
-
-			if (cJSON_IsNumeric(arg_val)) {
-				if (cJSON_IsInteger(arg_val)) {
-					// Any values below 0 must be a signed int
-					if (arg_val->valueint < 0) {
-						(*args)[i].i = arg_val->valueint;
-						(*arg_types)[i] = ARG_TYPE_SINT;
-						DEBUG("i=%ld\n", (*args)[i].i);
-						// Any values above 0 should be an unsigned int
-					} else if (arg_val->valueint >= 0) {
-						(*args)[i].ui = arg_val->valueint;
-						(*arg_types)[i] = ARG_TYPE_UINT;
-						DEBUG("ui=%ld\n", (*args)[i].i);
-					}
-					// If the number is not an integer, it must be a float
-				} else {
-					(*args)[i].f = arg_val->valuedouble;
-					(*arg_types)[i] = ARG_TYPE_FLOAT;
-					DEBUG("f=%f\n", (*args)[i].f);
-					// If argument is not a number, it must be a string
-				}
-			} else if (cJSON_IsString(arg_val)) {
-				char *arg_s = arg_val->valuestring;
-				size_t arg_s_size = (strlen(arg_s) + 1) * sizeof(char);
-				(*args)[i].v = (char *)malloc(arg_s_size);
-				(*arg_types)[i] = ARG_TYPE_STR;
-				strcpy((char *)(*args)[i].v, arg_s);
-			}
-		}
+		arg_types[0] = ARG_TYPE_NONE;
+		args[0].i = 0;
 	}
 
-	cJSON_Delete(parent);
-
 	return 0;
-}
 
-/**
- * Free the members of a IPCParsedCommand struct
- */
-static void
-ipc_free_parsed_command_members(IPCParsedCommand *command)
-{
-	for (int i = 0; i < command->argc; i++) {
-		if (command->arg_types[i] == ARG_TYPE_STR) free((void *)command->args[i].v);
-	}
-	free(command->args);
-	free(command->arg_types);
-	free(command->name);
+malformed:
+	logdatetime(stderr);
+	fprintf(stderr, "dwm: Failed to parse IPC run_command message from client\n");
+	return -1;
 }
 
 /**
@@ -470,7 +1085,7 @@ ipc_event_stoi(const char *subscription, IPCEvent *event)
  */
 
 static int
-ipc_parse_subscribe(const char *msg, IPCSubscriptionAction *subscribe, IPCEvent *event)
+ipc_parse_subscribe(const char *msg, IPCSubscriptionAction *subscribe, IPCEvent *event, IPCDelivery *delivery)
 {
 	cJSON *parent = cJSON_Parse((char *)msg);
 
@@ -490,6 +1105,7 @@ ipc_parse_subscribe(const char *msg, IPCSubscriptionAction *subscribe, IPCEvent
 	// {
 	//   "event": "<event name>"
 	//   "action": "<subscribe|unsubscribe>"
+	//   "delivery": "<latest|every>" (optional)
 	// }
 	cJSON *event_val = cJSON_GetObjectItemCaseSensitive(parent, "event");
 	if (event_val == NULL) {
@@ -521,6 +1137,19 @@ ipc_parse_subscribe(const char *msg, IPCSubscriptionAction *subscribe, IPCEvent
 		return -1;
 	}
 
+	cJSON *delivery_val = cJSON_GetObjectItemCaseSensitive(parent, "delivery");
+	if (cJSON_IsString(delivery_val)) {
+		if (strcmp(delivery_val->valuestring, "latest") == 0)
+			*delivery = IPC_DELIVERY_LATEST;
+		else if (strcmp(delivery_val->valuestring, "every") == 0)
+			*delivery = IPC_DELIVERY_EVERY;
+		else {
+			fputs("dwm: ipc_parse_subscribe: Invalid delivery specified for subscription\n", stderr);
+			cJSON_Delete(parent);
+			return -1;
+		}
+	}
+
 	cJSON_Delete(parent);
 	return 0;
 }
@@ -631,7 +1260,6 @@ ipc_run_command(IPCClient *ipc_client, char *msg)
 
 	if (ipc_get_ipc_command(parsed_command.name, &ipc_command) < 0) {
 		ipc_prepare_reply_failure(ipc_client, IPC_TYPE_RUN_COMMAND, "Command %s not found", parsed_command.name);
-		ipc_free_parsed_command_members(&parsed_command);
 		return -1;
 	}
 
@@ -641,19 +1269,19 @@ ipc_run_command(IPCClient *ipc_client, char *msg)
 			ipc_prepare_reply_failure(ipc_client, IPC_TYPE_RUN_COMMAND, "%u arguments provided, %u expected", parsed_command.argc, ipc_command.argc);
 		else if (res == -2)
 			ipc_prepare_reply_failure(ipc_client, IPC_TYPE_RUN_COMMAND, "Type mismatch");
-		ipc_free_parsed_command_members(&parsed_command);
 		return -1;
 	}
 
+	// The command may build JSON that outlives the message, e.g. reloaded rules
+	Arena *prev = setjsonarena(NULL);
 	if (parsed_command.argc == 1)
 		ipc_command.func.single_param(parsed_command.args);
 	else if (parsed_command.argc > 1)
 		ipc_command.func.array_param(parsed_command.args, parsed_command.argc);
+	setjsonarena(prev);
 
 	DEBUG("Called function for command %s\n", parsed_command.name);
 
-	ipc_free_parsed_command_members(&parsed_command);
-
 	ipc_prepare_reply_success(ipc_client, IPC_TYPE_RUN_COMMAND);
 	return 0;
 }
@@ -666,81 +1294,92 @@ ipc_run_command(IPCClient *ipc_client, char *msg)
 static void
 ipc_get_monitors(IPCClient *c, Monitor *mons, Monitor *selmon)
 {
-	cJSON *gen = cJSON_CreateArray();
-	cJSON *mon, *group, *detail;
-
-    for (Monitor *m = mons; m; m = m->next) {
-
-		mon = cJSON_CreateObject();
-		cJSON_AddItemToArray(gen, mon);
-
-		// monitor section;
+	IPCWriter w;
 
-		cJSON_AddNumberToObject(mon, "master_factor", m->mfact);
-		cJSON_AddIntegerToObject(mon, "num_master", m->nmaster);
-		cJSON_AddIntegerToObject(mon, "num", m->num);
-		cJSON_AddBoolToObject(mon, "is_selected", (m == selmon));
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 1);
 
-		group = cJSON_AddObjectToObject(mon, "monitor_geometry");
-		cJSON_AddIntegerToObject(group, "x", m->mx);
-		cJSON_AddIntegerToObject(group, "y", m->my);
-		cJSON_AddIntegerToObject(group, "width", m->mw);
-		cJSON_AddIntegerToObject(group, "height", m->mh);
+	for (Monitor *m = mons; m; m = m->next) {
 
-		group = cJSON_AddObjectToObject(mon, "window_geometry");
-		cJSON_AddIntegerToObject(group, "x", m->wx);
-		cJSON_AddIntegerToObject(group, "y", m->wy);
-		cJSON_AddIntegerToObject(group, "width", m->ww);
-		cJSON_AddIntegerToObject(group, "height", m->wh);
+		ipc_writer_object(&w, NULL);
 
-		group = cJSON_AddObjectToObject(mon, "tagset");
-		cJSON_AddIntegerToObject(group, "current", m->tagset[m->seltags]);
-		cJSON_AddIntegerToObject(group, "old", m->tagset[m->seltags ^ 1]);
+		// monitor section;
 
-		group = cJSON_AddObjectToObject(mon, "tag_state");
-		cJSON_AddItemToObject(group, "selected", cJSON_CreateInteger(m->tagstate.selected));
-		cJSON_AddItemToObject(group, "occupied", cJSON_CreateInteger(m->tagstate.occupied));
-		cJSON_AddItemToObject(group, "urgent", cJSON_CreateInteger(m->tagstate.urgent));
+		ipc_writer_double(&w, "master_factor", m->mfact);
+		ipc_writer_int(&w, "num_master", m->nmaster);
+		ipc_writer_int(&w, "num", m->num);
+		ipc_writer_bool(&w, "is_selected", (m == selmon));
+
+		ipc_writer_object(&w, "monitor_geometry");
+		ipc_writer_int(&w, "x", m->mx);
+		ipc_writer_int(&w, "y", m->my);
+		ipc_writer_int(&w, "width", m->mw);
+		ipc_writer_int(&w, "height", m->mh);
+		ipc_writer_close(&w);
+
+		ipc_writer_object(&w, "window_geometry");
+		ipc_writer_int(&w, "x", m->wx);
+		ipc_writer_int(&w, "y", m->wy);
+		ipc_writer_int(&w, "width", m->ww);
+		ipc_writer_int(&w, "height", m->wh);
+		ipc_writer_close(&w);
+
+		ipc_writer_object(&w, "tagset");
+		ipc_writer_int(&w, "current", m->tagset[m->seltags]);
+		ipc_writer_int(&w, "old", m->tagset[m->seltags ^ 1]);
+		ipc_writer_close(&w);
+
+		ipc_writer_object(&w, "tag_state");
+		ipc_writer_int(&w, "selected", m->tagstate[IPC_DELIVERY_LATEST].selected);
+		ipc_writer_int(&w, "occupied", m->tagstate[IPC_DELIVERY_LATEST].occupied);
+		ipc_writer_int(&w, "urgent", m->tagstate[IPC_DELIVERY_LATEST].urgent);
+		ipc_writer_close(&w);
 
 
 		// client section;
 
-		group = cJSON_AddObjectToObject(mon, "clients");
-		cJSON_AddIntegerToObject(group, "selected", m->sel ? m->sel->win : 0);
-		detail = cJSON_AddArrayToObject(group, "stack");
+		ipc_writer_object(&w, "clients");
+		ipc_writer_int(&w, "selected", m->sel ? m->sel->win : 0);
+		ipc_writer_array(&w, "stack");
 		for (Client *c = m->stack; c; c = c->snext)
-			cJSON_AddItemToArray(detail, cJSON_CreateInteger(c->win));
-		detail = cJSON_AddArrayToObject(group, "all");
+			ipc_writer_int(&w, NULL, c->win);
+		ipc_writer_close(&w);
+		ipc_writer_array(&w, "all");
 		for (Client *c = m->clients; c; c = c->next)
-			cJSON_AddItemToArray(detail, cJSON_CreateInteger(c->win));
+			ipc_writer_int(&w, NULL, c->win);
+		ipc_writer_close(&w);
+		ipc_writer_close(&w);
 
 
 		// layout section;
 
-		group = cJSON_AddObjectToObject(mon, "layout");
+		ipc_writer_object(&w, "layout");
+
+		ipc_writer_object(&w, "symbol");
+		ipc_writer_string(&w, "current", m->ltsymbol);
+		ipc_writer_string(&w, "old", m->lastltsymbol[IPC_DELIVERY_LATEST]);
+		ipc_writer_close(&w);
 
-		detail = cJSON_AddObjectToObject(group, "symbol");
-		cJSON_AddStringToObject(detail, "current", m->ltsymbol);
-		cJSON_AddStringToObject(detail, "old", m->lastltsymbol);
+		ipc_writer_object(&w, "address");
+		ipc_writer_int(&w, "current", (uintptr_t)m->lt[m->sellt]);
+		ipc_writer_int(&w, "old", (uintptr_t)m->lt[m->sellt ^ 1]);
+		ipc_writer_close(&w);
 
-		detail = cJSON_AddObjectToObject(group, "address");
-		cJSON_AddIntegerToObject(detail, "current", (uintptr_t)m->lt[m->sellt]);
-		cJSON_AddIntegerToObject(detail, "old", (uintptr_t)m->lt[m->sellt ^ 1]);
+		ipc_writer_close(&w);
 
 
 		// bar section;
 
-		group = cJSON_AddObjectToObject(mon, "bar");
-		cJSON_AddIntegerToObject(group, "y", m->by);
-		cJSON_AddBoolToObject(group, "is_shown", m->showbar);
-		cJSON_AddBoolToObject(group, "is_top", m->topbar);
-		cJSON_AddIntegerToObject(group, "window_id", m->barwin);
+		ipc_writer_object(&w, "bar");
+		ipc_writer_int(&w, "y", m->by);
+		ipc_writer_bool(&w, "is_shown", m->showbar);
+		ipc_writer_bool(&w, "is_top", m->topbar);
+		ipc_writer_int(&w, "window_id", m->barwin);
+		ipc_writer_close(&w);
 
+		ipc_writer_close(&w);
 	}
 
-	ipc_reply_prepare_send_message(gen, c, IPC_TYPE_GET_MONITORS);
-
-	cJSON_Delete(gen);
+	ipc_writer_reply(&w, c, IPC_TYPE_GET_MONITORS);
 }
 
 /**
@@ -751,13 +1390,13 @@ ipc_get_monitors(IPCClient *c, Monitor *mons, Monitor *selmon)
 static void
 ipc_get_tags(IPCClient *c, char *tags[], const int tags_len)
 {
-	cJSON *gen = cJSON_CreateArray();
-	for (int i = 0; i < tags_len; i++)
-		cJSON_AddItemToArray(gen, cJSON_CreateString(tags[i]));
+	IPCWriter w;
 
-	ipc_reply_prepare_send_message(gen, c, IPC_TYPE_GET_TAGS);
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 1);
+	for (int i = 0; i < tags_len; i++)
+		ipc_writer_string(&w, NULL, tags[i]);
 
-	cJSON_Delete(gen);
+	ipc_writer_reply(&w, c, IPC_TYPE_GET_TAGS);
 }
 
 /**
@@ -768,18 +1407,17 @@ ipc_get_tags(IPCClient *c, char *tags[], const int tags_len)
 static void
 ipc_get_layouts(IPCClient *c, const Layout layouts[], const int layouts_len)
 {
-	cJSON *gen = cJSON_CreateArray();
-	cJSON *layout;
+	IPCWriter w;
+
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 1);
 	for (int i = 0; i < layouts_len; i++) {
-		layout = cJSON_CreateObject();
-		cJSON_AddStringToObject(layout, "symbol", layouts[i].symbol ? layouts[i].symbol : "");
-		cJSON_AddIntegerToObject(layout, "address", (uintptr_t)(layouts + i));
-		cJSON_AddItemToArray(gen, layout);
+		ipc_writer_object(&w, NULL);
+		ipc_writer_string(&w, "symbol", layouts[i].symbol ? layouts[i].symbol : "");
+		ipc_writer_int(&w, "address", (uintptr_t)(layouts + i));
+		ipc_writer_close(&w);
 	}
 
-	ipc_reply_prepare_send_message(gen, c, IPC_TYPE_GET_LAYOUTS);
-
-	cJSON_Delete(gen);
+	ipc_writer_reply(&w, c, IPC_TYPE_GET_LAYOUTS);
 }
 
 static int
@@ -791,16 +1429,16 @@ ipc_find_dwm_client(IPCClient *ipc_client, const char *msg, const Monitor *mons)
 
 	Client *c = getclientbyname(name);
 	if (c) {
-		cJSON *gen = cJSON_CreateObject();
-		cJSON_AddStringToObject(gen, "name", c->name);
-		cJSON_AddIntegerToObject(gen, "pid", c->pid);
-		cJSON_AddIntegerToObject(gen, "tags", c->tags);
-		cJSON_AddIntegerToObject(gen, "window_id", c->win);
-		cJSON_AddIntegerToObject(gen, "monitor_number", c->mon->num);
+		IPCWriter w;
+		ipc_writer_begin(&w, ipc_client->encoding == IPC_ENCODING_BINARY, 0);
+		ipc_writer_string(&w, "name", c->name);
+		ipc_writer_int(&w, "pid", c->pid);
+		ipc_writer_int(&w, "tags", c->tags);
+		ipc_writer_int(&w, "window_id", c->win);
+		ipc_writer_int(&w, "monitor_number", c->mon->num);
 
-		ipc_reply_prepare_send_message(gen, ipc_client, IPC_TYPE_FIND_DWM_CLIENT);
+		ipc_writer_reply(&w, ipc_client, IPC_TYPE_FIND_DWM_CLIENT);
 
-		cJSON_Delete(gen);
 		free(name);
 		return 0;
 	}
@@ -810,6 +1448,132 @@ ipc_find_dwm_client(IPCClient *ipc_client, const char *msg, const Monitor *mons)
 	return -1;
 }
 
+/**
+ * Write the members describing a client into the open object, as returned by
+ * get_dwm_client and for each client of get_clients
+ */
+static void
+ipc_client_write(IPCWriter *w, Client *c)
+{
+	ipc_writer_string(w, "name", c->name);
+	ipc_writer_int(w, "pid", c->pid);
+	ipc_writer_int(w, "tags", c->tags);
+	ipc_writer_int(w, "window_id", c->win);
+	ipc_writer_int(w, "monitor_number", c->mon->num);
+
+	ipc_writer_object(w, "geometry");
+	ipc_writer_object(w, "current");
+	ipc_writer_int(w, "x", c->x);
+	ipc_writer_int(w, "y", c->y);
+	ipc_writer_int(w, "width", c->w);
+	ipc_writer_int(w, "height", c->h);
+	ipc_writer_close(w);
+
+	ipc_writer_object(w, "old");
+	ipc_writer_int(w, "x", c->oldx);
+	ipc_writer_int(w, "y", c->oldy);
+	ipc_writer_int(w, "width", c->oldw);
+	ipc_writer_int(w, "height", c->oldh);
+	ipc_writer_close(w);
+	ipc_writer_close(w);
+
+	ipc_writer_object(w, "size_hints");
+	ipc_writer_object(w, "base");
+	ipc_writer_int(w, "width", c->basew);
+	ipc_writer_int(w, "height", c->baseh);
+	ipc_writer_close(w);
+	ipc_writer_object(w, "step");
+	ipc_writer_int(w, "width", c->incw);
+	ipc_writer_int(w, "height", c->incw);
+	ipc_writer_close(w);
+	ipc_writer_object(w, "max");
+	ipc_writer_int(w, "width", c->maxw);
+	ipc_writer_int(w, "height", c->maxh);
+	ipc_writer_close(w);
+	ipc_writer_object(w, "min");
+	ipc_writer_int(w, "width", c->minw);
+	ipc_writer_int(w, "height", c->minh);
+	ipc_writer_close(w);
+	ipc_writer_object(w, "aspect_ratio");
+	ipc_writer_int(w, "min", c->mina);
+	ipc_writer_int(w, "max", c->maxa);
+	ipc_writer_close(w);
+	ipc_writer_close(w);
+
+	ipc_writer_object(w, "border_width");
+	ipc_writer_int(w, "current", c->bw);
+	ipc_writer_int(w, "old", c->oldbw);
+	ipc_writer_close(w);
+
+	ipc_writer_object(w, "states");
+	#if PATCH_FLAG_FAKEFULLSCREEN
+	ipc_writer_int(w, "fakefullscreen", c->fakefullscreen);
+	#endif // PATCH_FLAG_FAKEFULLSCREEN
+	#if PATCH_FLAG_FLOAT_ALIGNMENT
+	ipc_writer_double(w, "float_align_x", c->floatalignx);
+	ipc_writer_double(w, "float_align_y", c->floataligny);
+	#endif // PATCH_FLAG_FLOAT_ALIGNMENT
+	#if PATCH_FLAG_FOLLOW_PARENT
+	ipc_writer_int(w, "follow_parent", c->followparent);
+	#endif // PATCH_FLAG_FOLLOW_PARENT
+	#if PATCH_MOUSE_POINTER_HIDING
+	ipc_writer_int(w, "cursor_autohide", c->cursorautohide);
+	ipc_writer_int(w, "cursor_hide_on_keys", c->cursorhideonkeys);
+	#endif // PATCH_MOUSE_POINTER_HIDING
+	#if PATCH_FLAG_ALWAYSONTOP
+	ipc_writer_int(w, "is_alwaysontop", c->alwaysontop);
+	#endif // PATCH_FLAG_ALWAYSONTOP
+	#if PATCH_FLAG_CENTRED
+	ipc_writer_int(w, "is_centred", c->iscentred);
+	#endif // PATCH_FLAG_CENTRED
+	ipc_writer_int(w, "is_fixed", c->isfixed);
+	ipc_writer_int(w, "is_floating", c->isfloating);
+	ipc_writer_int(w, "is_fullscreen", c->isfullscreen);
+	#if PATCH_FLAG_GAME
+	ipc_writer_int(w, "is_game", c->isgame);
+	#if PATCH_FLAG_GAME_STRICT
+	ipc_writer_int(w, "is_game_strict", c->isgamestrict);
+	#endif // PATCH_FLAG_GAME_STRICT
+	#endif // PATCH_FLAG_GAME
+	#if PATCH_FOCUS_FOLLOWS_MOUSE
+	#if PATCH_FLAG_GREEDY_FOCUS
+	ipc_writer_int(w, "is_greedy", c->isgreedy);
+	#endif // PATCH_FLAG_GREEDY_FOCUS
+	#endif // PATCH_FOCUS_FOLLOWS_MOUSE
+	#if PATCH_FLAG_HIDDEN
+	ipc_writer_int(w, "is_hidden", c->ishidden);
+	#endif // PATCH_FLAG_HIDDEN
+	#if PATCH_FLAG_IGNORED
+	ipc_writer_int(w, "is_ignored", c->isignored);
+	#endif // PATCH_FLAG_IGNORED
+	#if PATCH_ATTACH_BELOW_AND_NEWMASTER
+	ipc_writer_int(w, "is_newmaster", c->newmaster);
+	#endif // PATCH_ATTACH_BELOW_AND_NEWMASTER
+	#if PATCH_FLAG_PANEL
+	ipc_writer_int(w, "is_panel", c->ispanel);
+	#endif // PATCH_FLAG_PANEL
+	#if PATCH_FLAG_STICKY
+	ipc_writer_int(w, "is_sticky", c->issticky);
+	#endif // PATCH_FLAG_STICKY
+	ipc_writer_int(w, "is_urgent", c->isurgent);
+	ipc_writer_int(w, "never_focus", c->neverfocus);
+	#if PATCH_FLAG_NEVER_FULLSCREEN
+	ipc_writer_int(w, "never_fullscreen", c->neverfullscreen);
+	#endif // PATCH_FLAG_NEVER_FULLSCREEN
+	#if PATCH_FLAG_NEVER_MOVE
+	ipc_writer_int(w, "never_move", c->nevermove);
+	#endif // PATCH_FLAG_NEVER_MOVE
+	#if PATCH_FLAG_NEVER_RESIZE
+	ipc_writer_int(w, "never_resize", c->neverresize);
+	#endif // PATCH_FLAG_NEVER_RESIZE
+	ipc_writer_int(w, "old_state", c->oldstate);
+	#if PATCH_FLAG_PAUSE_ON_INVISIBLE
+	ipc_writer_int(w, "pause_on_invisible", c->pauseinvisible);
+	#endif // PATCH_FLAG_PAUSE_ON_INVISIBLE
+
+	ipc_writer_close(w);
+}
+
 /**
  * Called when an IPC_TYPE_GET_DWM_CLIENT message is received from a client. It
  * prepares a JSON reply with the properties of the client with the specified
@@ -835,117 +1599,11 @@ ipc_get_dwm_client(IPCClient *ipc_client, const char *msg, const Monitor *mons)
 	for (const Monitor *m = mons; m; m = m->next)
 		for (Client *c = m->clients; c; c = c->next)
 			if (c->win == win) {
-				cJSON *gen = cJSON_CreateObject();
-				cJSON_AddStringToObject(gen, "name", c->name);
-				cJSON_AddIntegerToObject(gen, "pid", c->pid);
-				cJSON_AddIntegerToObject(gen, "tags", c->tags);
-				cJSON_AddIntegerToObject(gen, "window_id", c->win);
-				cJSON_AddIntegerToObject(gen, "monitor_number", c->mon->num);
-
-				cJSON *section, *detail;
-				section = cJSON_AddObjectToObject(gen, "geometry");
-				detail = cJSON_AddObjectToObject(section, "current");
-				cJSON_AddIntegerToObject(detail, "x", c->x);
-				cJSON_AddIntegerToObject(detail, "y", c->y);
-				cJSON_AddIntegerToObject(detail, "width", c->w);
-				cJSON_AddIntegerToObject(detail, "height", c->h);
-
-				detail = cJSON_AddObjectToObject(section, "old");
-				cJSON_AddIntegerToObject(detail, "x", c->oldx);
-				cJSON_AddIntegerToObject(detail, "y", c->oldy);
-				cJSON_AddIntegerToObject(detail, "width", c->oldw);
-				cJSON_AddIntegerToObject(detail, "height", c->oldh);
-
-				section = cJSON_AddObjectToObject(gen, "size_hints");
-				detail = cJSON_AddObjectToObject(section, "base");
-				cJSON_AddIntegerToObject(detail, "width", c->basew);
-				cJSON_AddIntegerToObject(detail, "height", c->baseh);
-				detail = cJSON_AddObjectToObject(section, "step");
-				cJSON_AddIntegerToObject(detail, "width", c->incw);
-				cJSON_AddIntegerToObject(detail, "height", c->incw);
-				detail = cJSON_AddObjectToObject(section, "max");
-				cJSON_AddIntegerToObject(detail, "width", c->maxw);
-				cJSON_AddIntegerToObject(detail, "height", c->maxh);
-				detail = cJSON_AddObjectToObject(section, "min");
-				cJSON_AddIntegerToObject(detail, "width", c->minw);
-				cJSON_AddIntegerToObject(detail, "height", c->minh);
-				detail = cJSON_AddObjectToObject(section, "aspect_ratio");
-				cJSON_AddIntegerToObject(detail, "min", c->mina);
-				cJSON_AddIntegerToObject(detail, "max", c->maxa);
-
-				section = cJSON_AddObjectToObject(gen, "border_width");
-				cJSON_AddIntegerToObject(section, "current", c->bw);
-				cJSON_AddIntegerToObject(section, "old", c->oldbw);
-
-				section = cJSON_AddObjectToObject(gen, "states");
-				#if PATCH_FLAG_FAKEFULLSCREEN
-				cJSON_AddIntegerToObject(section, "fakefullscreen", c->fakefullscreen);
-				#endif // PATCH_FLAG_FAKEFULLSCREEN
-				#if PATCH_FLAG_FLOAT_ALIGNMENT
-				cJSON_AddNumberToObject(section, "float_align_x", c->floatalignx);
-				cJSON_AddNumberToObject(section, "float_align_y", c->floataligny);
-				#endif // PATCH_FLAG_FLOAT_ALIGNMENT
-				#if PATCH_FLAG_FOLLOW_PARENT
-				cJSON_AddIntegerToObject(section, "follow_parent", c->followparent);
-				#endif // PATCH_FLAG_FOLLOW_PARENT
-				#if PATCH_MOUSE_POINTER_HIDING
-				cJSON_AddIntegerToObject(section, "cursor_autohide", c->cursorautohide);
-				cJSON_AddIntegerToObject(section, "cursor_hide_on_keys", c->cursorhideonkeys);
-				#endif // PATCH_MOUSE_POINTER_HIDING
-				#if PATCH_FLAG_ALWAYSONTOP
-				cJSON_AddIntegerToObject(section, "is_alwaysontop", c->alwaysontop);
-				#endif // PATCH_FLAG_ALWAYSONTOP
-				#if PATCH_FLAG_CENTRED
-				cJSON_AddIntegerToObject(section, "is_centred", c->iscentred);
-				#endif // PATCH_FLAG_CENTRED
-				cJSON_AddIntegerToObject(section, "is_fixed", c->isfixed);
-				cJSON_AddIntegerToObject(section, "is_floating", c->isfloating);
-				cJSON_AddIntegerToObject(section, "is_fullscreen", c->isfullscreen);
-				#if PATCH_FLAG_GAME
-				cJSON_AddIntegerToObject(section, "is_game", c->isgame);
-				#if PATCH_FLAG_GAME_STRICT
-				cJSON_AddIntegerToObject(section, "is_game_strict", c->isgamestrict);
-				#endif // PATCH_FLAG_GAME_STRICT
-				#endif // PATCH_FLAG_GAME
-				#if PATCH_FOCUS_FOLLOWS_MOUSE
-				#if PATCH_FLAG_GREEDY_FOCUS
-				cJSON_AddIntegerToObject(section, "is_greedy", c->isgreedy);
-				#endif // PATCH_FLAG_GREEDY_FOCUS
-				#endif // PATCH_FOCUS_FOLLOWS_MOUSE
-				#if PATCH_FLAG_HIDDEN
-				cJSON_AddIntegerToObject(section, "is_hidden", c->ishidden);
-				#endif // PATCH_FLAG_HIDDEN
-				#if PATCH_FLAG_IGNORED
-				cJSON_AddIntegerToObject(section, "is_ignored", c->isignored);
-				#endif // PATCH_FLAG_IGNORED
-				#if PATCH_ATTACH_BELOW_AND_NEWMASTER
-				cJSON_AddIntegerToObject(section, "is_newmaster", c->newmaster);
-				#endif // PATCH_ATTACH_BELOW_AND_NEWMASTER
-				#if PATCH_FLAG_PANEL
-				cJSON_AddIntegerToObject(section, "is_panel", c->ispanel);
-				#endif // PATCH_FLAG_PANEL
-				#if PATCH_FLAG_STICKY
-				cJSON_AddIntegerToObject(section, "is_sticky", c->issticky);
-				#endif // PATCH_FLAG_STICKY
-				cJSON_AddIntegerToObject(section, "is_urgent", c->isurgent);
-				cJSON_AddIntegerToObject(section, "never_focus", c->neverfocus);
-				#if PATCH_FLAG_NEVER_FULLSCREEN
-				cJSON_AddIntegerToObject(section, "never_fullscreen", c->neverfullscreen);
-				#endif // PATCH_FLAG_NEVER_FULLSCREEN
-				#if PATCH_FLAG_NEVER_MOVE
-				cJSON_AddIntegerToObject(section, "never_move", c->nevermove);
-				#endif // PATCH_FLAG_NEVER_MOVE
-				#if PATCH_FLAG_NEVER_RESIZE
-				cJSON_AddIntegerToObject(section, "never_resize", c->neverresize);
-				#endif // PATCH_FLAG_NEVER_RESIZE
-				cJSON_AddIntegerToObject(section, "old_state", c->oldstate);
-				#if PATCH_FLAG_PAUSE_ON_INVISIBLE
-				cJSON_AddIntegerToObject(section, "pause_on_invisible", c->pauseinvisible);
-				#endif // PATCH_FLAG_PAUSE_ON_INVISIBLE
-
-				ipc_reply_prepare_send_message(gen, ipc_client, IPC_TYPE_GET_DWM_CLIENT);
-
-				cJSON_Delete(gen);
+				IPCWriter w;
+
+				ipc_writer_begin(&w, ipc_client->encoding == IPC_ENCODING_BINARY, 0);
+				ipc_client_write(&w, c);
+				ipc_writer_reply(&w, ipc_client, IPC_TYPE_GET_DWM_CLIENT);
 
 				return 0;
 			}
@@ -954,6 +1612,122 @@ ipc_get_dwm_client(IPCClient *ipc_client, const char *msg, const Monitor *mons)
 	return -1;
 }
 
+/**
+ * Check whether the client's cached WM_CLASS class or instance is exactly name
+ */
+static int
+ipc_client_has_class(Client *c, const char *name)
+{
+	return (strcmp(c->class, name) == 0 || strcmp(c->instance, name) == 0);
+}
+
+/**
+ * Called when an IPC_TYPE_GET_CLIENTS message is received from a client. It
+ * replies with the properties of every client matching the optional filters,
+ * one page at a time. The binary encoding is written straight from the
+ * clients, and as JSON each client is serialized on its own and appended to
+ * the reply, so no tree of the whole session is built.
+ *
+ * Returns 0 if the message was successfully parsed
+ * Returns -1 otherwise
+ */
+
+static int
+ipc_get_clients(IPCClient *ipc_client, const char *msg, Monitor *mons)
+{
+	// Format (every key optional, an empty message for all clients):
+	// {
+	//   "monitor": <monitor number>,
+	//   "tags": <clients on any of these tags>,
+	//   "class": "<WM_CLASS class or instance>",
+	//   "offset": <matching clients to skip>,
+	//   "limit": <most clients to return, 0 for all>
+	// }
+	// Reply:
+	// { "clients": [ <as get_dwm_client>, ... ], "offset": <offset>, "total": <matching clients> }
+	cJSON *parent = NULL, *val;
+	const int binary = ipc_client->encoding == IPC_ENCODING_BINARY;
+	int monitor = -1, err = 0;
+	unsigned int tags = 0, offset = 0, limit = 0, total = 0;
+	uint32_t n = 0, len = 0;
+	const char *class = NULL;
+	char tail[64], *text;
+	IPCWriter w, item;
+
+	if (msg && *msg) {
+		if (!(parent = cJSON_Parse(msg))) {
+			ipc_prepare_reply_failure(ipc_client, IPC_TYPE_GET_CLIENTS, "Failed to parse get_clients");
+			return -1;
+		}
+		if (cJSON_IsNumeric(val = cJSON_GetObjectItemCaseSensitive(parent, "monitor")))
+			monitor = val->valueint;
+		if (cJSON_IsNumeric(val = cJSON_GetObjectItemCaseSensitive(parent, "tags")))
+			tags = val->valueint;
+		if (cJSON_IsString(val = cJSON_GetObjectItemCaseSensitive(parent, "class")))
+			class = val->valuestring;
+		if (cJSON_IsNumeric(val = cJSON_GetObjectItemCaseSensitive(parent, "offset")) && val->valueint > 0)
+			offset = val->valueint;
+		if (cJSON_IsNumeric(val = cJSON_GetObjectItemCaseSensitive(parent, "limit")) && val->valueint > 0)
+			limit = val->valueint;
+	}
+
+	if (binary) {
+		ipc_writer_begin(&w, 1, 0);
+		ipc_writer_array(&w, "clients");
+	}
+	else {
+		ipc_bin_len = 0;
+		err = ipc_bin_put("{\"clients\":[", 12);
+	}
+
+	for (Monitor *m = mons; m && !err; m = m->next) {
+		if (monitor >= 0 && m->num != monitor)
+			continue;
+		for (Client *c = m->clients; c && !err; c = c->next) {
+			if ((tags && !(c->tags & tags)) || (class && !ipc_client_has_class(c, class)))
+				continue;
+			if (++total <= offset || (limit && n >= limit))
+				continue;
+
+			if (binary) {
+				ipc_writer_object(&w, NULL);
+				ipc_client_write(&w, c);
+				ipc_writer_close(&w);
+				err = w.err;
+			}
+			else {
+				ipc_writer_begin(&item, 0, 0);
+				ipc_client_write(&item, c);
+				text = ipc_writer_end(&item, &len);
+				err = !text || (n && ipc_bin_put(",", 1)) || ipc_bin_put(text, len - 1);
+				ipc_writer_free(&item, text);
+			}
+			n++;
+		}
+	}
+
+	if (binary) {
+		ipc_writer_close(&w);
+		ipc_writer_int(&w, "offset", offset);
+		ipc_writer_int(&w, "total", total);
+		err = !ipc_writer_end(&w, &len);
+	}
+	else {
+		snprintf(tail, sizeof(tail), "],\"offset\":%u,\"total\":%u}", offset, total);
+		err = err || ipc_bin_put(tail, strlen(tail) + 1);  // +1 for null char
+	}
+
+	cJSON_Delete(parent);
+
+	if (err) {
+		ipc_prepare_reply_failure(ipc_client, IPC_TYPE_GET_CLIENTS, "Failed to allocate reply");
+		return -1;
+	}
+
+	ipc_prepare_send_message(ipc_client, IPC_TYPE_GET_CLIENTS, ipc_bin_len, ipc_bin_buffer);
+	return 0;
+}
+
 /**
  * Called when an IPC_TYPE_SUBSCRIBE message is received from a client. It
  * subscribes/unsubscribes the client from the specified event and replies with
@@ -968,10 +1742,11 @@ ipc_subscribe(IPCClient *c, const char *msg)
 {
 	IPCSubscriptionAction action = IPC_ACTION_SUBSCRIBE;
 	IPCEvent event = 0;
+	IPCDelivery delivery = c->delivery;
 
 DEBUG("ipc_subscribe() 1\n");
 
-	if (ipc_parse_subscribe(msg, &action, &event)) {
+	if (ipc_parse_subscribe(msg, &action, &event, &delivery)) {
 		ipc_prepare_reply_failure(c, IPC_TYPE_SUBSCRIBE, "Event does not exist");
 		return -1;
 	}
@@ -981,6 +1756,7 @@ DEBUG("ipc_subscribe() 2\n");
 	if (action == IPC_ACTION_SUBSCRIBE) {
 		DEBUG("Subscribing client on fd %d to %d\n", c->fd, event);
 		c->subscriptions |= event;
+		c->delivery = delivery;
 	} else if (action == IPC_ACTION_UNSUBSCRIBE) {
 		DEBUG("Unsubscribing client on fd %d to %d\n", c->fd, event);
 		c->subscriptions ^= event;
@@ -994,9 +1770,206 @@ DEBUG("ipc_subscribe() 3\n");
 	return 0;
 }
 
+/**
+ * Create and map the shared memory snapshot.
+ *
+ * Returns 0 on success
+ * Returns -1 otherwise
+ */
+static int
+ipc_shm_create(void)
+{
+	int fd;
+	void *addr;
+
+	snprintf(ipc_shm_name, sizeof(ipc_shm_name), "/dwm-state-%ld", (long)getpid());
+	shm_unlink(ipc_shm_name);
+	if ((fd = shm_open(ipc_shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR)) < 0) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to create shared memory \"%s\": %s\n", ipc_shm_name, strerror(errno));
+		return -1;
+	}
+	if (ftruncate(fd, sizeof(IPCShm)) < 0
+	|| (addr = mmap(NULL, sizeof(IPCShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to map shared memory \"%s\": %s\n", ipc_shm_name, strerror(errno));
+		close(fd);
+		shm_unlink(ipc_shm_name);
+		return -1;
+	}
+	close(fd);
+
+	ipc_shm = addr;
+	ipc_shm->version = IPC_SHM_VERSION;
+	ipc_shm->size = sizeof(IPCShm);
+
+	return 0;
+}
+
+/**
+ * Add the latency of one X event type or IPC message type to an array, unless
+ * it never occurred
+ */
+static void
+ipc_latency_add(IPCWriter *w, const char *type, const Latency *l)
+{
+	if (!l->count)
+		return;
+
+	ipc_writer_object(w, NULL);
+	ipc_writer_string(w, "type", type);
+	ipc_writer_int(w, "count", l->count);
+	ipc_writer_double(w, "total_ms", l->total);
+	ipc_writer_double(w, "mean_ms", l->total / l->count);
+	ipc_writer_double(w, "p50_ms", latencyquantile(l, 0.5));
+	ipc_writer_double(w, "p90_ms", latencyquantile(l, 0.9));
+	ipc_writer_double(w, "p99_ms", latencyquantile(l, 0.99));
+	ipc_writer_double(w, "max_ms", l->max);
+	ipc_writer_int(w, "requests", l->requests);
+	ipc_writer_int(w, "flushes", l->flushes);
+
+	// [lowest microseconds, count] for each bucket in use
+	ipc_writer_array(w, "histogram");
+	for (unsigned int b = 0; b < LATENCY_BUCKETS; b++) {
+		if (!l->buckets[b])
+			continue;
+		ipc_writer_array(w, NULL);
+		ipc_writer_double(w, NULL, latencybucketus(b));
+		ipc_writer_double(w, NULL, l->buckets[b]);
+		ipc_writer_close(w);
+	}
+	ipc_writer_close(w);
+
+	ipc_writer_close(w);
+}
+
+/**
+ * Called when an IPC_TYPE_GET_LATENCY message is received from a client. It
+ * replies with the latency histograms of the X event handlers and of the IPC
+ * messages handled so far.
+ */
+static void
+ipc_get_latency(IPCClient *c)
+{
+	IPCWriter w;
+
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 0);
+
+	ipc_writer_array(&w, "x_events");
+	for (int i = 0; i < LASTEvent; i++)
+		if (handlernames[i])
+			ipc_latency_add(&w, handlernames[i], &xlatency[i]);
+	ipc_writer_close(&w);
+
+	ipc_writer_array(&w, "ipc_messages");
+	for (int i = 0; i < LENGTH(ipc_latency); i++)
+		ipc_latency_add(&w, ipc_type_names[i], &ipc_latency[i]);
+	ipc_writer_close(&w);
+
+	ipc_writer_reply(&w, c, IPC_TYPE_GET_LATENCY);
+}
+
+/**
+ * Called when an IPC_TYPE_GET_PROFILE message is received from a client. It
+ * replies with the time spent in each phase of the startup and of the latest
+ * reload, in milliseconds.
+ */
+static void
+ipc_get_profile(IPCClient *c)
+{
+	IPCWriter w;
+
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 1);
+
+	for (int i = 0; i < ipc_profiles_len; i++) {
+		const Profile *p = &ipc_profiles[i];
+		if (!p->done)
+			continue;
+		ipc_writer_object(&w, NULL);
+		ipc_writer_string(&w, "trigger", p->trigger);
+		ipc_writer_double(&w, "total_ms", p->total);
+		ipc_writer_int(&w, "managed", p->managed);
+		ipc_writer_object(&w, "phases_ms");
+		for (int j = 0; j < ProfileLast; j++)
+			ipc_writer_double(&w, profilephases[j], p->ms[j]);
+		ipc_writer_close(&w);
+		ipc_writer_close(&w);
+	}
+
+	ipc_writer_reply(&w, c, IPC_TYPE_GET_PROFILE);
+}
+
+/**
+ * Called when an IPC_TYPE_GET_STATE_SHM message is received from a client. It
+ * creates the shared memory snapshot if it doesn't exist yet and replies with
+ * its name, size and version.
+ */
+
+static void
+ipc_get_state_shm(IPCClient *c, Monitor *mons, Monitor *selmon)
+{
+	if (!ipc_shm) {
+		if (ipc_shm_create() < 0) {
+			ipc_prepare_reply_failure(c, IPC_TYPE_GET_STATE_SHM, "Failed to create shared memory");
+			return;
+		}
+		ipc_shm_update(mons, selmon);
+	}
+
+	IPCWriter w;
+
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 0);
+	ipc_writer_string(&w, "name", ipc_shm_name);
+	ipc_writer_int(&w, "size", sizeof(IPCShm));
+	ipc_writer_int(&w, "version", IPC_SHM_VERSION);
+
+	ipc_writer_reply(&w, c, IPC_TYPE_GET_STATE_SHM);
+}
+
+/**
+ * Called when an IPC_TYPE_SET_ENCODING message is received from a client. It
+ * switches the encoding of the client's replies and events and replies with
+ * the result, in the new encoding.
+ *
+ * Returns 0 if the message was successfully parsed.
+ * Returns -1 if the message could not be parsed
+ */
+
+static int
+ipc_set_encoding(IPCClient *c, const char *msg)
+{
+	// Format:
+	// {
+	//   "encoding": "<json|binary>"
+	// }
+	cJSON *parent = cJSON_Parse(msg);
+	cJSON *encoding_val = cJSON_GetObjectItemCaseSensitive(parent, "encoding");
+	int ret = 0;
+
+	if (!cJSON_IsString(encoding_val)) {
+		ipc_prepare_reply_failure(c, IPC_TYPE_SET_ENCODING, "No encoding specified");
+		ret = -1;
+	}
+	else if (strcmp(encoding_val->valuestring, "json") == 0)
+		c->encoding = IPC_ENCODING_JSON;
+	else if (strcmp(encoding_val->valuestring, "binary") == 0)
+		c->encoding = IPC_ENCODING_BINARY;
+	else {
+		ipc_prepare_reply_failure(c, IPC_TYPE_SET_ENCODING, "Invalid encoding: %s", encoding_val->valuestring);
+		ret = -1;
+	}
+
+	if (ret == 0)
+		ipc_prepare_reply_success(c, IPC_TYPE_SET_ENCODING);
+
+	cJSON_Delete(parent);
+	return ret;
+}
+
 int
 ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[],
-         const int commands_len)
+         const int commands_len, const uint32_t queue_max, const IPCSlowPolicy slow_policy,
+         const Profile *profiles, const int profiles_len)
 {
 	// Initialize struct to 0
 	memset(&sock_epoll_event, 0, sizeof(sock_epoll_event));
@@ -1004,8 +1977,15 @@ ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[],
 	int socket_fd = ipc_create_socket(socket_path);
 	if (socket_fd < 0) return -1;
 
-	ipc_commands = commands;
-	ipc_commands_len = commands_len;
+	if (ipc_index_commands(commands, commands_len) < 0) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: Failed to index IPC commands\n");
+		return -1;
+	}
+	ipc_queue_max = queue_max;
+	ipc_slow_policy = slow_policy;
+	ipc_profiles = profiles;
+	ipc_profiles_len = profiles_len;
 
 	epoll_fd = p_epoll_fd;
 
@@ -1044,8 +2024,29 @@ ipc_cleanup()
 	// Uninitialize all static variables
 	epoll_fd = -1;
 	sock_fd = -1;
+
+	free(ipc_commands);
+	free(ipc_bin_buffer);
+	if (ipc_replay_client) {
+		free(ipc_replay_client->buffer);
+		free(ipc_replay_client);
+		ipc_replay_client = NULL;
+	}
+	arena_free(&ipcarena);
+	free(ipc_args);
+	free(ipc_arg_types);
 	ipc_commands = NULL;
 	ipc_commands_len = 0;
+	ipc_bin_buffer = NULL;
+	ipc_bin_len = 0;
+	ipc_bin_cap = 0;
+	ipc_args = NULL;
+	ipc_arg_types = NULL;
+	ipc_args_max = 0;
+	ipc_queue_max = 0;
+	ipc_slow_policy = IPC_SLOW_DROP_EVENTS;
+	ipc_profiles = NULL;
+	ipc_profiles_len = 0;
 	memset(&sock_epoll_event, 0, sizeof(struct epoll_event));
 	memset(&sockaddr, 0, sizeof(struct sockaddr_un));
 
@@ -1095,6 +2096,14 @@ ipc_accept_client()
 		fputs("Failed to set flags on new client fd", stderr);
 	}
 
+	// Never block the event loop on a slow client
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+		shutdown(fd, SHUT_RDWR);
+		close(fd);
+		fputs("Failed to make new client fd non-blocking", stderr);
+		return -1;
+	}
+
 	IPCClient *nc = ipc_client_new(fd);
 	if (nc == NULL)
 		return -1;
@@ -1126,6 +2135,7 @@ ipc_drop_client(IPCClient *c)
 		ipc_list_remove_client(&ipc_clients, c);
 
 		free(c->buffer);
+		free(c->read_buffer);
 		free(c);
 
 		DEBUG("Successfully removed client on fd %d\n", fd);
@@ -1140,11 +2150,11 @@ int
 ipc_read_client(IPCClient *c, IPCMessageType *msg_type, uint32_t *msg_size, char **msg)
 {
 	int fd = c->fd;
-	int ret = ipc_recv_message(fd, (uint8_t *)msg_type, msg_size, (uint8_t **)msg);
+	int ret = ipc_recv_message(c, (uint8_t *)msg_type, msg_size, (uint8_t **)msg);
 
 	if (ret < 0) {
-		// This will happen if these errors occur while reading header
-		if (ret == -1 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		// The rest of the message has not arrived yet
+		if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
 			return -2;
 
 		fprintf(stderr, "Error reading message: dropping client at fd %d\n", fd);
@@ -1177,31 +2187,63 @@ ipc_read_client(IPCClient *c, IPCMessageType *msg_type, uint32_t *msg_size, char
 ssize_t
 ipc_write_client(IPCClient *c)
 {
-	const ssize_t n = ipc_write_message(c->fd, c->buffer, c->buffer_size);
+	dwm_ipc_header_t header;
+	struct iovec iov[2];
+	struct msghdr mh = {.msg_iov = iov};
+	uint32_t start, len, first, packet_size;
+	ssize_t n;
 
-	if (n < 0)
-		return n;
+	if (!c->buffer_size)
+		return 0;
 
-	// TODO: Deal with client timeouts
+	// The unwritten bytes wrap around the end of the ring at most once
+	start = (c->buffer_head + c->buffer_sent) % c->buffer_cap;
+	len = c->buffer_size - c->buffer_sent;
+	first = MIN(len, c->buffer_cap - start);
+	iov[0].iov_base = c->buffer + start;
+	iov[0].iov_len = first;
+	iov[1].iov_base = c->buffer;
+	iov[1].iov_len = len - first;
+	mh.msg_iovlen = (len > first ? 2 : 1);
+
+	// sendmsg() rather than writev(), so a client that went away doesn't raise SIGPIPE
+	do
+		n = sendmsg(c->fd, &mh, MSG_NOSIGNAL);
+	while (n < 0 && errno == EINTR);
 
-	if (n == c->buffer_size) {
-		c->buffer_size = 0;
-		free(c->buffer);
-		// No dangling pointers!
-		c->buffer = NULL;
+	if (n < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : n;
+
+	DEBUG("Wrote %zd/%" PRIu32 " to client at fd %d\n", n, len, c->fd);
+
+	// Pop the messages that have been written completely
+	c->buffer_sent += n;
+	while (c->buffer_size) {
+		ipc_ring_read(c, 0, &header, sizeof(header));
+		packet_size = sizeof(header) + header.size;
+		if (c->buffer_sent < packet_size)
+			break;
+		c->buffer_sent -= packet_size;
+		c->buffer_size -= packet_size;
+		if (header.type == IPC_TYPE_EVENT)
+			c->buffer_events -= packet_size;
+		c->buffer_head = (c->buffer_head + packet_size) % c->buffer_cap;
+	}
+
+	if (!c->buffer_size) {
+		c->buffer_head = 0;
 		// Stop waking up when client is ready to receive messages
 		if (c->event.events & EPOLLOUT) {
 			c->event.events -= EPOLLOUT;
 			epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &c->event);
 		}
-		return n;
+		if (c->dropped) {
+			logdatetime(stderr);
+			fprintf(stderr, "dwm: IPC client at fd %d caught up after %u events were dropped\n", c->fd, c->dropped);
+			c->dropped = 0;
+		}
 	}
 
-	// Shift unwritten buffer to beginning of buffer and reallocate
-	c->buffer_size -= n;
-	memmove(c->buffer, c->buffer + n, c->buffer_size);
-	c->buffer = (char *)realloc(c->buffer, c->buffer_size);
-
 	return n;
 }
 
@@ -1210,25 +2252,57 @@ ipc_prepare_send_message(IPCClient *c, const IPCMessageType msg_type, const uint
 {
 	dwm_ipc_header_t header = {.magic = IPC_MAGIC_ARR, .type = msg_type, .size = msg_size};
 
-	uint32_t header_size = sizeof(dwm_ipc_header_t);
-	uint32_t packet_size = header_size + msg_size;
+	const uint32_t header_size = sizeof(dwm_ipc_header_t);
+	const uint32_t packet_size = header_size + msg_size;
+	uint32_t cap;
+
+	// The client isn't keeping up with its events; replies are always queued,
+	// as the client asked for them
+	if (msg_type == IPC_TYPE_EVENT && ipc_queue_max && c->buffer_events + packet_size > ipc_queue_max) {
+		if (ipc_slow_policy == IPC_SLOW_DISCONNECT) {
+			logdatetime(stderr);
+			fprintf(stderr, "dwm: IPC client at fd %d exceeded its queue of %" PRIu32 " bytes, disconnecting\n", c->fd, ipc_queue_max);
+			// The hangup is reported through epoll, and the client dropped there
+			shutdown(c->fd, SHUT_RDWR);
+			c->subscriptions = 0;
+			c->buffer_size = 0;
+			c->buffer_head = 0;
+			c->buffer_sent = 0;
+			c->buffer_events = 0;
+			return;
+		}
 
-	if (c->buffer == NULL)
-		c->buffer = (char *)malloc(c->buffer_size + packet_size);
-	else
-		c->buffer = (char *)realloc(c->buffer, c->buffer_size + packet_size);
+		if (!c->dropped) {
+			logdatetime(stderr);
+			fprintf(stderr, "dwm: IPC client at fd %d exceeded its queue of %" PRIu32 " bytes, dropping events\n", c->fd, ipc_queue_max);
+		}
+		if (c->buffer_events)
+			ipc_ring_drop(c, c->buffer_events + packet_size - ipc_queue_max);
+		if (c->buffer_events + packet_size > ipc_queue_max) {
+			c->dropped++;
+			return;
+		}
+	}
 
-	// Copy header to end of client buffer
-	memcpy(c->buffer + c->buffer_size, &header, header_size);
-	c->buffer_size += header_size;
+	if (c->buffer_size + packet_size > c->buffer_cap) {
+		for (cap = c->buffer_cap ? c->buffer_cap : IPC_QUEUE_INITIAL_SIZE; cap < c->buffer_size + packet_size; cap *= 2);
+		if (ipc_ring_rebuild(c, cap) < 0) {
+			logdatetime(stderr);
+			fprintf(stderr, "dwm: Failed to grow the queue of IPC client at fd %d\n", c->fd);
+			return;
+		}
+	}
 
-	// Copy message to end of client buffer
-	memcpy(c->buffer + c->buffer_size, msg, msg_size);
-	c->buffer_size += msg_size;
+	ipc_ring_write(c, &header, header_size);
+	ipc_ring_write(c, msg, msg_size);
+	if (msg_type == IPC_TYPE_EVENT)
+		c->buffer_events += packet_size;
 
 	// Wake up when client is ready to receive messages
-	c->event.events |= EPOLLOUT;
-	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &c->event);
+	if (!(c->event.events & EPOLLOUT)) {
+		c->event.events |= EPOLLOUT;
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &c->event);
+	}
 }
 
 void
@@ -1248,16 +2322,16 @@ ipc_prepare_reply_failure(IPCClient *c, IPCMessageType msg_type, const char *for
 
 	DEBUG("ipc_prepare_reply_failure: IPCMessageType:%ix\n", msg_type);
 
-	cJSON *gen = cJSON_CreateObject();
-	cJSON_AddStringToObject(gen, "result", "error");
-	cJSON_AddStringToObject(gen, "reason", buffer);
+	IPCWriter w;
+	ipc_writer_begin(&w, c->encoding == IPC_ENCODING_BINARY, 0);
+	ipc_writer_string(&w, "result", "error");
+	ipc_writer_string(&w, "reason", buffer);
 
-	ipc_reply_prepare_send_message(gen, c, msg_type);
+	ipc_writer_reply(&w, c, msg_type);
 
 	logdatetime(stderr);
 	fprintf(stderr, "dwm: [fd %d] Error: %s\n", c->fd, buffer);
 
-	cJSON_Delete(gen);
 	free(buffer);
 }
 
@@ -1266,198 +2340,250 @@ ipc_prepare_reply_success(IPCClient *c, IPCMessageType msg_type)
 {
 	const char *success_msg = "{\"result\":\"success\"}";
 	const size_t msg_len = strlen(success_msg) + 1;  // +1 for null char
+	IPCWriter w;
+
+	if (c->encoding == IPC_ENCODING_BINARY) {
+		ipc_writer_begin(&w, 1, 0);
+		ipc_writer_string(&w, "result", "success");
+		ipc_writer_reply(&w, c, msg_type);
+		return;
+	}
 
 	ipc_prepare_send_message(c, msg_type, msg_len, success_msg);
 }
 
 
+int
+ipc_subscribers(IPCDelivery delivery)
+{
+	int subscriptions = 0;
+
+	for (IPCClient *c = ipc_clients; c; c = c->next)
+		if (c->delivery == delivery)
+			subscriptions |= c->subscriptions;
+
+	return subscriptions;
+}
+
 void
-ipc_tag_change_event(int mon_num, TagState old_state, TagState new_state)
+ipc_tag_change_event(int mon_num, TagState old_state, TagState new_state, IPCDelivery delivery)
 {
+	IPCWriter w;
+
+	if (!(ipc_subscribers(delivery) & IPC_EVENT_TAG_CHANGE))
+		return;
+
 	DEBUG("ipc_tag_change_event(mon_num:%i ...)\n", mon_num);
 
-	cJSON *gen = cJSON_CreateObject();
-	cJSON *event = cJSON_CreateObject();
-	cJSON *state;
-	cJSON_AddItemToObject(gen, IPC_EVENT_STRING_TAG_CHANGE, event);
-	cJSON_AddItemToObject(event, "monitor_number", cJSON_CreateInteger(mon_num));
+	for (int binary = 0; binary < 2; binary++) {
+		if (!ipc_event_wanted(IPC_EVENT_TAG_CHANGE, delivery, binary))
+			continue;
 
-	state = cJSON_CreateObject();
-	cJSON_AddItemToObject(event, "old_state", state);
-	cJSON_AddItemToObject(state, "selected", cJSON_CreateInteger(old_state.selected));
-	cJSON_AddItemToObject(state, "occupied", cJSON_CreateInteger(old_state.occupied));
-	cJSON_AddItemToObject(state, "urgent", cJSON_CreateInteger(old_state.urgent));
+		ipc_writer_begin(&w, binary, 0);
+		ipc_writer_object(&w, IPC_EVENT_STRING_TAG_CHANGE);
+		ipc_writer_int(&w, "monitor_number", mon_num);
 
-	state = cJSON_CreateObject();
-	cJSON_AddItemToObject(event, "new_state", state);
-	cJSON_AddItemToObject(state, "selected", cJSON_CreateInteger(new_state.selected));
-	cJSON_AddItemToObject(state, "occupied", cJSON_CreateInteger(new_state.occupied));
-	cJSON_AddItemToObject(state, "urgent", cJSON_CreateInteger(new_state.urgent));
+		ipc_writer_object(&w, "old_state");
+		ipc_writer_int(&w, "selected", old_state.selected);
+		ipc_writer_int(&w, "occupied", old_state.occupied);
+		ipc_writer_int(&w, "urgent", old_state.urgent);
+		ipc_writer_close(&w);
 
-	ipc_event_prepare_send_message(gen, IPC_EVENT_TAG_CHANGE);
+		ipc_writer_object(&w, "new_state");
+		ipc_writer_int(&w, "selected", new_state.selected);
+		ipc_writer_int(&w, "occupied", new_state.occupied);
+		ipc_writer_int(&w, "urgent", new_state.urgent);
+		ipc_writer_close(&w);
 
-	cJSON_Delete(gen);
+		ipc_writer_event(&w, IPC_EVENT_TAG_CHANGE, delivery);
+	}
 }
 
 void
-ipc_client_focus_change_event(int mon_num, Client *old_client, Client *new_client)
+ipc_client_focus_change_event(int mon_num, Window old_win, Window new_win, IPCDelivery delivery)
 {
-	DEBUG(
-		"ipc_client_focus_change_event(mon_num:%i, old_client:%s, new_client:%s)\n",
-		mon_num, old_client ? old_client->name : "<none>", new_client ? new_client->name : "<none>"
-	);
+	IPCWriter w;
+
+	if (!(ipc_subscribers(delivery) & IPC_EVENT_CLIENT_FOCUS_CHANGE))
+		return;
 
-	cJSON *gen = cJSON_CreateObject();
-	cJSON *event = cJSON_CreateObject();
+	DEBUG("ipc_client_focus_change_event(mon_num:%i, old_win:0x%lx, new_win:0x%lx)\n", mon_num, old_win, new_win);
 
-	cJSON_AddItemToObject(gen, IPC_EVENT_STRING_CLIENT_FOCUS_CHANGE, event);
-	cJSON_AddItemToObject(event, "monitor_number", cJSON_CreateInteger(mon_num));
-	cJSON_AddItemToObject(event, "old_win_id", old_client == NULL ? cJSON_CreateNull() : cJSON_CreateInteger(old_client->win));
-	cJSON_AddItemToObject(event, "new_win_id", new_client == NULL ? cJSON_CreateNull() : cJSON_CreateInteger(new_client->win));
+	for (int binary = 0; binary < 2; binary++) {
+		if (!ipc_event_wanted(IPC_EVENT_CLIENT_FOCUS_CHANGE, delivery, binary))
+			continue;
 
-	ipc_event_prepare_send_message(gen, IPC_EVENT_CLIENT_FOCUS_CHANGE);
+		ipc_writer_begin(&w, binary, 0);
+		ipc_writer_object(&w, IPC_EVENT_STRING_CLIENT_FOCUS_CHANGE);
+		ipc_writer_int(&w, "monitor_number", mon_num);
+		if (old_win == None)
+			ipc_writer_null(&w, "old_win_id");
+		else
+			ipc_writer_int(&w, "old_win_id", old_win);
+		if (new_win == None)
+			ipc_writer_null(&w, "new_win_id");
+		else
+			ipc_writer_int(&w, "new_win_id", new_win);
 
-	cJSON_Delete(gen);
+		ipc_writer_event(&w, IPC_EVENT_CLIENT_FOCUS_CHANGE, delivery);
+	}
 }
 
 void
 ipc_layout_change_event(const int mon_num, const char *old_symbol,
                         const Layout *old_layout, const char *new_symbol,
-                        const Layout *new_layout)
+                        const Layout *new_layout, IPCDelivery delivery)
 {
-	DEBUG("ipc_layout_change_event(mon_num:%i ...)\n", mon_num);
+	IPCWriter w;
+
+	if (!(ipc_subscribers(delivery) & IPC_EVENT_LAYOUT_CHANGE))
+		return;
 
-	cJSON *gen = cJSON_CreateObject();
-	cJSON *event = cJSON_CreateObject();
+	DEBUG("ipc_layout_change_event(mon_num:%i ...)\n", mon_num);
 
-	cJSON_AddItemToObject(gen, IPC_EVENT_STRING_LAYOUT_CHANGE, event);
-	cJSON_AddItemToObject(event, "monitor_number", cJSON_CreateInteger(mon_num));
-	cJSON_AddItemToObject(event, "old_symbol", cJSON_CreateString(old_symbol));
-	cJSON_AddItemToObject(event, "old_address", cJSON_CreateInteger((uintptr_t)old_layout));
-	cJSON_AddItemToObject(event, "new_symbol", cJSON_CreateString(new_symbol));
-	cJSON_AddItemToObject(event, "new_address", cJSON_CreateInteger((uintptr_t)new_layout));
+	for (int binary = 0; binary < 2; binary++) {
+		if (!ipc_event_wanted(IPC_EVENT_LAYOUT_CHANGE, delivery, binary))
+			continue;
 
-	ipc_event_prepare_send_message(gen, IPC_EVENT_LAYOUT_CHANGE);
+		ipc_writer_begin(&w, binary, 0);
+		ipc_writer_object(&w, IPC_EVENT_STRING_LAYOUT_CHANGE);
+		ipc_writer_int(&w, "monitor_number", mon_num);
+		ipc_writer_string(&w, "old_symbol", old_symbol);
+		ipc_writer_int(&w, "old_address", (uintptr_t)old_layout);
+		ipc_writer_string(&w, "new_symbol", new_symbol);
+		ipc_writer_int(&w, "new_address", (uintptr_t)new_layout);
 
-	cJSON_Delete(gen);
+		ipc_writer_event(&w, IPC_EVENT_LAYOUT_CHANGE, delivery);
+	}
 }
 
 void
-ipc_monitor_focus_change_event(const int last_mon_num, const int new_mon_num)
+ipc_monitor_focus_change_event(const int last_mon_num, const int new_mon_num, IPCDelivery delivery)
 {
-	DEBUG("ipc_monitor_focus_change_event(last_mon_num:%i, new_mon_num:%i)\n", last_mon_num, new_mon_num);
+	IPCWriter w;
 
-	cJSON *gen = cJSON_CreateObject();
-	cJSON *event = cJSON_CreateObject();
+	if (!(ipc_subscribers(delivery) & IPC_EVENT_MONITOR_FOCUS_CHANGE))
+		return;
 
-	cJSON_AddItemToObject(gen, IPC_EVENT_STRING_MONITOR_FOCUS_CHANGE, event);
-	cJSON_AddItemToObject(event, "old_monitor_number", cJSON_CreateInteger(last_mon_num));
-	cJSON_AddItemToObject(event, "new_monitor_number", cJSON_CreateInteger(new_mon_num));
+	DEBUG("ipc_monitor_focus_change_event(last_mon_num:%i, new_mon_num:%i)\n", last_mon_num, new_mon_num);
+
+	for (int binary = 0; binary < 2; binary++) {
+		if (!ipc_event_wanted(IPC_EVENT_MONITOR_FOCUS_CHANGE, delivery, binary))
+			continue;
 
-	ipc_event_prepare_send_message(gen, IPC_EVENT_MONITOR_FOCUS_CHANGE);
+		ipc_writer_begin(&w, binary, 0);
+		ipc_writer_object(&w, IPC_EVENT_STRING_MONITOR_FOCUS_CHANGE);
+		ipc_writer_int(&w, "old_monitor_number", last_mon_num);
+		ipc_writer_int(&w, "new_monitor_number", new_mon_num);
 
-	cJSON_Delete(gen);
+		ipc_writer_event(&w, IPC_EVENT_MONITOR_FOCUS_CHANGE, delivery);
+	}
 }
 
 void
-ipc_focused_title_change_event(const int mon_num, const Window client_id, const char *old_name, const char *new_name)
+ipc_focused_title_change_event(const int mon_num, const Window client_id, const char *old_name, const char *new_name, IPCDelivery delivery)
 {
+	IPCWriter w;
+
+	if (!(ipc_subscribers(delivery) & IPC_EVENT_FOCUSED_TITLE_CHANGE))
+		return;
+
 	DEBUG(
 		"ipc_focused_title_change_event(mon_num:%i, client_id:0x%lx, old_name:\"%s\", new_name:\"%s\")\n",
 		mon_num, client_id, old_name, new_name
 	);
 
-	cJSON *gen = cJSON_CreateObject();
-	cJSON *event = cJSON_CreateObject();
-
-	cJSON_AddItemToObject(gen, IPC_EVENT_STRING_FOCUSED_TITLE_CHANGE, event);
-	cJSON_AddItemToObject(event, "monitor_number", cJSON_CreateInteger(mon_num));
-	cJSON_AddItemToObject(event, "client_window_id", cJSON_CreateInteger(client_id));
-	cJSON_AddItemToObject(event, "old_name", cJSON_CreateString(old_name));
-	cJSON_AddItemToObject(event, "new_name", cJSON_CreateString(new_name));
+	for (int binary = 0; binary < 2; binary++) {
+		if (!ipc_event_wanted(IPC_EVENT_FOCUSED_TITLE_CHANGE, delivery, binary))
+			continue;
 
-	ipc_event_prepare_send_message(gen, IPC_EVENT_FOCUSED_TITLE_CHANGE);
+		ipc_writer_begin(&w, binary, 0);
+		ipc_writer_object(&w, IPC_EVENT_STRING_FOCUSED_TITLE_CHANGE);
+		ipc_writer_int(&w, "monitor_number", mon_num);
+		ipc_writer_int(&w, "client_window_id", client_id);
+		ipc_writer_string(&w, "old_name", old_name);
+		ipc_writer_string(&w, "new_name", new_name);
 
-	cJSON_Delete(gen);
+		ipc_writer_event(&w, IPC_EVENT_FOCUSED_TITLE_CHANGE, delivery);
+	}
 }
 
+static void
+ipc_client_state_write(IPCWriter *w, const char *key, const ClientState *state)
+{
+	ipc_writer_object(w, key);
+	ipc_writer_bool(w, "old_state", state->oldstate);
+	ipc_writer_bool(w, "is_fixed", state->isfixed);
+	ipc_writer_bool(w, "is_floating", state->isfloating);
+	ipc_writer_bool(w, "is_fullscreen", state->isfullscreen);
+	ipc_writer_bool(w, "is_urgent", state->isurgent);
+	ipc_writer_bool(w, "never_focus", state->neverfocus);
+	ipc_writer_close(w);
+}
 
 void
-ipc_focused_state_change_event(const int mon_num, const Window client_id, const ClientState *old_state, const ClientState *new_state)
+ipc_focused_state_change_event(const int mon_num, const Window client_id, const ClientState *old_state, const ClientState *new_state, IPCDelivery delivery)
 {
-	DEBUG("ipc_focused_state_change_event(mon_num:%i, client_id:0x%lx ...)\n", mon_num, client_id);
-
-	cJSON *gen = cJSON_CreateObject();
-	cJSON *event = cJSON_CreateObject();
-	cJSON *state;
+	IPCWriter w;
 
-	cJSON_AddItemToObject(gen, IPC_EVENT_STRING_FOCUSED_STATE_CHANGE, event);
-	cJSON_AddItemToObject(event, "monitor_number", cJSON_CreateInteger(mon_num));
-	cJSON_AddItemToObject(event, "client_window_id", cJSON_CreateInteger(client_id));
+	if (!(ipc_subscribers(delivery) & IPC_EVENT_FOCUSED_STATE_CHANGE))
+		return;
 
-	state = cJSON_CreateObject();
-	cJSON_AddItemToObject(event, "old_state", state);
-    cJSON_AddItemToObject(state, "old_state", cJSON_CreateBool(old_state->oldstate));;
-    cJSON_AddItemToObject(state, "is_fixed", cJSON_CreateBool(old_state->isfixed));;
-    cJSON_AddItemToObject(state, "is_floating", cJSON_CreateBool(old_state->isfloating));;
-    cJSON_AddItemToObject(state, "is_fullscreen", cJSON_CreateBool(old_state->isfullscreen));;
-    cJSON_AddItemToObject(state, "is_urgent", cJSON_CreateBool(old_state->isurgent));;
-    cJSON_AddItemToObject(state, "never_focus", cJSON_CreateBool(old_state->neverfocus));;
+	DEBUG("ipc_focused_state_change_event(mon_num:%i, client_id:0x%lx ...)\n", mon_num, client_id);
 
-	state = cJSON_CreateObject();
-	cJSON_AddItemToObject(event, "new_state", state);
-    cJSON_AddItemToObject(state, "old_state", cJSON_CreateBool(new_state->oldstate));;
-    cJSON_AddItemToObject(state, "is_fixed", cJSON_CreateBool(new_state->isfixed));;
-    cJSON_AddItemToObject(state, "is_floating", cJSON_CreateBool(new_state->isfloating));;
-    cJSON_AddItemToObject(state, "is_fullscreen", cJSON_CreateBool(new_state->isfullscreen));;
-    cJSON_AddItemToObject(state, "is_urgent", cJSON_CreateBool(new_state->isurgent));;
-    cJSON_AddItemToObject(state, "never_focus", cJSON_CreateBool(new_state->neverfocus));;
+	for (int binary = 0; binary < 2; binary++) {
+		if (!ipc_event_wanted(IPC_EVENT_FOCUSED_STATE_CHANGE, delivery, binary))
+			continue;
 
-	ipc_event_prepare_send_message(gen, IPC_EVENT_FOCUSED_STATE_CHANGE);
+		ipc_writer_begin(&w, binary, 0);
+		ipc_writer_object(&w, IPC_EVENT_STRING_FOCUSED_STATE_CHANGE);
+		ipc_writer_int(&w, "monitor_number", mon_num);
+		ipc_writer_int(&w, "client_window_id", client_id);
+		ipc_client_state_write(&w, "old_state", old_state);
+		ipc_client_state_write(&w, "new_state", new_state);
 
-	cJSON_Delete(gen);
+		ipc_writer_event(&w, IPC_EVENT_FOCUSED_STATE_CHANGE, delivery);
+	}
 }
 
 void
-ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon)
+ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon, IPCDelivery delivery)
 {
-	for (Monitor *m = mons; m; m = m->next) {
-		unsigned int urg = 0, occ = 0, tagset = 0;
-
-		for (Client *c = m->clients; c; c = c->next) {
-			occ |= c->tags;
-
-			if (c->isurgent) urg |= c->tags;
-		}
-		tagset = m->tagset[m->seltags];
+	Arena *prev = setjsonarena(&ipcarena);
 
-		TagState new_state = {.selected = tagset, .occupied = occ, .urgent = urg};
+	for (Monitor *m = mons; m; m = m->next) {
+		TagState new_state = {
+			.selected = m->tagset[m->seltags],
+			.occupied = tagcountmask(m->tagclients),
+			.urgent = tagcountmask(m->tagurgent)
+		};
 
-		if (memcmp(&m->tagstate, &new_state, sizeof(TagState)) != 0) {
-			ipc_tag_change_event(m->num, m->tagstate, new_state);
-			m->tagstate = new_state;
+		if (memcmp(&m->tagstate[delivery], &new_state, sizeof(TagState)) != 0) {
+			ipc_tag_change_event(m->num, m->tagstate[delivery], new_state, delivery);
+			m->tagstate[delivery] = new_state;
 		}
 
-		if (m->lastsel != m->sel) {
-			ipc_client_focus_change_event(m->num, m->lastsel, m->sel);
-			m->lastsel = m->sel;
+		Window selwin = m->sel ? m->sel->win : None;
+		if (m->lastselwin[delivery] != selwin) {
+			ipc_client_focus_change_event(m->num, m->lastselwin[delivery], selwin, delivery);
+			m->lastselwin[delivery] = selwin;
 		}
 
-		if (strcmp(m->ltsymbol, m->lastltsymbol) != 0 || m->lastlt != m->lt[m->sellt]) {
-			ipc_layout_change_event(m->num, m->lastltsymbol, m->lastlt, m->ltsymbol, m->lt[m->sellt]);
-			strcpy(m->lastltsymbol, m->ltsymbol);
-			m->lastlt = m->lt[m->sellt];
+		if (strcmp(m->ltsymbol, m->lastltsymbol[delivery]) != 0 || m->lastlt[delivery] != m->lt[m->sellt]) {
+			ipc_layout_change_event(m->num, m->lastltsymbol[delivery], m->lastlt[delivery], m->ltsymbol, m->lt[m->sellt], delivery);
+			strcpy(m->lastltsymbol[delivery], m->ltsymbol);
+			m->lastlt[delivery] = m->lt[m->sellt];
 		}
 
-		if (*lastselmon != selmon) {
-			if (*lastselmon != NULL)
-				ipc_monitor_focus_change_event((*lastselmon)->num, selmon->num);
-			*lastselmon = selmon;
+		if (lastselmon[delivery] != selmon) {
+			if (lastselmon[delivery] != NULL)
+				ipc_monitor_focus_change_event(lastselmon[delivery]->num, selmon->num, delivery);
+			lastselmon[delivery] = selmon;
 		}
 
 		Client *sel = m->sel;
 		if (!sel) continue;
-		ClientState *o = &m->sel->prevstate;
+		ClientState *o = &m->sel->prevstate[delivery];
 		ClientState n = {
 			.oldstate = sel->oldstate,
 			.isfixed = sel->isfixed,
@@ -1467,10 +2593,138 @@ ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon)
 			.neverfocus = sel->neverfocus
 		};
 		if (memcmp(o, &n, sizeof(ClientState)) != 0) {
-			ipc_focused_state_change_event(m->num, m->sel->win, o, &n);
+			ipc_focused_state_change_event(m->num, m->sel->win, o, &n, delivery);
 			*o = n;
 		}
 	}
+
+	setjsonarena(prev);
+	if (prev != &ipcarena)
+		arena_reset(&ipcarena);
+
+	if (delivery == IPC_DELIVERY_LATEST)
+		ipc_shm_update(mons, selmon);
+}
+
+void
+ipc_shm_cleanup(void)
+{
+	if (ipc_shm) {
+		munmap(ipc_shm, sizeof(IPCShm));
+		shm_unlink(ipc_shm_name);
+		ipc_shm = NULL;
+	}
+}
+
+void
+ipc_shm_update(Monitor *mons, Monitor *selmon)
+{
+	IPCShmSnapshot *s = &ipc_shm_staging;
+	IPCShmMonitor *sm;
+	uint32_t seq;
+
+	if (!ipc_shm)
+		return;
+
+	memset(s, 0, sizeof(IPCShmSnapshot));
+	s->selected_monitor = selmon ? selmon->num : -1;
+	for (Monitor *m = mons; m; m = m->next, s->num_monitors++) {
+		if (s->num_monitors >= IPC_SHM_MONITORS)
+			continue;
+		sm = &s->monitors[s->num_monitors];
+		sm->num = m->num;
+		sm->mx = m->mx;
+		sm->my = m->my;
+		sm->mw = m->mw;
+		sm->mh = m->mh;
+		sm->wx = m->wx;
+		sm->wy = m->wy;
+		sm->ww = m->ww;
+		sm->wh = m->wh;
+		sm->tagset = m->tagset[m->seltags];
+		sm->old_tagset = m->tagset[m->seltags ^ 1];
+		sm->occupied = tagcountmask(m->tagclients);
+		sm->urgent = tagcountmask(m->tagurgent);
+		sm->mfact = m->mfact;
+		sm->nmaster = m->nmaster;
+		sm->show_bar = m->showbar;
+		if (m->sel) {
+			sm->selected_win = m->sel->win;
+			strncpy(sm->selected_name, m->sel->name, sizeof(sm->selected_name) - 1);
+		}
+		strncpy(sm->ltsymbol, m->ltsymbol, sizeof(sm->ltsymbol) - 1);
+	}
+
+	// Readers poll seq, so only bump it for a real change
+	if (memcmp(&ipc_shm->snapshot, s, sizeof(IPCShmSnapshot)) == 0)
+		return;
+
+	seq = ipc_shm->seq;
+	__atomic_store_n(&ipc_shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&ipc_shm->snapshot, s, sizeof(IPCShmSnapshot));
+	__atomic_store_n(&ipc_shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Handle a complete message from a client. cJSON allocates from the IPC
+ * arena meanwhile, except while a command runs.
+ *
+ * Returns 0 if the message was handled
+ * Returns -1 otherwise
+ */
+static int
+ipc_handle_message(IPCClient *c, IPCMessageType msg_type, char *msg, Monitor *mons,
+                   Monitor **lastselmon, Monitor *selmon, char *tags[], const int tags_len,
+                   const Layout *layouts, const int layouts_len)
+{
+	if (msg_type == IPC_TYPE_GET_MONITORS)
+		ipc_get_monitors(c, mons, selmon);
+	else if (msg_type == IPC_TYPE_GET_TAGS)
+		ipc_get_tags(c, tags, tags_len);
+	else if (msg_type == IPC_TYPE_GET_LAYOUTS)
+		ipc_get_layouts(c, layouts, layouts_len);
+	else if (msg_type == IPC_TYPE_FIND_DWM_CLIENT) {
+		if (ipc_find_dwm_client(c, msg, mons) < 0)
+			return -1;
+	}
+	else if (msg_type == IPC_TYPE_GET_DWM_CLIENT) {
+		if (ipc_get_dwm_client(c, msg, mons) < 0)
+			return -1;
+	} else if (msg_type == IPC_TYPE_SUBSCRIBE) {
+		// Transitions aren't tracked while nobody receives them, so catch
+		// up before the first subscriber does
+		if (!ipc_subscribers(IPC_DELIVERY_EVERY))
+			ipc_send_events(mons, lastselmon, selmon, IPC_DELIVERY_EVERY);
+		if (ipc_subscribe(c, msg) < 0)
+			return -1;
+	}
+	else if (msg_type == IPC_TYPE_GET_CLIENTS) {
+		if (ipc_get_clients(c, msg, mons) < 0)
+			return -1;
+	}
+	else if (msg_type == IPC_TYPE_GET_STATE_SHM)
+		ipc_get_state_shm(c, mons, selmon);
+	else if (msg_type == IPC_TYPE_GET_PROFILE)
+		ipc_get_profile(c);
+	else if (msg_type == IPC_TYPE_GET_LATENCY)
+		ipc_get_latency(c);
+	else if (msg_type == IPC_TYPE_SET_ENCODING) {
+		if (ipc_set_encoding(c, msg) < 0)
+			return -1;
+	}
+	else if (msg_type == IPC_TYPE_RUN_COMMAND) {
+		if (ipc_run_command(c, msg) < 0)
+			return -1;
+		if (ipc_subscribers(IPC_DELIVERY_EVERY))
+			ipc_send_events(mons, lastselmon, selmon, IPC_DELIVERY_EVERY);
+		ipc_send_events(mons, lastselmon, selmon, IPC_DELIVERY_LATEST);
+	} else {
+		fprintf(stderr, "Invalid message type received from fd %d", c->fd);
+		ipc_prepare_reply_failure(c, msg_type, "Invalid message type: %d", msg_type);
+	}
+
+	return 0;
 }
 
 int
@@ -1494,35 +2748,28 @@ ipc_handle_client_epoll_event(struct epoll_event *ev, Monitor *mons,
 		char *msg = NULL;
 
 		DEBUG("Received message from fd %d\n", fd);
-		if (ipc_read_client(c, &msg_type, &msg_size, &msg) < 0)
+		int res = ipc_read_client(c, &msg_type, &msg_size, &msg);
+		if (res == -2)
+			// Partial message, wait for the rest
+			return 0;
+		if (res < 0)
 			return -1;
 
-		if (msg_type == IPC_TYPE_GET_MONITORS)
-			ipc_get_monitors(c, mons, selmon);
-		else if (msg_type == IPC_TYPE_GET_TAGS)
-			ipc_get_tags(c, tags, tags_len);
-		else if (msg_type == IPC_TYPE_GET_LAYOUTS)
-			ipc_get_layouts(c, layouts, layouts_len);
-		else if (msg_type == IPC_TYPE_FIND_DWM_CLIENT) {
-			if (ipc_find_dwm_client(c, msg, mons) < 0)
-				return -1;
-		}
-		else if (msg_type == IPC_TYPE_GET_DWM_CLIENT) {
-			if (ipc_get_dwm_client(c, msg, mons) < 0)
-				return -1;
-		} else if (msg_type == IPC_TYPE_SUBSCRIBE) {
-			if (ipc_subscribe(c, msg) < 0)
-				return -1;
-		}
-		else if (msg_type == IPC_TYPE_RUN_COMMAND) {
-			if (ipc_run_command(c, msg) < 0)
-				return -1;
-			ipc_send_events(mons, lastselmon, selmon);
-		} else {
-			fprintf(stderr, "Invalid message type received from fd %d", fd);
-			ipc_prepare_reply_failure(c, msg_type, "Invalid message type: %d", msg_type);
-		}
+		#if PATCH_EVENT_RECORDING
+		recordipc(msg_type, msg, msg_size);
+		#endif // PATCH_EVENT_RECORDING
+		LatencyMark mark;
+		latencybegin(&mark);
+		Arena *prev = setjsonarena(&ipcarena);
+		res = ipc_handle_message(c, msg_type, msg, mons, lastselmon, selmon, tags, tags_len, layouts, layouts_len);
+		setjsonarena(prev);
+		if (msg_type < LENGTH(ipc_latency))
+			latencyend(&ipc_latency[msg_type], &mark);
+		if (prev != &ipcarena)
+			arena_reset(&ipcarena);
 		free(msg);
+		if (res < 0)
+			return -1;
 	} else {
 		fprintf(stderr, "Epoll event returned %d from fd %d\n", ev->events, fd);
 		return -1;
@@ -1531,6 +2778,39 @@ ipc_handle_client_epoll_event(struct epoll_event *ev, Monitor *mons,
 	return 0;
 }
 
+int
+ipc_replay_message(IPCMessageType msg_type, char *msg, Monitor *mons,
+                   Monitor **lastselmon, Monitor *selmon,
+                   char *tags[], const int tags_len,
+                   const Layout *layouts, const int layouts_len)
+{
+	IPCClient *c;
+	int res;
+
+	// Not in ipc_clients, so it is never sent events
+	if (!ipc_replay_client && !(ipc_replay_client = ipc_client_new(-1)))
+		return -1;
+	c = ipc_replay_client;
+
+	LatencyMark mark;
+	latencybegin(&mark);
+	Arena *prev = setjsonarena(&ipcarena);
+	res = ipc_handle_message(c, msg_type, msg, mons, lastselmon, selmon, tags, tags_len, layouts, layouts_len);
+	setjsonarena(prev);
+	if (msg_type < LENGTH(ipc_latency))
+		latencyend(&ipc_latency[msg_type], &mark);
+	if (prev != &ipcarena)
+		arena_reset(&ipcarena);
+
+	c->buffer_size = 0;
+	c->buffer_head = 0;
+	c->buffer_sent = 0;
+	c->buffer_events = 0;
+	c->subscriptions = 0;
+
+	return res;
+}
+
 int
 ipc_handle_socket_epoll_event(struct epoll_event *ev)
 {
@@ -31,6 +31,11 @@ typedef enum IPCMessageType {
 	IPC_TYPE_GET_DWM_CLIENT = 5,
 	IPC_TYPE_SUBSCRIBE = 6,
 	IPC_TYPE_EVENT = 7,
+	IPC_TYPE_SET_ENCODING = 8,
+	IPC_TYPE_GET_STATE_SHM = 9,
+	IPC_TYPE_GET_CLIENTS = 10,
+	IPC_TYPE_GET_PROFILE = 11,
+	IPC_TYPE_GET_LATENCY = 12,
 } IPCMessageType;
 
 typedef enum IPCEvent {
@@ -42,6 +47,103 @@ typedef enum IPCEvent {
 	IPC_EVENT_TAG_CHANGE = 1 << 5,
 } IPCEvent;
 
+/**
+ * What to do with a client whose outgoing queue reaches the high-water mark
+ */
+typedef enum IPCSlowPolicy {
+	IPC_SLOW_DROP_EVENTS = 0,  // Drop its oldest queued events
+	IPC_SLOW_DISCONNECT = 1    // Disconnect it
+} IPCSlowPolicy;
+
+/**
+ * A client selects the encoding of its replies and events by sending
+ * IPC_TYPE_SET_ENCODING with {"encoding": "<json|binary>"}; the reply is
+ * already in the new encoding. Requests are always JSON.
+ *
+ * In the binary encoding each value is one of these tags followed by its
+ * payload, in host byte order like the header. A string is a uint32_t length
+ * and its bytes without a null char, an array a uint32_t count and its values,
+ * and an object a uint32_t count of key strings, each followed by its value.
+ */
+typedef enum IPCBinaryTag {
+	IPC_BIN_NULL = 0,
+	IPC_BIN_FALSE = 1,
+	IPC_BIN_TRUE = 2,
+	IPC_BIN_INT = 3,     // int64_t
+	IPC_BIN_DOUBLE = 4,  // double
+	IPC_BIN_STRING = 5,
+	IPC_BIN_ARRAY = 6,
+	IPC_BIN_OBJECT = 7
+} IPCBinaryTag;
+
+#define IPC_WRITER_DEPTH 8  // Deepest nesting of a reply or event
+
+/**
+ * Builds one reply or event in one encoding from the same calls: a cJSON tree
+ * for JSON clients, or the binary encoding written straight from dwm's state
+ * for binary clients, which never pay for a tree. Values are added to the
+ * innermost open object or array, with the key ignored inside arrays.
+ */
+typedef struct IPCWriter {
+	int binary;
+	int depth;                              // Of the innermost open container
+	int err;                                // Something couldn't be allocated, or nested too deep
+	int overflow;                           // Containers opened past IPC_WRITER_DEPTH
+	int isarray[IPC_WRITER_DEPTH];
+	cJSON *json[IPC_WRITER_DEPTH];          // Open containers, for JSON
+	uint32_t count[IPC_WRITER_DEPTH];       // Members of each, for binary
+	uint32_t count_off[IPC_WRITER_DEPTH];   // Where each count is in the buffer
+} IPCWriter;
+
+/**
+ * Read-only shared memory snapshot of dwm's state, for status bars and pagers
+ * that would otherwise poll. IPC_TYPE_GET_STATE_SHM replies with the POSIX
+ * shared memory object's name, size and version; dwm creates it on the first
+ * request and rewrites it at the end of every batch of events that changes it.
+ * The object outlives in-place reloads, so a mapping stays valid until dwm exits.
+ *
+ * The snapshot is guarded by a seqlock: seq is odd while dwm writes, and grows
+ * by 2 with every change. A reader copies it out with
+ *
+ *   do {
+ *       while ((seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE)) & 1);
+ *       snapshot = shm->snapshot;
+ *       __atomic_thread_fence(__ATOMIC_ACQUIRE);
+ *   } while (seq != __atomic_load_n(&shm->seq, __ATOMIC_RELAXED));
+ */
+#define IPC_SHM_VERSION 1
+#define IPC_SHM_MONITORS 16
+
+typedef struct IPCShmMonitor {
+	int32_t num;
+	int32_t mx, my, mw, mh;            // Monitor geometry
+	int32_t wx, wy, ww, wh;            // Window area geometry
+	uint32_t tagset;
+	uint32_t old_tagset;
+	uint32_t occupied;                 // Tags with clients
+	uint32_t urgent;                   // Tags with urgent clients
+	float mfact;
+	int32_t nmaster;
+	int32_t show_bar;
+	uint64_t selected_win;             // 0 if no client is selected
+	char selected_name[256];
+	char ltsymbol[16];
+} IPCShmMonitor;
+
+typedef struct IPCShmSnapshot {
+	uint32_t num_monitors;             // May exceed IPC_SHM_MONITORS; the rest are left out
+	int32_t selected_monitor;          // num of the selected monitor
+	IPCShmMonitor monitors[IPC_SHM_MONITORS];
+} IPCShmSnapshot;
+
+typedef struct IPCShm {
+	uint32_t version;                  // IPC_SHM_VERSION
+	uint32_t size;                     // sizeof(IPCShm)
+	uint32_t seq;
+	uint32_t reserved;
+	IPCShmSnapshot snapshot;
+} IPCShm;
+
 typedef enum IPCSubscriptionAction {
   IPC_ACTION_UNSUBSCRIBE = 0,
   IPC_ACTION_SUBSCRIBE = 1
@@ -94,11 +196,18 @@ typedef struct IPCParsedCommand {
  * @param epoll_fd File descriptor for epoll
  * @param commands Address of IPCCommands array defined in config.h
  * @param commands_len Length of commands[] array
+ * @param queue_max Most bytes of events queued for a client before slow_policy
+ *   applies, 0 for no limit; replies are always queued
+ * @param slow_policy What to do with a client whose queue reaches queue_max
+ * @param profiles Startup and reload profiles, reported by IPC_TYPE_GET_PROFILE
+ * @param profiles_len Length of profiles[] array
  *
  * @return int The file descriptor of the socket if it was successfully created,
  *   -1 otherwise
  */
-int ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[], const int commands_len);
+int ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[], const int commands_len,
+             const uint32_t queue_max, const IPCSlowPolicy slow_policy,
+             const Profile *profiles, const int profiles_len);
 
 /**
  * Uninitialize the socket and module. Free allocated memory and restore static
@@ -106,6 +215,13 @@ int ipc_init(const char *socket_path, const int p_epoll_fd, IPCCommand commands[
  */
 void ipc_cleanup();
 
+/**
+ * Unmap and unlink the shared memory snapshot. ipc_cleanup leaves it in place,
+ * so readers keep a live mapping across dwm's in-place reloads; call this once
+ * dwm is exiting instead.
+ */
+void ipc_shm_cleanup(void);
+
 /**
  * Get the file descriptor of the IPC socket
  *
@@ -167,7 +283,8 @@ int ipc_accept_client();
 int ipc_read_client(IPCClient *c, IPCMessageType *msg_type, uint32_t *msg_size, char **msg);
 
 /**
- * Write any pending buffer of the client to the client's socket
+ * Write as much of the client's queued messages to its socket as it accepts
+ * without blocking
  *
  * @param c Client whose buffer to write
  *
@@ -206,6 +323,15 @@ void ipc_prepare_reply_failure(IPCClient *c, IPCMessageType msg_type, const char
  */
 void ipc_prepare_reply_success(IPCClient *c, IPCMessageType msg_type);
 
+/**
+ * Get the events subscribed to by clients with the specified delivery
+ *
+ * @param delivery Delivery of the clients to include
+ *
+ * @return Bitmask of IPCEvent, 0 if there are no such subscribers
+ */
+int ipc_subscribers(IPCDelivery delivery);
+
 /**
  * Send a tag_change_event to all subscribers. Should be called only when there
  * has been a tag state change.
@@ -213,18 +339,20 @@ void ipc_prepare_reply_success(IPCClient *c, IPCMessageType msg_type);
  * @param mon_num The index of the monitor (Monitor.num property)
  * @param old_state The old tag state
  * @param new_state The new (now current) tag state
+ * @param delivery Only send to subscribers with this delivery
  */
-void ipc_tag_change_event(const int mon_num, TagState old_state, TagState new_state);
+void ipc_tag_change_event(const int mon_num, TagState old_state, TagState new_state, IPCDelivery delivery);
 
 /**
  * Send a client_focus_change_event to all subscribers. Should be called only
  * when the client focus changes.
  *
  * @param mon_num The index of the monitor (Monitor.num property)
- * @param old_client The old DWM client selection (Monitor.oldsel)
- * @param new_client The new (now current) DWM client selection
+ * @param old_win Window of the old DWM client selection, or None
+ * @param new_win Window of the new (now current) DWM client selection, or None
+ * @param delivery Only send to subscribers with this delivery
  */
-void ipc_client_focus_change_event(const int mon_num, Client *old_client, Client *new_client);
+void ipc_client_focus_change_event(const int mon_num, Window old_win, Window new_win, IPCDelivery delivery);
 
 /**
  * Send a layout_change_event to all subscribers. Should be called only
@@ -235,10 +363,11 @@ void ipc_client_focus_change_event(const int mon_num, Client *old_client, Client
  * @param old_layout Address to the old Layout
  * @param new_symbol The new (now current) layout symbol
  * @param new_layout Address to the new Layout
+ * @param delivery Only send to subscribers with this delivery
  */
 void ipc_layout_change_event(const int mon_num, const char *old_symbol,
                              const Layout *old_layout, const char *new_symbol,
-                             const Layout *new_layout);
+                             const Layout *new_layout, IPCDelivery delivery);
 
 /**
  * Send a monitor_focus_change_event to all subscribers. Should be called only
@@ -246,8 +375,9 @@ void ipc_layout_change_event(const int mon_num, const char *old_symbol,
  *
  * @param last_mon_num The index of the previously selected monitor
  * @param new_mon_num The index of the newly selected monitor
+ * @param delivery Only send to subscribers with this delivery
  */
-void ipc_monitor_focus_change_event(const int last_mon_num, const int new_mon_num);
+void ipc_monitor_focus_change_event(const int last_mon_num, const int new_mon_num, IPCDelivery delivery);
 
 /**
  * Send a focused_title_change_event to all subscribers. Should only be called
@@ -257,9 +387,11 @@ void ipc_monitor_focus_change_event(const int last_mon_num, const int new_mon_nu
  * @param client_id Window XID of client
  * @param old_name Old name of the client window
  * @param new_name New name of the client window
+ * @param delivery Only send to subscribers with this delivery
  */
 void ipc_focused_title_change_event(const int mon_num, const Window client_id,
-                                    const char *old_name, const char *new_name);
+                                    const char *old_name, const char *new_name,
+                                    IPCDelivery delivery);
 
 /**
  * Send a focused_state_change_event to all subscribers. Should only be called
@@ -269,19 +401,33 @@ void ipc_focused_title_change_event(const int mon_num, const Window client_id,
  * @param client_id Window XID of client
  * @param old_state Old state of the client
  * @param new_state New state of the client
+ * @param delivery Only send to subscribers with this delivery
  */
 void ipc_focused_state_change_event(const int mon_num, const Window client_id,
                                     const ClientState *old_state,
-                                    const ClientState *new_state);
+                                    const ClientState *new_state,
+                                    IPCDelivery delivery);
 /**
- * Check to see if an event has occured and call the *_change_event functions
- * accordingly
+ * Check to see if an event has occured since the last call for the same
+ * delivery and call the *_change_event functions accordingly. Any intermediate
+ * states in between are not reported.
  *
  * @param mons Address of Monitor pointing to start of linked list
- * @param lastselmon Address of pointer to previously selected monitor
+ * @param lastselmon Array of previously selected monitors, per IPCDelivery
  * @param selmon Address of selected Monitor
+ * @param delivery Which subscribers' baseline to diff against and send to
  */
-void ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon);
+void ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon, IPCDelivery delivery);
+
+/**
+ * Rewrite the shared memory snapshot if it has been created and the state
+ * differs from it. This is called by ipc_send_events for IPC_DELIVERY_LATEST,
+ * i.e. once each batch of events has been handled.
+ *
+ * @param mons Address of Monitor pointing to start of linked list
+ * @param selmon Address of selected Monitor
+ */
+void ipc_shm_update(Monitor *mons, Monitor *selmon);
 
 /**
  * Handle an epoll event caused by a registered IPC client. Read, process, and
@@ -292,7 +438,7 @@ void ipc_send_events(Monitor *mons, Monitor **lastselmon, Monitor *selmon);
  * @param ev Associated epoll event returned by epoll_wait
  * @param mons Address of Monitor pointing to start of linked list
  * @param selmon Address of selected Monitor
- * @param lastselmon Address of pointer to previously selected monitor
+ * @param lastselmon Array of previously selected monitors, per IPCDelivery
  * @param tags Array of tag names
  * @param tags_len Length of tags array
  * @param layouts Array of available layouts
@@ -306,6 +452,21 @@ int ipc_handle_client_epoll_event(struct epoll_event *ev, Monitor *mons,
                                   char *tags[], const int tags_len,
                                   const Layout *layouts, const int layouts_len);
 
+/**
+ * Handle a recorded message as if a client had sent it, for replaying event
+ * recordings; any reply is discarded. Takes the same parameters as
+ * ipc_handle_client_epoll_event, in place of its epoll event.
+ *
+ * @param msg_type Type of the recorded message
+ * @param msg Null terminated payload of the recorded message
+ *
+ * @return 0 if the message was handled, -1 otherwise
+ */
+int ipc_replay_message(IPCMessageType msg_type, char *msg, Monitor *mons,
+                       Monitor **lastselmon, Monitor *selmon,
+                       char *tags[], const int tags_len,
+                       const Layout *layouts, const int layouts_len);
+
 /**
  * Handle an epoll event caused by the IPC socket. This function only handles an
  * EPOLLIN event indicating a new client requesting to connect to the socket.
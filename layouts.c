@@ -0,0 +1,704 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdio.h>
+
+#include "layouts.h"
+
+#define MIN(A, B)               ((A) < (B) ? (A) : (B))
+#define WIDTH(X)                ((X)->w + 2 * (X)->bw)
+#define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
+
+static void fibonacci(LayoutParams *p, LayoutClient *lc, unsigned int n, int s);
+static void getfacts(LayoutParams *p, LayoutClient *lc, unsigned int n, int msize, int ssize, float *mf, float *sf, int *mr, int *sr);
+static void place(LayoutParams *p, LayoutClient *c, int x, int y, int w, int h);
+
+static void
+place(LayoutParams *p, LayoutClient *c, int x, int y, int w, int h)
+{
+	c->x = x;
+	c->y = y;
+	c->w = w;
+	c->h = h;
+	if (p->place)
+		p->place(p, c);
+}
+
+static void
+getfacts(LayoutParams *p, LayoutClient *lc, unsigned int n, int msize, int ssize, float *mf, float *sf, int *mr, int *sr)
+{
+	unsigned int i;
+	float mfacts = 0, sfacts = 0;
+	int mtotal = 0, stotal = 0;
+
+	for (i = 0; i < n; i++)
+		if (i < p->nmaster)
+			mfacts += lc[i].cfact;
+		else
+			sfacts += lc[i].cfact;
+
+	for (i = 0; i < n; i++)
+		if (i < p->nmaster)
+			mtotal += msize * (lc[i].cfact / mfacts);
+		else
+			stotal += ssize * (lc[i].cfact / sfacts);
+
+	*mf = mfacts; // total factor of master area
+	*sf = sfacts; // total factor of stack area
+	*mr = msize - mtotal; // the remainder (rest) of pixels after a cfacts master split
+	*sr = ssize - stotal; // the remainder (rest) of pixels after a cfacts stack split
+}
+
+/*
+ * Bottomstack layout + gaps
+ * https://dwm.suckless.org/patches/bottomstack/
+ */
+void
+layout_bstack(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int sx = 0, sy = 0, sh = 0, sw = 0;
+	float mfacts, sfacts;
+	int mrest, srest;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	sx = mx = p->wx + oh;
+	sy = my = p->wy + ov;
+	sh = mh = p->wh - 2*ov;
+	mw = p->ww - 2*oh - ih * (MIN(n, p->nmaster) - 1);
+	sw = p->ww - 2*oh - ih * (n - p->nmaster - 1);
+
+	if (p->nmaster && n > p->nmaster) {
+		sh = (mh - iv) * (1 - p->mfact);
+		mh = mh - sh - iv;
+		sx = mx;
+		sy = my + mh + iv;
+	}
+
+	getfacts(p, lc, n, mw, sw, &mfacts, &sfacts, &mrest, &srest);
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i < p->nmaster) {
+			place(p, c, mx,
+				p->mirror ? (p->wy + p->wh - (my - p->wy) - (mh - (2*c->bw))) : my,
+				mw * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw)
+			);
+			mx += WIDTH(c) + ih;
+		} else {
+			place(p, c, sx,
+				p->mirror ? (p->wy + p->wh - (sy - p->wy) - (sh - (2*c->bw))) : sy,
+				sw * (c->cfact / sfacts) + ((i - p->nmaster) < srest ? 1 : 0) - (2*c->bw), sh - (2*c->bw)
+			);
+			sx += WIDTH(c) + ih;
+		}
+	}
+}
+
+void
+layout_bstackhoriz(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int sx = 0, sy = 0, sh = 0, sw = 0;
+	float mfacts, sfacts;
+	int mrest, srest;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	sx = mx = p->wx + oh;
+	sy = my = p->wy + ov;
+	mh = p->wh - 2*ov;
+	sh = p->wh - 2*ov - iv * (n - p->nmaster - 1);
+	mw = p->ww - 2*oh - ih * (MIN(n, p->nmaster) - 1);
+	sw = p->ww - 2*oh;
+
+	if (p->nmaster && n > p->nmaster) {
+		sh = (mh - iv) * (1 - p->mfact);
+		mh = mh - sh - iv;
+		sy = my + mh + iv;
+		sh = p->wh - mh - 2*ov - iv * (n - p->nmaster);
+	}
+
+	getfacts(p, lc, n, mw, sh, &mfacts, &sfacts, &mrest, &srest);
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i < p->nmaster) {
+			place(p, c, mx,
+				p->mirror ? (p->wy + p->wh - (my - p->wy) - (mh - (2*c->bw))) : my,
+				mw * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw)
+			);
+			mx += WIDTH(c) + ih;
+		} else {
+			place(p, c, sx,
+				p->mirror ? (p->wy + p->wh - (sy - p->wy) - (sh * (c->cfact / sfacts) + ((i - p->nmaster) < srest ? 1 : 0) - (2*c->bw))) : sy,
+				sw - (2*c->bw), sh * (c->cfact / sfacts) + ((i - p->nmaster) < srest ? 1 : 0) - (2*c->bw)
+			);
+			sy += HEIGHT(c) + iv;
+		}
+	}
+}
+
+void
+layout_centredfloatingmaster(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	float mfacts, sfacts;
+	float mihf = 1.0; // master inner horizontal gap factor
+	int oh = p->oh, ov = p->ov, ih = p->ih;
+	int mrest, srest;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int sx = 0, sy = 0, sh = 0, sw = 0;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	sx = mx = p->wx + oh;
+	sy = my = p->wy + ov;
+	sh = mh = p->wh - 2*ov;
+	mw = p->ww - 2*oh - ih*(n - 1);
+	sw = p->ww - 2*oh - ih*(n - p->nmaster - 1);
+
+	if (p->nmaster && n > p->nmaster) {
+		mihf = 0.8;
+		/* go mfact box in the centre if more than nmaster clients */
+		if (p->ww > p->wh) {
+			mw = p->ww * p->mfact - ih*mihf*(MIN(n, p->nmaster) - 1);
+			mh = p->wh * 0.9;
+		} else {
+			mw = p->ww * 0.9 - ih*mihf*(MIN(n, p->nmaster) - 1);
+			mh = p->wh * p->mfact;
+		}
+		mx = p->wx + (p->ww - mw) / 2;
+		my = p->wy + (p->wh - mh) / 2;
+
+		sx = p->wx + oh;
+		sy = p->wy + ov;
+		sh = p->wh - 2*ov;
+	}
+
+	getfacts(p, lc, n, mw, sw, &mfacts, &sfacts, &mrest, &srest);
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i < p->nmaster) {
+			/* nmaster clients are stacked horizontally, in the centre of the screen */
+			place(p, c, mx, my, mw * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw));
+			mx += WIDTH(c) + ih*mihf;
+		} else {
+			/* stack clients are stacked horizontally */
+			place(p, c, sx, sy, sw * (c->cfact / sfacts) + ((i - p->nmaster) < srest ? 1 : 0) - (2*c->bw), sh - (2*c->bw));
+			sx += WIDTH(c) + ih;
+		}
+	}
+}
+
+/*
+ * Centred master layout + gaps
+ * https://dwm.suckless.org/patches/centeredmaster/
+ */
+void
+layout_centredmaster(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int lx = 0, ly = 0, lw = 0, lh = 0;
+	int rx = 0, ry = 0, rw = 0, rh = 0;
+	float mfacts = 0, lfacts = 0, rfacts = 0;
+	int mtotal = 0, ltotal = 0, rtotal = 0;
+	int mrest = 0, lrest = 0, rrest = 0;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	/* initialize areas */
+	mx = p->wx + oh;
+	my = p->wy + ov;
+	mh = p->wh - 2*ov - iv * ((!p->nmaster ? n : MIN(n, p->nmaster)) - 1);
+	mw = p->ww - 2*oh;
+	lh = p->wh - 2*ov - iv * (((n - p->nmaster) / 2) - 1);
+	rh = p->wh - 2*ov - iv * (((n - p->nmaster) / 2) - ((n - p->nmaster) % 2 ? 0 : 1));
+
+	if (p->nmaster && n > p->nmaster) {
+		/* go mfact box in the centre if more than nmaster clients */
+		if (n - p->nmaster > 1) {
+			/* ||<-S->|<---M--->|<-S->|| */
+			mw = (p->ww - 2*oh - 2*ih) * p->mfact;
+			lw = (p->ww - mw - 2*oh - 2*ih) / 2;
+			rw = (p->ww - mw - 2*oh - 2*ih) - lw;
+			mx += lw + ih;
+		} else {
+			/* ||<---M--->|<-S->|| */
+			mw = (mw - ih) * p->mfact;
+			lw = 0;
+			rw = p->ww - mw - ih - 2*oh;
+		}
+		lx = p->wx + oh;
+		ly = p->wy + ov;
+		rx = mx + mw + ih;
+		ry = p->wy + ov;
+	}
+
+	/* calculate facts */
+	for (i = 0; i < n; i++) {
+		if (!p->nmaster || i < p->nmaster)
+			mfacts += lc[i].cfact;
+		else if ((i - p->nmaster) % 2)
+			lfacts += lc[i].cfact; // total factor of left hand stack area
+		else
+			rfacts += lc[i].cfact; // total factor of right hand stack area
+	}
+
+	for (i = 0; i < n; i++)
+		if (!p->nmaster || i < p->nmaster)
+			mtotal += mh * (lc[i].cfact / mfacts);
+		else if ((i - p->nmaster) % 2)
+			ltotal += lh * (lc[i].cfact / lfacts);
+		else
+			rtotal += rh * (lc[i].cfact / rfacts);
+
+	mrest = mh - mtotal;
+	lrest = lh - ltotal;
+	rrest = rh - rtotal;
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (!p->nmaster || i < p->nmaster) {
+			/* nmaster clients are stacked vertically, in the centre of the screen */
+			place(p, c, mx, my, mw - (2*c->bw), mh * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw));
+			my += HEIGHT(c) + iv;
+		} else {
+			/* stack clients are stacked vertically */
+			if ((i - p->nmaster) % 2 ) {
+				place(p, c, lx, ly, lw - (2*c->bw), lh * (c->cfact / lfacts) + ((i - 2*p->nmaster) < 2*lrest ? 1 : 0) - (2*c->bw));
+				ly += HEIGHT(c) + iv;
+			} else {
+				place(p, c, rx, ry, rw - (2*c->bw), rh * (c->cfact / rfacts) + ((i - 2*p->nmaster) < 2*rrest ? 1 : 0) - (2*c->bw));
+				ry += HEIGHT(c) + iv;
+			}
+		}
+	}
+}
+
+/*
+ * Deck layout + gaps
+ * https://dwm.suckless.org/patches/deck/
+ */
+void
+layout_deck(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int sx = 0, sy = 0, sh = 0, sw = 0;
+	float mfacts, sfacts;
+	int mrest, srest;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	sx = mx = p->wx + oh;
+	sy = my = p->wy + ov;
+	sh = mh = p->wh - 2*ov - iv * (MIN(n, p->nmaster) - 1);
+	sw = mw = p->ww - 2*oh;
+
+	if (p->nmaster && n > p->nmaster) {
+		sw = (mw - ih) * (1 - p->mfact);
+		mw = mw - sw - ih;
+		sh = p->wh - 2*ov;
+		if (p->mirror) {
+			mx += sw + ih;
+			sx = p->wx + oh;
+		}
+		else
+			sx = mx + mw + ih;
+	}
+
+	getfacts(p, lc, n, mh, sh, &mfacts, &sfacts, &mrest, &srest);
+
+	if ((int)n - p->nmaster > 0) /* override layout symbol */
+		snprintf(p->ltsymbol, sizeof p->ltsymbol, "D [%d]", n - p->nmaster);
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i < p->nmaster) {
+			place(p, c, mx, my, mw - (2*c->bw), mh * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw));
+			my += HEIGHT(c) + iv;
+		} else {
+			place(p, c, sx, sy, sw - (2*c->bw), sh - (2*c->bw));
+		}
+	}
+}
+
+/*
+ * Fibonacci layout + gaps
+ * https://dwm.suckless.org/patches/fibonacci/
+ */
+static void
+fibonacci(LayoutParams *p, LayoutClient *lc, unsigned int n, int s)
+{
+	unsigned int i, j;
+	int nx, ny, nw, nh;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int nv, hrest = 0, wrest = 0, r = 1;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	nx = p->wx + oh;
+	ny = p->wy + ov;
+	nw = p->ww - 2*oh;
+	nh = p->wh - 2*ov;
+
+	for (i = 0, j = 0; j < n; j++) {
+		c = &lc[j];
+		if (r) {
+			if ((i % 2 && (nh - iv) / 2 <= (p->bh + 2*c->bw)) || (!(i % 2) && (nw - ih) / 2 <= (p->bh + 2*c->bw))) {
+				r = 0;
+			}
+			if (r && i < n - 1) {
+				if (i % 2) {
+					nv = (nh - iv) / 2;
+					hrest = nh - 2*nv - iv;
+					nh = nv;
+				} else {
+					nv = (nw - ih) / 2;
+					wrest = nw - 2*nv - ih;
+					nw = nv;
+				}
+
+				if ((i % 4) == 2 && !s)
+					nx += nw + ih;
+				else if ((i % 4) == 3 && !s)
+					ny += nh + iv;
+			}
+
+			if ((i % 4) == 0) {
+				if (s) {
+					ny += nh + iv;
+					nh += hrest;
+				}
+				else {
+					nh -= hrest;
+					ny -= nh + iv;
+				}
+			}
+			else if ((i % 4) == 1) {
+				nx += nw + ih;
+				nw += wrest;
+			}
+			else if ((i % 4) == 2) {
+				ny += nh + iv;
+				nh += hrest;
+				if (i < n - 1)
+					nw += wrest;
+			}
+			else if ((i % 4) == 3) {
+				if (s) {
+					nx += nw + ih;
+					nw -= wrest;
+				} else {
+					nw -= wrest;
+					nx -= nw + ih;
+					nh += hrest;
+				}
+			}
+			if (i == 0)	{
+				if (n != 1) {
+					nw = (p->ww - ih - 2*oh) - (p->ww - ih - 2*oh) * (1 - p->mfact);
+					wrest = 0;
+				}
+				ny = p->wy + ov;
+			}
+			else if (i == 1)
+				nw = p->ww - nw - ih - 2*oh;
+			i++;
+		}
+
+		place(p, c,
+			p->mirror ? (p->wx + p->ww - (nx - p->wx) - nw - (2*c->bw)) : nx,
+			ny, nw - (2*c->bw), nh - (2*c->bw)
+		);
+	}
+}
+
+void
+layout_dwindle(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	fibonacci(p, lc, n, 1);
+}
+
+/*
+ * Gappless grid layout + gaps (ironically)
+ * https://dwm.suckless.org/patches/gaplessgrid/
+ */
+void
+layout_gaplessgrid(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int x, y, cols, rows, ch, cw, cn, rn, rrest, crest; // counters
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	/* grid dimensions */
+	for (cols = 0; cols <= n/2; cols++)
+		if (cols*cols >= n)
+			break;
+	if (n == 5) /* set layout against the general calculation: not 1:2:2, but 2:3 */
+		cols = 2;
+	rows = n/cols;
+	cn = rn = 0; // reset column no, row no, client count
+
+	ch = (p->wh - 2*ov - iv * (rows - 1)) / rows;
+	cw = (p->ww - 2*oh - ih * (cols - 1)) / cols;
+	rrest = (p->wh - 2*ov - iv * (rows - 1)) - ch * rows;
+	crest = (p->ww - 2*oh - ih * (cols - 1)) - cw * cols;
+	x = p->wx + oh;
+	y = p->wy + ov;
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i/rows + 1 > cols - n%cols) {
+			rows = n/cols + 1;
+			ch = (p->wh - 2*ov - iv * (rows - 1)) / rows;
+			rrest = (p->wh - 2*ov - iv * (rows - 1)) - ch * rows;
+		}
+		place(p, c,
+			x,
+			y + rn*(ch + iv) + MIN(rn, rrest),
+			cw + (cn < crest ? 1 : 0) - 2*c->bw,
+			ch + (rn < rrest ? 1 : 0) - 2*c->bw
+		);
+		rn++;
+		if (rn >= rows) {
+			rn = 0;
+			x += cw + ih + (cn < crest ? 1 : 0);
+			cn++;
+		}
+	}
+}
+
+/*
+ * Gridmode layout + gaps
+ * https://dwm.suckless.org/patches/gridmode/
+ */
+void
+layout_grid(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int cx, cy, cw, ch, cc, cr, chrest, cwrest, cols, rows;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	LayoutClient *c;
+
+	/* grid dimensions */
+	for (rows = 0; rows <= n/2; rows++)
+		if (rows*rows >= n)
+			break;
+	cols = (rows && (rows - 1) * rows >= n) ? rows - 1 : rows;
+
+	/* window geoms (cell height/width) */
+	ch = (p->wh - 2*ov - iv * (rows - 1)) / (rows ? rows : 1);
+	cw = (p->ww - 2*oh - ih * (cols - 1)) / (cols ? cols : 1);
+	chrest = (p->wh - 2*ov - iv * (rows - 1)) - ch * rows;
+	cwrest = (p->ww - 2*oh - ih * (cols - 1)) - cw * cols;
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		cc = i / rows;
+		cr = i % rows;
+		cx = p->wx + oh + cc * (cw + ih) + MIN(cc, cwrest);
+		cy = p->wy + ov + cr * (ch + iv) + MIN(cr, chrest);
+		place(p, c, cx, cy, cw + (cc < cwrest ? 1 : 0) - 2*c->bw, ch + (cr < chrest ? 1 : 0) - 2*c->bw);
+	}
+}
+
+/*
+ * Horizontal grid layout + gaps
+ * https://dwm.suckless.org/patches/horizgrid/
+ */
+void
+layout_horizgrid(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	LayoutClient *c;
+	unsigned int i;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int sx = 0, sy = 0, sh = 0, sw = 0;
+	int ntop;
+	int nbottom = 1;
+	float mfacts = 0, sfacts = 0;
+	int mrest, srest, mtotal = 0, stotal = 0;
+
+	if (n == 0)
+		return;
+
+	if (n <= 2)
+		ntop = n;
+	else {
+		ntop = n / 2;
+		nbottom = n - ntop;
+	}
+	sx = mx = p->wx + oh;
+	sy = my = p->wy + ov;
+	sh = mh = p->wh - 2*ov;
+	sw = mw = p->ww - 2*oh;
+
+	if (n > ntop) {
+		sh = (mh - iv) / 2;
+		mh = mh - sh - iv;
+		sy = my + mh + iv;
+		mw = p->ww - 2*oh - ih * (ntop - 1);
+		sw = p->ww - 2*oh - ih * (nbottom - 1);
+	}
+
+	/* calculate facts */
+	for (i = 0; i < n; i++)
+		if (i < ntop)
+			mfacts += lc[i].cfact;
+		else
+			sfacts += lc[i].cfact;
+
+	for (i = 0; i < n; i++)
+		if (i < ntop)
+			mtotal += mh * (lc[i].cfact / mfacts);
+		else
+			stotal += sw * (lc[i].cfact / sfacts);
+
+	mrest = mh - mtotal;
+	srest = sw - stotal;
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i < ntop) {
+			place(p, c, mx, my, mw * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw));
+			mx += WIDTH(c) + ih;
+		} else {
+			place(p, c, sx, sy, sw * (c->cfact / sfacts) + ((i - ntop) < srest ? 1 : 0) - (2*c->bw), sh - (2*c->bw));
+			sx += WIDTH(c) + ih;
+		}
+	}
+}
+
+/*
+ * nrowgrid layout + gaps
+ * https://dwm.suckless.org/patches/nrowgrid/
+ */
+void
+layout_nrowgrid(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int ri = 0, ci = 0;  /* counters */
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	unsigned int cx, cy, cw, ch;                /* client geometry */
+	unsigned int uw = 0, uh = 0, uc = 0;        /* utilization trackers */
+	unsigned int cols, rows = p->nmaster + 1;
+	LayoutClient *c;
+
+	/* nothing to do here */
+	if (n == 0)
+		return;
+
+	/* force 2 clients to always split vertically */
+	if (p->forcevsplit && n == 2)
+		rows = 1;
+
+	/* never allow empty rows */
+	if (n < rows)
+		rows = n;
+
+	/* define first row */
+	cols = n / rows;
+	uc = cols;
+	cy = p->wy + ov;
+	ch = (p->wh - 2*ov - iv*(rows - 1)) / rows;
+	uh = ch;
+
+	for (i = 0; i < n; i++, ci++) {
+		c = &lc[i];
+		if (ci == cols) {
+			uw = 0;
+			ci = 0;
+			ri++;
+
+			/* next row */
+			cols = (n - uc) / (rows - ri);
+			uc += cols;
+			cy = p->wy + uh + ov + iv;
+			uh += ch + iv;
+		}
+
+		cx = p->wx + uw + oh;
+		cw = (p->ww - 2*oh - uw) / (cols - ci);
+		uw += cw + ih;
+
+		place(p, c, cx, cy, cw - (2*c->bw), ch - (2*c->bw));
+	}
+}
+
+void
+layout_spiral(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	fibonacci(p, lc, n, 0);
+}
+
+/*
+ * Default tile layout + gaps
+ */
+void
+layout_tile(LayoutParams *p, LayoutClient *lc, unsigned int n)
+{
+	unsigned int i;
+	int oh = p->oh, ov = p->ov, ih = p->ih, iv = p->iv;
+	int mx = 0, my = 0, mh = 0, mw = 0;
+	int sx = 0, sy = 0, sh = 0, sw = 0;
+	float mfacts, sfacts;
+	int mrest, srest;
+	LayoutClient *c;
+
+	if (n == 0)
+		return;
+
+	sx = mx = p->wx + oh;
+	sy = my = p->wy + ov;
+	mh = p->wh - 2*ov - iv * (MIN(n, p->nmaster) - 1);
+	sh = p->wh - 2*ov - iv * (n - p->nmaster - 1);
+	sw = mw = p->ww - 2*oh;
+
+	if (p->nmaster && n > p->nmaster) {
+		sw = (mw - ih) * (1 - p->mfact);
+		mw = mw - sw - ih;
+		if (p->mirror) {
+			mx = p->wx + p->ww - mw - oh;
+			sx = p->wx + oh;
+		}
+		else
+			sx = mx + mw + ih;
+	}
+
+	getfacts(p, lc, n, mh, sh, &mfacts, &sfacts, &mrest, &srest);
+
+	for (i = 0; i < n; i++) {
+		c = &lc[i];
+		if (i < p->nmaster) {
+			place(p, c, mx, my, mw - (2*c->bw), mh * (c->cfact / mfacts) + (i < mrest ? 1 : 0) - (2*c->bw));
+			my += HEIGHT(c) + iv;
+		} else {
+			place(p, c, sx, sy, sw - (2*c->bw), sh * (c->cfact / sfacts) + ((i - p->nmaster) < srest ? 1 : 0) - (2*c->bw));
+			sy += HEIGHT(c) + iv;
+		}
+	}
+}
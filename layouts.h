@@ -0,0 +1,49 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * Tiling layout engine
+ *
+ * The layout functions only compute geometry; they know nothing about X or
+ * dwm's Client and Monitor, so they can be benchmarked headless.
+ * vanitygaps.c adapts them to dwm, applying each result through resize().
+ */
+
+typedef struct LayoutClient LayoutClient;
+typedef struct LayoutParams LayoutParams;
+
+struct LayoutClient {
+	int x, y, w, h;			// resulting geometry, excluding the border;
+	int bw;					// border width;
+	float cfact;			// client scale factor, 1.0 without cfacts;
+	void *data;				// caller's client;
+};
+
+struct LayoutParams {
+	int wx, wy, ww, wh;		// work area;
+	int oh, ov, ih, iv;		// effective outer/inner gaps, 0 without gaps;
+	float mfact;
+	int nmaster;
+	int mirror;				// swap master and stack sides;
+	int bh;					// bar height, the smallest fibonacci split;
+	int forcevsplit;		// nrowgrid: always split 2 clients vertically;
+	char ltsymbol[16];		// set by layouts that override the layout symbol;
+	// called as each client is laid out; it may adjust the geometry in place
+	// (e.g. for size hints) before the next client is positioned against it;
+	void (*place)(LayoutParams *p, LayoutClient *c);
+	void *data;				// caller's context;
+};
+
+typedef void (*LayoutFunc)(LayoutParams *p, LayoutClient *lc, unsigned int n);
+
+void layout_bstack(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_bstackhoriz(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_centredfloatingmaster(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_centredmaster(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_deck(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_dwindle(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_gaplessgrid(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_grid(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_horizgrid(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_nrowgrid(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_spiral(LayoutParams *p, LayoutClient *lc, unsigned int n);
+void layout_tile(LayoutParams *p, LayoutClient *lc, unsigned int n);
@@ -17,6 +17,7 @@
 #define PATCH_CROP_WINDOWS					1
 #define PATCH_CUSTOM_TAG_ICONS				1	// Enable per-tag a user-specified icon in place of tag number (alt-tag);
 #define PATCH_DRAG_FACTS					1
+#define PATCH_EVENT_RECORDING				1	// record the handled X events and IPC messages to a file, and replay them, depends on PATCH_IPC;
 #define PATCH_EWMH_TAGS						0	// Supports reporting workspace(tag) changes;
 #define PATCH_EXTERNAL_WINDOW_ACTIVATION	1	// Behaves like spawn except will allow focus stealing for the life of the spawnee;
 #define PATCH_FOCUS_BORDER					0
@@ -25,6 +26,7 @@
 #define PATCH_FONT_GROUPS					1
 #define PATCH_HANDLE_SIGNALS				1	// respond appropriately to signals;
 #define PATCH_HIDE_VACANT_TAGS				1
+#define PATCH_HOT_RELOAD					1	// reload the rules/layout files when they change on disk, depends on PATCH_IPC;
 #define PATCH_IPC							1	// socket-based message handling;
 #define PATCH_KEY_HOLD						1	// shortcut hold option to trigger extra action;
 #define PATCH_KEY_HOLD_TO_REVERT_VIEW		1 	// hold to switch back to the monitor/view active at the point the key was pressed;
@@ -0,0 +1,701 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Event recording and replay.
+ *
+ * dwm -e <file> records every X event dispatched to a handler, and every IPC
+ * message handled, with its time into a binary file. dwm -E <file> replays
+ * such a recording through the same handlers on the display it was started on,
+ * normally an Xvfb or Xephyr server, and reports the time spent per event.
+ *
+ * A recording is a RecordFileHeader, then records, each a RecordHeader and
+ * len bytes of payload, padded to RECORD_ALIGN so they can be read in place:
+ *   RecState   a RecordState, then the bar windows and dwm's atoms; written
+ *              whenever dwm (re)starts, so windows and atoms can be translated;
+ *   RecWindow  a RecordWindow, then the class, instance, title and window type
+ *              name, each null terminated; written for every client managed
+ *              when dwm (re)starts, and for each window on its MapRequest;
+ *   RecXEvent  the XEvent, truncated to the size of its type's struct;
+ *   RecNested  an event read by a handler's own event loop, like movemouse();
+ *   RecIPC     the IPC message payload.
+ *
+ * The replay creates the recorded client windows from a forked process with
+ * its own connection, so dwm manages, signals and kills them as it would any
+ * client, and destroys or unmaps them there before the events that report it.
+ * Each event is dispatched with its windows and atoms translated, after the
+ * nested events that follow it have been put back in front of the queue. The
+ * live events that dwm's own requests cause are discarded, as the recording
+ * already holds those that mattered. Window properties other than those in the
+ * RecWindow record are not recorded, so property changes are replayed with the
+ * window's synthetic values.
+ */
+
+#define RECORD_MAGIC			"dwmrec2"
+#define RECORD_ALIGN			8		// of the headers and payloads, as the XEvent's longs and pointers;
+#define RECORD_PADDED(len)		(((len) + RECORD_ALIGN - 1) & ~(uint32_t)(RECORD_ALIGN - 1))
+#define REPLAY_SLOWEST			10
+
+enum { RecState, RecWindow, RecXEvent, RecNested, RecIPC };	// RecordHeader kind;
+enum { ReplayCreate, ReplayDestroy, ReplayUnmap };			// requests to the replay clients;
+
+typedef struct {
+	char magic[8];
+	uint32_t xeventsize;		// sizeof(XEvent) of the recording build;
+	uint32_t natoms;			// atoms in its RecState records;
+} RecordFileHeader;
+
+typedef struct {
+	uint64_t ns;				// since the recording started;
+	uint32_t len;				// bytes of payload that follow;
+	uint16_t type;				// X event or IPC message type;
+	uint8_t kind;
+	uint8_t pad;
+} RecordHeader;
+
+typedef struct {
+	uint64_t root;
+	uint32_t nbars;				// bar windows that follow, in monitor order;
+	uint32_t natoms;			// wmatom, netatom and xatom values that follow the bars;
+} RecordState;
+
+typedef struct {
+	uint64_t win;
+	uint64_t transient;			// WM_TRANSIENT_FOR, or None;
+	int16_t x, y;
+	uint16_t w, h;
+	uint8_t managed;			// already managed, so the replay maps it itself;
+	uint8_t pad[7];
+} RecordWindow;
+
+typedef struct {
+	double ms;
+	unsigned long index;		// of the record;
+	uint64_t ns;
+	int type;
+	int ipc;
+} ReplaySlow;
+
+// bytes of each event type recorded, 0 for those that aren't;
+static const unsigned short recordsizes[LASTEvent] = {
+	[KeyPress] = sizeof(XKeyEvent),
+	[KeyRelease] = sizeof(XKeyEvent),
+	[ButtonPress] = sizeof(XButtonEvent),
+	[ButtonRelease] = sizeof(XButtonEvent),
+	[MotionNotify] = sizeof(XMotionEvent),
+	[EnterNotify] = sizeof(XCrossingEvent),
+	[LeaveNotify] = sizeof(XCrossingEvent),
+	[FocusIn] = sizeof(XFocusChangeEvent),
+	[FocusOut] = sizeof(XFocusChangeEvent),
+	[Expose] = sizeof(XExposeEvent),
+	[DestroyNotify] = sizeof(XDestroyWindowEvent),
+	[UnmapNotify] = sizeof(XUnmapEvent),
+	[MapNotify] = sizeof(XMapEvent),
+	[MapRequest] = sizeof(XMapRequestEvent),
+	[ConfigureNotify] = sizeof(XConfigureEvent),
+	[ConfigureRequest] = sizeof(XConfigureRequestEvent),
+	[ResizeRequest] = sizeof(XResizeRequestEvent),
+	[PropertyNotify] = sizeof(XPropertyEvent),
+	[ClientMessage] = sizeof(XClientMessageEvent),
+	[MappingNotify] = sizeof(XMappingEvent),
+};
+
+static const char *record_filename = NULL;
+static const char *replay_filename = NULL;
+static FILE *recordfile = NULL;
+static struct timespec recordstarted;
+
+static Window (*replaywins)[2] = NULL;		// recorded window, and the replay's;
+static unsigned int nreplaywins = 0;
+static uint64_t *replayatoms = NULL;		// recorded atoms, in the order of dwm's;
+static unsigned int nreplayatoms = 0;
+static int replayfd = -1;					// socket to the replay clients process;
+
+static void
+recordwrite(int kind, int type, const void *payload, uint32_t len)
+{
+	static const char padding[RECORD_ALIGN] = { 0 };
+	RecordHeader h = { 0 };
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	h.ns = (now.tv_sec - recordstarted.tv_sec) * 1000000000ULL + now.tv_nsec - recordstarted.tv_nsec;
+	h.len = len;
+	h.type = type;
+	h.kind = kind;
+	if (fwrite(&h, sizeof(h), 1, recordfile) != 1 || (len && fwrite(payload, len, 1, recordfile) != 1)
+	|| (RECORD_PADDED(len) != len && fwrite(padding, RECORD_PADDED(len) - len, 1, recordfile) != 1)) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: unable to write to event recording \"%s\", stopping the recording.\n", record_filename);
+		recordstop();
+	}
+}
+
+int
+recordstart(const char *filename)
+{
+	RecordFileHeader h = { RECORD_MAGIC, sizeof(XEvent), WMLast + NetLast + XLast };
+
+	if (!(recordfile = fopen(filename, "wb"))) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: unable to record events to \"%s\": %s\n", filename, strerror(errno));
+		return 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &recordstarted);
+	if (fwrite(&h, sizeof(h), 1, recordfile) != 1) {
+		fclose(recordfile);
+		recordfile = NULL;
+		return 0;
+	}
+	logdatetime(stderr);
+	fprintf(stderr, "dwm: recording events to \"%s\".\n", filename);
+	return 1;
+}
+
+void
+recordstate(void)
+{
+	unsigned int i, nbars = 0, natoms = WMLast + NetLast + XLast;
+	Monitor *m;
+	Client *c;
+	RecordState *rs;
+	uint64_t *ids;
+
+	if (!recordfile)
+		return;
+	for (m = mons; m; m = m->next)
+		nbars++;
+	if (!(rs = calloc(1, sizeof(RecordState) + (nbars + natoms) * sizeof(uint64_t))))
+		return;
+	rs->root = root;
+	rs->nbars = nbars;
+	rs->natoms = natoms;
+	ids = (uint64_t *)(rs + 1);
+	for (m = mons; m; m = m->next)
+		*ids++ = m->barwin;
+	for (i = 0; i < WMLast; i++)
+		*ids++ = wmatom[i];
+	for (i = 0; i < NetLast; i++)
+		*ids++ = netatom[i];
+	for (i = 0; i < XLast; i++)
+		*ids++ = xatom[i];
+	recordwrite(RecState, 0, rs, sizeof(RecordState) + (nbars + natoms) * sizeof(uint64_t));
+	free(rs);
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			recordwindow(c->win, 1);
+	fflush(recordfile);
+}
+
+void
+recordwindow(Window w, int managed)
+{
+	XWindowAttributes wa;
+	XClassHint ch = { NULL, NULL };
+	Window trans = None;
+	Atom wtype;
+	char title[256] = "", *typename = NULL, *buffer;
+	RecordWindow rw = { 0 };
+	size_t len;
+
+	if (!XGetWindowAttributes(dpy, w, &wa))
+		return;
+	XGetClassHint(dpy, w, &ch);
+	XGetTransientForHint(dpy, w, &trans);
+	if (!gettextprop(w, netatom[NetWMName], title, sizeof(title)))
+		gettextprop(w, XA_WM_NAME, title, sizeof(title));
+	if ((wtype = getatompropex(w, netatom[NetWMWindowType])) != None)
+		typename = XGetAtomName(dpy, wtype);
+
+	rw.win = w;
+	rw.transient = trans;
+	rw.x = wa.x;
+	rw.y = wa.y;
+	rw.w = wa.width;
+	rw.h = wa.height;
+	rw.managed = managed;
+	len = sizeof(rw)
+		+ strlen(ch.res_class ? ch.res_class : "") + 1
+		+ strlen(ch.res_name ? ch.res_name : "") + 1
+		+ strlen(title) + 1
+		+ strlen(typename ? typename : "") + 1;
+	if ((buffer = malloc(len))) {
+		memcpy(buffer, &rw, sizeof(rw));
+		sprintf(buffer + sizeof(rw), "%s%c%s%c%s%c%s",
+			ch.res_class ? ch.res_class : "", '\0',
+			ch.res_name ? ch.res_name : "", '\0',
+			title, '\0',
+			typename ? typename : ""
+		);
+		recordwrite(RecWindow, 0, buffer, len);
+		free(buffer);
+	}
+
+	if (ch.res_class)
+		XFree(ch.res_class);
+	if (ch.res_name)
+		XFree(ch.res_name);
+	if (typename)
+		XFree(typename);
+}
+
+void
+recordevent(XEvent *ev, int nested)
+{
+	if (!recordfile || ev->type >= LASTEvent || !recordsizes[ev->type])
+		return;
+	if (ev->type == MapRequest && !nested)
+		recordwindow(ev->xmaprequest.window, 0);
+	recordwrite(nested ? RecNested : RecXEvent, ev->type, ev, recordsizes[ev->type]);
+}
+
+void
+recordipc(IPCMessageType type, const char *msg, uint32_t size)
+{
+	if (recordfile)
+		recordwrite(RecIPC, type, msg, size);
+}
+
+void
+recordstop(void)
+{
+	if (!recordfile)
+		return;
+	fclose(recordfile);
+	recordfile = NULL;
+}
+
+// the replay clients process: creates, destroys and unmaps windows on request;
+static void
+replayclients(int fd)
+{
+	Display *d;
+	Window w;
+	Atom atom, wmdelete, netwmname, netwmtype, utf8string;
+	XClassHint ch;
+	XEvent ev;
+	uint32_t req[2];
+	uint64_t reply;
+	char *buffer = NULL;
+	const char *class, *instance, *title, *type;
+	RecordWindow *rw;
+
+	if (!(d = XOpenDisplay(NULL)))
+		_exit(EXIT_FAILURE);
+	wmdelete = XInternAtom(d, "WM_DELETE_WINDOW", False);
+	netwmname = XInternAtom(d, "_NET_WM_NAME", False);
+	netwmtype = XInternAtom(d, "_NET_WM_WINDOW_TYPE", False);
+	utf8string = XInternAtom(d, "UTF8_STRING", False);
+
+	while (recv(fd, req, sizeof(req), MSG_WAITALL) == sizeof(req)) {
+		if (!(buffer = realloc(buffer, req[1] + 1)) || recv(fd, buffer, req[1], MSG_WAITALL) != req[1])
+			break;
+		buffer[req[1]] = '\0';
+		reply = 0;
+		switch (req[0]) {
+			case ReplayCreate:
+				rw = (RecordWindow *)buffer;
+				class = buffer + sizeof(RecordWindow);
+				instance = class + strlen(class) + 1;
+				title = instance + strlen(instance) + 1;
+				type = title + strlen(title) + 1;
+				w = XCreateSimpleWindow(d, DefaultRootWindow(d), rw->x, rw->y, MAX(rw->w, 1), MAX(rw->h, 1), 0, 0, 0);
+				ch.res_class = (char *)class;
+				ch.res_name = (char *)instance;
+				XSetClassHint(d, w, &ch);
+				XStoreName(d, w, title);
+				XChangeProperty(d, w, netwmname, utf8string, 8, PropModeReplace, (unsigned char *)title, strlen(title));
+				// so killclient() asks, rather than kills this process's connection;
+				XSetWMProtocols(d, w, &wmdelete, 1);
+				if (rw->transient)
+					XSetTransientForHint(d, w, rw->transient);
+				if (*type) {
+					atom = XInternAtom(d, type, False);
+					XChangeProperty(d, w, netwmtype, XA_ATOM, 32, PropModeReplace, (unsigned char *)&atom, 1);
+				}
+				reply = w;
+				break;
+			case ReplayDestroy:
+				XDestroyWindow(d, *(uint64_t *)buffer);
+				break;
+			case ReplayUnmap:
+				XUnmapWindow(d, *(uint64_t *)buffer);
+				break;
+		}
+		XSync(d, False);
+		while (XPending(d))
+			XNextEvent(d, &ev);
+		if (write(fd, &reply, sizeof(reply)) != sizeof(reply))
+			break;
+	}
+	XCloseDisplay(d);
+	_exit(EXIT_SUCCESS);
+}
+
+// send a request to the replay clients process, returning its reply;
+static uint64_t
+replayrequest(uint32_t op, const void *payload, uint32_t len)
+{
+	uint32_t req[2] = { op, len };
+	uint64_t reply;
+
+	if (replayfd == -1)
+		return 0;
+	if (send(replayfd, req, sizeof(req), MSG_NOSIGNAL) != sizeof(req)
+	|| send(replayfd, payload, len, MSG_NOSIGNAL) != len
+	|| recv(replayfd, &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply)) {
+		logdatetime(stderr);
+		fputs("dwm: lost the replay clients process; the remaining windows aren't replayed.\n", stderr);
+		close(replayfd);
+		replayfd = -1;
+		return 0;
+	}
+	return reply;
+}
+
+static void
+replaymap(Window from, Window to)
+{
+	unsigned int i;
+	Window (*wins)[2];
+
+	for (i = 0; i < nreplaywins; i++)
+		if (replaywins[i][0] == from) {
+			replaywins[i][1] = to;
+			return;
+		}
+	if (!(nreplaywins & (nreplaywins - 1))) {
+		if (!(wins = realloc(replaywins, (nreplaywins ? nreplaywins * 2 : 64) * sizeof(*replaywins))))
+			return;
+		replaywins = wins;
+	}
+	replaywins[nreplaywins][0] = from;
+	replaywins[nreplaywins++][1] = to;
+}
+
+// the replay's window for a recorded window; those unknown are passed through;
+static Window
+replaywin(Window w)
+{
+	unsigned int i;
+
+	if (w == None)
+		return None;
+	for (i = 0; i < nreplaywins; i++)
+		if (replaywins[i][0] == w)
+			return replaywins[i][1];
+	return w;
+}
+
+// the replay's atom for a recorded atom, or None if dwm didn't intern it;
+static Atom
+replayatom(Atom a)
+{
+	unsigned int i;
+
+	if (a <= XA_LAST_PREDEFINED)
+		return a;
+	for (i = 0; i < nreplayatoms; i++)
+		if (replayatoms[i] == a)
+			return i < WMLast ? wmatom[i] : i < WMLast + NetLast ? netatom[i - WMLast] : xatom[i - WMLast - NetLast];
+	return None;
+}
+
+static int
+replaystate(const RecordState *rs, uint32_t len)
+{
+	const uint64_t *ids = (const uint64_t *)(rs + 1);
+	unsigned int i;
+	Monitor *m;
+
+	if (len < sizeof(RecordState) || len != sizeof(RecordState) + (rs->nbars + rs->natoms) * sizeof(uint64_t)
+	|| rs->natoms != WMLast + NetLast + XLast)
+		return 0;
+	replaymap(rs->root, root);
+	for (i = 0, m = mons; i < rs->nbars; i++, m = m ? m->next : NULL)
+		replaymap(ids[i], m ? m->barwin : None);
+	free(replayatoms);
+	if (!(replayatoms = malloc(rs->natoms * sizeof(uint64_t))))
+		return 0;
+	memcpy(replayatoms, ids + rs->nbars, rs->natoms * sizeof(uint64_t));
+	nreplayatoms = rs->natoms;
+	return 1;
+}
+
+static void
+replaywindow(RecordWindow *rw, uint32_t len)
+{
+	XMapRequestEvent mr = { .type = MapRequest, .display = dpy, .parent = root };
+	Window w;
+
+	if (len < sizeof(RecordWindow))
+		return;
+	// a withdrawn window being mapped again;
+	if ((w = replaywin(rw->win)) != rw->win && w != None)
+		return;
+	rw->transient = replaywin(rw->transient);
+	if (!(w = replayrequest(ReplayCreate, rw, len)))
+		return;
+	replaymap(rw->win, w);
+	// clients that were managed already are set up without being timed;
+	if (rw->managed) {
+		mr.window = w;
+		maprequest((XEvent *)&mr);
+	}
+}
+
+static void
+replaytranslate(XEvent *ev)
+{
+	ev->xany.display = dpy;
+	ev->xany.window = replaywin(ev->xany.window);
+	switch (ev->type) {
+		case KeyPress:
+		case KeyRelease:
+			ev->xkey.root = root;
+			ev->xkey.subwindow = replaywin(ev->xkey.subwindow);
+			break;
+		case ButtonPress:
+		case ButtonRelease:
+			ev->xbutton.root = root;
+			ev->xbutton.subwindow = replaywin(ev->xbutton.subwindow);
+			break;
+		case MotionNotify:
+			ev->xmotion.root = root;
+			ev->xmotion.subwindow = replaywin(ev->xmotion.subwindow);
+			break;
+		case EnterNotify:
+		case LeaveNotify:
+			ev->xcrossing.root = root;
+			ev->xcrossing.subwindow = replaywin(ev->xcrossing.subwindow);
+			break;
+		case MapRequest:
+			ev->xmaprequest.window = replaywin(ev->xmaprequest.window);
+			break;
+		case ConfigureRequest:
+			ev->xconfigurerequest.window = replaywin(ev->xconfigurerequest.window);
+			ev->xconfigurerequest.above = replaywin(ev->xconfigurerequest.above);
+			break;
+		case ConfigureNotify:
+			ev->xconfigure.window = replaywin(ev->xconfigure.window);
+			ev->xconfigure.above = replaywin(ev->xconfigure.above);
+			break;
+		case DestroyNotify:
+			ev->xdestroywindow.window = replaywin(ev->xdestroywindow.window);
+			break;
+		case UnmapNotify:
+			ev->xunmap.window = replaywin(ev->xunmap.window);
+			break;
+		case MapNotify:
+			ev->xmap.window = replaywin(ev->xmap.window);
+			break;
+		case PropertyNotify:
+			ev->xproperty.atom = replayatom(ev->xproperty.atom);
+			break;
+		case ClientMessage:
+			ev->xclient.message_type = replayatom(ev->xclient.message_type);
+			if (ev->xclient.message_type == netatom[NetWMState]) {
+				ev->xclient.data.l[1] = replayatom(ev->xclient.data.l[1]);
+				ev->xclient.data.l[2] = replayatom(ev->xclient.data.l[2]);
+			}
+			break;
+	}
+}
+
+// discard the live events caused by dwm's own requests;
+static void
+replaydrain(void)
+{
+	XEvent ev;
+
+	XSync(dpy, False);
+	while (running == 1 && XPending(dpy))
+		XNextEvent(dpy, &ev);
+}
+
+static void
+replayslowest(ReplaySlow *slow, double ms, unsigned long index, uint64_t ns, int type, int ipc)
+{
+	int i;
+
+	if (ms <= slow[REPLAY_SLOWEST - 1].ms)
+		return;
+	for (i = REPLAY_SLOWEST - 1; i > 0 && ms > slow[i - 1].ms; i--)
+		slow[i] = slow[i - 1];
+	slow[i] = (ReplaySlow){ ms, index, ns, type, ipc };
+}
+
+// replay a recording, returning 0 if it couldn't be read;
+int
+replay(const char *filename)
+{
+	FILE *f;
+	long size;
+	char *data = NULL, *p, *end, *msg;
+	RecordFileHeader *fh;
+	RecordHeader *h, *nh;
+	XEvent ev, *nested = NULL, *grown;
+	Window destroyed;
+	ReplaySlow slow[REPLAY_SLOWEST] = { 0 };
+	unsigned long index = 0, nevents = 0, nmessages = 0;
+	unsigned int i, n, nnested = 0;
+	uint64_t recorded = 0;
+	struct timespec started, mark;
+	double ms, total = 0;
+	int sv[2];
+	pid_t pid;
+
+	if (!(f = fopen(filename, "rb"))
+	|| fseek(f, 0, SEEK_END) || (size = ftell(f)) < (long)sizeof(RecordFileHeader) || fseek(f, 0, SEEK_SET)
+	|| !(data = malloc(size)) || fread(data, size, 1, f) != 1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: unable to read the event recording \"%s\".\n", filename);
+		if (f)
+			fclose(f);
+		free(data);
+		return 0;
+	}
+	fclose(f);
+	fh = (RecordFileHeader *)data;
+	if (memcmp(fh->magic, RECORD_MAGIC, sizeof(fh->magic)) || fh->xeventsize != sizeof(XEvent)
+	|| fh->natoms != WMLast + NetLast + XLast) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: \"%s\" isn't an event recording made by this build of dwm.\n", filename);
+		free(data);
+		return 0;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1 || (pid = fork()) == -1) {
+		logdatetime(stderr);
+		fprintf(stderr, "dwm: unable to start the replay clients process: %s\n", strerror(errno));
+		free(data);
+		return 0;
+	}
+	if (pid == 0) {
+		sigprocmask(SIG_SETMASK, &sigorigmask, NULL);
+		close(ConnectionNumber(dpy));
+		close(sv[0]);
+		replayclients(sv[1]);
+	}
+	close(sv[1]);
+	replayfd = sv[0];
+
+	memset(xlatency, 0, sizeof(xlatency));
+	memset(ipc_latency, 0, sizeof(ipc_latency));
+	clock_gettime(CLOCK_MONOTONIC, &started);
+
+	for (p = data + sizeof(RecordFileHeader), end = data + size; running == 1 && p + sizeof(RecordHeader) <= end; index++) {
+		h = (RecordHeader *)p;
+		p += sizeof(RecordHeader);
+		if (RECORD_PADDED(h->len) > end - p)
+			break;
+		p += RECORD_PADDED(h->len);
+		recorded = h->ns;
+
+		switch (h->kind) {
+			case RecState:
+				if (!replaystate((RecordState *)(h + 1), h->len)) {
+					logdatetime(stderr);
+					fprintf(stderr, "dwm: \"%s\" has an invalid state record.\n", filename);
+					p = end;
+				}
+				break;
+
+			case RecWindow:
+				replaywindow((RecordWindow *)(h + 1), h->len);
+				break;
+
+			case RecXEvent:
+				if (h->type >= LASTEvent || !handler[h->type] || h->len > sizeof(XEvent))
+					break;
+				replaydrain();
+				memset(&ev, 0, sizeof(ev));
+				memcpy(&ev, h + 1, h->len);
+				destroyed = ev.type == DestroyNotify ? ev.xdestroywindow.window : None;
+				replaytranslate(&ev);
+				// the windows' own process unmaps or destroys them, as a client would;
+				if (ev.type == DestroyNotify && wintoclient(ev.xdestroywindow.window))
+					replayrequest(ReplayDestroy, &(uint64_t){ ev.xdestroywindow.window }, sizeof(uint64_t));
+				else if (ev.type == UnmapNotify && !ev.xunmap.send_event && wintoclient(ev.xunmap.window))
+					replayrequest(ReplayUnmap, &(uint64_t){ ev.xunmap.window }, sizeof(uint64_t));
+				replaydrain();
+
+				// the events the handler's own loop read follow it;
+				// all of them, as a drag's ButtonRelease is what ends its loop;
+				for (n = 0, nh = (RecordHeader *)p;
+					(char *)(nh + 1) <= end && nh->kind == RecNested && RECORD_PADDED(nh->len) <= end - (char *)(nh + 1);
+					nh = (RecordHeader *)((char *)(nh + 1) + RECORD_PADDED(nh->len)), index++) {
+					if (nh->len > sizeof(XEvent))
+						continue;
+					if (n == nnested) {
+						if (!(grown = realloc(nested, (nnested ? nnested * 2 : 64) * sizeof(XEvent))))
+							die("fatal: could not realloc() %u bytes\n", (unsigned int)((nnested ? nnested * 2 : 64) * sizeof(XEvent)));
+						nested = grown;
+						nnested = nnested ? nnested * 2 : 64;
+					}
+					memset(&nested[n], 0, sizeof(XEvent));
+					memcpy(&nested[n], nh + 1, nh->len);
+					replaytranslate(&nested[n++]);
+				}
+				p = (char *)nh;
+				for (i = n; i > 0; i--)
+					XPutBackEvent(dpy, &nested[i - 1]);
+
+				clock_gettime(CLOCK_MONOTONIC, &mark);
+				dispatch(&ev);
+				ms = elapsedms(&mark);
+				total += ms;
+				nevents++;
+				replayslowest(slow, ms, index, h->ns, ev.type, 0);
+				// the server may reuse the id for another window;
+				if (destroyed)
+					replaymap(destroyed, None);
+				break;
+
+			case RecIPC:
+				replaydrain();
+				if (!(msg = malloc(h->len + 1)))
+					break;
+				memcpy(msg, h + 1, h->len);
+				msg[h->len] = '\0';
+				clock_gettime(CLOCK_MONOTONIC, &mark);
+				ipc_replay_message(h->type, msg, mons, lastselmon, selmon, tags, LENGTH(tags), layouts, LENGTH(layouts));
+				ms = elapsedms(&mark);
+				total += ms;
+				nmessages++;
+				replayslowest(slow, ms, index, h->ns, h->type, 1);
+				free(msg);
+				break;
+		}
+	}
+
+	printf("replayed %lu X events and %lu IPC messages from \"%s\": %.3f ms handling, %.3f ms in all, recorded over %.3f s.\n",
+		nevents, nmessages, filename, total, elapsedms(&started), recorded / 1e9
+	);
+	puts("handler latency (ms):");
+	for (i = 0; i < LASTEvent; i++)
+		if (handlernames[i])
+			latencyprint(stdout, handlernames[i], &xlatency[i]);
+	for (i = 0; i < LENGTH(ipc_latency); i++)
+		latencyprint(stdout, ipc_type_names[i], &ipc_latency[i]);
+	puts("slowest events:");
+	for (i = 0; i < REPLAY_SLOWEST && slow[i].ms > 0; i++)
+		printf("    record %-8lu at %10.3f s  %-18s %.3f ms\n", slow[i].index, slow[i].ns / 1e9,
+			slow[i].ipc ? (slow[i].type < LENGTH(ipc_type_names) ? ipc_type_names[slow[i].type] : "ipc")
+				: (handlernames[slow[i].type] ? handlernames[slow[i].type] : "event"),
+			slow[i].ms
+		);
+	fflush(stdout);
+
+	if (replayfd != -1)
+		close(replayfd);
+	replayfd = -1;
+	free(replaywins);
+	replaywins = NULL;
+	nreplaywins = 0;
+	free(replayatoms);
+	replayatoms = NULL;
+	nreplayatoms = 0;
+	free(nested);
+	free(data);
+	return 1;
+}
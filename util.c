@@ -13,6 +13,16 @@
 #include <time.h>
 #include "util.h"
 
+struct ArenaChunk {
+	ArenaChunk *next;
+	size_t size;			// usable bytes after the header;
+	size_t used;
+};
+
+#define ARENA_ALIGN			16
+#define ARENA_HEADER		((sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_DATA(k)		((char *)(k) + ARENA_HEADER)
+
 char *
 expandenv(const char *string)
 {
@@ -306,3 +316,76 @@ nullterminate(char **str, size_t *len)
 	return 0;
 }
 #endif // PATCH_IPC
+
+static ArenaChunk *
+arena_chunk(size_t size)
+{
+	ArenaChunk *k = malloc(ARENA_HEADER + size);
+
+	if (!k)
+		return NULL;
+	k->next = NULL;
+	k->size = size;
+	k->used = 0;
+	return k;
+}
+
+void *
+arena_alloc(Arena *a, size_t size)
+{
+	ArenaChunk *k = a->chunks;
+
+	size = (MAX(size, 1) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!k || k->used + size > k->size) {
+		if (size > a->chunksize / 4) {
+			// behind the current chunk, which keeps serving small requests;
+			if (!(k = arena_chunk(size)))
+				return NULL;
+			if (a->chunks) {
+				k->next = a->chunks->next;
+				a->chunks->next = k;
+			}
+			else
+				a->chunks = k;
+		}
+		else {
+			if (!(k = arena_chunk(a->chunksize)))
+				return NULL;
+			k->next = a->chunks;
+			a->chunks = k;
+		}
+	}
+	k->used += size;
+	return ARENA_DATA(k) + k->used - size;
+}
+
+void
+arena_free(Arena *a)
+{
+	ArenaChunk *k, *next;
+
+	for (k = a->chunks; k; k = next) {
+		next = k->next;
+		free(k);
+	}
+	a->chunks = NULL;
+}
+
+// keeps one usual sized chunk for reuse;
+void
+arena_reset(Arena *a)
+{
+	ArenaChunk *k, *next, *keep = NULL;
+
+	for (k = a->chunks; k; k = next) {
+		next = k->next;
+		if (!keep && k->size == a->chunksize) {
+			keep = k;
+			keep->next = NULL;
+			keep->used = 0;
+		}
+		else
+			free(k);
+	}
+	a->chunks = keep;
+}
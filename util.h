@@ -1,4 +1,6 @@
 /* See LICENSE file for copyright and license details. */
+#ifndef UTIL_H_
+#define UTIL_H_
 
 #define MAX(A, B)               ((A) > (B) ? (A) : (B))
 #define MIN(A, B)               ((A) < (B) ? (A) : (B))
@@ -17,6 +19,17 @@ void logdatetime(FILE *fd);
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
 
+// bump allocator, released only as a whole;
+typedef struct ArenaChunk ArenaChunk;
+typedef struct {
+	ArenaChunk *chunks;		// newest first;
+	size_t chunksize;		// usual chunk size; a large request gets a chunk of its own;
+} Arena;
+
+void *arena_alloc(Arena *a, size_t size);
+void arena_free(Arena *a);
+void arena_reset(Arena *a);
+
 char *expandenv(const char *string);
 char *str_replace(char *orig, char *rep, char *with);
 #if PATCH_IPC
@@ -25,3 +38,5 @@ int mkdirp(const char *path);
 int parentdir(const char *path, char **parent);
 int nullterminate(char **str, size_t *len);
 #endif // PATCH_IPC
+
+#endif // UTIL_H_
@@ -141,173 +141,96 @@ tilecount(Monitor *m, unsigned int *nc)
 }
 #endif // PATCH_VANITY_GAPS
 
-void
-getfacts(Monitor *m, int msize, int ssize, float *mf, float *sf, int *mr, int *sr)
-{
-	unsigned int n;
-	float mfacts = 0, sfacts = 0;
-	int mtotal = 0, stotal = 0;
-	Client *c;
-
-	for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++)
-		if (n < m->nmaster)
-			#if PATCH_CFACTS
-			mfacts += c->cfact;
-			#else // NO PATCH_CFACTS
-			mfacts += 1;
-			#endif // PATCH_CFACTS
-		else
-			#if PATCH_CFACTS
-			sfacts += c->cfact;
-			#else // NO PATCH_CFACTS
-			sfacts += 1;
-			#endif // PATCH_CFACTS
-
-	for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++)
-		if (n < m->nmaster)
-			mtotal += msize * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			);
-		else
-			stotal += ssize * (
-				#if PATCH_CFACTS
-				c->cfact / sfacts
-				#else // NO PATCH_CFACTS
-				1 / sfacts
-				#endif // PATCH_CFACTS
-			);
-
-	*mf = mfacts; // total factor of master area
-	*sf = sfacts; // total factor of stack area
-	*mr = msize - mtotal; // the remainder (rest) of pixels after a cfacts master split
-	*sr = ssize - stotal; // the remainder (rest) of pixels after a cfacts stack split
-}
-
 /***
  * Layouts
+ *
+ * The geometry is computed by the headless engine in layouts.c; these adapt
+ * a monitor's tiled clients to it and apply each result through resize().
  */
 
-#if PATCH_LAYOUT_BSTACK
-/*
- * Bottomstack layout + gaps
- * https://dwm.suckless.org/patches/bottomstack/
- */
-static void
-bstack(Monitor *m)
+static LayoutClient *layoutclients = NULL;	// scratch client array for layoutmonitor();
+static unsigned int layoutclientsize = 0;
+static LayoutCache *layoutrecording = NULL;	// cache taking the requested geometry, set by arrangelayout();
+
+void
+layoutmonitor(Monitor *m, LayoutFunc func)
 {
 	unsigned int i, n;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int sx = 0, sy = 0, sh = 0, sw = 0;
-	float mfacts, sfacts;
-	int mrest, srest;
+	LayoutParams p;
 	Client *c;
 
+	memset(&p, 0, sizeof(LayoutParams));
 	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
+	getgaps(m, &p.oh, &p.ov, &p.ih, &p.iv, &n);
 	#else // NO PATCH_VANITY_GAPS
 	tilecount(m, &n);
 	#endif // PATCH_VANITY_GAPS
 	if (n == 0)
 		return;
 
-	sx = mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	sy = my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	sh = mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (MIN(n, m->nmaster) - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	sw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (n - m->nmaster - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (m->nmaster && n > m->nmaster) {
-		sh = (
-			mh
-			#if PATCH_VANITY_GAPS
-			- iv
-			#endif // PATCH_VANITY_GAPS
-		) * (1 - m->mfact);
-		mh = mh - sh
-			#if PATCH_VANITY_GAPS
-			- iv
-			#endif // PATCH_VANITY_GAPS
-		;
-		sx = mx;
-		sy = my + mh
-			#if PATCH_VANITY_GAPS
-			+ iv
-			#endif // PATCH_VANITY_GAPS
-		;
+	if (n > layoutclientsize) {
+		free(layoutclients);
+		layoutclients = ecalloc(n, sizeof(LayoutClient));
+		layoutclientsize = n;
+	}
+	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
+		layoutclients[i].bw = c->bw;
+		#if PATCH_CFACTS
+		layoutclients[i].cfact = c->cfact;
+		#else // NO PATCH_CFACTS
+		layoutclients[i].cfact = 1;
+		#endif // PATCH_CFACTS
+		layoutclients[i].data = c;
 	}
 
-	getfacts(m, mw, sw, &mfacts, &sfacts, &mrest, &srest);
+	p.wx = m->wx;
+	p.wy = m->wy;
+	p.ww = m->ww;
+	p.wh = m->wh;
+	p.mfact = m->mfact;
+	p.nmaster = m->nmaster;
+	#if PATCH_MIRROR_LAYOUT
+	p.mirror = m->mirror;
+	#endif // PATCH_MIRROR_LAYOUT
+	p.bh = bh;
+	p.forcevsplit = FORCE_VSPLIT;
+	p.place = layoutplace;
+
+	func(&p, layoutclients, n);
+
+	if (p.ltsymbol[0])
+		memcpy(m->ltsymbol, p.ltsymbol, sizeof m->ltsymbol);
+}
 
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
-		if (i < m->nmaster) {
-			resize(
-				c, mx,
-				#if PATCH_MIRROR_LAYOUT
-				m->mirror ? (m->wy + m->wh - (my - m->wy) - (mh - (2*c->bw))) :
-				#endif // PATCH_MIRROR_LAYOUT
-				my,
-				mw * (
-					#if PATCH_CFACTS
-					c->cfact / mfacts
-					#else // NO PATCH_CFACTS
-					1 / mfacts
-					#endif // PATCH_CFACTS
-				) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw), 0
-			);
-			mx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			resize(
-				c, sx,
-				#if PATCH_MIRROR_LAYOUT
-				m->mirror ? (m->wy + m->wh - (sy - m->wy) - (sh - (2*c->bw))) :
-				#endif // PATCH_MIRROR_LAYOUT
-				sy,
-				sw * (
-					#if PATCH_CFACTS
-					c->cfact / sfacts
-					#else // NO PATCH_CFACTS
-					1 / sfacts
-					#endif // PATCH_CFACTS
-				) + ((i - m->nmaster) < srest ? 1 : 0) - (2*c->bw), sh - (2*c->bw), 0
-			);
-			sx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
+void
+layoutplace(LayoutParams *p, LayoutClient *lc)
+{
+	Client *c = lc->data;
+	LayoutCacheClient *lcc;
+	unsigned int i = lc - layoutclients;
+
+	// the request is cached, as resize() adjusts it and resizeclient() may inflate it;
+	if (layoutrecording && i < layoutrecording->size) {
+		lcc = &layoutrecording->clients[i];
+		lcc->x = lc->x;
+		lcc->y = lc->y;
+		lcc->w = lc->w;
+		lcc->h = lc->h;
+		lcc->placed = 1;
 	}
+	// later clients are positioned against the size hints-adjusted geometry;
+	resize(c, lc->x, lc->y, lc->w, lc->h, 0);
+	lc->x = c->x;
+	lc->y = c->y;
+	lc->w = c->w;
+	lc->h = c->h;
+}
+
+#if PATCH_LAYOUT_BSTACK
+static void
+bstack(Monitor *m)
+{
+	layoutmonitor(m, layout_bstack);
 }
 #endif // PATCH_LAYOUT_BSTACK
 
@@ -315,357 +238,15 @@ bstack(Monitor *m)
 static void
 bstackhoriz(Monitor *m)
 {
-	unsigned int i, n;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int sx = 0, sy = 0, sh = 0, sw = 0;
-	float mfacts, sfacts;
-	int mrest, srest;
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	sx = mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	sy = my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	sh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (n - m->nmaster - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (MIN(n, m->nmaster) - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	sw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (m->nmaster && n > m->nmaster) {
-		sh = (
-			mh
-			#if PATCH_VANITY_GAPS
-			- iv
-			#endif // PATCH_VANITY_GAPS
-		) * (1 - m->mfact);
-		mh = mh - sh
-			#if PATCH_VANITY_GAPS
-			- iv
-			#endif // PATCH_VANITY_GAPS
-		;
-		sy = my + mh
-			#if PATCH_VANITY_GAPS
-			+ iv
-			#endif // PATCH_VANITY_GAPS
-		;
-		sh = m->wh - mh
-			#if PATCH_VANITY_GAPS
-			- 2*ov - iv * (n - m->nmaster)
-			#endif // PATCH_VANITY_GAPS
-		;
-	}
-
-	getfacts(m, mw, sh, &mfacts, &sfacts, &mrest, &srest);
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
-		if (i < m->nmaster) {
-			resize(
-				c, mx,
-				#if PATCH_MIRROR_LAYOUT
-				m->mirror ? (m->wy + m->wh - (my - m->wy) - (mh - (2*c->bw))) :
-				#endif // PATCH_MIRROR_LAYOUT
-				my,
-				mw * (
-					#if PATCH_CFACTS
-					c->cfact / mfacts
-					#else // NO PATCH_CFACTS
-					1 / mfacts
-					#endif // PATCH_CFACTS
-				) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw), 0
-			);
-			mx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			resize(
-				c, sx,
-				#if PATCH_MIRROR_LAYOUT
-				m->mirror ? (m->wy + m->wh - (sy - m->wy) - (sh * (
-					#if PATCH_CFACTS
-					c->cfact / sfacts
-					#else // NO PATCH_CFACTS
-					1 / sfacts
-					#endif // PATCH_CFACTS
-				) + ((i - m->nmaster) < srest ? 1 : 0) - (2*c->bw))) :
-				#endif // PATCH_MIRROR_LAYOUT
-				sy,
-				sw - (2*c->bw), sh * (
-					#if PATCH_CFACTS
-					c->cfact / sfacts
-					#else // NO PATCH_CFACTS
-					1 / sfacts
-					#endif // PATCH_CFACTS
-				) + ((i - m->nmaster) < srest ? 1 : 0) - (2*c->bw), 0
-			);
-			sy += HEIGHT(c)
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
-	}
+	layoutmonitor(m, layout_bstackhoriz);
 }
 #endif // PATCH_LAYOUT_BSTACKHORIZ
 
 #if PATCH_LAYOUT_CENTREDMASTER
-/*
- * Centred master layout + gaps
- * https://dwm.suckless.org/patches/centeredmaster/
- */
 void
 centredmaster(Monitor *m)
 {
-	unsigned int i, n;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int lx = 0, ly = 0, lw = 0, lh = 0;
-	int rx = 0, ry = 0, rw = 0, rh = 0;
-	float mfacts = 0, lfacts = 0, rfacts = 0;
-	int mtotal = 0, ltotal = 0, rtotal = 0;
-	int mrest = 0, lrest = 0, rrest = 0;
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	/* initialize areas */
-	mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * ((!m->nmaster ? n : MIN(n, m->nmaster)) - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	lh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (((n - m->nmaster) / 2) - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	rh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (((n - m->nmaster) / 2) - ((n - m->nmaster) % 2 ? 0 : 1))
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (m->nmaster && n > m->nmaster) {
-		/* go mfact box in the centre if more than nmaster clients */
-		if (n - m->nmaster > 1) {
-			/* ||<-S->|<---M--->|<-S->|| */
-			mw = (m->ww
-				#if PATCH_VANITY_GAPS
-				- 2*oh - 2*ih
-				#endif // PATCH_VANITY_GAPS
-			) * m->mfact;
-			lw = (m->ww - mw
-				#if PATCH_VANITY_GAPS
-				- 2*oh - 2*ih
-				#endif // PATCH_VANITY_GAPS
-			) / 2;
-			rw = (m->ww - mw
-				#if PATCH_VANITY_GAPS
-				- 2*oh - 2*ih
-				#endif // PATCH_VANITY_GAPS
-			) - lw;
-			mx += lw
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			/* ||<---M--->|<-S->|| */
-			mw = (mw
-				#if PATCH_VANITY_GAPS
-				- ih
-				#endif // PATCH_VANITY_GAPS
-			) * m->mfact;
-			lw = 0;
-			rw = m->ww - mw
-				#if PATCH_VANITY_GAPS
-				- ih - 2*oh
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
-		lx = m->wx
-			#if PATCH_VANITY_GAPS
-			+ oh
-			#endif // PATCH_VANITY_GAPS
-		;
-		ly = m->wy
-			#if PATCH_VANITY_GAPS
-			+ ov
-			#endif // PATCH_VANITY_GAPS
-		;
-		rx = mx + mw
-			#if PATCH_VANITY_GAPS
-			+ ih
-			#endif // PATCH_VANITY_GAPS
-		;
-		ry = m->wy
-			#if PATCH_VANITY_GAPS
-			+ ov
-			#endif // PATCH_VANITY_GAPS
-		;
-	}
-
-	/* calculate facts */
-	for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-		if (!m->nmaster || n < m->nmaster)
-			mfacts +=
-				#if PATCH_CFACTS
-				c->cfact
-				#else // NO PATCH_CFACTS
-				1
-				#endif // PATCH_CFACTS
-			;
-		else if ((n - m->nmaster) % 2)
-			lfacts +=
-				#if PATCH_CFACTS
-				c->cfact
-				#else // NO PATCH_CFACTS
-				1
-				#endif // PATCH_CFACTS
-			; // total factor of left hand stack area
-		else
-			rfacts +=
-				#if PATCH_CFACTS
-				c->cfact
-				#else // NO PATCH_CFACTS
-				1
-				#endif // PATCH_CFACTS
-			; // total factor of right hand stack area
-	}
-
-	for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++)
-		if (!m->nmaster || n < m->nmaster)
-			mtotal += mh * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			);
-		else if ((n - m->nmaster) % 2)
-			ltotal += lh * (
-				#if PATCH_CFACTS
-				c->cfact / lfacts
-				#else // NO PATCH_CFACTS
-				1 / lfacts
-				#endif // PATCH_CFACTS
-			);
-		else
-			rtotal += rh * (
-				#if PATCH_CFACTS
-				c->cfact / rfacts
-				#else // NO PATCH_CFACTS
-				1 / rfacts
-				#endif // PATCH_CFACTS
-			);
-
-	mrest = mh - mtotal;
-	lrest = lh - ltotal;
-	rrest = rh - rtotal;
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
-		if (!m->nmaster || i < m->nmaster) {
-			/* nmaster clients are stacked vertically, in the centre of the screen */
-			resize(c, mx, my, mw - (2*c->bw), mh * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			) + (i < mrest ? 1 : 0) - (2*c->bw), 0);
-			my += HEIGHT(c)
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			/* stack clients are stacked vertically */
-			if ((i - m->nmaster) % 2 ) {
-				resize(c, lx, ly, lw - (2*c->bw), lh * (
-					#if PATCH_CFACTS
-					c->cfact / lfacts
-					#else // NO PATCH_CFACTS
-					1 / lfacts
-					#endif // PATCH_CFACTS
-				) + ((i - 2*m->nmaster) < 2*lrest ? 1 : 0) - (2*c->bw), 0);
-				ly += HEIGHT(c)
-					#if PATCH_VANITY_GAPS
-					+ iv
-					#endif // PATCH_VANITY_GAPS
-				;
-			} else {
-				resize(c, rx, ry, rw - (2*c->bw), rh * (
-					#if PATCH_CFACTS
-					c->cfact / rfacts
-					#else // NO PATCH_CFACTS
-					1 / rfacts
-					#endif // PATCH_CFACTS
-				) + ((i - 2*m->nmaster) < 2*rrest ? 1 : 0) - (2*c->bw), 0);
-				ry += HEIGHT(c)
-					#if PATCH_VANITY_GAPS
-					+ iv
-					#endif // PATCH_VANITY_GAPS
-				;
-			}
-		}
-	}
+	layoutmonitor(m, layout_centredmaster);
 }
 #endif // PATCH_LAYOUT_CENTREDMASTER
 
@@ -673,432 +254,23 @@ centredmaster(Monitor *m)
 void
 centredfloatingmaster(Monitor *m)
 {
-	unsigned int i, n;
-	float mfacts, sfacts;
-	#if PATCH_VANITY_GAPS
-	float mihf = 1.0; // master inner horizontal gap factor
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mrest, srest;
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int sx = 0, sy = 0, sh = 0, sw = 0;
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	sx = mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	sy = my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	sh = mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih*(n - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	sw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih*(n - m->nmaster - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (m->nmaster && n > m->nmaster) {
-		#if PATCH_VANITY_GAPS
-		mihf = 0.8;
-		#endif // PATCH_VANITY_GAPS
-		/* go mfact box in the centre if more than nmaster clients */
-		if (m->ww > m->wh) {
-			mw = m->ww * m->mfact
-				#if PATCH_VANITY_GAPS
-				- ih*mihf*(MIN(n, m->nmaster) - 1)
-				#endif // PATCH_VANITY_GAPS
-			;
-			mh = m->wh * 0.9;
-		} else {
-			mw = m->ww * 0.9
-				#if PATCH_VANITY_GAPS
-				- ih*mihf*(MIN(n, m->nmaster) - 1)
-				#endif // PATCH_VANITY_GAPS
-			;
-			mh = m->wh * m->mfact;
-		}
-		mx = m->wx + (m->ww - mw) / 2;
-		my = m->wy + (m->wh - mh) / 2;
-
-		sx = m->wx
-			#if PATCH_VANITY_GAPS
-			+ oh
-			#endif // PATCH_VANITY_GAPS
-		;
-		sy = m->wy
-			#if PATCH_VANITY_GAPS
-			+ ov
-			#endif // PATCH_VANITY_GAPS
-		;
-		sh = m->wh
-			#if PATCH_VANITY_GAPS
-			- 2*ov
-			#endif // PATCH_VANITY_GAPS
-		;
-	}
-
-	getfacts(m, mw, sw, &mfacts, &sfacts, &mrest, &srest);
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-		if (i < m->nmaster) {
-			/* nmaster clients are stacked horizontally, in the centre of the screen */
-			resize(c, mx, my, mw * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw), 0);
-			mx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih*mihf
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			/* stack clients are stacked horizontally */
-			resize(c, sx, sy, sw * (
-				#if PATCH_CFACTS
-				c->cfact / sfacts
-				#else // NO PATCH_CFACTS
-				1 / sfacts
-				#endif // PATCH_CFACTS
-			) + ((i - m->nmaster) < srest ? 1 : 0) - (2*c->bw), sh - (2*c->bw), 0);
-			sx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
+	layoutmonitor(m, layout_centredfloatingmaster);
 }
 #endif // PATCH_LAYOUT_CENTREDFLOATINGMASTER
 
 #if PATCH_LAYOUT_DECK
-/*
- * Deck layout + gaps
- * https://dwm.suckless.org/patches/deck/
- */
 void
 deck(Monitor *m)
 {
-	unsigned int i, n;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int sx = 0, sy = 0, sh = 0, sw = 0;
-	float mfacts, sfacts;
-	int mrest, srest;
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	sx = mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	sy = my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	sh = mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (MIN(n, m->nmaster) - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	sw = mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (m->nmaster && n > m->nmaster) {
-		sw = (mw
-			#if PATCH_VANITY_GAPS
-			- ih
-			#endif // PATCH_VANITY_GAPS
-		) * (1 - m->mfact);
-		mw = mw - sw
-			#if PATCH_VANITY_GAPS
-			- ih
-			#endif // PATCH_VANITY_GAPS
-		;
-		sh = m->wh
-			#if PATCH_VANITY_GAPS
-			- 2*ov
-			#endif // PATCH_VANITY_GAPS
-		;
-		#if PATCH_MIRROR_LAYOUT
-		if (m->mirror) {
-			mx += sw
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-			sx = m->wx
-				#if PATCH_VANITY_GAPS
-				+ oh
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
-		else
-		#endif // PATCH_MIRROR_LAYOUT
-		sx = mx + mw
-			#if PATCH_VANITY_GAPS
-			+ ih
-			#endif // PATCH_VANITY_GAPS
-		;
-	}
-
-	getfacts(m, mh, sh, &mfacts, &sfacts, &mrest, &srest);
-
-	if ((int)n - m->nmaster > 0) /* override layout symbol */
-		snprintf(m->ltsymbol, sizeof m->ltsymbol, "D [%d]", n - m->nmaster);
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-		if (i < m->nmaster) {
-			resize(c, mx, my, mw - (2*c->bw), mh * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			) + (i < mrest ? 1 : 0) - (2*c->bw), 0);
-			my += HEIGHT(c)
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			resize(c, sx, sy, sw - (2*c->bw), sh - (2*c->bw), 0);
-		}
+	layoutmonitor(m, layout_deck);
 }
 #endif // PATCH_LAYOUT_DECK
 
-#if PATCH_LAYOUT_DWINDLE || PATCH_LAYOUT_SPIRAL
-/*
- * Fibonacci layout + gaps
- * https://dwm.suckless.org/patches/fibonacci/
- */
-void
-fibonacci(Monitor *m, int s)
-{
-	unsigned int i, n;
-	int nx, ny, nw, nh;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int nv, hrest = 0, wrest = 0, r = 1;
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	nx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	ny = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	nw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	nh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next)) {
-		if (r) {
-			if ((i % 2 && (nh
-				#if PATCH_VANITY_GAPS
-				- iv
-				#endif // PATCH_VANITY_GAPS
-				) / 2 <= (bh + 2*c->bw)) || (!(i % 2) && (nw
-				#if PATCH_VANITY_GAPS
-				- ih
-				#endif // PATCH_VANITY_GAPS
-				) / 2 <= (bh + 2*c->bw))) {
-				r = 0;
-			}
-			if (r && i < n - 1) {
-				if (i % 2) {
-					nv = (nh
-						#if PATCH_VANITY_GAPS
-						- iv
-						#endif // PATCH_VANITY_GAPS
-					) / 2;
-					hrest = nh - 2*nv
-						#if PATCH_VANITY_GAPS
-						- iv
-						#endif // PATCH_VANITY_GAPS
-					;
-					nh = nv;
-				} else {
-					nv = (nw
-						#if PATCH_VANITY_GAPS
-						- ih
-						#endif // PATCH_VANITY_GAPS
-					) / 2;
-					wrest = nw - 2*nv
-						#if PATCH_VANITY_GAPS
-						- ih
-						#endif // PATCH_VANITY_GAPS
-					;
-					nw = nv;
-				}
-
-				if ((i % 4) == 2 && !s)
-					nx += nw
-						#if PATCH_VANITY_GAPS
-						+ ih
-						#endif // PATCH_VANITY_GAPS
-					;
-				else if ((i % 4) == 3 && !s)
-					ny += nh
-						#if PATCH_VANITY_GAPS
-						+ iv
-						#endif // PATCH_VANITY_GAPS
-					;
-			}
-
-			if ((i % 4) == 0) {
-				if (s) {
-					ny += nh
-						#if PATCH_VANITY_GAPS
-						+ iv
-						#endif // PATCH_VANITY_GAPS
-					;
-					nh += hrest;
-				}
-				else {
-					nh -= hrest;
-					ny -= nh
-						#if PATCH_VANITY_GAPS
-						+ iv
-						#endif // PATCH_VANITY_GAPS
-					;
-				}
-			}
-			else if ((i % 4) == 1) {
-				nx += nw
-					#if PATCH_VANITY_GAPS
-					+ ih
-					#endif // PATCH_VANITY_GAPS
-				;
-				nw += wrest;
-			}
-			else if ((i % 4) == 2) {
-				ny += nh
-					#if PATCH_VANITY_GAPS
-					+ iv
-					#endif // PATCH_VANITY_GAPS
-				;
-				nh += hrest;
-				if (i < n - 1)
-					nw += wrest;
-			}
-			else if ((i % 4) == 3) {
-				if (s) {
-					nx += nw
-						#if PATCH_VANITY_GAPS
-						+ ih
-						#endif // PATCH_VANITY_GAPS
-					;
-					nw -= wrest;
-				} else {
-					nw -= wrest;
-					nx -= nw
-						#if PATCH_VANITY_GAPS
-						+ ih
-						#endif // PATCH_VANITY_GAPS
-					;
-					nh += hrest;
-				}
-			}
-			if (i == 0)	{
-				if (n != 1) {
-					nw = (m->ww
-						#if PATCH_VANITY_GAPS
-						- ih - 2*oh
-						#endif // PATCH_VANITY_GAPS
-					) - (m->ww
-						#if PATCH_VANITY_GAPS
-						- ih - 2*oh
-						#endif // PATCH_VANITY_GAPS
-					) * (1 - m->mfact);
-					wrest = 0;
-				}
-				ny = m->wy
-					#if PATCH_VANITY_GAPS
-					+ ov
-					#endif // PATCH_VANITY_GAPS
-				;
-			}
-			else if (i == 1)
-				nw = m->ww - nw
-					#if PATCH_VANITY_GAPS
-					- ih - 2*oh
-					#endif // PATCH_VANITY_GAPS
-				;
-			i++;
-		}
-
-		resize(c,
-			#if PATCH_MIRROR_LAYOUT
-			m->mirror ? (m->wx + m->ww - (nx - m->wx) - nw - (2*c->bw)) :
-			#endif // PATCH_MIRROR_LAYOUT
-			nx, ny, nw - (2*c->bw), nh - (2*c->bw), False
-		);
-	}
-}
-#endif // PATCH_LAYOUT_DWINDLE || PATCH_LAYOUT_SPIRAL
-
 #if PATCH_LAYOUT_DWINDLE
 void
 dwindle(Monitor *m)
 {
-	fibonacci(m, 1);
+	layoutmonitor(m, layout_dwindle);
 }
 #endif // PATCH_LAYOUT_DWINDLE
 
@@ -1106,552 +278,170 @@ dwindle(Monitor *m)
 void
 spiral(Monitor *m)
 {
-	fibonacci(m, 0);
+	layoutmonitor(m, layout_spiral);
 }
 #endif // PATCH_LAYOUT_SPIRAL
 
 #if PATCH_LAYOUT_GAPLESSGRID
-/*
- * Gappless grid layout + gaps (ironically)
- * https://dwm.suckless.org/patches/gaplessgrid/
- */
 void
 gaplessgrid(Monitor *m)
 {
-	unsigned int i, n;
-	int x, y, cols, rows, ch, cw, cn, rn, rrest, crest; // counters
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	/* grid dimensions */
-	for (cols = 0; cols <= n/2; cols++)
-		if (cols*cols >= n)
-			break;
-	if (n == 5) /* set layout against the general calculation: not 1:2:2, but 2:3 */
-		cols = 2;
-	rows = n/cols;
-	cn = rn = 0; // reset column no, row no, client count
-
-	ch = (m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (rows - 1)
-		#endif // PATCH_VANITY_GAPS
-	) / rows;
-	cw = (m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (cols - 1)
-		#endif // PATCH_VANITY_GAPS
-	) / cols;
-	rrest = (m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (rows - 1)
-		#endif // PATCH_VANITY_GAPS
-	) - ch * rows;
-	crest = (m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (cols - 1)
-		#endif // PATCH_VANITY_GAPS
-	) - cw * cols;
-	x = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	y = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	for (i = 0, c = nexttiled(m->clients); c; i++, c = nexttiled(c->next)) {
-		if (i/rows + 1 > cols - n%cols) {
-			rows = n/cols + 1;
-			ch = (m->wh
-				#if PATCH_VANITY_GAPS
-				- 2*ov - iv * (rows - 1)
-				#endif // PATCH_VANITY_GAPS
-			) / rows;
-			rrest = (m->wh
-				#if PATCH_VANITY_GAPS
-				- 2*ov - iv * (rows - 1)
-				#endif // PATCH_VANITY_GAPS
-			) - ch * rows;
-		}
-		resize(c,
-			x,
-			y + rn*(ch
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			) + MIN(rn, rrest),
-			cw + (cn < crest ? 1 : 0) - 2*c->bw,
-			ch + (rn < rrest ? 1 : 0) - 2*c->bw,
-			0);
-		rn++;
-		if (rn >= rows) {
-			rn = 0;
-			x += cw
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-				+ (cn < crest ? 1 : 0);
-			cn++;
-		}
-	}
+	layoutmonitor(m, layout_gaplessgrid);
 }
 #endif // PATCH_LAYOUT_GAPLESSGRID
 
 #if PATCH_LAYOUT_GRID
-/*
- * Gridmode layout + gaps
- * https://dwm.suckless.org/patches/gridmode/
- */
 void
 grid(Monitor *m)
 {
-	unsigned int i, n;
-	int cx, cy, cw, ch, cc, cr, chrest, cwrest, cols, rows;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	Client *c;
-
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-
-	/* grid dimensions */
-	for (rows = 0; rows <= n/2; rows++)
-		if (rows*rows >= n)
-			break;
-	cols = (rows && (rows - 1) * rows >= n) ? rows - 1 : rows;
-
-	/* window geoms (cell height/width) */
-	ch = (m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (rows - 1)
-		#endif // PATCH_VANITY_GAPS
-	) / (rows ? rows : 1);
-	cw = (m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (cols - 1)
-		#endif // PATCH_VANITY_GAPS
-	) / (cols ? cols : 1);
-	chrest = (m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (rows - 1)
-		#endif // PATCH_VANITY_GAPS
-	) - ch * rows;
-	cwrest = (m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh - ih * (cols - 1)
-		#endif // PATCH_VANITY_GAPS
-	) - cw * cols;
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
-		cc = i / rows;
-		cr = i % rows;
-		cx = m->wx
-			#if PATCH_VANITY_GAPS
-			+ oh
-			#endif // PATCH_VANITY_GAPS
-			+ cc * (cw
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			) + MIN(cc, cwrest)
-		;
-		cy = m->wy
-			#if PATCH_VANITY_GAPS
-			+ ov
-			#endif // PATCH_VANITY_GAPS
-			+ cr * (ch
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			) + MIN(cr, chrest)
-		;
-		resize(c, cx, cy, cw + (cc < cwrest ? 1 : 0) - 2*c->bw, ch + (cr < chrest ? 1 : 0) - 2*c->bw, False);
-	}
+	layoutmonitor(m, layout_grid);
 }
 #endif // PATCH_LAYOUT_GRID
 
 #if PATCH_LAYOUT_HORIZGRID
-/*
- * Horizontal grid layout + gaps
- * https://dwm.suckless.org/patches/horizgrid/
- */
 void
-horizgrid(Monitor *m) {
-	Client *c;
-	unsigned int n, i;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int sx = 0, sy = 0, sh = 0, sw = 0;
-	int ntop;
-	#if PATCH_VANITY_GAPS
-	int nbottom = 1;
-	#endif // PATCH_VANITY_GAPS
-	float mfacts = 0, sfacts = 0;
-	int mrest, srest, mtotal = 0, stotal = 0;
-
-	/* Count windows */
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	if (n <= 2)
-		ntop = n;
-	else {
-		ntop = n / 2;
-		#if PATCH_VANITY_GAPS
-		nbottom = n - ntop;
-		#endif // PATCH_VANITY_GAPS
-	}
-	sx = mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	sy = my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	sh = mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	sw = mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (n > ntop) {
-		sh = (mh
-			#if PATCH_VANITY_GAPS
-			- iv
-			#endif // PATCH_VANITY_GAPS
-			) / 2
-		;
-		mh = mh - sh
-			#if PATCH_VANITY_GAPS
-			- iv
-			#endif // PATCH_VANITY_GAPS
-		;
-		sy = my + mh
-			#if PATCH_VANITY_GAPS
-			+ iv
-			#endif // PATCH_VANITY_GAPS
-		;
-		mw = m->ww
-			#if PATCH_VANITY_GAPS
-			- 2*oh - ih * (ntop - 1)
-			#endif // PATCH_VANITY_GAPS
-		;
-		sw = m->ww
-			#if PATCH_VANITY_GAPS
-			- 2*oh - ih * (nbottom - 1)
-			#endif // PATCH_VANITY_GAPS
-		;
-	}
-
-	/* calculate facts */
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-		if (i < ntop)
-			mfacts +=
-				#if PATCH_CFACTS
-				c->cfact
-				#else // NO PATCH_CFACTS
-				1
-				#endif // PATCH_CFACTS
-			;
-		else
-			sfacts +=
-				#if PATCH_CFACTS
-				c->cfact
-				#else // NO PATCH_CFACTS
-				1
-				#endif // PATCH_CFACTS
-			;
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-		if (i < ntop)
-			mtotal += mh * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			);
-		else
-			stotal += sw * (
-				#if PATCH_CFACTS
-				c->cfact / sfacts
-				#else // NO PATCH_CFACTS
-				1 / sfacts
-				#endif // PATCH_CFACTS
-			);
-
-	mrest = mh - mtotal;
-	srest = sw - stotal;
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-		if (i < ntop) {
-			resize(c, mx, my, mw * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			) + (i < mrest ? 1 : 0) - (2*c->bw), mh - (2*c->bw), 0);
-			mx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			resize(c, sx, sy, sw * (
-				#if PATCH_CFACTS
-				c->cfact / sfacts
-				#else // NO PATCH_CFACTS
-				1 / sfacts
-				#endif // PATCH_CFACTS
-			) + ((i - ntop) < srest ? 1 : 0) - (2*c->bw), sh - (2*c->bw), 0);
-			sx += WIDTH(c)
-				#if PATCH_VANITY_GAPS
-				+ ih
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
+horizgrid(Monitor *m)
+{
+	layoutmonitor(m, layout_horizgrid);
 }
 #endif // PATCH_LAYOUT_HORIZGRID
 
 #if PATCH_LAYOUT_NROWGRID
+void
+nrowgrid(Monitor *m)
+{
+	layoutmonitor(m, layout_nrowgrid);
+}
+#endif // PATCH_LAYOUT_NROWGRID
+
+static void
+tile(Monitor *m)
+{
+	layoutmonitor(m, layout_tile);
+}
+
 /*
- * nrowgrid layout + gaps
- * https://dwm.suckless.org/patches/nrowgrid/
+ * Layout result cache
+ *
+ * Replays the geometry last requested for the monitor's (or, with pertag, the
+ * tag's) tiled clients while nothing the layout functions read has changed;
+ * it goes through resize() again, so the size hints apply as they did.
  */
 void
-nrowgrid(Monitor *m)
+arrangelayout(Monitor *m)
 {
-	unsigned int n;
-	int ri = 0, ci = 0;  /* counters */
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	unsigned int cx, cy, cw, ch;                /* client geometry */
-	unsigned int uw = 0, uh = 0, uc = 0;        /* utilization trackers */
-	unsigned int cols, rows = m->nmaster + 1;
+	unsigned int i;
+	int hit = 0;
+	LayoutInputs in;
+	LayoutClientInputs cin;
+	LayoutCacheClient *lcc;
+	LayoutCache *lc;
 	Client *c;
 
-	/* count clients */
-	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
-	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
-	#endif // PATCH_VANITY_GAPS
-
-	/* nothing to do here */
-	if (n == 0)
+	// monocle sizes clients from the stack rather than the tiled list;
+	if (m->lt[m->sellt]->arrange == monocle) {
+		monocle(m);
 		return;
+	}
 
-	/* force 2 clients to always split vertically */
-	if (FORCE_VSPLIT && n == 2)
-		rows = 1;
-
-	/* never allow empty rows */
-	if (n < rows)
-		rows = n;
-
-	/* define first row */
-	cols = n / rows;
-	uc = cols;
-	cy = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	ch = (m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv*(rows - 1)
-		#endif // PATCH_VANITY_GAPS
-	) / rows;
-	uh = ch;
+	#if PATCH_PERTAG
+	lc = &m->pertag->ltcaches[m->pertag->curtag];
+	#else // NO PATCH_PERTAG
+	lc = &m->ltcache;
+	#endif // PATCH_PERTAG
 
-	for (c = nexttiled(m->clients); c; c = nexttiled(c->next), ci++) {
-		if (ci == cols) {
-			uw = 0;
-			ci = 0;
-			ri++;
+	getlayoutinputs(m, &in);
+	if (lc->valid && !memcmp(&in, &lc->in, sizeof in)) {
+		for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
+			getlayoutclientinputs(c, &cin);
+			if (memcmp(&cin, &lc->clients[i].in, sizeof cin))
+				break;
+		}
+		hit = !c;
+	}
 
-			/* next row */
-			cols = (n - uc) / (rows - ri);
-			uc += cols;
-			cy = m->wy + uh
-				#if PATCH_VANITY_GAPS
-				+ ov + iv
-				#endif // PATCH_VANITY_GAPS
-			;
-			uh += ch
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			;
+	if (hit) {
+		for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
+			lcc = &lc->clients[i];
+			resize(c, lcc->x, lcc->y, lcc->w, lcc->h, 0);
 		}
+		memcpy(m->ltsymbol, lc->ltsymbol, sizeof m->ltsymbol);
+		layouts_cached++;
+		return;
+	}
 
-		cx = m->wx + uw
-			#if PATCH_VANITY_GAPS
-			+ oh
-			#endif // PATCH_VANITY_GAPS
-		;
-		cw = (m->ww
-			#if PATCH_VANITY_GAPS
-			- 2*oh
-			#endif // PATCH_VANITY_GAPS
-			- uw) / (cols - ci);
-		uw += cw
-			#if PATCH_VANITY_GAPS
-			+ ih
-			#endif // PATCH_VANITY_GAPS
-		;
+	lc->valid = 0;
+	if (in.n > lc->size) {
+		free(lc->clients);
+		lc->clients = ecalloc(in.n, sizeof(LayoutCacheClient));
+		lc->size = in.n;
+	}
+	else
+		memset(lc->clients, 0, lc->size * sizeof(LayoutCacheClient));
+
+	layoutrecording = lc;
+	m->lt[m->sellt]->arrange(m);
+	layoutrecording = NULL;
+	layouts_computed++;
 
-		resize(c, cx, cy, cw - (2*c->bw), ch - (2*c->bw), 0);
+	// the inputs are taken after, as resize() may refresh the size hints;
+	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
+		lcc = &lc->clients[i];
+		// layouts placing clients other than through layoutplace() aren't cached;
+		if (!lcc->placed)
+			return;
+		getlayoutclientinputs(c, &lcc->in);
 	}
+	lc->in = in;
+	memcpy(lc->ltsymbol, m->ltsymbol, sizeof lc->ltsymbol);
+	lc->valid = 1;
 }
-#endif // PATCH_LAYOUT_NROWGRID
 
-/*
- * Default tile layout + gaps
- */
-static void
-tile(Monitor *m)
+void
+getlayoutclientinputs(Client *c, LayoutClientInputs *in)
 {
-	unsigned int i, n;
-	#if PATCH_VANITY_GAPS
-	int oh, ov, ih, iv;
-	#endif // PATCH_VANITY_GAPS
-	int mx = 0, my = 0, mh = 0, mw = 0;
-	int sx = 0, sy = 0, sh = 0, sw = 0;
-	float mfacts, sfacts;
-	int mrest, srest;
-	Client *c;
+	// zeroed so that padding compares equal;
+	memset(in, 0, sizeof(LayoutClientInputs));
+	in->c = c;
+	in->win = c->win;
+	in->bw = c->bw;
+	in->isfullscreen = c->isfullscreen;
+	in->hintsvalid = c->hintsvalid;
+	in->basew = c->basew;
+	in->baseh = c->baseh;
+	in->incw = c->incw;
+	in->inch = c->inch;
+	in->maxw = c->maxw;
+	in->maxh = c->maxh;
+	in->minw = c->minw;
+	in->minh = c->minh;
+	in->mina = c->mina;
+	in->maxa = c->maxa;
+	#if PATCH_CFACTS
+	in->cfact = c->cfact;
+	#endif // PATCH_CFACTS
+}
 
+void
+getlayoutinputs(Monitor *m, LayoutInputs *in)
+{
+	// zeroed so that padding compares equal;
+	memset(in, 0, sizeof(LayoutInputs));
+	in->arrange = m->lt[m->sellt]->arrange;
+	in->mfact = m->mfact;
+	in->nmaster = m->nmaster;
+	#if PATCH_MIRROR_LAYOUT
+	in->mirror = m->mirror;
+	#endif // PATCH_MIRROR_LAYOUT
+	in->wx = m->wx;
+	in->wy = m->wy;
+	in->ww = m->ww;
+	in->wh = m->wh;
 	#if PATCH_VANITY_GAPS
-	getgaps(m, &oh, &ov, &ih, &iv, &n);
+	getgaps(m, &in->oh, &in->ov, &in->ih, &in->iv, &in->n);
 	#else // NO PATCH_VANITY_GAPS
-	tilecount(m, &n);
+	tilecount(m, &in->n);
 	#endif // PATCH_VANITY_GAPS
-	if (n == 0)
-		return;
-
-	sx = mx = m->wx
-		#if PATCH_VANITY_GAPS
-		+ oh
-		#endif // PATCH_VANITY_GAPS
-	;
-	sy = my = m->wy
-		#if PATCH_VANITY_GAPS
-		+ ov
-		#endif // PATCH_VANITY_GAPS
-	;
-	mh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (MIN(n, m->nmaster) - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	sh = m->wh
-		#if PATCH_VANITY_GAPS
-		- 2*ov - iv * (n - m->nmaster - 1)
-		#endif // PATCH_VANITY_GAPS
-	;
-	sw = mw = m->ww
-		#if PATCH_VANITY_GAPS
-		- 2*oh
-		#endif // PATCH_VANITY_GAPS
-	;
-
-	if (m->nmaster && n > m->nmaster) {
-		sw = (
-			mw
-			#if PATCH_VANITY_GAPS
-			- ih
-			#endif // PATCH_VANITY_GAPS
-		) * (1 - m->mfact);
-		mw = mw - sw
-			#if PATCH_VANITY_GAPS
-			- ih
-			#endif // PATCH_VANITY_GAPS
-		;
-		#if PATCH_MIRROR_LAYOUT
-		if (m->mirror) {
-			mx = m->wx + m->ww - mw
-				#if PATCH_VANITY_GAPS
-				- oh
-				#endif // PATCH_VANITY_GAPS
-			;
-			sx = m->wx
-				#if PATCH_VANITY_GAPS
-				+ oh
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
-		else
-		#endif // PATCH_MIRROR_LAYOUT
-		sx = mx + mw
-			#if PATCH_VANITY_GAPS
-			+ ih
-			#endif // PATCH_VANITY_GAPS
-		;
-	}
-
-	getfacts(m, mh, sh, &mfacts, &sfacts, &mrest, &srest);
-
-	for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
-		if (i < m->nmaster) {
-			resize(c, mx, my, mw - (2*c->bw), mh * (
-				#if PATCH_CFACTS
-				c->cfact / mfacts
-				#else // NO PATCH_CFACTS
-				1 / mfacts
-				#endif // PATCH_CFACTS
-			) + (i < mrest ? 1 : 0) - (2*c->bw), 0);
-			my += HEIGHT(c)
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			;
-		} else {
-			resize(c, sx, sy, sw - (2*c->bw), sh * (
-				#if PATCH_CFACTS
-				c->cfact / sfacts
-				#else // NO PATCH_CFACTS
-				1 / sfacts
-				#endif // PATCH_CFACTS
-			) + ((i - m->nmaster) < srest ? 1 : 0) - (2*c->bw), 0);
-			sy += HEIGHT(c)
-				#if PATCH_VANITY_GAPS
-				+ iv
-				#endif // PATCH_VANITY_GAPS
-			;
-		}
-}
\ No newline at end of file
+	in->bh = bh;
+	in->minbh = minbh;
+}
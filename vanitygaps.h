@@ -29,9 +29,6 @@ static void deck(Monitor *m);
 #if PATCH_LAYOUT_DWINDLE
 static void dwindle(Monitor *m);
 #endif // PATCH_LAYOUT_DWINDLE
-#if PATCH_LAYOUT_DWINDLE || PATCH_LAYOUT_SPIRAL
-static void fibonacci(Monitor *m, int s);
-#endif // PATCH_LAYOUT_DWINDLE || PATCH_LAYOUT_SPIRAL
 #if PATCH_LAYOUT_GAPLESSGRID
 static void gaplessgrid(Monitor *m);
 #endif // PATCH_LAYOUT_GAPLESSGRID
@@ -49,7 +46,11 @@ static void spiral(Monitor *m);
 #endif // PATCH_LAYOUT_SPIRAL
 static void tile(Monitor *m);
 /* Internals */
-static void getfacts(Monitor *m, int msize, int ssize, float *mf, float *sf, int *mr, int *sr);
+static void arrangelayout(Monitor *m);
+static void getlayoutclientinputs(Client *c, LayoutClientInputs *in);
+static void getlayoutinputs(Monitor *m, LayoutInputs *in);
+static void layoutmonitor(Monitor *m, LayoutFunc func);
+static void layoutplace(LayoutParams *p, LayoutClient *lc);
 #if PATCH_VANITY_GAPS
 static void getgaps(Monitor *m, int *oh, int *ov, int *ih, int *iv, unsigned int *nc);
 static void setgaps(int oh, int ov, int ih, int iv);